@@ -0,0 +1,798 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Benchmark
+ *
+ * Renders a fixed set of procedurally generated scenes, each stressing a
+ * different part of the renderer, and reports timings as JSON. Scenes are
+ * generated from a fixed seed so reports of different builds can be compared,
+ * see cycles_bench_compare.py. */
+
+#include <stdio.h>
+
+#ifndef _WIN32
+#  include <sys/resource.h>
+#endif
+
+#include "buffers.h"
+#include "camera.h"
+#include "device.h"
+#include "graph.h"
+#include "integrator.h"
+#include "light.h"
+#include "mesh.h"
+#include "nodes.h"
+#include "object.h"
+#include "scene.h"
+#include "session.h"
+#include "shader.h"
+
+#include "util_args.h"
+#include "util_foreach.h"
+#include "util_function.h"
+#include "util_hash.h"
+#include "util_logging.h"
+#include "util_path.h"
+#include "util_progress.h"
+#include "util_string.h"
+#include "util_system.h"
+#include "util_time.h"
+#include "util_transform.h"
+#include "util_version.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Random Numbers
+ *
+ * Hash based, so scenes don't depend on the order in which they are
+ * generated. */
+
+class BenchRandom {
+public:
+	explicit BenchRandom(uint seed_) : seed(seed_), index(0) {}
+
+	float get()
+	{
+		return (float)hash_int_2d(seed, index++) * (1.0f/(float)0xFFFFFFFF);
+	}
+
+	float get(float min, float max)
+	{
+		return min + get()*(max - min);
+	}
+
+protected:
+	uint seed;
+	uint index;
+};
+
+/* Scene Building */
+
+static Shader *bench_add_shader(Scene *scene,
+                                const char *name,
+                                ShaderGraph *graph)
+{
+	Shader *shader = new Shader();
+	shader->name = name;
+	shader->set_graph(graph);
+	scene->shaders.push_back(shader);
+	shader->tag_update(scene);
+
+	return shader;
+}
+
+static Shader *bench_add_closure_shader(Scene *scene,
+                                        const char *name,
+                                        ShaderNode *node,
+                                        const char *output)
+{
+	ShaderGraph *graph = new ShaderGraph();
+	graph->add(node);
+	graph->connect(node->output(output), graph->output()->input("Surface"));
+
+	return bench_add_shader(scene, name, graph);
+}
+
+static Shader *bench_add_diffuse_shader(Scene *scene, float3 color)
+{
+	DiffuseBsdfNode *diffuse = new DiffuseBsdfNode();
+	diffuse->color = color;
+
+	return bench_add_closure_shader(scene, "diffuse", diffuse, "BSDF");
+}
+
+static Shader *bench_add_emission_shader(Scene *scene, float3 color, float strength)
+{
+	EmissionNode *emission = new EmissionNode();
+	emission->color = color;
+	emission->strength = strength;
+
+	return bench_add_closure_shader(scene, "emission", emission, "Emission");
+}
+
+static void bench_set_background(Scene *scene, float3 color)
+{
+	ShaderGraph *graph = new ShaderGraph();
+
+	BackgroundNode *background = new BackgroundNode();
+	background->color = color;
+	graph->add(background);
+	graph->connect(background->output("Background"), graph->output()->input("Surface"));
+
+	Shader *shader = scene->default_background;
+	shader->set_graph(graph);
+	shader->tag_update(scene);
+}
+
+static Mesh *bench_add_mesh(Scene *scene, Shader *shader)
+{
+	Mesh *mesh = new Mesh();
+	mesh->used_shaders.push_back(shader);
+	scene->meshes.push_back(mesh);
+
+	return mesh;
+}
+
+static void bench_add_object(Scene *scene, Mesh *mesh, const Transform& tfm)
+{
+	Object *object = new Object();
+	object->mesh = mesh;
+	object->tfm = tfm;
+	scene->objects.push_back(object);
+}
+
+static void bench_add_light(Scene *scene, LightType type, float3 co, float3 dir, float size, Shader *shader)
+{
+	Light *light = new Light();
+	light->type = type;
+	light->co = co;
+	light->dir = dir;
+	light->size = size;
+	light->shader = shader;
+	light->use_mis = true;
+	scene->lights.push_back(light);
+}
+
+/* Square in the XY plane. */
+static void bench_mesh_plane(Mesh *mesh, float size)
+{
+	mesh->reserve_mesh(4, 2);
+
+	mesh->add_vertex(make_float3(-size, -size, 0.0f));
+	mesh->add_vertex(make_float3(size, -size, 0.0f));
+	mesh->add_vertex(make_float3(size, size, 0.0f));
+	mesh->add_vertex(make_float3(-size, size, 0.0f));
+
+	mesh->add_triangle(0, 1, 2, 0, false);
+	mesh->add_triangle(0, 2, 3, 0, false);
+}
+
+static void bench_mesh_box(Mesh *mesh, float3 bmin, float3 bmax)
+{
+	static const int faces[6][4] = {{0, 2, 3, 1}, {4, 5, 7, 6}, {0, 1, 5, 4},
+	                                {2, 6, 7, 3}, {0, 4, 6, 2}, {1, 3, 7, 5}};
+
+	mesh->reserve_mesh(8, 12);
+
+	for(int i = 0; i < 8; i++) {
+		mesh->add_vertex(make_float3((i & 1)? bmax.x: bmin.x,
+		                             (i & 2)? bmax.y: bmin.y,
+		                             (i & 4)? bmax.z: bmin.z));
+	}
+
+	for(int i = 0; i < 6; i++) {
+		mesh->add_triangle(faces[i][0], faces[i][1], faces[i][2], 0, false);
+		mesh->add_triangle(faces[i][0], faces[i][2], faces[i][3], 0, false);
+	}
+}
+
+static void bench_mesh_sphere(Mesh *mesh, float3 center, float radius, int segments, int rings)
+{
+	int vert_offset = mesh->verts.size();
+
+	mesh->reserve_mesh(vert_offset + (rings + 1)*segments,
+	                   mesh->num_triangles() + rings*segments*2);
+
+	for(int r = 0; r <= rings; r++) {
+		float theta = M_PI_F*r/rings;
+
+		for(int s = 0; s < segments; s++) {
+			float phi = M_2PI_F*s/segments;
+			float3 N = make_float3(sinf(theta)*cosf(phi), sinf(theta)*sinf(phi), cosf(theta));
+
+			mesh->add_vertex(center + N*radius);
+		}
+	}
+
+	for(int r = 0; r < rings; r++) {
+		for(int s = 0; s < segments; s++) {
+			int v0 = vert_offset + r*segments + s;
+			int v1 = vert_offset + r*segments + (s + 1) % segments;
+			int v2 = v0 + segments;
+			int v3 = v1 + segments;
+
+			mesh->add_triangle(v0, v2, v3, 0, true);
+			mesh->add_triangle(v0, v3, v1, 0, true);
+		}
+	}
+}
+
+static void bench_camera(Scene *scene, float3 eye, float3 target)
+{
+	float3 forward = normalize(target - eye);
+	float3 right = normalize(cross(make_float3(0.0f, 0.0f, 1.0f), forward));
+	float3 up = cross(forward, right);
+
+	Camera *camera = scene->camera;
+	camera->matrix = make_transform(right.x, up.x, forward.x, eye.x,
+	                                right.y, up.y, forward.y, eye.y,
+	                                right.z, up.z, forward.z, eye.z,
+	                                0.0f, 0.0f, 0.0f, 1.0f);
+	camera->need_update = true;
+}
+
+/* Scenes */
+
+/* Ten thousand instances of a sphere on a ground plane, lit by the sun. */
+static void bench_scene_instances(Scene *scene)
+{
+	BenchRandom rng(1);
+
+	Mesh *ground = bench_add_mesh(scene, bench_add_diffuse_shader(scene, make_float3(0.5f, 0.5f, 0.5f)));
+	bench_mesh_plane(ground, 60.0f);
+	bench_add_object(scene, ground, transform_identity());
+
+	Mesh *sphere = bench_add_mesh(scene, bench_add_diffuse_shader(scene, make_float3(0.8f, 0.3f, 0.2f)));
+	bench_mesh_sphere(sphere, make_float3(0.0f, 0.0f, 0.0f), 1.0f, 32, 16);
+
+	for(int y = 0; y < 100; y++) {
+		for(int x = 0; x < 100; x++) {
+			float scale = rng.get(0.1f, 0.4f);
+			float3 co = make_float3(x - 50.0f + rng.get(), y - 50.0f + rng.get(), scale);
+
+			bench_add_object(scene, sphere,
+			                 transform_translate(co) *
+			                 transform_rotate(rng.get(0.0f, M_2PI_F), make_float3(0.0f, 0.0f, 1.0f)) *
+			                 transform_scale(make_float3(scale, scale, scale)));
+		}
+	}
+
+	Shader *sun = bench_add_emission_shader(scene, make_float3(1.0f, 0.95f, 0.9f), 3.0f);
+	bench_add_light(scene, LIGHT_DISTANT, make_float3(0.0f, 0.0f, 0.0f),
+	                normalize(make_float3(-0.3f, 0.4f, -1.0f)), 0.05f, sun);
+
+	bench_set_background(scene, make_float3(0.2f, 0.25f, 0.3f));
+	bench_camera(scene, make_float3(-20.0f, -30.0f, 12.0f), make_float3(0.0f, 0.0f, 0.0f));
+}
+
+/* A hundred thousand curly hairs on a sphere. */
+static void bench_scene_hair(Scene *scene)
+{
+	BenchRandom rng(2);
+	const int num_hairs = 100000;
+	const int num_keys = 8;
+
+	Mesh *head = bench_add_mesh(scene, bench_add_diffuse_shader(scene, make_float3(0.6f, 0.45f, 0.35f)));
+	bench_mesh_sphere(head, make_float3(0.0f, 0.0f, 0.0f), 1.0f, 64, 32);
+	bench_add_object(scene, head, transform_identity());
+
+	Mesh *hair = bench_add_mesh(scene, bench_add_closure_shader(scene, "hair", new HairBsdfNode(), "BSDF"));
+	hair->reserve_curves(num_hairs, num_hairs*num_keys);
+
+	for(int i = 0; i < num_hairs; i++) {
+		float z = rng.get(-1.0f, 1.0f);
+		float phi = rng.get(0.0f, M_2PI_F);
+		float r = sqrtf(max(1.0f - z*z, 0.0f));
+		float3 N = make_float3(r*cosf(phi), r*sinf(phi), z);
+		Transform frame = make_transform_frame(N);
+		float curl = rng.get(0.0f, M_2PI_F);
+		float length = rng.get(0.4f, 0.8f);
+
+		int first_key = hair->curve_keys.size();
+
+		for(int k = 0; k < num_keys; k++) {
+			float t = (float)k/(num_keys - 1);
+			float3 offset = make_float3(cosf(curl + t*8.0f), sinf(curl + t*8.0f), 0.0f)*0.05f*t;
+			float3 co = N*(1.0f + t*length) + transform_direction(&frame, offset);
+
+			hair->add_curve_key(co, 0.004f*(1.0f - t) + 0.0005f);
+		}
+
+		hair->add_curve(first_key, 0);
+	}
+
+	bench_add_object(scene, hair, transform_identity());
+
+	Shader *sun = bench_add_emission_shader(scene, make_float3(1.0f, 1.0f, 1.0f), 3.0f);
+	bench_add_light(scene, LIGHT_DISTANT, make_float3(0.0f, 0.0f, 0.0f),
+	                normalize(make_float3(0.5f, 1.0f, -0.5f)), 0.05f, sun);
+
+	bench_set_background(scene, make_float3(0.3f, 0.3f, 0.3f));
+	bench_camera(scene, make_float3(0.0f, -5.0f, 0.5f), make_float3(0.0f, 0.0f, 0.0f));
+}
+
+/* Spheres with subsurface scattering, lit by a small light. */
+static void bench_scene_subsurface(Scene *scene)
+{
+	Mesh *ground = bench_add_mesh(scene, bench_add_diffuse_shader(scene, make_float3(0.5f, 0.5f, 0.5f)));
+	bench_mesh_plane(ground, 20.0f);
+	bench_add_object(scene, ground, transform_identity());
+
+	SubsurfaceScatteringNode *subsurface = new SubsurfaceScatteringNode();
+	subsurface->color = make_float3(0.9f, 0.6f, 0.5f);
+	subsurface->scale = 0.5f;
+	subsurface->radius = make_float3(1.0f, 0.4f, 0.2f);
+
+	Mesh *spheres = bench_add_mesh(scene, bench_add_closure_shader(scene, "subsurface", subsurface, "BSSRDF"));
+
+	for(int y = 0; y < 3; y++) {
+		for(int x = 0; x < 3; x++) {
+			bench_mesh_sphere(spheres, make_float3(x*2.5f - 2.5f, y*2.5f - 2.5f, 1.0f), 1.0f, 64, 32);
+		}
+	}
+
+	bench_add_object(scene, spheres, transform_identity());
+
+	Shader *light = bench_add_emission_shader(scene, make_float3(1.0f, 1.0f, 1.0f), 500.0f);
+	bench_add_light(scene, LIGHT_POINT, make_float3(0.0f, 6.0f, 6.0f), make_float3(0.0f, 0.0f, 0.0f), 0.5f, light);
+
+	bench_set_background(scene, make_float3(0.05f, 0.05f, 0.05f));
+	bench_camera(scene, make_float3(0.0f, -9.0f, 6.0f), make_float3(0.0f, 0.0f, 0.5f));
+}
+
+/* Heterogeneous scattering volume in a box, lit from inside and outside. */
+static void bench_scene_volume(Scene *scene)
+{
+	Mesh *ground = bench_add_mesh(scene, bench_add_diffuse_shader(scene, make_float3(0.5f, 0.5f, 0.5f)));
+	bench_mesh_plane(ground, 20.0f);
+	bench_add_object(scene, ground, transform_identity());
+
+	ShaderGraph *graph = new ShaderGraph();
+
+	TextureCoordinateNode *texco = new TextureCoordinateNode();
+	graph->add(texco);
+
+	NoiseTextureNode *noise = new NoiseTextureNode();
+	noise->scale = 2.0f;
+	noise->detail = 4.0f;
+	graph->add(noise);
+
+	ScatterVolumeNode *scatter = new ScatterVolumeNode();
+	scatter->anisotropy = 0.3f;
+	graph->add(scatter);
+
+	graph->connect(texco->output("Object"), noise->input("Vector"));
+	graph->connect(noise->output("Fac"), scatter->input("Density"));
+	graph->connect(scatter->output("Volume"), graph->output()->input("Volume"));
+
+	Mesh *box = bench_add_mesh(scene, bench_add_shader(scene, "volume", graph));
+	bench_mesh_box(box, make_float3(-2.0f, -2.0f, 0.0f), make_float3(2.0f, 2.0f, 4.0f));
+	bench_add_object(scene, box, transform_identity());
+
+	Shader *light = bench_add_emission_shader(scene, make_float3(1.0f, 0.7f, 0.4f), 200.0f);
+	bench_add_light(scene, LIGHT_POINT, make_float3(0.0f, 0.0f, 2.0f), make_float3(0.0f, 0.0f, 0.0f), 0.2f, light);
+
+	Shader *sun = bench_add_emission_shader(scene, make_float3(0.8f, 0.9f, 1.0f), 2.0f);
+	bench_add_light(scene, LIGHT_DISTANT, make_float3(0.0f, 0.0f, 0.0f),
+	                normalize(make_float3(0.4f, 0.3f, -1.0f)), 0.05f, sun);
+
+	bench_set_background(scene, make_float3(0.05f, 0.05f, 0.1f));
+	bench_camera(scene, make_float3(0.0f, -9.0f, 4.0f), make_float3(0.0f, 0.0f, 2.0f));
+}
+
+/* A thousand small colored lights over a field of spheres. */
+static void bench_scene_lights(Scene *scene)
+{
+	BenchRandom rng(5);
+	const int num_colors = 8;
+	const int num_lights = 1024;
+
+	Mesh *ground = bench_add_mesh(scene, bench_add_diffuse_shader(scene, make_float3(0.5f, 0.5f, 0.5f)));
+	bench_mesh_plane(ground, 30.0f);
+	bench_add_object(scene, ground, transform_identity());
+
+	Mesh *spheres = bench_add_mesh(scene, bench_add_diffuse_shader(scene, make_float3(0.8f, 0.8f, 0.8f)));
+
+	for(int y = 0; y < 8; y++) {
+		for(int x = 0; x < 8; x++) {
+			bench_mesh_sphere(spheres, make_float3(x*6.0f - 21.0f, y*6.0f - 21.0f, 1.0f), 1.0f, 32, 16);
+		}
+	}
+
+	bench_add_object(scene, spheres, transform_identity());
+
+	Shader *colors[num_colors];
+
+	for(int i = 0; i < num_colors; i++) {
+		float3 color = make_float3(rng.get(0.2f, 1.0f), rng.get(0.2f, 1.0f), rng.get(0.2f, 1.0f));
+		colors[i] = bench_add_emission_shader(scene, color, 20.0f);
+	}
+
+	for(int i = 0; i < num_lights; i++) {
+		float3 co = make_float3(rng.get(-25.0f, 25.0f), rng.get(-25.0f, 25.0f), rng.get(0.5f, 4.0f));
+		bench_add_light(scene, LIGHT_POINT, co, make_float3(0.0f, 0.0f, 0.0f), 0.05f, colors[i % num_colors]);
+	}
+
+	/* sampling all lights would dominate the render time */
+	scene->integrator->sample_all_lights_direct = false;
+	scene->integrator->sample_all_lights_indirect = false;
+	scene->integrator->use_light_tree = true;
+	scene->integrator->tag_update(scene);
+
+	bench_set_background(scene, make_float3(0.01f, 0.01f, 0.01f));
+	bench_camera(scene, make_float3(0.0f, -35.0f, 15.0f), make_float3(0.0f, 0.0f, 0.0f));
+}
+
+struct BenchScene {
+	const char *name;
+	void (*create)(Scene *scene);
+};
+
+static const BenchScene bench_scenes[] = {
+	{"instances", bench_scene_instances},
+	{"hair", bench_scene_hair},
+	{"subsurface", bench_scene_subsurface},
+	{"volume", bench_scene_volume},
+	{"lights", bench_scene_lights},
+};
+
+/* Running */
+
+struct BenchOptions {
+	SessionParams session_params;
+	SceneParams scene_params;
+	int width, height;
+	float time_limit;
+	string scenes;
+	string output;
+	string label;
+	string bvh_layout;
+	bool quiet;
+};
+
+struct BenchResult {
+	string name;
+	double create_time;
+	double update_time;
+	double bvh_build_time;
+	double render_time;
+	uint64_t pixel_samples;
+	uint64_t num_rays;
+	size_t mem_peak;
+	bool cancelled;
+};
+
+static void bench_write_render_tile(RenderTile& /*rtile*/)
+{
+	/* pixels are not needed, tiles are only written to free their buffers */
+}
+
+static void bench_check_time_limit(Progress *progress, float time_limit)
+{
+	double total_time, render_time;
+	progress->get_time(total_time, render_time);
+
+	if(render_time > time_limit)
+		progress->set_cancel("Time limit reached");
+}
+
+static BenchResult bench_run(const BenchScene& bench, const BenchOptions& options)
+{
+	BenchResult result;
+	result.name = bench.name;
+
+	Session *session = new Session(options.session_params);
+	session->write_render_tile_cb = function_bind(&bench_write_render_tile, _1);
+
+	if(options.time_limit > 0.0f) {
+		session->progress.set_cancel_callback(function_bind(&bench_check_time_limit,
+		                                                    &session->progress,
+		                                                    options.time_limit));
+	}
+
+	/* create scene */
+	double create_start_time = time_dt();
+
+	Scene *scene = new Scene(options.scene_params, options.session_params.device);
+	bench.create(scene);
+
+	scene->camera->width = options.width;
+	scene->camera->height = options.height;
+	scene->camera->full_width = options.width;
+	scene->camera->full_height = options.height;
+	scene->camera->compute_auto_viewplane();
+
+	result.create_time = time_dt() - create_start_time;
+
+	/* render */
+	BufferParams buffer_params;
+	buffer_params.width = options.width;
+	buffer_params.height = options.height;
+	buffer_params.full_width = options.width;
+	buffer_params.full_height = options.height;
+
+	session->scene = scene;
+	session->reset(buffer_params, options.session_params.samples);
+	session->start();
+	session->wait();
+
+	double total_time;
+	session->progress.get_time(total_time, result.render_time);
+
+	result.cancelled = session->progress.get_cancel();
+	result.update_time = scene->update_time;
+	result.bvh_build_time = scene->bvh_build_time;
+	result.pixel_samples = (uint64_t)((double)session->progress.get_progress() *
+	                                  options.width * options.height *
+	                                  options.session_params.samples);
+	result.num_rays = session->stats.num_rays;
+	result.mem_peak = session->stats.mem_peak;
+
+	if(session->progress.get_error())
+		fprintf(stderr, "%s: %s\n", bench.name, session->progress.get_error_message().c_str());
+
+	/* also frees the scene */
+	delete session;
+
+	return result;
+}
+
+static size_t bench_process_mem_peak()
+{
+#ifndef _WIN32
+	struct rusage usage;
+
+	if(getrusage(RUSAGE_SELF, &usage) == 0) {
+#  ifdef __APPLE__
+		return usage.ru_maxrss;
+#  else
+		return (size_t)usage.ru_maxrss*1024;
+#  endif
+	}
+#endif
+	return 0;
+}
+
+static string bench_json_string(const string& str)
+{
+	string result = "\"";
+
+	foreach(char c, str) {
+		if(c == '"' || c == '\\')
+			result += '\\';
+		if((unsigned char)c >= 0x20)
+			result += c;
+	}
+
+	return result + "\"";
+}
+
+static string bench_report(const BenchOptions& options, const vector<BenchResult>& results)
+{
+	string report = "{\n";
+
+	report += "\t\"label\": " + bench_json_string(options.label) + ",\n";
+	report += "\t\"version\": " + bench_json_string(CYCLES_VERSION_STRING) + ",\n";
+	report += "\t\"device\": " + bench_json_string(options.session_params.device.description) + ",\n";
+	report += "\t\"cpu\": " + bench_json_string(system_cpu_brand_string()) + ",\n";
+	report += string_printf("\t\"threads\": %d,\n", TaskScheduler::num_threads());
+	report += "\t\"bvh_layout\": " + bench_json_string(options.bvh_layout) + ",\n";
+#ifdef WITH_CYCLES_RAY_STATS
+	/* rays are only counted by the CPU device */
+	const bool rays_counted = (options.session_params.device.type == DEVICE_CPU);
+#else
+	const bool rays_counted = false;
+#endif
+	report += string_printf("\t\"rays_counted\": %s,\n", rays_counted? "true": "false");
+	report += string_printf("\t\"width\": %d,\n", options.width);
+	report += string_printf("\t\"height\": %d,\n", options.height);
+	report += string_printf("\t\"samples\": %d,\n", options.session_params.samples);
+	report += string_printf("\t\"time_limit\": %.3f,\n", options.time_limit);
+	report += string_printf("\t\"process_peak_memory\": %llu,\n",
+	                        (unsigned long long)bench_process_mem_peak());
+	report += "\t\"scenes\": [\n";
+
+	for(size_t i = 0; i < results.size(); i++) {
+		const BenchResult& result = results[i];
+		double render_time = max(result.render_time, 1e-6);
+
+		report += "\t\t{\n";
+		report += "\t\t\t\"name\": " + bench_json_string(result.name) + ",\n";
+		report += string_printf("\t\t\t\"create_time\": %.4f,\n", result.create_time);
+		report += string_printf("\t\t\t\"sync_time\": %.4f,\n", result.update_time);
+		report += string_printf("\t\t\t\"bvh_build_time\": %.4f,\n", result.bvh_build_time);
+		report += string_printf("\t\t\t\"render_time\": %.4f,\n", result.render_time);
+		report += string_printf("\t\t\t\"pixel_samples\": %llu,\n", (unsigned long long)result.pixel_samples);
+		report += string_printf("\t\t\t\"samples_per_second\": %.1f,\n", result.pixel_samples/render_time);
+		report += string_printf("\t\t\t\"rays\": %llu,\n", (unsigned long long)result.num_rays);
+		report += string_printf("\t\t\t\"rays_per_second\": %.1f,\n", result.num_rays/render_time);
+		report += string_printf("\t\t\t\"device_peak_memory\": %llu,\n", (unsigned long long)result.mem_peak);
+		report += string_printf("\t\t\t\"time_limit_reached\": %s\n", result.cancelled? "true": "false");
+		report += (i + 1 < results.size())? "\t\t},\n": "\t\t}\n";
+	}
+
+	report += "\t]\n}\n";
+
+	return report;
+}
+
+static void options_parse(int argc, const char **argv, BenchOptions& options)
+{
+	options.width = 960;
+	options.height = 540;
+	options.time_limit = 0.0f;
+	options.quiet = false;
+	options.bvh_layout = "bvh2";
+	options.session_params.samples = 16;
+
+	string devicename = "CPU";
+	bool list = false, help = false, debug = false, version = false;
+	int verbosity = 1;
+
+	ArgParse ap;
+
+	ap.options ("Usage: cycles_bench [options]",
+		"--device %s", &devicename, "Device to use, the CPU by default",
+		"--threads %d", &options.session_params.threads, "CPU rendering threads",
+		"--samples %d", &options.session_params.samples, "Number of samples to render per scene",
+		"--time-limit %f", &options.time_limit, "Stop rendering a scene after this many seconds",
+		"--width %d", &options.width, "Image width in pixels",
+		"--height %d", &options.height, "Image height in pixels",
+		"--tile-width %d", &options.session_params.tile_size.x, "Tile width in pixels",
+		"--tile-height %d", &options.session_params.tile_size.y, "Tile height in pixels",
+		"--bvh-layout %s", &options.bvh_layout, "BVH layout for the CPU device: bvh2, qbvh or obvh, bvh2 by default",
+		"--scenes %s", &options.scenes, "Comma separated names of scenes to render, all by default",
+		"--output %s", &options.output, "File path to write the JSON report, printed by default",
+		"--label %s", &options.label, "Label stored in the report, to identify the build",
+		"--quiet", &options.quiet, "Don't print progress messages",
+		"--list", &list, "List the scenes",
+#ifdef WITH_CYCLES_LOGGING
+		"--debug", &debug, "Enable debug logging",
+		"--verbose %d", &verbosity, "Set verbosity of the logger",
+#endif
+		"--help", &help, "Print help message",
+		"--version", &version, "Print version number",
+		NULL);
+
+	if(ap.parse(argc, argv) < 0) {
+		fprintf(stderr, "%s\n", ap.geterror().c_str());
+		ap.usage();
+		exit(EXIT_FAILURE);
+	}
+
+	if(debug) {
+		util_logging_start();
+		util_logging_verbosity_set(verbosity);
+	}
+
+	if(list) {
+		for(size_t i = 0; i < sizeof(bench_scenes)/sizeof(*bench_scenes); i++)
+			printf("%s\n", bench_scenes[i].name);
+		exit(EXIT_SUCCESS);
+	}
+	else if(help) {
+		ap.usage();
+		exit(EXIT_SUCCESS);
+	}
+	else if(version) {
+		printf("%s\n", CYCLES_VERSION_STRING);
+		exit(EXIT_SUCCESS);
+	}
+
+	/* find matching device */
+	DeviceType device_type = Device::type_from_string(devicename.c_str());
+	bool device_available = false;
+
+	foreach(DeviceInfo& device, Device::available_devices()) {
+		if(device_type == device.type) {
+			options.session_params.device = device;
+			device_available = true;
+			break;
+		}
+	}
+
+	if(options.session_params.device.type == DEVICE_NONE || !device_available) {
+		fprintf(stderr, "Unknown device: %s\n", devicename.c_str());
+		exit(EXIT_FAILURE);
+	}
+	else if(options.session_params.samples <= 0) {
+		fprintf(stderr, "Invalid number of samples: %d\n", options.session_params.samples);
+		exit(EXIT_FAILURE);
+	}
+	else if(options.width <= 0 || options.height <= 0) {
+		fprintf(stderr, "Invalid resolution: %dx%d\n", options.width, options.height);
+		exit(EXIT_FAILURE);
+	}
+
+	/* wide BVH layouts are only traversed by the CPU kernels that support them */
+	const bool is_cpu = (options.session_params.device.type == DEVICE_CPU);
+
+	if(options.bvh_layout == "bvh2") {
+		options.scene_params.use_qbvh = false;
+		options.scene_params.use_obvh = false;
+	}
+	else if(options.bvh_layout == "qbvh" && is_cpu && system_cpu_support_sse2()) {
+		options.scene_params.use_qbvh = true;
+		options.scene_params.use_obvh = false;
+	}
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX2
+	else if(options.bvh_layout == "obvh" && is_cpu && system_cpu_support_avx2()) {
+		options.scene_params.use_qbvh = false;
+		options.scene_params.use_obvh = true;
+	}
+#endif
+	else {
+		fprintf(stderr, "BVH layout %s is not supported by this device.\n", options.bvh_layout.c_str());
+		exit(EXIT_FAILURE);
+	}
+
+	/* final render of a fixed number of samples per tile */
+	options.session_params.background = true;
+	options.session_params.progressive = false;
+	options.session_params.progressive_refine = false;
+
+	/* same as scenes read from files */
+	options.scene_params.bvh_type = SceneParams::BVH_STATIC;
+}
+
+CCL_NAMESPACE_END
+
+using namespace ccl;
+
+int main(int argc, const char **argv)
+{
+	util_logging_init(argv[0]);
+	path_init();
+
+	BenchOptions options;
+	options_parse(argc, argv, options);
+
+	vector<string> names;
+	string_split(names, options.scenes, ",");
+
+	vector<BenchResult> results;
+
+	for(size_t i = 0; i < sizeof(bench_scenes)/sizeof(*bench_scenes); i++) {
+		const BenchScene& bench = bench_scenes[i];
+
+		if(!names.empty() && std::find(names.begin(), names.end(), bench.name) == names.end())
+			continue;
+
+		if(!options.quiet) {
+			fprintf(stderr, "Rendering %s ...\n", bench.name);
+		}
+
+		results.push_back(bench_run(bench, options));
+
+		if(!options.quiet) {
+			const BenchResult& result = results.back();
+			fprintf(stderr, "Rendered %s in %.2fs, synced in %.2fs.\n",
+			        bench.name, result.render_time, result.update_time);
+		}
+	}
+
+	string report = bench_report(options, results);
+
+	if(options.output.empty()) {
+		printf("%s", report.c_str());
+	}
+	else if(!path_write_text(options.output, report)) {
+		fprintf(stderr, "Failed to write report to %s.\n", options.output.c_str());
+		return EXIT_FAILURE;
+	}
+
+	return 0;
+}
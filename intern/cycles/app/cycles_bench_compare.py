@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+#
+# Copyright 2011-2016 Blender Foundation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Compare two reports written by cycles_bench, exits with an error code when
+# any metric regressed by more than the threshold.
+#
+#   cycles_bench --label before --output before.json
+#   cycles_bench --label after --output after.json
+#   cycles_bench_compare.py before.json after.json --threshold 5
+#
+# To compare BVH layouts, render the same build with different layouts:
+#
+#   cycles_bench --bvh-layout qbvh --output qbvh.json
+#   cycles_bench --bvh-layout obvh --output obvh.json
+#   cycles_bench_compare.py qbvh.json obvh.json
+
+import argparse
+import json
+import sys
+
+# Metric name and whether higher values are better.
+METRICS = (
+    ("create_time", False),
+    ("sync_time", False),
+    ("bvh_build_time", False),
+    ("render_time", False),
+    ("samples_per_second", True),
+    ("rays_per_second", True),
+    ("device_peak_memory", False),
+)
+
+
+def load_report(filepath):
+    with open(filepath, "r") as f:
+        report = json.load(f)
+    return report, {scene["name"]: scene for scene in report["scenes"]}
+
+
+def format_change(old, new, higher_is_better):
+    if old == 0:
+        return 0.0, "n/a"
+    change = (new - old) * 100.0 / old
+    regression = -change if higher_is_better else change
+    return regression, "%+.1f%%" % change
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two cycles_bench reports.")
+    parser.add_argument("before", help="Report of the reference build")
+    parser.add_argument("after", help="Report of the build to test")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="Regression in percent that is reported as failure")
+    parser.add_argument("--min-time", type=float, default=0.1,
+                        help="Ignore timings below this many seconds, they are too noisy")
+    args = parser.parse_args()
+
+    before, before_scenes = load_report(args.before)
+    after, after_scenes = load_report(args.after)
+
+    print("%s (%s, %s) -> %s (%s, %s)" % (before.get("label") or args.before, before["version"],
+                                          before.get("bvh_layout", "bvh2"),
+                                          after.get("label") or args.after, after["version"],
+                                          after.get("bvh_layout", "bvh2")))
+
+    if before["samples"] != after["samples"] or \
+       (before["width"], before["height"]) != (after["width"], after["height"]):
+        print("Warning: reports were rendered with different settings")
+
+    # Rays are only counted in builds with WITH_CYCLES_RAY_STATS.
+    rays_counted = before.get("rays_counted", True) and after.get("rays_counted", True)
+    if not rays_counted:
+        print("Note: rays were not counted in both reports, ray metrics are skipped")
+
+    regressions = []
+
+    for name, old_scene in before_scenes.items():
+        new_scene = after_scenes.get(name)
+        if new_scene is None:
+            print("\n%s: missing in %s" % (name, args.after))
+            continue
+
+        print("\n%s" % name)
+
+        for metric, higher_is_better in METRICS:
+            if metric == "rays_per_second" and not rays_counted:
+                continue
+
+            old = old_scene.get(metric, 0)
+            new = new_scene.get(metric, 0)
+            regression, change = format_change(old, new, higher_is_better)
+
+            if metric.endswith("_time") and max(old, new) < args.min_time:
+                regression = 0.0
+
+            status = ""
+            if regression > args.threshold:
+                status = "  REGRESSION"
+                regressions.append((name, metric, change))
+
+            print("  %-20s %14.4f %14.4f %10s%s" % (metric, old, new, change, status))
+
+    if regressions:
+        print("\n%d regression(s) above %.1f%%:" % (len(regressions), args.threshold))
+        for name, metric, change in regressions:
+            print("  %s %s %s" % (name, metric, change))
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
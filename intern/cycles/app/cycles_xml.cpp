@@ -35,6 +35,8 @@
 #include "shader.h"
 #include "scene.h"
 
+#include "volume_grid.h"
+
 #include "subd_patch.h"
 #include "subd_split.h"
 
@@ -529,6 +531,108 @@ static void xml_read_mesh(const XMLReadState& state, pugi::xml_node node)
 	}
 }
 
+/* Volume
+ *
+ * Box around grids from an OpenVDB file, with a voxel attribute per grid. */
+
+static void xml_read_volume(const XMLReadState& state, pugi::xml_node node)
+{
+	string src;
+	vector<string> grids;
+	string grids_str;
+
+	if(!xml_read_string(&src, node, "src"))
+		return;
+
+	string filepath = path_join(state.base, src);
+
+	if(xml_read_string(&grids_str, node, "grids"))
+		string_split(grids, grids_str);
+	else
+		grids.push_back("density");
+
+	int3 origin, resolution;
+	Transform index_to_world;
+
+	if(!volume_grid_vdb_bounds(filepath, grids[0], &origin, &resolution, &index_to_world)) {
+		fprintf(stderr, "Failed to read volume grid \"%s\" from %s.\n",
+		        grids[0].c_str(), filepath.c_str());
+		return;
+	}
+
+	/* add mesh */
+	Mesh *mesh = xml_add_mesh(state.scene, state.tfm);
+	mesh->used_shaders.push_back(state.shader);
+
+	/* box around the voxels, which are centered at integer coordinates */
+	const float3 box_min = make_float3(origin.x, origin.y, origin.z) - make_float3(0.5f, 0.5f, 0.5f);
+	const float3 box_size = make_float3(resolution.x, resolution.y, resolution.z);
+
+	mesh->reserve_mesh(8, 12);
+
+	for(int i = 0; i < 8; i++) {
+		float3 P = box_min + box_size*make_float3((i & 1)? 1.0f: 0.0f,
+		                                          (i & 2)? 1.0f: 0.0f,
+		                                          (i & 4)? 1.0f: 0.0f);
+		mesh->verts.push_back_reserved(transform_point(&index_to_world, P));
+	}
+
+	/* outward facing in index space */
+	const int quads[6][4] = {{0, 2, 3, 1}, {4, 5, 7, 6}, {0, 1, 5, 4},
+	                         {2, 6, 7, 3}, {0, 4, 6, 2}, {1, 3, 7, 5}};
+	const bool flip = transform_negative_scale(index_to_world);
+
+	for(int i = 0; i < 6; i++) {
+		const int *q = quads[i];
+
+		if(flip) {
+			mesh->add_triangle(q[0], q[2], q[1], 0, false);
+			mesh->add_triangle(q[0], q[3], q[2], 0, false);
+		}
+		else {
+			mesh->add_triangle(q[0], q[1], q[2], 0, false);
+			mesh->add_triangle(q[0], q[2], q[3], 0, false);
+		}
+	}
+
+	/* texture space of the grids */
+	Attribute *attr = mesh->attributes.add(ATTR_STD_GENERATED_TRANSFORM);
+	*(attr->data_transform()) = transform_scale(make_float3(1.0f, 1.0f, 1.0f)/box_size) *
+	                            transform_translate(make_float3(0.5f, 0.5f, 0.5f) - make_float3(origin.x, origin.y, origin.z)) *
+	                            transform_inverse(index_to_world);
+
+	ImageManager *image_manager = state.scene->image_manager;
+
+	foreach(const string& grid, grids) {
+		AttributeStandard std = Attribute::name_standard(grid.c_str());
+
+		if(std != ATTR_STD_VOLUME_DENSITY &&
+		   std != ATTR_STD_VOLUME_COLOR &&
+		   std != ATTR_STD_VOLUME_FLAME &&
+		   std != ATTR_STD_VOLUME_HEAT &&
+		   std != ATTR_STD_VOLUME_VELOCITY)
+		{
+			fprintf(stderr, "Unknown volume grid \"%s\".\n", grid.c_str());
+			continue;
+		}
+
+		VoxelAttribute *volume_data = mesh->attributes.add(std)->data_voxel();
+		bool is_float, is_linear;
+
+		volume_data->manager = image_manager;
+		volume_data->slot = image_manager->add_image(filepath,
+		                                             NULL,
+		                                             false,
+		                                             0.0f,
+		                                             is_float,
+		                                             is_linear,
+		                                             INTERPOLATION_LINEAR,
+		                                             EXTENSION_CLIP,
+		                                             true,
+		                                             grid);
+	}
+}
+
 /* Light */
 
 static void xml_read_light(XMLReadState& state, pugi::xml_node node)
@@ -626,6 +730,9 @@ static void xml_read_scene(XMLReadState& state, pugi::xml_node scene_node)
 		else if(string_iequals(node.name(), "mesh")) {
 			xml_read_mesh(state, node);
 		}
+		else if(string_iequals(node.name(), "volume")) {
+			xml_read_volume(state, node);
+		}
 		else if(string_iequals(node.name(), "light")) {
 			xml_read_light(state, node);
 		}
@@ -290,6 +290,65 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 min=0.0, max=1.0,
                 default=0.01,
                 )
+        cls.use_light_tree = BoolProperty(
+                name="Light Tree",
+                description="Sample mesh lights with a light tree, choosing emitters based on their distance and "
+                            "orientation to the shading point. Reduces noise in scenes with many mesh lights",
+                default=False,
+                )
+        cls.adaptive_threshold = FloatProperty(
+                name="Adaptive Threshold",
+                description="Noise level at which pixels stop being sampled, only used for final CPU renders "
+                            "without progressive refine. Zero disables adaptive sampling",
+                min=0.0, max=1.0,
+                default=0.0,
+                precision=4,
+                )
+        cls.adaptive_min_samples = IntProperty(
+                name="Adaptive Min Samples",
+                description="Minimum number of samples taken before a pixel can be considered converged. "
+                            "Zero picks a value based on the threshold",
+                min=0, max=4096,
+                default=0,
+                )
+        cls.use_path_guiding = BoolProperty(
+                name="Path Guiding",
+                description="Learn the distribution of incident light while rendering and use it to guide "
+                            "paths from diffuse surfaces, only used for path tracing on the CPU. "
+                            "Final renders use progressive refine",
+                default=False,
+                )
+        cls.path_guiding_memory = IntProperty(
+                name="Path Guiding Memory",
+                description="Maximum memory in megabytes used for the learned light distribution",
+                min=1, max=65536,
+                default=256,
+                )
+
+        cls.use_denoising = BoolProperty(
+                name="Denoising",
+                description="Denoise final renders once all tiles are finished, using feature passes written "
+                            "during rendering",
+                default=False,
+                )
+        cls.denoising_radius = IntProperty(
+                name="Radius",
+                description="Size of the image area that is searched for similar pixels",
+                min=1, max=25,
+                default=8,
+                )
+        cls.denoising_strength = FloatProperty(
+                name="Strength",
+                description="Color similarity bandwidth, higher values remove more noise but lose detail",
+                min=0.0, max=1.0,
+                default=0.5,
+                )
+        cls.denoising_feature_strength = FloatProperty(
+                name="Feature Strength",
+                description="Feature similarity bandwidth, higher values blur more across normal, albedo and depth edges",
+                min=0.0, max=1.0,
+                default=0.5,
+                )
 
         cls.caustics_reflective = BoolProperty(
                 name="Reflective Caustics",
@@ -534,6 +593,24 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 default=0,
                 min=0, max=16,
                 )
+        cls.use_bvh_cache = BoolProperty(
+                name="Cache BVH",
+                description="Cache built BVHs on disk for faster re-renders and consecutive frames, "
+                            "geometry which did not change is not built again",
+                default=False,
+                )
+        cls.use_compact_mesh = BoolProperty(
+                name="Compact Mesh",
+                description="Store vertex normals and face corner attributes like UVs and colors with reduced "
+                            "precision, uses less memory for large meshes at the cost of some accuracy",
+                default=False,
+                )
+        cls.use_compact_hair = BoolProperty(
+                name="Compact Hair",
+                description="Store hair keys with reduced precision relative to the bounds of each strand, "
+                            "uses less memory for dense hair at the cost of slightly thinner strands",
+                default=False,
+                )
         cls.tile_order = EnumProperty(
                 name="Tile Order",
                 description="Tile order for rendering",
@@ -638,6 +715,20 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
             items=enum_texture_limit
             )
 
+        cls.use_texture_cache = BoolProperty(
+            name="Texture Cache",
+            description="Read image textures on demand while rendering instead of loading them into memory, "
+                        "tiled and MIP mapped files (.tx) are read most efficiently (CPU only)",
+            default=False,
+            )
+
+        cls.texture_cache_size = IntProperty(
+            name="Cache Size",
+            description="Maximum memory used by the texture cache in megabytes",
+            min=16, max=1024 * 1024,
+            default=1024,
+            )
+
         cls.ao_bounces = IntProperty(
             name="AO Bounces",
             default=0,
@@ -665,6 +756,10 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         cls.debug_use_cpu_sse3 = BoolProperty(name="SSE3", default=True)
         cls.debug_use_cpu_sse2 = BoolProperty(name="SSE2", default=True)
         cls.debug_use_qbvh = BoolProperty(name="QBVH", default=True)
+        cls.debug_use_obvh = BoolProperty(name="OBVH", default=True)
+        cls.debug_use_cpu_stream = BoolProperty(name="Ray Stream", default=False)
+        cls.debug_use_cpu_shader_jit = BoolProperty(name="Compile Shaders", default=False)
+        cls.debug_use_cpu_shader_jit_verify = BoolProperty(name="Verify Compiled Shaders", default=False)
 
         cls.debug_use_cuda_adaptive_compile = BoolProperty(name="Adaptive Compile", default=False)
 
@@ -175,6 +175,11 @@ class CyclesRender_PT_sampling(CyclesButtonsPanel, Panel):
         sub.prop(cscene, "sample_clamp_direct")
         sub.prop(cscene, "sample_clamp_indirect")
         sub.prop(cscene, "light_sampling_threshold")
+        sub.prop(cscene, "use_light_tree")
+        sub.prop(cscene, "use_path_guiding")
+        subsub = sub.row(align=True)
+        subsub.active = cscene.use_path_guiding
+        subsub.prop(cscene, "path_guiding_memory", text="Memory")
 
         if cscene.progressive == 'PATH' or use_branched_path(context) is False:
             col = split.column()
@@ -208,6 +213,11 @@ class CyclesRender_PT_sampling(CyclesButtonsPanel, Panel):
         if not (use_opencl(context) and cscene.feature_set != 'EXPERIMENTAL'):
             layout.row().prop(cscene, "sampling_pattern", text="Pattern")
 
+        row = layout.row(align=True)
+        row.active = use_cpu(context)
+        row.prop(cscene, "adaptive_threshold")
+        row.prop(cscene, "adaptive_min_samples", text="Min Samples")
+
         for rl in scene.render.layers:
             if rl.samples > 0:
                 layout.separator()
@@ -381,6 +391,33 @@ class CyclesRender_PT_film(CyclesButtonsPanel, Panel):
             sub.prop(cscene, "filter_width", text="Width")
 
 
+class CyclesRender_PT_denoising(CyclesButtonsPanel, Panel):
+    bl_label = "Denoising"
+    bl_options = {'DEFAULT_CLOSED'}
+
+    def draw_header(self, context):
+        cscene = context.scene.cycles
+
+        self.layout.prop(cscene, "use_denoising", text="")
+
+    def draw(self, context):
+        layout = self.layout
+
+        scene = context.scene
+        cscene = scene.cycles
+
+        layout.active = cscene.use_denoising and not cscene.use_progressive_refine
+
+        split = layout.split()
+
+        col = split.column()
+        col.prop(cscene, "denoising_radius")
+
+        col = split.column(align=True)
+        col.prop(cscene, "denoising_strength", slider=True)
+        col.prop(cscene, "denoising_feature_strength", slider=True)
+
+
 class CyclesRender_PT_performance(CyclesButtonsPanel, Panel):
     bl_label = "Performance"
     bl_options = {'DEFAULT_CLOSED'}
@@ -425,12 +462,25 @@ class CyclesRender_PT_performance(CyclesButtonsPanel, Panel):
 
         col.label(text="Final Render:")
         col.prop(rd, "use_persistent_data", text="Persistent Images")
+        col.prop(cscene, "use_bvh_cache")
+
+        col.separator()
+
+        col.label(text="Textures:")
+        sub = col.column(align=True)
+        sub.active = use_cpu(context)
+        sub.prop(cscene, "use_texture_cache")
+        subsub = sub.column(align=True)
+        subsub.active = cscene.use_texture_cache
+        subsub.prop(cscene, "texture_cache_size")
 
         col.separator()
 
         col.label(text="Acceleration structure:")
         col.prop(cscene, "debug_use_spatial_splits")
         col.prop(cscene, "debug_use_hair_bvh")
+        col.prop(cscene, "use_compact_mesh")
+        col.prop(cscene, "use_compact_hair")
 
         row = col.row()
         row.active = not cscene.debug_use_spatial_splits
@@ -1518,6 +1568,12 @@ class CyclesRender_PT_debug(CyclesButtonsPanel, Panel):
         row.prop(cscene, "debug_use_cpu_avx", toggle=True)
         row.prop(cscene, "debug_use_cpu_avx2", toggle=True)
         col.prop(cscene, "debug_use_qbvh")
+        col.prop(cscene, "debug_use_obvh")
+        col.prop(cscene, "debug_use_cpu_stream")
+        col.prop(cscene, "debug_use_cpu_shader_jit")
+        sub = col.column()
+        sub.active = cscene.debug_use_cpu_shader_jit
+        sub.prop(cscene, "debug_use_cpu_shader_jit_verify")
 
         col = layout.column()
         col.label('CUDA Flags:')
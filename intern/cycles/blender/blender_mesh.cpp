@@ -33,6 +33,9 @@
 
 #include "mikktspace.h"
 
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
 CCL_NAMESPACE_BEGIN
 
 /* Per-face bit flags. */
@@ -77,19 +80,230 @@ inline void face_split_tri_indices(const int num_verts,
 	}
 }
 
+/* Blender Mesh Arrays
+ *
+ * Arrays of the derived Blender mesh are looked up through RNA once, after
+ * that the mesh is converted reading them directly. Conversion does not touch
+ * RNA at all, so it can run in tasks while the other objects are synced. */
+
+struct BlenderMeshLayer {
+	ustring name;
+	bool active_render;
+	/* MTFace or MCol per tessface, MLoopUV or MLoopCol per loop */
+	const void *data;
+};
+
+struct BlenderMeshArrays {
+	BlenderMeshArrays()
+	: verts(NULL), edges(NULL), tessfaces(NULL), polys(NULL), loops(NULL),
+	  orco(NULL), num_verts(0), num_edges(0), num_tessfaces(0), num_polys(0),
+	  use_loop_normals(false)
+	{
+	}
+
+	const MVert *verts;
+	const MEdge *edges;
+	const MFace *tessfaces;
+	const MPoly *polys;
+	const MLoop *loops;
+	/* undeformed coordinates, normalized to the texture space at orco_loc */
+	const float (*orco)[3];
+
+	int num_verts;
+	int num_edges;
+	int num_tessfaces;
+	int num_polys;
+
+	float3 orco_loc, orco_size;
+	/* texture space for generated coordinates */
+	float3 texspace_loc, texspace_size;
+
+	bool use_loop_normals;
+
+	vector<BlenderMeshLayer> uv_layers;
+	vector<BlenderMeshLayer> color_layers;
+};
+
+/* State of a mesh being synced, kept until its conversion task is done and
+ * the Blender side can be finished on the sync thread. */
+struct BlenderMeshSync {
+	BlenderMeshSync(Mesh *mesh_, BL::Object& b_ob_)
+	: mesh(mesh_), b_ob(b_ob_), b_mesh(PointerRNA_NULL),
+	  create_surface(false), subdivision(false), subdivide_uvs(true),
+	  can_free_caches(false)
+	{
+	}
+
+	Mesh *mesh;
+	BL::Object b_ob;
+	BL::Mesh b_mesh;
+	BlenderMeshArrays arrays;
+	vector<Shader*> used_shaders;
+
+	bool create_surface;
+	bool subdivision;
+	bool subdivide_uvs;
+	bool can_free_caches;
+
+	/* number of vertices and split of every tessface */
+	vector<int> nverts;
+	vector<int> face_flags;
+
+	/* previous geometry, to detect if the BVH needs a rebuild */
+	array<int> oldtriangle;
+	array<float3> oldcurve_keys;
+	array<float> oldcurve_radius;
+};
+
+template<typename T>
+static const void *mesh_layer_data(T& b_layer)
+{
+	return (b_layer.data.length() != 0)? b_layer.data[0].ptr.data: NULL;
+}
+
+static void mesh_arrays_gather(BL::Mesh& b_mesh,
+                               bool subdivision,
+                               bool use_loop_normals,
+                               BlenderMeshArrays *arrays)
+{
+	const ::Mesh *me = (const ::Mesh*)b_mesh.ptr.data;
+
+	arrays->verts = me->mvert;
+	arrays->edges = me->medge;
+	arrays->tessfaces = me->mface;
+	arrays->polys = me->mpoly;
+	arrays->loops = me->mloop;
+	arrays->num_verts = me->totvert;
+	arrays->num_edges = me->totedge;
+	arrays->num_tessfaces = me->totface;
+	arrays->num_polys = me->totpoly;
+	arrays->use_loop_normals = use_loop_normals;
+
+	int orco_index = me->vdata.typemap[CD_ORCO];
+	arrays->orco = (orco_index != -1)? (const float(*)[3])me->vdata.layers[orco_index].data: NULL;
+
+	BL::Mesh b_texco_mesh = b_mesh.texco_mesh();
+	BL::Mesh& b_orco_mesh = (b_texco_mesh)? b_texco_mesh: b_mesh;
+	arrays->orco_loc = get_float3(b_orco_mesh.texspace_location());
+	arrays->orco_size = get_float3(b_orco_mesh.texspace_size());
+
+	mesh_texture_space(b_mesh, arrays->texspace_loc, arrays->texspace_size);
+
+	arrays->uv_layers.clear();
+	arrays->color_layers.clear();
+
+	if(subdivision) {
+		BL::Mesh::uv_layers_iterator l;
+		int i = 0;
+
+		for(b_mesh.uv_layers.begin(l); l != b_mesh.uv_layers.end(); ++l, ++i) {
+			BlenderMeshLayer layer = {ustring(l->name().c_str()),
+			                          b_mesh.uv_textures[i].active_render(),
+			                          mesh_layer_data(*l)};
+			arrays->uv_layers.push_back(layer);
+		}
+
+		BL::Mesh::vertex_colors_iterator c;
+		for(b_mesh.vertex_colors.begin(c); c != b_mesh.vertex_colors.end(); ++c) {
+			BlenderMeshLayer layer = {ustring(c->name().c_str()),
+			                          c->active_render(),
+			                          mesh_layer_data(*c)};
+			arrays->color_layers.push_back(layer);
+		}
+	}
+	else {
+		BL::Mesh::tessface_uv_textures_iterator l;
+		for(b_mesh.tessface_uv_textures.begin(l); l != b_mesh.tessface_uv_textures.end(); ++l) {
+			BlenderMeshLayer layer = {ustring(l->name().c_str()),
+			                          l->active_render(),
+			                          mesh_layer_data(*l)};
+			arrays->uv_layers.push_back(layer);
+		}
+
+		BL::Mesh::tessface_vertex_colors_iterator c;
+		for(b_mesh.tessface_vertex_colors.begin(c); c != b_mesh.tessface_vertex_colors.end(); ++c) {
+			BlenderMeshLayer layer = {ustring(c->name().c_str()),
+			                          c->active_render(),
+			                          mesh_layer_data(*c)};
+			arrays->color_layers.push_back(layer);
+		}
+	}
+}
+
+static inline float3 mvert_co(const MVert& mvert)
+{
+	return make_float3(mvert.co[0], mvert.co[1], mvert.co[2]);
+}
+
+static inline float3 mvert_normal(const MVert& mvert)
+{
+	/* same conversion as normal_short_to_float_v3() */
+	return make_float3(mvert.no[0], mvert.no[1], mvert.no[2]) * (1.0f / 32767.0f);
+}
+
+static inline int4 mface_verts(const MFace& mface)
+{
+	return make_int4(mface.v1, mface.v2, mface.v3, mface.v4);
+}
+
+static inline int mface_num_verts(const MFace& mface)
+{
+	return (mface.v4 == 0)? 3: 4;
+}
+
+static float3 mface_normal(const BlenderMeshArrays& arrays, const MFace& mface)
+{
+	const MVert *verts = arrays.verts;
+
+	/* same as normal_quad_v3() and normal_tri_v3() */
+	if(mface.v4) {
+		float3 d1 = mvert_co(verts[mface.v1]) - mvert_co(verts[mface.v3]);
+		float3 d2 = mvert_co(verts[mface.v2]) - mvert_co(verts[mface.v4]);
+		return safe_normalize(cross(d1, d2));
+	}
+	else {
+		float3 n1 = mvert_co(verts[mface.v1]) - mvert_co(verts[mface.v2]);
+		float3 n2 = mvert_co(verts[mface.v2]) - mvert_co(verts[mface.v3]);
+		return safe_normalize(cross(n1, n2));
+	}
+}
+
+static float3 mesh_undeformed_co(const BlenderMeshArrays& arrays, int v)
+{
+	if(arrays.orco) {
+		const float *orco = arrays.orco[v];
+		return arrays.orco_loc + make_float3(orco[0], orco[1], orco[2])*arrays.orco_size;
+	}
+
+	return mvert_co(arrays.verts[v]);
+}
+
+static inline uchar4 mcol_to_byte(const MCol& mcol)
+{
+	/* tessface colors are stored as BGR */
+	float3 color = make_float3(mcol.b, mcol.g, mcol.r) / 255.0f;
+	return color_float_to_byte(color_srgb_to_scene_linear(color));
+}
+
+static inline uchar4 mloopcol_to_byte(const MLoopCol& mloopcol)
+{
+	float3 color = make_float3(mloopcol.r, mloopcol.g, mloopcol.b) / 255.0f;
+	return color_float_to_byte(color_srgb_to_scene_linear(color));
+}
+
 /* Tangent Space */
 
 struct MikkUserData {
-	MikkUserData(const BL::Mesh& mesh_,
-	             BL::MeshTextureFaceLayer *layer_,
+	MikkUserData(const BlenderMeshArrays *arrays_,
+	             const MTFace *layer_,
 	             int num_faces_)
-	: mesh(mesh_), layer(layer_), num_faces(num_faces_)
+	: arrays(arrays_), layer(layer_), num_faces(num_faces_)
 	{
 		tangent.resize(num_faces*4);
 	}
 
-	BL::Mesh mesh;
-	BL::MeshTextureFaceLayer *layer;
+	const BlenderMeshArrays *arrays;
+	const MTFace *layer;
 	int num_faces;
 	vector<float4> tangent;
 };
@@ -103,55 +317,33 @@ static int mikk_get_num_faces(const SMikkTSpaceContext *context)
 static int mikk_get_num_verts_of_face(const SMikkTSpaceContext *context, const int face_num)
 {
 	MikkUserData *userdata = (MikkUserData*)context->m_pUserData;
-	BL::MeshTessFace f = userdata->mesh.tessfaces[face_num];
-	int4 vi = get_int4(f.vertices_raw());
-
-	return (vi[3] == 0)? 3: 4;
+	return mface_num_verts(userdata->arrays->tessfaces[face_num]);
 }
 
 static void mikk_get_position(const SMikkTSpaceContext *context, float P[3], const int face_num, const int vert_num)
 {
 	MikkUserData *userdata = (MikkUserData*)context->m_pUserData;
-	BL::MeshTessFace f = userdata->mesh.tessfaces[face_num];
-	int4 vi = get_int4(f.vertices_raw());
-	BL::MeshVertex v = userdata->mesh.vertices[vi[vert_num]];
-	float3 vP = get_float3(v.co());
-
-	P[0] = vP.x;
-	P[1] = vP.y;
-	P[2] = vP.z;
+	int4 vi = mface_verts(userdata->arrays->tessfaces[face_num]);
+	const MVert& v = userdata->arrays->verts[vi[vert_num]];
+
+	P[0] = v.co[0];
+	P[1] = v.co[1];
+	P[2] = v.co[2];
 }
 
 static void mikk_get_texture_coordinate(const SMikkTSpaceContext *context, float uv[2], const int face_num, const int vert_num)
 {
 	MikkUserData *userdata = (MikkUserData*)context->m_pUserData;
 	if(userdata->layer != NULL) {
-		BL::MeshTextureFace tf = userdata->layer->data[face_num];
-		float3 tfuv;
-
-		switch(vert_num) {
-			case 0:
-				tfuv = get_float3(tf.uv1());
-				break;
-			case 1:
-				tfuv = get_float3(tf.uv2());
-				break;
-			case 2:
-				tfuv = get_float3(tf.uv3());
-				break;
-			default:
-				tfuv = get_float3(tf.uv4());
-				break;
-		}
+		const MTFace& tf = userdata->layer[face_num];
 
-		uv[0] = tfuv.x;
-		uv[1] = tfuv.y;
+		uv[0] = tf.uv[vert_num][0];
+		uv[1] = tf.uv[vert_num][1];
 	}
 	else {
-		int vert_idx = userdata->mesh.tessfaces[face_num].vertices()[vert_num];
-		float3 orco =
-			get_float3(userdata->mesh.vertices[vert_idx].undeformed_co());
-		float2 tmp = map_to_sphere(make_float3(orco[0], orco[1], orco[2]));
+		int4 vi = mface_verts(userdata->arrays->tessfaces[face_num]);
+		float3 orco = mesh_undeformed_co(*userdata->arrays, vi[vert_num]);
+		float2 tmp = map_to_sphere(orco);
 		uv[0] = tmp.x;
 		uv[1] = tmp.y;
 	}
@@ -160,16 +352,15 @@ static void mikk_get_texture_coordinate(const SMikkTSpaceContext *context, float
 static void mikk_get_normal(const SMikkTSpaceContext *context, float N[3], const int face_num, const int vert_num)
 {
 	MikkUserData *userdata = (MikkUserData*)context->m_pUserData;
-	BL::MeshTessFace f = userdata->mesh.tessfaces[face_num];
+	const MFace& f = userdata->arrays->tessfaces[face_num];
 	float3 vN;
 
-	if(f.use_smooth()) {
-		int4 vi = get_int4(f.vertices_raw());
-		BL::MeshVertex v = userdata->mesh.vertices[vi[vert_num]];
-		vN = get_float3(v.normal());
+	if(f.flag & ME_SMOOTH) {
+		int4 vi = mface_verts(f);
+		vN = mvert_normal(userdata->arrays->verts[vi[vert_num]]);
 	}
 	else {
-		vN = get_float3(f.normal());
+		vN = mface_normal(*userdata->arrays, f);
 	}
 
 	N[0] = vN.x;
@@ -184,16 +375,18 @@ static void mikk_set_tangent_space(const SMikkTSpaceContext *context, const floa
 	userdata->tangent[face*4 + vert] = make_float4(T[0], T[1], T[2], sign);
 }
 
-static void mikk_compute_tangents(BL::Mesh& b_mesh,
-                                  BL::MeshTextureFaceLayer *b_layer,
-                                  Mesh *mesh,
-                                  const vector<int>& nverts,
-                                  const vector<int>& face_flags,
-                                  bool need_sign,
-                                  bool active_render)
+/* Compute tangents into already allocated attributes, runs as a task so the
+ * tangents of multiple UV maps are computed in parallel. */
+static void mikk_compute_tangents(const BlenderMeshSync *sync,
+                                  const MTFace *layer,
+                                  float3 *tangent,
+                                  float *tangent_sign)
 {
+	const vector<int>& nverts = sync->nverts;
+	const vector<int>& face_flags = sync->face_flags;
+
 	/* setup userdata */
-	MikkUserData userdata(b_mesh, b_layer, nverts.size());
+	MikkUserData userdata(&sync->arrays, layer, nverts.size());
 
 	/* setup interface */
 	SMikkTSpaceInterface sm_interface;
@@ -214,40 +407,6 @@ static void mikk_compute_tangents(BL::Mesh& b_mesh,
 	/* compute tangents */
 	genTangSpaceDefault(&context);
 
-	/* create tangent attributes */
-	Attribute *attr;
-	ustring name;
-	if(b_layer != NULL)
-		name = ustring((string(b_layer->name().c_str()) + ".tangent").c_str());
-	else
-		name = ustring("orco.tangent");
-
-	if(active_render)
-		attr = mesh->attributes.add(ATTR_STD_UV_TANGENT, name);
-	else
-		attr = mesh->attributes.add(name, TypeDesc::TypeVector, ATTR_ELEMENT_CORNER);
-
-	float3 *tangent = attr->data_float3();
-
-	/* create bitangent sign attribute */
-	float *tangent_sign = NULL;
-
-	if(need_sign) {
-		Attribute *attr_sign;
-		ustring name_sign;
-		if(b_layer != NULL)
-			name_sign = ustring((string(b_layer->name().c_str()) + ".tangent_sign").c_str());
-		else
-			name_sign = ustring("orco.tangent_sign");
-
-		if(active_render)
-			attr_sign = mesh->attributes.add(ATTR_STD_UV_TANGENT_SIGN, name_sign);
-		else
-			attr_sign = mesh->attributes.add(name_sign, TypeDesc::TypeFloat, ATTR_ELEMENT_CORNER);
-
-		tangent_sign = attr_sign->data_float();
-	}
-
 	for(int i = 0; i < nverts.size(); i++) {
 		int tri_a[3], tri_b[3];
 		face_split_tri_indices(nverts[i], face_flags[i], tri_a, tri_b);
@@ -280,6 +439,55 @@ static void mikk_compute_tangents(BL::Mesh& b_mesh,
 	}
 }
 
+/* Create tangent attributes and push a task to fill them. */
+static void attr_create_tangent(Scene *scene,
+                                BlenderMeshSync *sync,
+                                const BlenderMeshLayer *layer,
+                                TaskPool *pool)
+{
+	Mesh *mesh = sync->mesh;
+	bool active_render = (layer != NULL)? layer->active_render: true;
+	string prefix = (layer != NULL)? layer->name.string(): string("orco");
+
+	/* tangent attribute */
+	AttributeStandard std = (active_render)? ATTR_STD_UV_TANGENT: ATTR_STD_NONE;
+	ustring name = ustring(prefix + ".tangent");
+
+	if(!(mesh->need_attribute(scene, name) || (active_render && mesh->need_attribute(scene, std))))
+		return;
+
+	Attribute *attr;
+
+	if(active_render)
+		attr = mesh->attributes.add(ATTR_STD_UV_TANGENT, name);
+	else
+		attr = mesh->attributes.add(name, TypeDesc::TypeVector, ATTR_ELEMENT_CORNER);
+
+	/* bitangent sign attribute */
+	std = (active_render)? ATTR_STD_UV_TANGENT_SIGN: ATTR_STD_NONE;
+	ustring name_sign = ustring(prefix + ".tangent_sign");
+	float *tangent_sign = NULL;
+
+	if(mesh->need_attribute(scene, name_sign) || mesh->need_attribute(scene, std)) {
+		Attribute *attr_sign;
+
+		if(active_render)
+			attr_sign = mesh->attributes.add(ATTR_STD_UV_TANGENT_SIGN, name_sign);
+		else
+			attr_sign = mesh->attributes.add(name_sign, TypeDesc::TypeFloat, ATTR_ELEMENT_CORNER);
+
+		tangent_sign = attr_sign->data_float();
+	}
+
+	const MTFace *mtface = (layer != NULL)? (const MTFace*)layer->data: NULL;
+
+	pool->push(function_bind(&mikk_compute_tangents,
+	                         sync,
+	                         mtface,
+	                         attr->data_float3(),
+	                         tangent_sign));
+}
+
 /* Create Volume Attribute */
 
 static void create_mesh_volume_attribute(BL::Object& b_ob,
@@ -332,58 +540,49 @@ static void create_mesh_volume_attributes(Scene *scene,
 /* Create vertex color attributes. */
 static void attr_create_vertex_color(Scene *scene,
                                      Mesh *mesh,
-                                     BL::Mesh& b_mesh,
+                                     const BlenderMeshArrays& arrays,
                                      const vector<int>& nverts,
                                      const vector<int>& face_flags,
                                      bool subdivision)
 {
-	if(subdivision) {
-		BL::Mesh::vertex_colors_iterator l;
+	foreach(const BlenderMeshLayer& layer, arrays.color_layers) {
+		if(!mesh->need_attribute(scene, layer.name))
+			continue;
 
-		for(b_mesh.vertex_colors.begin(l); l != b_mesh.vertex_colors.end(); ++l) {
-			if(!mesh->need_attribute(scene, ustring(l->name().c_str())))
-				continue;
-
-			Attribute *attr = mesh->subd_attributes.add(ustring(l->name().c_str()),
+		if(subdivision) {
+			Attribute *attr = mesh->subd_attributes.add(layer.name,
 			                                            TypeDesc::TypeColor,
 			                                            ATTR_ELEMENT_CORNER_BYTE);
 
-			BL::Mesh::polygons_iterator p;
+			const MLoopCol *mloopcol = (const MLoopCol*)layer.data;
 			uchar4 *cdata = attr->data_uchar4();
 
-			for(b_mesh.polygons.begin(p); p != b_mesh.polygons.end(); ++p) {
-				int n = p->loop_total();
-				for(int i = 0; i < n; i++) {
-					float3 color = get_float3(l->data[p->loop_start() + i].color());
-					*(cdata++) = color_float_to_byte(color_srgb_to_scene_linear(color));
+			for(int p = 0; p < arrays.num_polys; p++) {
+				const MPoly& poly = arrays.polys[p];
+				for(int i = 0; i < poly.totloop; i++) {
+					*(cdata++) = mloopcol_to_byte(mloopcol[poly.loopstart + i]);
 				}
 			}
 		}
-	}
-	else {
-		BL::Mesh::tessface_vertex_colors_iterator l;
-		for(b_mesh.tessface_vertex_colors.begin(l); l != b_mesh.tessface_vertex_colors.end(); ++l) {
-			if(!mesh->need_attribute(scene, ustring(l->name().c_str())))
-				continue;
-
-			Attribute *attr = mesh->attributes.add(ustring(l->name().c_str()),
+		else {
+			Attribute *attr = mesh->attributes.add(layer.name,
 			                                       TypeDesc::TypeColor,
 			                                       ATTR_ELEMENT_CORNER_BYTE);
 
-			BL::MeshColorLayer::data_iterator c;
+			/* four colors per tessface */
+			const MCol *mcol = (const MCol*)layer.data;
 			uchar4 *cdata = attr->data_uchar4();
-			size_t i = 0;
 
-			for(l->data.begin(c); c != l->data.end(); ++c, ++i) {
+			for(int i = 0; i < nverts.size(); i++, mcol += 4) {
 				int tri_a[3], tri_b[3];
 				face_split_tri_indices(nverts[i], face_flags[i], tri_a, tri_b);
 
 				uchar4 colors[4];
-				colors[0] = color_float_to_byte(color_srgb_to_scene_linear(get_float3(c->color1())));
-				colors[1] = color_float_to_byte(color_srgb_to_scene_linear(get_float3(c->color2())));
-				colors[2] = color_float_to_byte(color_srgb_to_scene_linear(get_float3(c->color3())));
+				colors[0] = mcol_to_byte(mcol[0]);
+				colors[1] = mcol_to_byte(mcol[1]);
+				colors[2] = mcol_to_byte(mcol[2]);
 				if(nverts[i] == 4) {
-					colors[3] = color_float_to_byte(color_srgb_to_scene_linear(get_float3(c->color4())));
+					colors[3] = mcol_to_byte(mcol[3]);
 				}
 
 				cdata[0] = colors[tri_a[0]];
@@ -405,78 +604,67 @@ static void attr_create_vertex_color(Scene *scene,
 
 /* Create uv map attributes. */
 static void attr_create_uv_map(Scene *scene,
-                               Mesh *mesh,
-                               BL::Mesh& b_mesh,
-                               const vector<int>& nverts,
-                               const vector<int>& face_flags,
-                               bool subdivision,
-                               bool subdivide_uvs)
+                               BlenderMeshSync *sync,
+                               TaskPool *pool)
 {
-	if(subdivision) {
-		BL::Mesh::uv_layers_iterator l;
-		int i = 0;
+	Mesh *mesh = sync->mesh;
+	const BlenderMeshArrays& arrays = sync->arrays;
+	const vector<int>& nverts = sync->nverts;
+	const vector<int>& face_flags = sync->face_flags;
 
-		for(b_mesh.uv_layers.begin(l); l != b_mesh.uv_layers.end(); ++l, ++i) {
-			bool active_render = b_mesh.uv_textures[i].active_render();
-			AttributeStandard std = (active_render)? ATTR_STD_UV: ATTR_STD_NONE;
-			ustring name = ustring(l->name().c_str());
+	if(sync->subdivision) {
+		foreach(const BlenderMeshLayer& layer, arrays.uv_layers) {
+			AttributeStandard std = (layer.active_render)? ATTR_STD_UV: ATTR_STD_NONE;
 
 			/* UV map */
-			if(mesh->need_attribute(scene, name) || mesh->need_attribute(scene, std)) {
+			if(mesh->need_attribute(scene, layer.name) || mesh->need_attribute(scene, std)) {
 				Attribute *attr;
 
-				if(active_render)
-					attr = mesh->subd_attributes.add(std, name);
+				if(layer.active_render)
+					attr = mesh->subd_attributes.add(std, layer.name);
 				else
-					attr = mesh->subd_attributes.add(name, TypeDesc::TypePoint, ATTR_ELEMENT_CORNER);
+					attr = mesh->subd_attributes.add(layer.name, TypeDesc::TypePoint, ATTR_ELEMENT_CORNER);
 
-				if(subdivide_uvs) {
+				if(sync->subdivide_uvs) {
 					attr->flags |= ATTR_SUBDIVIDED;
 				}
 
-				BL::Mesh::polygons_iterator p;
+				const MLoopUV *mloopuv = (const MLoopUV*)layer.data;
 				float3 *fdata = attr->data_float3();
 
-				for(b_mesh.polygons.begin(p); p != b_mesh.polygons.end(); ++p) {
-					int n = p->loop_total();
-					for(int j = 0; j < n; j++) {
-						*(fdata++) = get_float3(l->data[p->loop_start() + j].uv());
+				for(int p = 0; p < arrays.num_polys; p++) {
+					const MPoly& poly = arrays.polys[p];
+					for(int j = 0; j < poly.totloop; j++) {
+						const float *uv = mloopuv[poly.loopstart + j].uv;
+						*(fdata++) = make_float3(uv[0], uv[1], 0.0f);
 					}
 				}
 			}
 		}
 	}
-	else if(b_mesh.tessface_uv_textures.length() != 0) {
-		BL::Mesh::tessface_uv_textures_iterator l;
-
-		for(b_mesh.tessface_uv_textures.begin(l); l != b_mesh.tessface_uv_textures.end(); ++l) {
-			bool active_render = l->active_render();
-			AttributeStandard std = (active_render)? ATTR_STD_UV: ATTR_STD_NONE;
-			ustring name = ustring(l->name().c_str());
+	else if(arrays.uv_layers.size() != 0) {
+		foreach(const BlenderMeshLayer& layer, arrays.uv_layers) {
+			AttributeStandard std = (layer.active_render)? ATTR_STD_UV: ATTR_STD_NONE;
 
 			/* UV map */
-			if(mesh->need_attribute(scene, name) || mesh->need_attribute(scene, std)) {
+			if(mesh->need_attribute(scene, layer.name) || mesh->need_attribute(scene, std)) {
 				Attribute *attr;
 
-				if(active_render)
-					attr = mesh->attributes.add(std, name);
+				if(layer.active_render)
+					attr = mesh->attributes.add(std, layer.name);
 				else
-					attr = mesh->attributes.add(name, TypeDesc::TypePoint, ATTR_ELEMENT_CORNER);
+					attr = mesh->attributes.add(layer.name, TypeDesc::TypePoint, ATTR_ELEMENT_CORNER);
 
-				BL::MeshTextureFaceLayer::data_iterator t;
+				const MTFace *mtface = (const MTFace*)layer.data;
 				float3 *fdata = attr->data_float3();
-				size_t i = 0;
 
-				for(l->data.begin(t); t != l->data.end(); ++t, ++i) {
+				for(int i = 0; i < nverts.size(); i++) {
 					int tri_a[3], tri_b[3];
 					face_split_tri_indices(nverts[i], face_flags[i], tri_a, tri_b);
 
 					float3 uvs[4];
-					uvs[0] = get_float3(t->uv1());
-					uvs[1] = get_float3(t->uv2());
-					uvs[2] = get_float3(t->uv3());
-					if(nverts[i] == 4) {
-						uvs[3] = get_float3(t->uv4());
+					for(int j = 0; j < nverts[i]; j++) {
+						uvs[j] = make_float3(mtface[i].uv[j][0], mtface[i].uv[j][1], 0.0f);
 					}
 
 					fdata[0] = uvs[tri_a[0]];
@@ -494,134 +682,109 @@ static void attr_create_uv_map(Scene *scene,
 			}
 
 			/* UV tangent */
-			std = (active_render)? ATTR_STD_UV_TANGENT: ATTR_STD_NONE;
-			name = ustring((string(l->name().c_str()) + ".tangent").c_str());
-
-			if(mesh->need_attribute(scene, name) || (active_render && mesh->need_attribute(scene, std))) {
-				std = (active_render)? ATTR_STD_UV_TANGENT_SIGN: ATTR_STD_NONE;
-				name = ustring((string(l->name().c_str()) + ".tangent_sign").c_str());
-				bool need_sign = (mesh->need_attribute(scene, name) || mesh->need_attribute(scene, std));
-
-				mikk_compute_tangents(b_mesh,
-				                      &(*l),
-				                      mesh,
-				                      nverts,
-				                      face_flags,
-				                      need_sign,
-				                      active_render);
-			}
+			attr_create_tangent(scene, sync, &layer, pool);
 		}
 	}
-	else if(mesh->need_attribute(scene, ATTR_STD_UV_TANGENT)) {
-		bool need_sign = mesh->need_attribute(scene, ATTR_STD_UV_TANGENT_SIGN);
-		mikk_compute_tangents(b_mesh,
-		                      NULL,
-		                      mesh,
-		                      nverts,
-		                      face_flags,
-		                      need_sign,
-		                      true);
+	else {
+		attr_create_tangent(scene, sync, NULL, pool);
 	}
 }
 
+/* Compute vertex pointiness into an already allocated attribute. */
+static void mesh_compute_pointiness(const BlenderMeshSync *sync, float *data)
+{
+	const BlenderMeshArrays& arrays = sync->arrays;
+	const int numverts = arrays.num_verts;
+	int *counter = new int[numverts];
+	float *raw_data = new float[numverts];
+	float3 *edge_accum = new float3[numverts];
+
+	/* Calculate pointiness using single ring neighborhood. */
+	memset(counter, 0, sizeof(int) * numverts);
+	memset(raw_data, 0, sizeof(float) * numverts);
+	memset(edge_accum, 0, sizeof(float3) * numverts);
+	for(int i = 0; i < arrays.num_edges; ++i) {
+		int v0 = arrays.edges[i].v1,
+		    v1 = arrays.edges[i].v2;
+		float3 co0 = mvert_co(arrays.verts[v0]),
+		       co1 = mvert_co(arrays.verts[v1]);
+		float3 edge = normalize(co1 - co0);
+		edge_accum[v0] += edge;
+		edge_accum[v1] += -edge;
+		++counter[v0];
+		++counter[v1];
+	}
+	for(int i = 0; i < numverts; ++i) {
+		if(counter[i] > 0) {
+			float3 normal = mvert_normal(arrays.verts[i]);
+			float angle = safe_acosf(dot(normal, edge_accum[i] / counter[i]));
+			raw_data[i] = angle * M_1_PI_F;
+		}
+		else {
+			raw_data[i] = 0.0f;
+		}
+	}
+
+	/* Blur vertices to approximate 2 ring neighborhood. */
+	memset(counter, 0, sizeof(int) * numverts);
+	memcpy(data, raw_data, sizeof(float) * numverts);
+	for(int i = 0; i < arrays.num_edges; ++i) {
+		int v0 = arrays.edges[i].v1,
+		    v1 = arrays.edges[i].v2;
+		data[v0] += raw_data[v1];
+		data[v1] += raw_data[v0];
+		++counter[v0];
+		++counter[v1];
+	}
+	for(int i = 0; i < numverts; ++i) {
+		data[i] /= counter[i] + 1;
+	}
+
+	delete [] counter;
+	delete [] raw_data;
+	delete [] edge_accum;
+}
+
 /* Create vertex pointiness attributes. */
 static void attr_create_pointiness(Scene *scene,
-                                   Mesh *mesh,
-                                   BL::Mesh& b_mesh,
-                                   bool subdivision)
+                                   BlenderMeshSync *sync,
+                                   TaskPool *pool)
 {
+	Mesh *mesh = sync->mesh;
+
 	if(mesh->need_attribute(scene, ATTR_STD_POINTINESS)) {
-		const int numverts = b_mesh.vertices.length();
-		AttributeSet& attributes = (subdivision)? mesh->subd_attributes: mesh->attributes;
+		AttributeSet& attributes = (sync->subdivision)? mesh->subd_attributes: mesh->attributes;
 		Attribute *attr = attributes.add(ATTR_STD_POINTINESS);
-		float *data = attr->data_float();
-		int *counter = new int[numverts];
-		float *raw_data = new float[numverts];
-		float3 *edge_accum = new float3[numverts];
-
-		/* Calculate pointiness using single ring neighborhood. */
-		memset(counter, 0, sizeof(int) * numverts);
-		memset(raw_data, 0, sizeof(float) * numverts);
-		memset(edge_accum, 0, sizeof(float3) * numverts);
-		BL::Mesh::edges_iterator e;
-		int i = 0;
-		for(b_mesh.edges.begin(e); e != b_mesh.edges.end(); ++e, ++i) {
-			int v0 = b_mesh.edges[i].vertices()[0],
-			    v1 = b_mesh.edges[i].vertices()[1];
-			float3 co0 = get_float3(b_mesh.vertices[v0].co()),
-			       co1 = get_float3(b_mesh.vertices[v1].co());
-			float3 edge = normalize(co1 - co0);
-			edge_accum[v0] += edge;
-			edge_accum[v1] += -edge;
-			++counter[v0];
-			++counter[v1];
-		}
-		i = 0;
-		BL::Mesh::vertices_iterator v;
-		for(b_mesh.vertices.begin(v); v != b_mesh.vertices.end(); ++v, ++i) {
-			if(counter[i] > 0) {
-				float3 normal = get_float3(b_mesh.vertices[i].normal());
-				float angle = safe_acosf(dot(normal, edge_accum[i] / counter[i]));
-				raw_data[i] = angle * M_1_PI_F;
-			}
-			else {
-				raw_data[i] = 0.0f;
-			}
-		}
-
-		/* Blur vertices to approximate 2 ring neighborhood. */
-		memset(counter, 0, sizeof(int) * numverts);
-		memcpy(data, raw_data, sizeof(float) * numverts);
-		i = 0;
-		for(b_mesh.edges.begin(e); e != b_mesh.edges.end(); ++e, ++i) {
-			int v0 = b_mesh.edges[i].vertices()[0],
-			    v1 = b_mesh.edges[i].vertices()[1];
-			data[v0] += raw_data[v1];
-			data[v1] += raw_data[v0];
-			++counter[v0];
-			++counter[v1];
-		}
-		for(i = 0; i < numverts; ++i) {
-			data[i] /= counter[i] + 1;
-		}
 
-		delete [] counter;
-		delete [] raw_data;
-		delete [] edge_accum;
+		pool->push(function_bind(&mesh_compute_pointiness, sync, attr->data_float()));
 	}
 }
 
 /* Create Mesh */
 
-static void create_mesh(Scene *scene,
-                        Mesh *mesh,
-                        BL::Mesh& b_mesh,
-                        const vector<Shader*>& used_shaders,
-                        bool subdivision = false,
-                        bool subdivide_uvs = true)
+static void create_mesh(Scene *scene, BlenderMeshSync *sync, TaskPool *pool)
 {
+	Mesh *mesh = sync->mesh;
+	const BlenderMeshArrays& arrays = sync->arrays;
+	const vector<Shader*>& used_shaders = sync->used_shaders;
+	bool subdivision = sync->subdivision;
+
 	/* count vertices and faces */
-	int numverts = b_mesh.vertices.length();
-	int numfaces = (!subdivision) ? b_mesh.tessfaces.length() : b_mesh.polygons.length();
+	int numverts = arrays.num_verts;
+	int numfaces = (!subdivision) ? arrays.num_tessfaces : arrays.num_polys;
 	int numtris = 0;
 	int numcorners = 0;
 	int numngons = 0;
-	bool use_loop_normals = b_mesh.use_auto_smooth() && (mesh->subdivision_type != Mesh::SUBDIVISION_CATMULL_CLARK);
-
-	BL::Mesh::vertices_iterator v;
-	BL::Mesh::tessfaces_iterator f;
-	BL::Mesh::polygons_iterator p;
 
 	if(!subdivision) {
-		for(b_mesh.tessfaces.begin(f); f != b_mesh.tessfaces.end(); ++f) {
-			int4 vi = get_int4(f->vertices_raw());
-			numtris += (vi[3] == 0)? 1: 2;
+		for(int i = 0; i < arrays.num_tessfaces; i++) {
+			numtris += (arrays.tessfaces[i].v4 == 0)? 1: 2;
 		}
 	}
 	else {
-		for(b_mesh.polygons.begin(p); p != b_mesh.polygons.end(); ++p) {
-			numngons += (p->loop_total() == 4)? 0: 1;
-			numcorners += p->loop_total();
+		for(int i = 0; i < arrays.num_polys; i++) {
+			numngons += (arrays.polys[i].totloop == 4)? 0: 1;
+			numcorners += arrays.polys[i].totloop;
 		}
 	}
 
@@ -630,46 +793,45 @@ static void create_mesh(Scene *scene,
 	mesh->reserve_subd_faces(numfaces, numngons, numcorners);
 
 	/* create vertex coordinates and normals */
-	for(b_mesh.vertices.begin(v); v != b_mesh.vertices.end(); ++v)
-		mesh->add_vertex(get_float3(v->co()));
+	for(int i = 0; i < numverts; i++)
+		mesh->add_vertex(mvert_co(arrays.verts[i]));
 
 	AttributeSet& attributes = (subdivision)? mesh->subd_attributes: mesh->attributes;
 	Attribute *attr_N = attributes.add(ATTR_STD_VERTEX_NORMAL);
 	float3 *N = attr_N->data_float3();
 
-	for(b_mesh.vertices.begin(v); v != b_mesh.vertices.end(); ++v, ++N)
-		*N = get_float3(v->normal());
-	N = attr_N->data_float3();
+	for(int i = 0; i < numverts; i++)
+		N[i] = mvert_normal(arrays.verts[i]);
 
 	/* create generated coordinates from undeformed coordinates */
 	if(mesh->need_attribute(scene, ATTR_STD_GENERATED)) {
 		Attribute *attr = attributes.add(ATTR_STD_GENERATED);
 		attr->flags |= ATTR_SUBDIVIDED;
 
-		float3 loc, size;
-		mesh_texture_space(b_mesh, loc, size);
-
 		float3 *generated = attr->data_float3();
-		size_t i = 0;
 
-		for(b_mesh.vertices.begin(v); v != b_mesh.vertices.end(); ++v)
-			generated[i++] = get_float3(v->undeformed_co())*size - loc;
+		for(int i = 0; i < numverts; i++)
+			generated[i] = mesh_undeformed_co(arrays, i)*arrays.texspace_size - arrays.texspace_loc;
 	}
 
 	/* Create needed vertex attributes. */
-	attr_create_pointiness(scene, mesh, b_mesh, subdivision);
+	attr_create_pointiness(scene, sync, pool);
 
 	/* create faces */
-	vector<int> nverts(numfaces);
-	vector<int> face_flags(numfaces, FACE_FLAG_NONE);
-	int fi = 0;
+	vector<int>& nverts = sync->nverts;
+	vector<int>& face_flags = sync->face_flags;
+
+	nverts.resize(numfaces);
+	face_flags.clear();
+	face_flags.resize(numfaces, FACE_FLAG_NONE);
 
 	if(!subdivision) {
-		for(b_mesh.tessfaces.begin(f); f != b_mesh.tessfaces.end(); ++f, ++fi) {
-			int4 vi = get_int4(f->vertices_raw());
-			int n = (vi[3] == 0)? 3: 4;
-			int shader = clamp(f->material_index(), 0, used_shaders.size()-1);
-			bool smooth = f->use_smooth() || use_loop_normals;
+		for(int fi = 0; fi < arrays.num_tessfaces; fi++) {
+			const MFace& f = arrays.tessfaces[fi];
+			int4 vi = mface_verts(f);
+			int n = mface_num_verts(f);
+			int shader = clamp((int)f.mat_nr, 0, used_shaders.size()-1);
+			bool smooth = (f.flag & ME_SMOOTH) || arrays.use_loop_normals;
 
 			/* Create triangles.
 			 *
@@ -699,15 +861,16 @@ static void create_mesh(Scene *scene,
 	else {
 		vector<int> vi;
 
-		for(b_mesh.polygons.begin(p); p != b_mesh.polygons.end(); ++p) {
-			int n = p->loop_total();
-			int shader = clamp(p->material_index(), 0, used_shaders.size()-1);
-			bool smooth = p->use_smooth() || use_loop_normals;
+		for(int p = 0; p < arrays.num_polys; p++) {
+			const MPoly& poly = arrays.polys[p];
+			int n = poly.totloop;
+			int shader = clamp((int)poly.mat_nr, 0, used_shaders.size()-1);
+			bool smooth = (poly.flag & ME_SMOOTH) || arrays.use_loop_normals;
 
-			vi.reserve(n);
+			vi.resize(n);
 			for(int i = 0; i < n; i++) {
 				/* NOTE: Autosmooth is already taken care about. */
-				vi[i] = b_mesh.loops[p->loop_start() + i].vertex_index();
+				vi[i] = arrays.loops[poly.loopstart + i].v;
 			}
 
 			/* create subd faces */
@@ -718,8 +881,8 @@ static void create_mesh(Scene *scene,
 	/* Create all needed attributes.
 	 * The calculate functions will check whether they're needed or not.
 	 */
-	attr_create_vertex_color(scene, mesh, b_mesh, nverts, face_flags, subdivision);
-	attr_create_uv_map(scene, mesh, b_mesh, nverts, face_flags, subdivision, subdivide_uvs);
+	attr_create_vertex_color(scene, mesh, arrays, nverts, face_flags, subdivision);
+	attr_create_uv_map(scene, sync, pool);
 
 	/* for volume objects, create a matrix to transform from object space to
 	 * mesh texture space. this does not work with deformations but that can
@@ -728,32 +891,22 @@ static void create_mesh(Scene *scene,
 		Attribute *attr = mesh->attributes.add(ATTR_STD_GENERATED_TRANSFORM);
 		Transform *tfm = attr->data_transform();
 
-		float3 loc, size;
-		mesh_texture_space(b_mesh, loc, size);
-
-		*tfm = transform_translate(-loc)*transform_scale(size);
+		*tfm = transform_translate(-arrays.texspace_loc)*transform_scale(arrays.texspace_size);
 	}
 }
 
-static void create_subd_mesh(Scene *scene,
-                             Mesh *mesh,
-                             BL::Object& b_ob,
-                             BL::Mesh& b_mesh,
-                             const vector<Shader*>& used_shaders,
-                             float dicing_rate,
-                             int max_subdivisions)
+static void create_subd_mesh(Scene *scene, BlenderMeshSync *sync, TaskPool *pool)
 {
-	BL::SubsurfModifier subsurf_mod(b_ob.modifiers[b_ob.modifiers.length()-1]);
-	bool subdivide_uvs = subsurf_mod.use_subsurf_uv();
+	Mesh *mesh = sync->mesh;
+	const BlenderMeshArrays& arrays = sync->arrays;
 
-	create_mesh(scene, mesh, b_mesh, used_shaders, true, subdivide_uvs);
+	create_mesh(scene, sync, pool);
 
 	/* export creases */
 	size_t num_creases = 0;
-	BL::Mesh::edges_iterator e;
 
-	for(b_mesh.edges.begin(e); e != b_mesh.edges.end(); ++e) {
-		if(e->crease() != 0.0f) {
+	for(int i = 0; i < arrays.num_edges; i++) {
+		if(arrays.edges[i].crease != 0) {
 			num_creases++;
 		}
 	}
@@ -761,17 +914,27 @@ static void create_subd_mesh(Scene *scene,
 	mesh->subd_creases.resize(num_creases);
 
 	Mesh::SubdEdgeCrease* crease = mesh->subd_creases.data();
-	for(b_mesh.edges.begin(e); e != b_mesh.edges.end(); ++e) {
-		if(e->crease() != 0.0f) {
-			crease->v[0] = e->vertices()[0];
-			crease->v[1] = e->vertices()[1];
-			crease->crease = e->crease();
+	for(int i = 0; i < arrays.num_edges; i++) {
+		const MEdge& e = arrays.edges[i];
+
+		if(e.crease != 0) {
+			crease->v[0] = e.v1;
+			crease->v[1] = e.v2;
+			crease->crease = (uchar)e.crease / 255.0f;
 
 			crease++;
 		}
 	}
+}
 
-	/* set subd params */
+/* Set subdivision parameters, these read Blender data so it is done on the
+ * sync thread before the mesh gets converted. */
+static void create_subd_params(Scene *scene,
+                               Mesh *mesh,
+                               BL::Object& b_ob,
+                               float dicing_rate,
+                               int max_subdivisions)
+{
 	if(!mesh->subd_params) {
 		mesh->subd_params = new SubdParams(mesh);
 	}
@@ -901,13 +1064,17 @@ Mesh *BlenderSync::sync_mesh(BL::Object& b_ob,
 	
 	mesh_synced.insert(mesh);
 
+	BlenderMeshSync *mesh_sync = new BlenderMeshSync(mesh, b_ob);
+	mesh_sync->used_shaders = used_shaders;
+	mesh_sync->can_free_caches = can_free_caches;
+
 	/* create derived mesh */
-	array<int> oldtriangle = mesh->triangles;
+	mesh_sync->oldtriangle = mesh->triangles;
 	
 	/* compares curve_keys rather than strands in order to handle quick hair
 	 * adjustments in dynamic BVH - other methods could probably do this better*/
-	array<float3> oldcurve_keys = mesh->curve_keys;
-	array<float> oldcurve_radius = mesh->curve_radius;
+	mesh_sync->oldcurve_keys = mesh->curve_keys;
+	mesh_sync->oldcurve_radius = mesh->curve_radius;
 
 	mesh->clear();
 	mesh->used_shaders = used_shaders;
@@ -934,43 +1101,86 @@ Mesh *BlenderSync::sync_mesh(BL::Object& b_ob,
 			mesh->subdivision_type = Mesh::SUBDIVISION_NONE;
 		}
 
-		BL::Mesh b_mesh = object_to_mesh(b_data,
-		                                 b_ob,
-		                                 b_scene,
-		                                 true,
-		                                 !preview,
-		                                 need_undeformed,
-		                                 mesh->subdivision_type);
-
-		if(b_mesh) {
-			if(render_layer.use_surfaces && !hide_tris) {
-				if(mesh->subdivision_type != Mesh::SUBDIVISION_NONE)
-					create_subd_mesh(scene, mesh, b_ob, b_mesh, used_shaders,
-					                 dicing_rate, max_subdivisions);
-				else
-					create_mesh(scene, mesh, b_mesh, used_shaders, false);
+		BL::Mesh& b_mesh = mesh_sync->b_mesh;
+		b_mesh = object_to_mesh(b_data,
+		                        b_ob,
+		                        b_scene,
+		                        true,
+		                        !preview,
+		                        need_undeformed,
+		                        mesh->subdivision_type);
 
-				create_mesh_volume_attributes(scene, b_ob, mesh, b_scene.frame_current());
-			}
+		if(b_mesh && render_layer.use_surfaces && !hide_tris) {
+			mesh_sync->create_surface = true;
+
+			/* gather everything that needs RNA here, and convert the mesh
+			 * in a task while the remaining objects are synced */
+			bool use_loop_normals = b_mesh.use_auto_smooth() &&
+			                        (mesh->subdivision_type != Mesh::SUBDIVISION_CATMULL_CLARK);
 
-			if(render_layer.use_hair && mesh->subdivision_type == Mesh::SUBDIVISION_NONE)
-				sync_curves(mesh, b_mesh, b_ob, false);
+			if(mesh->subdivision_type != Mesh::SUBDIVISION_NONE) {
+				BL::SubsurfModifier subsurf_mod(b_ob.modifiers[b_ob.modifiers.length()-1]);
 
-			if(can_free_caches) {
-				b_ob.cache_release();
+				mesh_sync->subdivision = true;
+				mesh_sync->subdivide_uvs = subsurf_mod.use_subsurf_uv();
+				create_subd_params(scene, mesh, b_ob, dicing_rate, max_subdivisions);
 			}
 
-			/* free derived mesh */
-			b_data.meshes.remove(b_mesh, false);
+			mesh_arrays_gather(b_mesh,
+			                   mesh_sync->subdivision,
+			                   use_loop_normals,
+			                   &mesh_sync->arrays);
+
+			if(mesh_sync->subdivision)
+				mesh_pool.push(function_bind(&create_subd_mesh, scene, mesh_sync, &mesh_pool));
+			else
+				mesh_pool.push(function_bind(&create_mesh, scene, mesh_sync, &mesh_pool));
 		}
 	}
 	mesh->geometry_flags = requested_geometry_flags;
 
+	/* tag now, objects check if their mesh changed right after this */
+	mesh->tag_update(scene, false);
+
+	mesh_syncs.push_back(mesh_sync);
+
+	/* Derived meshes are kept until their conversion is finished, limit how
+	 * many are alive at the same time. */
+	if(mesh_syncs.size() >= (size_t)max(TaskScheduler::num_threads(), 1) * 4)
+		sync_meshes_wait();
+
+	return mesh;
+}
+
+void BlenderSync::sync_mesh_finish(BlenderMeshSync *mesh_sync)
+{
+	Mesh *mesh = mesh_sync->mesh;
+	BL::Object& b_ob = mesh_sync->b_ob;
+	BL::Mesh& b_mesh = mesh_sync->b_mesh;
+
+	if(b_mesh) {
+		if(mesh_sync->create_surface)
+			create_mesh_volume_attributes(scene, b_ob, mesh, b_scene.frame_current());
+
+		if(render_layer.use_hair && mesh->subdivision_type == Mesh::SUBDIVISION_NONE)
+			sync_curves(mesh, b_mesh, b_ob, false);
+
+		if(mesh_sync->can_free_caches) {
+			b_ob.cache_release();
+		}
+
+		/* free derived mesh */
+		b_data.meshes.remove(b_mesh, false);
+	}
+
 	/* fluid motion */
 	sync_mesh_fluid_motion(b_ob, scene, mesh);
 
 	/* tag update */
 	bool rebuild = false;
+	const array<int>& oldtriangle = mesh_sync->oldtriangle;
+	const array<float3>& oldcurve_keys = mesh_sync->oldcurve_keys;
+	const array<float>& oldcurve_radius = mesh_sync->oldcurve_radius;
 
 	if(oldtriangle.size() != mesh->triangles.size())
 		rebuild = true;
@@ -994,8 +1204,23 @@ Mesh *BlenderSync::sync_mesh(BL::Object& b_ob,
 	}
 	
 	mesh->tag_update(scene, rebuild);
+}
 
-	return mesh;
+void BlenderSync::sync_meshes_wait()
+{
+	if(mesh_syncs.size() == 0)
+		return;
+
+	mesh_pool.wait_work();
+
+	/* finish in the order meshes were synced, so image slots and everything
+	 * else added on the Blender side stays the same as before */
+	foreach(BlenderMeshSync *mesh_sync, mesh_syncs) {
+		sync_mesh_finish(mesh_sync);
+		delete mesh_sync;
+	}
+
+	mesh_syncs.clear();
 }
 
 void BlenderSync::sync_mesh_motion(BL::Object& b_ob,
@@ -600,6 +600,10 @@ void BlenderSync::sync_objects(BL::SpaceView3D& b_v3d, float motion_time)
 		}
 	}
 
+	/* finish meshes still being converted, also when cancelled so the
+	 * derived meshes get freed */
+	sync_meshes_wait();
+
 	progress.set_sync_status("");
 
 	if(!cancel && !motion) {
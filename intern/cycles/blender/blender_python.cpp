@@ -67,6 +67,10 @@ bool debug_flags_sync_from_scene(BL::Scene b_scene)
 	flags.cpu.sse3 = get_boolean(cscene, "debug_use_cpu_sse3");
 	flags.cpu.sse2 = get_boolean(cscene, "debug_use_cpu_sse2");
 	flags.cpu.qbvh = get_boolean(cscene, "debug_use_qbvh");
+	flags.cpu.obvh = get_boolean(cscene, "debug_use_obvh");
+	flags.cpu.stream = get_boolean(cscene, "debug_use_cpu_stream");
+	flags.cpu.shader_jit = get_boolean(cscene, "debug_use_cpu_shader_jit");
+	flags.cpu.shader_jit_verify = get_boolean(cscene, "debug_use_cpu_shader_jit_verify");
 	/* Synchronize CUDA flags. */
 	flags.cuda.adaptive_compile = get_boolean(cscene, "debug_use_cuda_adaptive_compile");
 	/* Synchronize OpenCL kernel type. */
@@ -497,7 +497,20 @@ void BlenderSession::render()
 			}
 		}
 
+		/* adaptive sampling needs all samples of a tile rendered at once */
+		if(scene->integrator->adaptive_threshold > 0.0f &&
+		   session_params.device.type == DEVICE_CPU &&
+		   !session_params.progressive)
+		{
+			Pass::add(PASS_ADAPTIVE_AUX_BUFFER, passes);
+		}
+
+		/* denoising is done on finished tiles, which progressive refine never has */
+		bool use_denoising = session_params.denoising.use && !session_params.progressive_refine;
+
 		buffer_params.passes = passes;
+		buffer_params.denoising_data_pass = use_denoising;
+		scene->film->denoising_data_pass = use_denoising;
 		scene->film->pass_alpha_threshold = b_layer_iter->pass_alpha_threshold();
 		scene->film->tag_passes_update(scene, passes);
 		scene->film->tag_update(scene);
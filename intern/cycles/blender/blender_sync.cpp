@@ -295,6 +295,17 @@ void BlenderSync::sync_integrator()
 	integrator->sample_all_lights_indirect = get_boolean(cscene, "sample_all_lights_indirect");
 	integrator->light_sampling_threshold = get_float(cscene, "light_sampling_threshold");
 
+	bool use_light_tree = get_boolean(cscene, "use_light_tree");
+	if(integrator->use_light_tree != use_light_tree)
+		scene->light_manager->tag_update(scene);
+	integrator->use_light_tree = use_light_tree;
+
+	integrator->adaptive_threshold = get_float(cscene, "adaptive_threshold");
+	integrator->adaptive_min_samples = get_int(cscene, "adaptive_min_samples");
+
+	integrator->use_path_guiding = get_boolean(cscene, "use_path_guiding");
+	integrator->path_guiding_memory = get_int(cscene, "path_guiding_memory");
+
 	int diffuse_samples = get_int(cscene, "diffuse_samples");
 	int glossy_samples = get_int(cscene, "glossy_samples");
 	int transmission_samples = get_int(cscene, "transmission_samples");
@@ -496,8 +507,18 @@ SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
 	else if(shadingsystem == 1)
 		params.shadingsystem = SHADINGSYSTEM_OSL;
 	
-	if(background)
+	if(background && params.shadingsystem != SHADINGSYSTEM_OSL)
+		params.persistent_data = r.use_persistent_data();
+	else
+		params.persistent_data = false;
+
+	/* With persistent data the scene is kept between frames. A dynamic BVH
+	 * keeps the mesh BVHs valid when only object transforms are animated,
+	 * then only the cheap top level BVH needs to be updated. */
+	if(background && !params.persistent_data)
 		params.bvh_type = SceneParams::BVH_STATIC;
+	else if(background)
+		params.bvh_type = SceneParams::BVH_DYNAMIC;
 	else
 		params.bvh_type = (SceneParams::BVHType)get_enum(
 		        cscene,
@@ -508,11 +529,9 @@ SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
 	params.use_bvh_spatial_split = RNA_boolean_get(&cscene, "debug_use_spatial_splits");
 	params.use_bvh_unaligned_nodes = RNA_boolean_get(&cscene, "debug_use_hair_bvh");
 	params.num_bvh_time_steps = RNA_int_get(&cscene, "debug_bvh_time_steps");
-
-	if(background && params.shadingsystem != SHADINGSYSTEM_OSL)
-		params.persistent_data = r.use_persistent_data();
-	else
-		params.persistent_data = false;
+	params.use_bvh_cache = background && RNA_boolean_get(&cscene, "use_bvh_cache");
+	params.use_compact_mesh = RNA_boolean_get(&cscene, "use_compact_mesh");
+	params.use_compact_curves = RNA_boolean_get(&cscene, "use_compact_hair");
 
 	int texture_limit;
 	if(background) {
@@ -528,6 +547,13 @@ SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
 		params.texture_limit = 0;
 	}
 
+	if(RNA_boolean_get(&cscene, "use_texture_cache")) {
+		params.texture_cache_size = RNA_int_get(&cscene, "texture_cache_size");
+	}
+	else {
+		params.texture_cache_size = 0;
+	}
+
 #if !(defined(__GNUC__) && (defined(i386) || defined(_M_IX86)))
 	if(is_cpu) {
 		params.use_qbvh = DebugFlags().cpu.qbvh && system_cpu_support_sse2();
@@ -538,6 +564,14 @@ SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
 		params.use_qbvh = false;
 	}
 
+	/* The octo BVH is only traversed by the AVX2 kernel, so it is only used
+	 * when that kernel will be picked by the CPU device. */
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX2
+	params.use_obvh = is_cpu && DebugFlags().cpu.obvh && system_cpu_support_avx2();
+#else
+	params.use_obvh = false;
+#endif
+
 	return params;
 }
 
@@ -676,6 +710,9 @@ SessionParams BlenderSync::get_session_params(BL::RenderEngine& b_engine,
 		params.tile_order = TILE_BOTTOM_TO_TOP;
 	}
 
+	/* save buffers writes render results into an EXR file with fixed tiles */
+	params.split_tiles = !(background && b_scene.render().use_save_buffers());
+
 	params.start_resolution = get_int(cscene, "preview_start_resolution");
 
 	/* other parameters */
@@ -690,6 +727,10 @@ SessionParams BlenderSync::get_session_params(BL::RenderEngine& b_engine,
 
 	params.progressive_refine = get_boolean(cscene, "use_progressive_refine");
 
+	/* path guiding learns in between passes over the entire image */
+	if(get_boolean(cscene, "use_path_guiding") && params.device.type == DEVICE_CPU)
+		params.progressive_refine = true;
+
 	if(background) {
 		if(params.progressive_refine)
 			params.progressive = true;
@@ -701,6 +742,12 @@ SessionParams BlenderSync::get_session_params(BL::RenderEngine& b_engine,
 	else
 		params.progressive = true;
 
+	/* denoising */
+	params.denoising.use = get_boolean(cscene, "use_denoising");
+	params.denoising.radius = get_int(cscene, "denoising_radius");
+	params.denoising.strength = get_float(cscene, "denoising_strength");
+	params.denoising.feature_strength = get_float(cscene, "denoising_feature_strength");
+
 	/* shading system - scene level needs full refresh */
 	const bool shadingsystem = RNA_boolean_get(&cscene, "shading_system");
 
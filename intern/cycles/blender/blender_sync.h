@@ -29,12 +29,14 @@
 
 #include "util_map.h"
 #include "util_set.h"
+#include "util_task.h"
 #include "util_transform.h"
 #include "util_vector.h"
 
 CCL_NAMESPACE_BEGIN
 
 class Background;
+struct BlenderMeshSync;
 class BlenderObjectCulling;
 class Camera;
 class Film;
@@ -111,6 +113,8 @@ private:
 
 	void sync_nodes(Shader *shader, BL::ShaderNodeTree& b_ntree);
 	Mesh *sync_mesh(BL::Object& b_ob, bool object_updated, bool hide_tris);
+	void sync_mesh_finish(BlenderMeshSync *mesh_sync);
+	void sync_meshes_wait();
 	void sync_curves(Mesh *mesh,
 	                 BL::Mesh& b_mesh,
 	                 BL::Object& b_ob,
@@ -165,6 +169,9 @@ private:
 	id_map<ParticleSystemKey, ParticleSystem> particle_system_map;
 	set<Mesh*> mesh_synced;
 	set<Mesh*> mesh_motion_synced;
+	/* meshes being converted in tasks, finished by sync_meshes_wait() */
+	vector<BlenderMeshSync*> mesh_syncs;
+	TaskPool mesh_pool;
 	set<float> motion_times;
 	void *world_map;
 	bool world_recalc;
@@ -26,12 +26,15 @@
 #include "bvh_params.h"
 #include "bvh_unaligned.h"
 
+#include "util_cache.h"
 #include "util_debug.h"
 #include "util_foreach.h"
+#include "util_function.h"
 #include "util_logging.h"
 #include "util_map.h"
 #include "util_progress.h"
 #include "util_system.h"
+#include "util_task.h"
 #include "util_types.h"
 #include "util_math.h"
 
@@ -58,13 +61,19 @@ struct BVHStackEntry
 /* BVH */
 
 BVH::BVH(const BVHParams& params_, const vector<Object*>& objects_)
-: params(params_), objects(objects_)
+: params(params_),
+  objects(objects_),
+  build_leaf_cost(0.0f),
+  top_level_nodes_size(0),
+  top_level_leaf_nodes_size(0)
 {
 }
 
 BVH *BVH::create(const BVHParams& params, const vector<Object*>& objects)
 {
-	if(params.use_qbvh)
+	if(params.use_obvh)
+		return new OBVH(params, objects);
+	else if(params.use_qbvh)
 		return new QBVH(params, objects);
 	else
 		return new RegularBVH(params, objects);
@@ -74,6 +83,9 @@ BVH *BVH::create(const BVHParams& params, const vector<Object*>& objects)
 
 void BVH::build(Progress& progress)
 {
+	if(cache_read(progress))
+		return;
+
 	progress.set_substatus("Building BVH");
 
 	/* build nodes */
@@ -99,25 +111,302 @@ void BVH::build(Progress& progress)
 		return;
 	}
 
+	/* reference for refits, before instances offset the primitive indices */
+	build_leaf_cost = leaf_cost(root);
+
 	/* pack nodes */
 	progress.set_substatus("Packing BVH nodes");
 	pack_nodes(root);
 
 	/* free build nodes */
 	root->deleteSubtree();
+
+	cache_write();
+}
+
+/* Disk Cache */
+
+#define BVH_CACHE_CATEGORY "bvh"
+
+/* Bump when the layout of the packed nodes or of the cached data changes,
+ * files written by older versions are then no longer found. */
+#define BVH_CACHE_VERSION 1
+
+/* Files of least recently used BVHs are removed above this size. */
+#define BVH_CACHE_MAX_SIZE ((uint64_t)8 << 30)
+
+static string bvh_cache_filename(const string& cache_key)
+{
+	return string_printf("%s_v%d", cache_key.c_str(), BVH_CACHE_VERSION);
+}
+
+bool BVH::cache_read(Progress& progress)
+{
+	if(cache_key.empty())
+		return false;
+
+	CacheData data;
+	if(!Cache::read(BVH_CACHE_CATEGORY, bvh_cache_filename(cache_key), data))
+		return false;
+
+	progress.set_substatus("Reading BVH from cache");
+
+	array<int4> nodes, leaf_nodes;
+	bool ok = data.read(pack.root_index) &&
+	          data.read(build_leaf_cost) &&
+	          data.read(pack.prim_index) &&
+	          data.read(pack.prim_type) &&
+	          data.read(pack.prim_object) &&
+	          data.read(nodes) &&
+	          data.read(leaf_nodes) &&
+	          pack.prim_type.size() == pack.prim_index.size() &&
+	          pack.prim_object.size() == pack.prim_index.size();
+
+	if(!ok) {
+		VLOG(1) << "Invalid BVH cache file " << cache_key << ", rebuilding.";
+		pack.prim_index.clear();
+		pack.prim_type.clear();
+		pack.prim_object.clear();
+		return false;
+	}
+
+	VLOG(1) << "Read BVH from cache " << cache_key << ".";
+
+	pack_primitives();
+
+	const size_t nodes_size = nodes.size();
+	const size_t leaf_nodes_size = leaf_nodes.size();
+	pack.nodes.steal_data(nodes);
+	pack.leaf_nodes.steal_data(leaf_nodes);
+
+	if(params.top_level) {
+		pack_instances(nodes_size, leaf_nodes_size);
+	}
+
+	return true;
+}
+
+void BVH::cache_write()
+{
+	if(cache_key.empty())
+		return;
+
+	/* Store the arrays as they are before pack_instances() merged in the
+	 * instanced BVHs, those are cached separately. */
+	const array<int>& prim_index = (params.top_level)? top_level_prim_index: pack.prim_index;
+	const size_t prim_size = prim_index.size();
+	const size_t nodes_size = (params.top_level)? top_level_nodes_size: pack.nodes.size();
+	const size_t leaf_nodes_size = (params.top_level)? top_level_leaf_nodes_size: pack.leaf_nodes.size();
+
+	CacheData data;
+	data.add(pack.root_index);
+	data.add(build_leaf_cost);
+	data.add(prim_index.data(), prim_size);
+	data.add(pack.prim_type.data(), prim_size);
+	data.add(pack.prim_object.data(), prim_size);
+	data.add(pack.nodes.data(), nodes_size);
+	data.add(pack.leaf_nodes.data(), leaf_nodes_size);
+
+	if(Cache::write(BVH_CACHE_CATEGORY, bvh_cache_filename(cache_key), data)) {
+		VLOG(1) << "Wrote BVH to cache " << cache_key << ".";
+	}
+}
+
+void BVH::cache_trim()
+{
+	Cache::trim(BVH_CACHE_CATEGORY, BVH_CACHE_MAX_SIZE);
 }
 
 /* Refitting */
 
-void BVH::refit(Progress& progress)
+bool BVH::refit(Progress& progress)
 {
+	if(params.top_level) {
+		unpack_instances();
+	}
+
 	progress.set_substatus("Packing BVH primitives");
 	pack_primitives();
 
-	if(progress.get_cancel()) return;
+	if(progress.get_cancel()) return false;
 
 	progress.set_substatus("Refitting BVH nodes");
-	refit_nodes();
+	float cost = refit_leaves();
+	bool refit = cost <= build_leaf_cost*params.refit_cost_threshold;
+
+	if(refit) {
+		refit_nodes();
+	}
+	else {
+		VLOG(1) << "BVH leaf cost increased from " << build_leaf_cost
+		        << " to " << cost << ", rebuild needed.";
+	}
+
+	refit_leaf_bounds.free_memory();
+	refit_leaf_visibility.free_memory();
+
+	if(!refit) {
+		return false;
+	}
+
+	if(params.top_level) {
+		pack_instances(top_level_nodes_size, top_level_leaf_nodes_size);
+	}
+
+	return true;
+}
+
+float BVH::leaf_cost(const BVHNode *root)
+{
+	vector<const BVHNode*> stack;
+	BoundBox bounds = BoundBox::empty;
+	float cost = 0.0f;
+
+	stack.push_back(root);
+
+	while(stack.size()) {
+		const BVHNode *node = stack.back();
+		stack.pop_back();
+
+		if(node->is_leaf()) {
+			const LeafNode *leaf = reinterpret_cast<const LeafNode*>(node);
+			BoundBox bbox = BoundBox::empty;
+			uint visibility = 0;
+
+			/* spatial splits clip leaf bounds, use full primitive bounds
+			 * to compare with refit_leaves() */
+			refit_primitives(leaf->m_lo, leaf->m_hi, bbox, visibility);
+
+			bounds.grow(bbox);
+			cost += bbox.safe_area()*leaf->num_triangles();
+		}
+		else {
+			for(int i = 0; i < node->num_children(); i++)
+				stack.push_back(node->get_child(i));
+		}
+	}
+
+	return (bounds.valid())? cost/max(bounds.safe_area(), 1e-20f): 0.0f;
+}
+
+float BVH::refit_leaves()
+{
+	const size_t num_leaves = pack.leaf_nodes.size();
+
+	refit_leaf_bounds.resize(num_leaves);
+	refit_leaf_visibility.resize(num_leaves);
+
+	/* primitives are the bulk of the work, refit leaves in parallel */
+	const size_t leaves_per_task = 4096;
+	TaskPool pool;
+
+	for(size_t start = 0; start < num_leaves; start += leaves_per_task) {
+		pool.push(function_bind(&BVH::refit_leaves_range,
+		                        this,
+		                        start,
+		                        min(start + leaves_per_task, num_leaves)));
+	}
+
+	pool.wait_work();
+
+	BoundBox bounds = BoundBox::empty;
+	float cost = 0.0f;
+
+	for(size_t i = 0; i < num_leaves; i++) {
+		const int4 c = pack.leaf_nodes[i];
+		const int num_prims = (c.x < 0)? 1: c.y - c.x;
+
+		bounds.grow(refit_leaf_bounds[i]);
+		cost += refit_leaf_bounds[i].safe_area()*num_prims;
+	}
+
+	return (bounds.valid())? cost/max(bounds.safe_area(), 1e-20f): 0.0f;
+}
+
+void BVH::refit_leaves_range(size_t start, size_t end)
+{
+	for(size_t i = start; i < end; i++) {
+		const int4 c = pack.leaf_nodes[i];
+		int lo = c.x, hi = c.y;
+
+		if(lo < 0) {
+			/* object instance */
+			lo = ~lo;
+			hi = lo + 1;
+		}
+
+		BoundBox bbox = BoundBox::empty;
+		uint visibility = 0;
+		refit_primitives(lo, hi, bbox, visibility);
+
+		refit_leaf_bounds[i] = bbox;
+		refit_leaf_visibility[i] = visibility;
+	}
+}
+
+void BVH::refit_primitives(int start, int end, BoundBox& bbox, uint& visibility)
+{
+	for(int prim = start; prim < end; prim++) {
+		int pidx = pack.prim_index[prim];
+		int tob = pack.prim_object[prim];
+		Object *ob = objects[tob];
+
+		if(pidx == -1) {
+			/* object instance */
+			bbox.grow(ob->bounds);
+		}
+		else {
+			/* primitives */
+			const Mesh *mesh = ob->mesh;
+
+			if(pack.prim_type[prim] & PRIMITIVE_ALL_CURVE) {
+				/* curves */
+				Mesh::Curve curve = mesh->get_curve(pidx);
+				int k = PRIMITIVE_UNPACK_SEGMENT(pack.prim_type[prim]);
+
+				curve.bounds_grow(k, &mesh->curve_keys[0], &mesh->curve_radius[0], bbox);
+
+				visibility |= PATH_RAY_CURVE;
+
+				/* motion curves */
+				if(mesh->use_motion_blur) {
+					Attribute *attr = mesh->curve_attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
+
+					if(attr) {
+						size_t mesh_size = mesh->curve_keys.size();
+						size_t steps = mesh->motion_steps - 1;
+						float3 *key_steps = attr->data_float3();
+
+						for(size_t i = 0; i < steps; i++)
+							curve.bounds_grow(k, key_steps + i*mesh_size, &mesh->curve_radius[0], bbox);
+					}
+				}
+			}
+			else {
+				/* triangles */
+				Mesh::Triangle triangle = mesh->get_triangle(pidx);
+				const float3 *vpos = &mesh->verts[0];
+
+				triangle.bounds_grow(vpos, bbox);
+
+				/* motion triangles */
+				if(mesh->use_motion_blur) {
+					Attribute *attr = mesh->attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
+
+					if(attr) {
+						size_t mesh_size = mesh->verts.size();
+						size_t steps = mesh->motion_steps - 1;
+						float3 *vert_steps = attr->data_float3();
+
+						for(size_t i = 0; i < steps; i++)
+							triangle.bounds_grow(vert_steps + i*mesh_size, bbox);
+					}
+				}
+			}
+		}
+
+		visibility |= ob->visibility;
+	}
 }
 
 /* Triangles */
@@ -189,6 +478,17 @@ void BVH::pack_primitives()
 
 /* Pack Instances */
 
+void BVH::unpack_instances()
+{
+	const size_t prim_index_size = top_level_prim_index.size();
+
+	pack.prim_index = top_level_prim_index;
+	pack.prim_type.resize(prim_index_size);
+	pack.prim_object.resize(prim_index_size);
+	pack.nodes.resize(top_level_nodes_size);
+	pack.leaf_nodes.resize(top_level_leaf_nodes_size);
+}
+
 void BVH::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
 {
 	/* The BVH's for instances are built separately, but for traversal all
@@ -196,6 +496,12 @@ void BVH::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
 	 * top level BVH, adjusting indexes and offsets where appropriate.
 	 */
 	const bool use_qbvh = params.use_qbvh;
+	const bool use_obvh = params.use_obvh;
+
+	/* Remember top level part of the arrays for refitting. */
+	top_level_prim_index = pack.prim_index;
+	top_level_nodes_size = nodes_size;
+	top_level_leaf_nodes_size = leaf_nodes_size;
 
 	/* Adjust primitive index to point to the triangle in the global array, for
 	 * meshes with transform applied and already in the top level BVH.
@@ -363,39 +669,55 @@ void BVH::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
 			for(size_t i = 0, j = 0; i < bvh_nodes_size; j++) {
 				size_t nsize, nsize_bbox;
 				if(bvh_nodes[i].x & PATH_RAY_NODE_UNALIGNED) {
-					nsize = use_qbvh
-					            ? BVH_UNALIGNED_QNODE_SIZE
-					            : BVH_UNALIGNED_NODE_SIZE;
-					nsize_bbox = (use_qbvh)? 13: 0;
+					if(use_obvh) {
+						nsize = BVH_UNALIGNED_ONODE_SIZE;
+						nsize_bbox = 25;
+					}
+					else {
+						nsize = use_qbvh
+						            ? BVH_UNALIGNED_QNODE_SIZE
+						            : BVH_UNALIGNED_NODE_SIZE;
+						nsize_bbox = (use_qbvh)? 13: 0;
+					}
 				}
 				else {
-					nsize = (use_qbvh)? BVH_QNODE_SIZE: BVH_NODE_SIZE;
-					nsize_bbox = (use_qbvh)? 7: 0;
+					if(use_obvh) {
+						nsize = BVH_ONODE_SIZE;
+						nsize_bbox = 13;
+					}
+					else {
+						nsize = (use_qbvh)? BVH_QNODE_SIZE: BVH_NODE_SIZE;
+						nsize_bbox = (use_qbvh)? 7: 0;
+					}
 				}
 
 				memcpy(pack_nodes + pack_nodes_offset,
 				       bvh_nodes + i,
 				       nsize_bbox*sizeof(int4));
 
-				/* Modify offsets into arrays */
-				int4 data = bvh_nodes[i + nsize_bbox];
+				/* Modify offsets into arrays, octo nodes store their eight
+				 * children in two int4. */
+				const size_t nsize_children = (use_obvh)? 2: 1;
+				for(size_t k = 0; k < nsize_children; k++) {
+					int4 data = bvh_nodes[i + nsize_bbox + k];
 
-				data.z += (data.z < 0)? -noffset_leaf: noffset;
-				data.w += (data.w < 0)? -noffset_leaf: noffset;
+					data.z += (data.z < 0)? -noffset_leaf: noffset;
+					data.w += (data.w < 0)? -noffset_leaf: noffset;
 
-				if(use_qbvh) {
-					data.x += (data.x < 0)? -noffset_leaf: noffset;
-					data.y += (data.y < 0)? -noffset_leaf: noffset;
-				}
+					if(use_qbvh || use_obvh) {
+						data.x += (data.x < 0)? -noffset_leaf: noffset;
+						data.y += (data.y < 0)? -noffset_leaf: noffset;
+					}
 
-				pack_nodes[pack_nodes_offset + nsize_bbox] = data;
+					pack_nodes[pack_nodes_offset + nsize_bbox + k] = data;
+				}
 
 				/* Usually this copies nothing, but we better
 				 * be prepared for possible node size extension.
 				 */
-				memcpy(&pack_nodes[pack_nodes_offset + nsize_bbox+1],
-				       &bvh_nodes[i + nsize_bbox+1],
-				       sizeof(int4) * (nsize - (nsize_bbox+1)));
+				memcpy(&pack_nodes[pack_nodes_offset + nsize_bbox + nsize_children],
+				       &bvh_nodes[i + nsize_bbox + nsize_children],
+				       sizeof(int4) * (nsize - (nsize_bbox + nsize_children)));
 
 				pack_nodes_offset += nsize;
 				i += nsize;
@@ -622,8 +944,6 @@ void RegularBVH::pack_nodes(const BVHNode *root)
 
 void RegularBVH::refit_nodes()
 {
-	assert(!params.top_level);
-
 	BoundBox bbox = BoundBox::empty;
 	uint visibility = 0;
 	refit_node(0, (pack.root_index == -1)? true: false, bbox, visibility);
@@ -637,69 +957,8 @@ void RegularBVH::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility
 		const int c0 = data[0].x;
 		const int c1 = data[0].y;
 		/* refit leaf node */
-		for(int prim = c0; prim < c1; prim++) {
-			int pidx = pack.prim_index[prim];
-			int tob = pack.prim_object[prim];
-			Object *ob = objects[tob];
-
-			if(pidx == -1) {
-				/* object instance */
-				bbox.grow(ob->bounds);
-			}
-			else {
-				/* primitives */
-				const Mesh *mesh = ob->mesh;
-
-				if(pack.prim_type[prim] & PRIMITIVE_ALL_CURVE) {
-					/* curves */
-					int str_offset = (params.top_level)? mesh->curve_offset: 0;
-					Mesh::Curve curve = mesh->get_curve(pidx - str_offset);
-					int k = PRIMITIVE_UNPACK_SEGMENT(pack.prim_type[prim]);
-
-					curve.bounds_grow(k, &mesh->curve_keys[0], &mesh->curve_radius[0], bbox);
-
-					visibility |= PATH_RAY_CURVE;
-
-					/* motion curves */
-					if(mesh->use_motion_blur) {
-						Attribute *attr = mesh->curve_attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
-
-						if(attr) {
-							size_t mesh_size = mesh->curve_keys.size();
-							size_t steps = mesh->motion_steps - 1;
-							float3 *key_steps = attr->data_float3();
-
-							for(size_t i = 0; i < steps; i++)
-								curve.bounds_grow(k, key_steps + i*mesh_size, &mesh->curve_radius[0], bbox);
-						}
-					}
-				}
-				else {
-					/* triangles */
-					int tri_offset = (params.top_level)? mesh->tri_offset: 0;
-					Mesh::Triangle triangle = mesh->get_triangle(pidx - tri_offset);
-					const float3 *vpos = &mesh->verts[0];
-
-					triangle.bounds_grow(vpos, bbox);
-
-					/* motion triangles */
-					if(mesh->use_motion_blur) {
-						Attribute *attr = mesh->attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
-
-						if(attr) {
-							size_t mesh_size = mesh->verts.size();
-							size_t steps = mesh->motion_steps - 1;
-							float3 *vert_steps = attr->data_float3();
-
-							for(size_t i = 0; i < steps; i++)
-								triangle.bounds_grow(vert_steps + i*mesh_size, bbox);
-						}
-					}
-				}
-			}
-
-			visibility |= ob->visibility;
-		}
+		bbox.grow(refit_leaf_bounds[idx]);
+		visibility |= refit_leaf_visibility[idx];
 
 		/* TODO(sergey): De-duplicate with pack_leaf(). */
 		float4 leaf_data[BVH_NODE_LEAF_SIZE];
@@ -1088,8 +1347,6 @@ void QBVH::pack_nodes(const BVHNode *root)
 
 void QBVH::refit_nodes()
 {
-	assert(!params.top_level);
-
 	BoundBox bbox = BoundBox::empty;
 	uint visibility = 0;
 	refit_node(0, (pack.root_index == -1)? true: false, bbox, visibility);
@@ -1101,69 +1358,8 @@ void QBVH::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
 		int4 *data = &pack.leaf_nodes[idx];
 		int4 c = data[0];
 		/* Refit leaf node. */
-		for(int prim = c.x; prim < c.y; prim++) {
-			int pidx = pack.prim_index[prim];
-			int tob = pack.prim_object[prim];
-			Object *ob = objects[tob];
-
-			if(pidx == -1) {
-				/* Object instance. */
-				bbox.grow(ob->bounds);
-			}
-			else {
-				/* Primitives. */
-				const Mesh *mesh = ob->mesh;
-
-				if(pack.prim_type[prim] & PRIMITIVE_ALL_CURVE) {
-					/* Curves. */
-					int str_offset = (params.top_level)? mesh->curve_offset: 0;
-					Mesh::Curve curve = mesh->get_curve(pidx - str_offset);
-					int k = PRIMITIVE_UNPACK_SEGMENT(pack.prim_type[prim]);
-
-					curve.bounds_grow(k, &mesh->curve_keys[0], &mesh->curve_radius[0], bbox);
-
-					visibility |= PATH_RAY_CURVE;
-
-					/* Motion curves. */
-					if(mesh->use_motion_blur) {
-						Attribute *attr = mesh->curve_attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
-
-						if(attr) {
-							size_t mesh_size = mesh->curve_keys.size();
-							size_t steps = mesh->motion_steps - 1;
-							float3 *key_steps = attr->data_float3();
-
-							for(size_t i = 0; i < steps; i++)
-								curve.bounds_grow(k, key_steps + i*mesh_size, &mesh->curve_radius[0], bbox);
-						}
-					}
-				}
-				else {
-					/* Triangles. */
-					int tri_offset = (params.top_level)? mesh->tri_offset: 0;
-					Mesh::Triangle triangle = mesh->get_triangle(pidx - tri_offset);
-					const float3 *vpos = &mesh->verts[0];
-
-					triangle.bounds_grow(vpos, bbox);
-
-					/* Motion triangles. */
-					if(mesh->use_motion_blur) {
-						Attribute *attr = mesh->attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
-
-						if(attr) {
-							size_t mesh_size = mesh->verts.size();
-							size_t steps = mesh->motion_steps - 1;
-							float3 *vert_steps = attr->data_float3();
-
-							for(size_t i = 0; i < steps; i++)
-								triangle.bounds_grow(vert_steps + i*mesh_size, bbox);
-						}
-					}
-				}
-			}
-
-			visibility |= ob->visibility;
-		}
+		bbox.grow(refit_leaf_bounds[idx]);
+		visibility |= refit_leaf_visibility[idx];
 
 		/* TODO(sergey): This is actually a copy of pack_leaf(),
 		 * but this chunk of code only knows actual data and has
@@ -1236,4 +1432,387 @@ void QBVH::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
 	}
 }
 
+/* OBVH */
+
+/* Same as node_qbvh_is_unaligned(), for the children of the octo node. */
+static bool node_obvh_is_unaligned(const BVHNode *node)
+{
+	const BVHNode *children[8];
+	const int num_children = node->get_wide_children(children, 8);
+	bool has_unaligned = false;
+	for(int i = 0; i < num_children; i++) {
+		has_unaligned |= children[i]->is_unaligned();
+	}
+	return has_unaligned;
+}
+
+OBVH::OBVH(const BVHParams& params_, const vector<Object*>& objects_)
+: BVH(params_, objects_)
+{
+	params.use_obvh = true;
+}
+
+void OBVH::pack_leaf(const BVHStackEntry& e, const LeafNode *leaf)
+{
+	float4 data[BVH_ONODE_LEAF_SIZE];
+	memset(data, 0, sizeof(data));
+	if(leaf->num_triangles() == 1 && pack.prim_index[leaf->m_lo] == -1) {
+		/* object */
+		data[0].x = __int_as_float(~(leaf->m_lo));
+		data[0].y = __int_as_float(0);
+	}
+	else {
+		/* triangle */
+		data[0].x = __int_as_float(leaf->m_lo);
+		data[0].y = __int_as_float(leaf->m_hi);
+	}
+	data[0].z = __uint_as_float(leaf->m_visibility);
+	if(leaf->num_triangles() != 0) {
+		data[0].w = __uint_as_float(pack.prim_type[leaf->m_lo]);
+	}
+
+	memcpy(&pack.leaf_nodes[e.idx], data, sizeof(float4)*BVH_ONODE_LEAF_SIZE);
+}
+
+void OBVH::pack_inner(const BVHStackEntry& e,
+                      const BVHStackEntry *en,
+                      int num)
+{
+	bool has_unaligned = false;
+	/* Check whether we have to create unaligned node or all nodes are aligned
+	 * and we can cut some corner here.
+	 */
+	if(params.use_unaligned_nodes) {
+		for(int i = 0; i < num; i++) {
+			if(en[i].node->is_unaligned()) {
+				has_unaligned = true;
+				break;
+			}
+		}
+	}
+	if(has_unaligned) {
+		pack_unaligned_inner(e, en, num);
+	}
+	else {
+		pack_aligned_inner(e, en, num);
+	}
+}
+
+void OBVH::pack_aligned_inner(const BVHStackEntry& e,
+                              const BVHStackEntry *en,
+                              int num)
+{
+	BoundBox bounds[8];
+	int child[8];
+	for(int i = 0; i < num; ++i) {
+		bounds[i] = en[i].node->m_bounds;
+		child[i] = en[i].encodeIdx();
+	}
+	pack_aligned_node(e.idx,
+	                  bounds,
+	                  child,
+	                  e.node->m_visibility,
+	                  e.node->m_time_from,
+	                  e.node->m_time_to,
+	                  num);
+}
+
+void OBVH::pack_aligned_node(int idx,
+                             const BoundBox *bounds,
+                             const int *child,
+                             const uint visibility,
+                             const float time_from,
+                             const float time_to,
+                             const int num)
+{
+	float4 data[BVH_ONODE_SIZE];
+	memset(data, 0, sizeof(data));
+
+	data[0].x = __uint_as_float(visibility & ~PATH_RAY_NODE_UNALIGNED);
+	data[0].y = time_from;
+	data[0].z = time_to;
+
+	/* Children 0-3 go into the first and children 4-7 into the second float4
+	 * of every row. */
+	for(int i = 0; i < 8; i++) {
+		const int half = i / 4;
+		const int lane = i % 4;
+
+		if(i < num) {
+			float3 bb_min = bounds[i].min;
+			float3 bb_max = bounds[i].max;
+
+			data[1 + half][lane] = bb_min.x;
+			data[3 + half][lane] = bb_max.x;
+			data[5 + half][lane] = bb_min.y;
+			data[7 + half][lane] = bb_max.y;
+			data[9 + half][lane] = bb_min.z;
+			data[11 + half][lane] = bb_max.z;
+
+			data[13 + half][lane] = __int_as_float(child[i]);
+		}
+		else {
+			/* We store BB which would never be recorded as intersection
+			 * so kernel might safely assume there are always 8 child nodes.
+			 */
+			data[1 + half][lane] = FLT_MAX;
+			data[3 + half][lane] = -FLT_MAX;
+			data[5 + half][lane] = FLT_MAX;
+			data[7 + half][lane] = -FLT_MAX;
+			data[9 + half][lane] = FLT_MAX;
+			data[11 + half][lane] = -FLT_MAX;
+
+			data[13 + half][lane] = __int_as_float(0);
+		}
+	}
+
+	memcpy(&pack.nodes[idx], data, sizeof(float4)*BVH_ONODE_SIZE);
+}
+
+void OBVH::pack_unaligned_inner(const BVHStackEntry& e,
+                                const BVHStackEntry *en,
+                                int num)
+{
+	Transform aligned_space[8];
+	BoundBox bounds[8];
+	int child[8];
+	for(int i = 0; i < num; ++i) {
+		aligned_space[i] = en[i].node->get_aligned_space();
+		bounds[i] = en[i].node->m_bounds;
+		child[i] = en[i].encodeIdx();
+	}
+	pack_unaligned_node(e.idx,
+	                    aligned_space,
+	                    bounds,
+	                    child,
+	                    e.node->m_visibility,
+	                    e.node->m_time_from,
+	                    e.node->m_time_to,
+	                    num);
+}
+
+void OBVH::pack_unaligned_node(int idx,
+                               const Transform *aligned_space,
+                               const BoundBox *bounds,
+                               const int *child,
+                               const uint visibility,
+                               const float time_from,
+                               const float time_to,
+                               const int num)
+{
+	float4 data[BVH_UNALIGNED_ONODE_SIZE];
+	memset(data, 0, sizeof(data));
+
+	data[0].x = __uint_as_float(visibility | PATH_RAY_NODE_UNALIGNED);
+	data[0].y = time_from;
+	data[0].z = time_to;
+
+	for(int i = 0; i < 8; i++) {
+		const int half = i / 4;
+		const int lane = i % 4;
+
+		if(i < num) {
+			Transform space = BVHUnaligned::compute_node_transform(
+			        bounds[i],
+			        aligned_space[i]);
+
+			data[1 + half][lane] = space.x.x;
+			data[3 + half][lane] = space.x.y;
+			data[5 + half][lane] = space.x.z;
+
+			data[7 + half][lane] = space.y.x;
+			data[9 + half][lane] = space.y.y;
+			data[11 + half][lane] = space.y.z;
+
+			data[13 + half][lane] = space.z.x;
+			data[15 + half][lane] = space.z.y;
+			data[17 + half][lane] = space.z.z;
+
+			data[19 + half][lane] = space.x.w;
+			data[21 + half][lane] = space.y.w;
+			data[23 + half][lane] = space.z.w;
+
+			data[25 + half][lane] = __int_as_float(child[i]);
+		}
+		else {
+			/* We store BB which would never be recorded as intersection
+			 * so kernel might safely assume there are always 8 child nodes.
+			 */
+			data[1 + half][lane] = 1.0f;
+			data[3 + half][lane] = 0.0f;
+			data[5 + half][lane] = 0.0f;
+
+			data[7 + half][lane] = 0.0f;
+			data[9 + half][lane] = 0.0f;
+			data[11 + half][lane] = 0.0f;
+
+			data[13 + half][lane] = 0.0f;
+			data[15 + half][lane] = 0.0f;
+			data[17 + half][lane] = 0.0f;
+
+			data[19 + half][lane] = -FLT_MAX;
+			data[21 + half][lane] = -FLT_MAX;
+			data[23 + half][lane] = -FLT_MAX;
+
+			data[25 + half][lane] = __int_as_float(0);
+		}
+	}
+
+	memcpy(&pack.nodes[idx], data, sizeof(float4)*BVH_UNALIGNED_ONODE_SIZE);
+}
+
+/* Octo SIMD Nodes */
+
+void OBVH::pack_nodes(const BVHNode *root)
+{
+	/* Calculate size of the arrays required. */
+	const size_t num_nodes = root->getSubtreeSize(BVH_STAT_ONODE_COUNT);
+	const size_t num_leaf_nodes = root->getSubtreeSize(BVH_STAT_LEAF_COUNT);
+	assert(num_leaf_nodes <= num_nodes);
+	const size_t num_inner_nodes = num_nodes - num_leaf_nodes;
+	size_t node_size;
+	if(params.use_unaligned_nodes) {
+		const size_t num_unaligned_nodes =
+		        root->getSubtreeSize(BVH_STAT_UNALIGNED_INNER_ONODE_COUNT);
+		node_size = (num_unaligned_nodes * BVH_UNALIGNED_ONODE_SIZE) +
+		            (num_inner_nodes - num_unaligned_nodes) * BVH_ONODE_SIZE;
+	}
+	else {
+		node_size = num_inner_nodes * BVH_ONODE_SIZE;
+	}
+	/* Resize arrays. */
+	pack.nodes.clear();
+	pack.leaf_nodes.clear();
+	/* For top level BVH, first merge existing BVH's so we know the offsets. */
+	if(params.top_level) {
+		pack_instances(node_size, num_leaf_nodes*BVH_ONODE_LEAF_SIZE);
+	}
+	else {
+		pack.nodes.resize(node_size);
+		pack.leaf_nodes.resize(num_leaf_nodes*BVH_ONODE_LEAF_SIZE);
+	}
+
+	int nextNodeIdx = 0, nextLeafNodeIdx = 0;
+
+	vector<BVHStackEntry> stack;
+	stack.reserve(BVHParams::MAX_DEPTH*7);
+	if(root->is_leaf()) {
+		stack.push_back(BVHStackEntry(root, nextLeafNodeIdx++));
+	}
+	else {
+		stack.push_back(BVHStackEntry(root, nextNodeIdx));
+		nextNodeIdx += node_obvh_is_unaligned(root)
+		                       ? BVH_UNALIGNED_ONODE_SIZE
+		                       : BVH_ONODE_SIZE;
+	}
+
+	while(stack.size()) {
+		BVHStackEntry e = stack.back();
+		stack.pop_back();
+
+		if(e.node->is_leaf()) {
+			/* leaf node */
+			const LeafNode *leaf = reinterpret_cast<const LeafNode*>(e.node);
+			pack_leaf(e, leaf);
+		}
+		else {
+			/* Inner node. */
+			const BVHNode *nodes[8];
+			const int numnodes = e.node->get_wide_children(nodes, 8);
+			/* Push entries on the stack. */
+			for(int i = 0; i < numnodes; ++i) {
+				int idx;
+				if(nodes[i]->is_leaf()) {
+					idx = nextLeafNodeIdx++;
+				}
+				else {
+					idx = nextNodeIdx;
+					nextNodeIdx += node_obvh_is_unaligned(nodes[i])
+					                       ? BVH_UNALIGNED_ONODE_SIZE
+					                       : BVH_ONODE_SIZE;
+				}
+				stack.push_back(BVHStackEntry(nodes[i], idx));
+			}
+			/* Set node. */
+			pack_inner(e, &stack[stack.size()-numnodes], numnodes);
+		}
+	}
+	assert(node_size == nextNodeIdx);
+	/* Root index to start traversal at, to handle case of single leaf node. */
+	pack.root_index = (root->is_leaf())? -1: 0;
+}
+
+void OBVH::refit_nodes()
+{
+	BoundBox bbox = BoundBox::empty;
+	uint visibility = 0;
+	refit_node(0, (pack.root_index == -1)? true: false, bbox, visibility);
+}
+
+void OBVH::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
+{
+	if(leaf) {
+		int4 *data = &pack.leaf_nodes[idx];
+		int4 c = data[0];
+		/* Refit leaf node. */
+		bbox.grow(refit_leaf_bounds[idx]);
+		visibility |= refit_leaf_visibility[idx];
+
+		float4 leaf_data[BVH_ONODE_LEAF_SIZE];
+		leaf_data[0].x = __int_as_float(c.x);
+		leaf_data[0].y = __int_as_float(c.y);
+		leaf_data[0].z = __uint_as_float(visibility);
+		leaf_data[0].w = __uint_as_float(c.w);
+		memcpy(&pack.leaf_nodes[idx], leaf_data, sizeof(float4)*BVH_ONODE_LEAF_SIZE);
+	}
+	else {
+		int4 *data = &pack.nodes[idx];
+		bool is_unaligned = (data[0].x & PATH_RAY_NODE_UNALIGNED) != 0;
+		const int4 *children = (is_unaligned)? &data[25]: &data[13];
+		int c[8];
+		for(int i = 0; i < 8; ++i) {
+			c[i] = children[i / 4][i % 4];
+		}
+		/* Refit inner node, set bbox from children. */
+		BoundBox child_bbox[8] = {BoundBox::empty, BoundBox::empty,
+		                          BoundBox::empty, BoundBox::empty,
+		                          BoundBox::empty, BoundBox::empty,
+		                          BoundBox::empty, BoundBox::empty};
+		uint child_visibility[8] = {0};
+
+		for(int i = 0; i < 8; ++i) {
+			if(c[i] != 0) {
+				refit_node((c[i] < 0)? -c[i]-1: c[i], (c[i] < 0),
+				           child_bbox[i], child_visibility[i]);
+				bbox.grow(child_bbox[i]);
+				visibility |= child_visibility[i];
+			}
+		}
+
+		if(is_unaligned) {
+			Transform aligned_space[8];
+			for(int i = 0; i < 8; ++i) {
+				aligned_space[i] = transform_identity();
+			}
+			pack_unaligned_node(idx,
+			                    aligned_space,
+			                    child_bbox,
+			                    c,
+			                    visibility,
+			                    0.0f,
+			                    1.0f,
+			                    8);
+		}
+		else {
+			pack_aligned_node(idx,
+			                  child_bbox,
+			                  c,
+			                  visibility,
+			                  0.0f,
+			                  1.0f,
+			                  8);
+		}
+	}
+}
+
 CCL_NAMESPACE_END
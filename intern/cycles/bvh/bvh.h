@@ -37,11 +37,14 @@ class Progress;
 #define BVH_NODE_LEAF_SIZE	1
 #define BVH_QNODE_SIZE	8
 #define BVH_QNODE_LEAF_SIZE	1
+#define BVH_ONODE_SIZE	15
+#define BVH_ONODE_LEAF_SIZE	1
 #define BVH_ALIGN		4096
 #define TRI_NODE_SIZE	3
 
 #define BVH_UNALIGNED_NODE_SIZE 7
 #define BVH_UNALIGNED_QNODE_SIZE 14
+#define BVH_UNALIGNED_ONODE_SIZE 27
 
 /* Packed BVH
  *
@@ -86,22 +89,61 @@ public:
 	PackedBVH pack;
 	BVHParams params;
 	vector<Object*> objects;
+	/* Content hash of everything the BVH is built from. When set, the
+	 * packed nodes are read from and written to the disk cache. */
+	string cache_key;
 
 	static BVH *create(const BVHParams& params, const vector<Object*>& objects);
 	virtual ~BVH() {}
 
+	/* Remove least recently used files from the disk cache. */
+	static void cache_trim();
+
 	void build(Progress& progress);
-	void refit(Progress& progress);
+
+	/* Update bounds for changed primitive positions, keeping the tree
+	 * structure. Returns false when the quality of the tree degraded too
+	 * much, the BVH must be rebuilt in that case. */
+	bool refit(Progress& progress);
 
 protected:
 	BVH(const BVHParams& params, const vector<Object*>& objects);
 
+	/* Leaf SAH cost of the tree after building, relative to root area. */
+	float build_leaf_cost;
+
+	/* Top level part of the arrays before instances are merged in, so the
+	 * top level BVH can be refitted. */
+	array<int> top_level_prim_index;
+	size_t top_level_nodes_size;
+	size_t top_level_leaf_nodes_size;
+
+	/* Leaf bounds and visibility computed by refit_leaves(), indexed by the
+	 * leaf node. All node layouts use a single int4 per leaf. */
+	vector<BoundBox> refit_leaf_bounds;
+	vector<uint> refit_leaf_visibility;
+
+	/* disk cache of the packed nodes, before instances are merged in */
+	bool cache_read(Progress& progress);
+	void cache_write();
+
 	/* triangles and strands */
 	void pack_primitives();
 	void pack_triangle(int idx, float4 storage[3]);
 
 	/* merge instance BVH's */
 	void pack_instances(size_t nodes_size, size_t leaf_nodes_size);
+	/* restore top level arrays as they were before pack_instances() */
+	void unpack_instances();
+
+	/* grow bbox and visibility by the primitives of a leaf */
+	void refit_primitives(int start, int end, BoundBox& bbox, uint& visibility);
+
+	/* leaf SAH cost of the built tree */
+	float leaf_cost(const BVHNode *root);
+	/* compute bounds of all packed leaves in parallel, returns leaf SAH cost */
+	float refit_leaves();
+	void refit_leaves_range(size_t start, size_t end);
 
 	/* for subclasses to implement */
 	virtual void pack_nodes(const BVHNode *root) = 0;
@@ -196,6 +238,50 @@ protected:
 	void refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility);
 };
 
+/* OBVH
+ *
+ * Octo BVH, with each node having eight children, to use with AVX2 instructions. */
+
+class OBVH : public BVH {
+protected:
+	/* constructor */
+	friend class BVH;
+	OBVH(const BVHParams& params, const vector<Object*>& objects);
+
+	/* pack */
+	void pack_nodes(const BVHNode *root);
+
+	void pack_leaf(const BVHStackEntry& e, const LeafNode *leaf);
+	void pack_inner(const BVHStackEntry& e, const BVHStackEntry *en, int num);
+
+	void pack_aligned_inner(const BVHStackEntry& e,
+	                        const BVHStackEntry *en,
+	                        int num);
+	void pack_aligned_node(int idx,
+	                       const BoundBox *bounds,
+	                       const int *child,
+	                       const uint visibility,
+	                       const float time_from,
+	                       const float time_to,
+	                       const int num);
+
+	void pack_unaligned_inner(const BVHStackEntry& e,
+	                          const BVHStackEntry *en,
+	                          int num);
+	void pack_unaligned_node(int idx,
+	                         const Transform *aligned_space,
+	                         const BoundBox *bounds,
+	                         const int *child,
+	                         const uint visibility,
+	                         const float time_from,
+	                         const float time_to,
+	                         const int num);
+
+	/* refit */
+	void refit_nodes();
+	void refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility);
+};
+
 CCL_NAMESPACE_END
 
 #endif /* __BVH_H__ */
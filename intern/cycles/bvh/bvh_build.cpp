@@ -955,18 +955,20 @@ BVHNode* BVHBuild::create_leaf_node(const BVHRange& range,
 		if(num != 0) {
 			assert(p_type[i].size() == p_index[i].size());
 			assert(p_type[i].size() == p_object[i].size());
-			Transform aligned_space;
-			bool alignment_found = false;
 			for(int j = 0; j < num; ++j) {
 				const int index = start_index + j;
 				local_prim_type[index] = p_type[i][j];
 				local_prim_index[index] = p_index[i][j];
 				local_prim_object[index] = p_object[i][j];
-				if(params.use_unaligned_nodes && !alignment_found) {
-					alignment_found =
-						unaligned_heuristic.compute_aligned_space(p_ref[i][j],
-						                                          &aligned_space);
-				}
+			}
+			/* Curve leaves get a box oriented along their segments. */
+			Transform aligned_space;
+			bool alignment_found = false;
+			if(params.use_unaligned_nodes) {
+				alignment_found =
+				        unaligned_heuristic.compute_aligned_space(&p_ref[i][0],
+				                                                  num,
+				                                                  &aligned_space);
 			}
 			LeafNode *leaf_node = new LeafNode(bounds[i],
 			                                   visibility[i],
@@ -984,17 +986,22 @@ BVHNode* BVHBuild::create_leaf_node(const BVHRange& range,
 			}
 			if(alignment_found) {
 				/* Need to recalculate leaf bounds with new alignment. */
-				leaf_node->m_bounds = BoundBox::empty;
+				BoundBox aligned_bounds = BoundBox::empty;
 				for(int j = 0; j < num; ++j) {
 					const BVHReference &ref = p_ref[i][j];
 					BoundBox ref_bounds =
 					        unaligned_heuristic.compute_aligned_prim_boundbox(
 					                ref,
 					                aligned_space);
-					leaf_node->m_bounds.grow(ref_bounds);
+					aligned_bounds.grow(ref_bounds);
+				}
+				/* Keep the regular box when it is smaller, which happens for
+				 * strongly curved segments.
+				 */
+				if(aligned_bounds.safe_area() < leaf_node->m_bounds.safe_area()) {
+					leaf_node->m_bounds = aligned_bounds;
+					leaf_node->set_aligned_space(aligned_space);
 				}
-				/* Set alignment space. */
-				leaf_node->set_aligned_space(aligned_space);
 			}
 			leaves[num_leaves++] = leaf_node;
 			start_index += num;
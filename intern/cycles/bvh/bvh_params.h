@@ -53,6 +53,9 @@ public:
 	/* QBVH */
 	bool use_qbvh;
 
+	/* OBVH, takes precedence over QBVH */
+	bool use_obvh;
+
 	/* Mask of primitives to be included into the BVH. */
 	int primitive_mask;
 
@@ -72,6 +75,12 @@ public:
 	/* Same as above, but for triangle primitives. */
 	int num_motion_triangle_steps;
 
+	/* Refitting keeps the tree structure, so its quality degrades when
+	 * primitives move relative to each other. A refit is rejected and the
+	 * BVH should be rebuilt when the SAH cost of the leaves grows by more
+	 * than this factor compared to the freshly built tree. */
+	float refit_cost_threshold;
+
 	/* fixed parameters */
 	enum {
 		MAX_DEPTH = 64,
@@ -99,11 +108,14 @@ public:
 
 		top_level = false;
 		use_qbvh = false;
+		use_obvh = false;
 		use_unaligned_nodes = false;
 
 		primitive_mask = PRIMITIVE_ALL;
 
 		num_motion_curve_steps = 0;
+
+		refit_cost_threshold = 1.5f;
 	}
 
 	/* SAH costs */
@@ -39,38 +39,23 @@ Transform BVHUnaligned::compute_aligned_space(
         const BVHObjectBinning& range,
         const BVHReference *references) const
 {
-	for(int i = range.start(); i < range.end(); ++i) {
-		const BVHReference& ref = references[i];
-		Transform aligned_space;
-		/* Use first primitive which defines correct direction to define
-		 * the orientation space.
-		 */
-		if(compute_aligned_space(ref, &aligned_space)) {
-			return aligned_space;
-		}
-	}
-	return transform_identity();
+	Transform aligned_space;
+	compute_aligned_space(references + range.start(), range.size(), &aligned_space);
+	return aligned_space;
 }
 
 Transform BVHUnaligned::compute_aligned_space(
         const BVHRange& range,
         const BVHReference *references) const
 {
-	for(int i = range.start(); i < range.end(); ++i) {
-		const BVHReference& ref = references[i];
-		Transform aligned_space;
-		/* Use first primitive which defines correct direction to define
-		 * the orientation space.
-		 */
-		if(compute_aligned_space(ref, &aligned_space)) {
-			return aligned_space;
-		}
-	}
-	return transform_identity();
+	Transform aligned_space;
+	compute_aligned_space(references + range.start(), range.size(), &aligned_space);
+	return aligned_space;
 }
 
-bool BVHUnaligned::compute_aligned_space(const BVHReference& ref,
-                                         Transform *aligned_space) const
+bool BVHUnaligned::curve_segment_keys(const BVHReference& ref,
+                                      float3 *v1,
+                                      float3 *v2) const
 {
 	const Object *object = objects_[ref.prim_object()];
 	const int packed_type = ref.prim_type();
@@ -81,8 +66,18 @@ bool BVHUnaligned::compute_aligned_space(const BVHReference& ref,
 		const Mesh *mesh = object->mesh;
 		const Mesh::Curve& curve = mesh->get_curve(curve_index);
 		const int key = curve.first_key + segment;
-		const float3 v1 = mesh->curve_keys[key],
-		             v2 = mesh->curve_keys[key + 1];
+		*v1 = mesh->curve_keys[key];
+		*v2 = mesh->curve_keys[key + 1];
+		return true;
+	}
+	return false;
+}
+
+bool BVHUnaligned::compute_aligned_space(const BVHReference& ref,
+                                         Transform *aligned_space) const
+{
+	float3 v1, v2;
+	if(curve_segment_keys(ref, &v1, &v2)) {
 		float length;
 		const float3 axis = normalize_len(v2 - v1, &length);
 		if(length > 1e-6f) {
@@ -94,6 +89,70 @@ bool BVHUnaligned::compute_aligned_space(const BVHReference& ref,
 	return false;
 }
 
+bool BVHUnaligned::compute_aligned_space(const BVHReference *references,
+                                         int num,
+                                         Transform *aligned_space) const
+{
+	/* Main axis is the length weighted average direction of the segments,
+	 * with segments pointing the other way flipped. For thin strands this is
+	 * much tighter than the direction of a single segment.
+	 */
+	float3 axis = make_float3(0.0f, 0.0f, 0.0f);
+	for(int i = 0; i < num; ++i) {
+		float3 v1, v2;
+		if(curve_segment_keys(references[i], &v1, &v2)) {
+			const float3 dir = v2 - v1;
+			axis += (dot(dir, axis) < 0.0f)? -dir: dir;
+		}
+	}
+	float length;
+	axis = normalize_len(axis, &length);
+	if(!(length > 1e-6f)) {
+		*aligned_space = transform_identity();
+		return false;
+	}
+
+	/* Rotate the other axes around it to follow the largest spread of the
+	 * segment centers, which is where curved strands bend to.
+	 */
+	const Transform frame = make_transform_frame(axis);
+	const float3 dx = float4_to_float3(frame.x),
+	             dy = float4_to_float3(frame.y);
+	float3 origin = make_float3(0.0f, 0.0f, 0.0f);
+	float sx = 0.0f, sy = 0.0f, sxx = 0.0f, sxy = 0.0f, syy = 0.0f;
+	int num_segments = 0;
+	for(int i = 0; i < num; ++i) {
+		float3 v1, v2;
+		if(curve_segment_keys(references[i], &v1, &v2)) {
+			const float3 center = (v1 + v2)*0.5f;
+			if(num_segments == 0) {
+				/* Relative to the first center for precision. */
+				origin = center;
+			}
+			const float x = dot(center - origin, dx),
+			            y = dot(center - origin, dy);
+			sx += x;
+			sy += y;
+			sxx += x*x;
+			sxy += x*y;
+			syy += y*y;
+			++num_segments;
+		}
+	}
+	const float inv_num = 1.0f / num_segments;
+	const float cxx = sxx*inv_num - sx*sx*inv_num*inv_num,
+	            cxy = sxy*inv_num - sx*sy*inv_num*inv_num,
+	            cyy = syy*inv_num - sy*sy*inv_num*inv_num;
+	const float angle = 0.5f * atan2f(2.0f*cxy, cxx - cyy);
+	const float3 new_dx = cosf(angle)*dx + sinf(angle)*dy;
+	const float3 new_dy = cross(axis, new_dx);
+	*aligned_space = make_transform(new_dx.x, new_dx.y, new_dx.z, 0.0f,
+	                                new_dy.x, new_dy.y, new_dy.z, 0.0f,
+	                                axis.x, axis.y, axis.z, 0.0f,
+	                                0.0f, 0.0f, 0.0f, 1.0f);
+	return true;
+}
+
 BoundBox BVHUnaligned::compute_aligned_prim_boundbox(
         const BVHReference& prim,
         const Transform& aligned_space) const
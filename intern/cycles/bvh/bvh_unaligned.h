@@ -48,6 +48,14 @@ public:
 	bool compute_aligned_space(const BVHReference& ref,
 	                           Transform *aligned_space) const;
 
+	/* Calculate alignment fitted to all curve segments of the references.
+	 *
+	 * Return true when space was calculated successfully.
+	 */
+	bool compute_aligned_space(const BVHReference *references,
+	                           int num,
+	                           Transform *aligned_space) const;
+
 	/* Calculate primitive's bounding box in given space. */
 	BoundBox compute_aligned_prim_boundbox(
 	        const BVHReference& prim,
@@ -71,6 +79,9 @@ public:
 	static Transform compute_node_transform(const BoundBox& bounds,
 	                                        const Transform& aligned_space);
 protected:
+	/* Get the keys of a curve segment, return false for other primitives. */
+	bool curve_segment_keys(const BVHReference& ref, float3 *v1, float3 *v2) const;
+
 	/* List of objects BVH is being created for. */
 	const vector<Object*>& objects_;
 };
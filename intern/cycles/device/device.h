@@ -264,6 +264,12 @@ public:
 	/* open shading language, only for CPU device */
 	virtual void *osl_memory() { return NULL; }
 
+	/* texture cache for images which are read on demand, only for CPU device */
+	virtual void *oiio_memory() { return NULL; }
+
+	/* sparse storage for volume images, only for CPU device */
+	virtual void *volume_grid_memory() { return NULL; }
+
 	/* load/compile kernels, must be called before adding tasks */ 
 	virtual bool load_kernels(
 	        const DeviceRequestedFeatures& /*requested_features*/)
@@ -281,8 +287,8 @@ public:
 		const DeviceDrawParams &draw_params);
 
 #ifdef WITH_NETWORK
-	/* networking */
-	void server_run();
+	/* networking, port 0 uses the default server port */
+	void server_run(int port = 0);
 #endif
 
 	/* multi device */
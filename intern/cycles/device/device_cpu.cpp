@@ -31,6 +31,10 @@
 #include "kernel_compat_cpu.h"
 #include "kernel_types.h"
 #include "kernel_globals.h"
+#include "kernel_oiio_globals.h"
+#include "kernel_path_guiding_globals.h"
+#include "kernel_shader_jit_globals.h"
+#include "kernel_volume_grid_globals.h"
 
 #include "osl_shader.h"
 #include "osl_globals.h"
@@ -57,6 +61,13 @@ public:
 #ifdef WITH_OSL
 	OSLGlobals osl_globals;
 #endif
+	OIIOGlobals oiio_globals;
+	PathGuidingGlobals path_guiding_globals;
+	ShaderJitGlobals shader_jit_globals;
+	VolumeGridGlobals volume_grid_globals;
+
+	/* Features of the scene, to know whether the ray stream kernel can be used. */
+	DeviceRequestedFeatures requested_features;
 	
 	CPUDevice(DeviceInfo& info, Stats &stats, bool background)
 	: Device(info, stats, background)
@@ -64,6 +75,15 @@ public:
 #ifdef WITH_OSL
 		kernel_globals.osl = &osl_globals;
 #endif
+		oiio_globals.tex_sys = OIIO::TextureSystem::create(false);
+		kernel_globals.oiio = &oiio_globals;
+		kernel_globals.oiio_tdata = NULL;
+		kernel_globals.volume_grids = &volume_grid_globals;
+		kernel_globals.path_guiding = &path_guiding_globals;
+		kernel_globals.shader_jit = NULL;
+#ifdef __KERNEL_RAY_STATS__
+		kernel_globals.num_rays = 0;
+#endif
 
 		/* do now to avoid thread issues */
 		system_cpu_support_sse2();
@@ -110,6 +130,8 @@ public:
 	~CPUDevice()
 	{
 		task_pool.stop();
+		device_cpu_shader_jit_free(&shader_jit_globals);
+		OIIO::TextureSystem::destroy(oiio_globals.tex_sys);
 	}
 
 	virtual bool show_samples() const
@@ -185,6 +207,12 @@ public:
 		}
 	}
 
+	bool load_kernels(const DeviceRequestedFeatures& requested_features_)
+	{
+		requested_features = requested_features_;
+		return true;
+	}
+
 	void *osl_memory()
 	{
 #ifdef WITH_OSL
@@ -194,6 +222,16 @@ public:
 #endif
 	}
 
+	void *oiio_memory()
+	{
+		return &oiio_globals;
+	}
+
+	void *volume_grid_memory()
+	{
+		return &volume_grid_globals;
+	}
+
 	void thread_run(DeviceTask *task)
 	{
 		if(task->type == DeviceTask::PATH_TRACE)
@@ -224,46 +262,82 @@ public:
 		RenderTile tile;
 
 		void(*path_trace_kernel)(KernelGlobals*, float*, unsigned int*, int, int, int, int, int);
+		void(*path_trace_stream_kernel)(KernelGlobals*, float*, unsigned int*, int, int, int, int, int, int, int);
+		bool(*adaptive_convergence_kernel)(KernelGlobals*, float*, int, int, int, int, int, int, int);
+		void(*adaptive_adjust_kernel)(KernelGlobals*, float*, int, int, int, int, int, int, int);
 
 #ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX2
 		if(system_cpu_support_avx2()) {
 			path_trace_kernel = kernel_cpu_avx2_path_trace;
+			path_trace_stream_kernel = kernel_cpu_avx2_path_trace_stream;
+			adaptive_convergence_kernel = kernel_cpu_avx2_adaptive_convergence_check;
+			adaptive_adjust_kernel = kernel_cpu_avx2_adaptive_adjust_samples;
 		}
 		else
 #endif
 #ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX
 		if(system_cpu_support_avx()) {
 			path_trace_kernel = kernel_cpu_avx_path_trace;
+			path_trace_stream_kernel = kernel_cpu_avx_path_trace_stream;
+			adaptive_convergence_kernel = kernel_cpu_avx_adaptive_convergence_check;
+			adaptive_adjust_kernel = kernel_cpu_avx_adaptive_adjust_samples;
 		}
 		else
 #endif
 #ifdef WITH_CYCLES_OPTIMIZED_KERNEL_SSE41
 		if(system_cpu_support_sse41()) {
 			path_trace_kernel = kernel_cpu_sse41_path_trace;
+			path_trace_stream_kernel = kernel_cpu_sse41_path_trace_stream;
+			adaptive_convergence_kernel = kernel_cpu_sse41_adaptive_convergence_check;
+			adaptive_adjust_kernel = kernel_cpu_sse41_adaptive_adjust_samples;
 		}
 		else
 #endif
 #ifdef WITH_CYCLES_OPTIMIZED_KERNEL_SSE3
 		if(system_cpu_support_sse3()) {
 			path_trace_kernel = kernel_cpu_sse3_path_trace;
+			path_trace_stream_kernel = kernel_cpu_sse3_path_trace_stream;
+			adaptive_convergence_kernel = kernel_cpu_sse3_adaptive_convergence_check;
+			adaptive_adjust_kernel = kernel_cpu_sse3_adaptive_adjust_samples;
 		}
 		else
 #endif
 #ifdef WITH_CYCLES_OPTIMIZED_KERNEL_SSE2
 		if(system_cpu_support_sse2()) {
 			path_trace_kernel = kernel_cpu_sse2_path_trace;
+			path_trace_stream_kernel = kernel_cpu_sse2_path_trace_stream;
+			adaptive_convergence_kernel = kernel_cpu_sse2_adaptive_convergence_check;
+			adaptive_adjust_kernel = kernel_cpu_sse2_adaptive_adjust_samples;
 		}
 		else
 #endif
 		{
 			path_trace_kernel = kernel_cpu_path_trace;
+			path_trace_stream_kernel = kernel_cpu_path_trace_stream;
+			adaptive_convergence_kernel = kernel_cpu_adaptive_convergence_check;
+			adaptive_adjust_kernel = kernel_cpu_adaptive_adjust_samples;
 		}
 		
+		const KernelIntegrator *kintegrator = &kernel_globals.__data.integrator;
+		bool use_adaptive_sampling = kintegrator->adaptive_threshold > 0.0f;
+
+		/* Ray stream kernel does not support volumes, subsurface scattering,
+		 * branched path tracing and path guiding, use regular kernel for such
+		 * scenes. */
+		bool use_stream = DebugFlags().cpu.stream &&
+		                  !kintegrator->branched &&
+		                  !kintegrator->use_path_guiding &&
+		                  !requested_features.use_volume &&
+		                  !requested_features.use_subsurface;
+
 		while(task.acquire_tile(this, tile)) {
 			float *render_buffer = (float*)tile.buffer;
 			uint *rng_state = (uint*)tile.rng_state;
 			int start_sample = tile.start_sample;
 			int end_sample = tile.start_sample + tile.num_samples;
+			/* Convergence is estimated from the sums of all samples in the buffer. */
+			bool tile_adaptive = use_adaptive_sampling && start_sample == 0;
+			bool tile_converged = false;
 
 			for(int sample = start_sample; sample < end_sample; sample++) {
 				if(task.get_cancel() || task_pool.canceled()) {
@@ -271,18 +345,53 @@ public:
 						break;
 				}
 
-				for(int y = tile.y; y < tile.y + tile.h; y++) {
-					for(int x = tile.x; x < tile.x + tile.w; x++) {
-						path_trace_kernel(&kg, render_buffer, rng_state,
-						                  sample, x, y, tile.offset, tile.stride);
+				if(use_stream) {
+					path_trace_stream_kernel(&kg, render_buffer, rng_state,
+					                         sample, tile.x, tile.y, tile.w, tile.h,
+					                         tile.offset, tile.stride);
+				}
+				else {
+					for(int y = tile.y; y < tile.y + tile.h; y++) {
+						for(int x = tile.x; x < tile.x + tile.w; x++) {
+							path_trace_kernel(&kg, render_buffer, rng_state,
+							                  sample, x, y, tile.offset, tile.stride);
+						}
 					}
 				}
 
 				tile.sample = sample + 1;
 
+				/* Stop sampling converged pixels, and retire the whole tile
+				 * once none of its pixels need more samples. */
+				if(tile_adaptive &&
+				   tile.sample >= kintegrator->adaptive_min_samples &&
+				   tile.sample % kintegrator->adaptive_step == 0)
+				{
+					tile_converged = adaptive_convergence_kernel(&kg, render_buffer,
+					                                             tile.sample,
+					                                             tile.x, tile.y,
+					                                             tile.w, tile.h,
+					                                             tile.offset, tile.stride);
+				}
+
+				if(tile_converged) {
+					/* Report skipped samples as done to keep progress consistent. */
+					tile.sample = end_sample;
+					task.update_progress(&tile, tile.w*tile.h*(end_sample - sample));
+					break;
+				}
+
 				task.update_progress(&tile, tile.w*tile.h);
 			}
 
+			if(tile_adaptive) {
+				adaptive_adjust_kernel(&kg, render_buffer,
+				                       tile.sample,
+				                       tile.x, tile.y,
+				                       tile.w, tile.h,
+				                       tile.offset, tile.stride);
+			}
+
 			task.release_tile(tile);
 
 			if(task_pool.canceled()) {
@@ -460,6 +569,31 @@ public:
 
 	void task_add(DeviceTask& task)
 	{
+		/* path guiding caches are updated in between progressive passes */
+		if(task.type == DeviceTask::PATH_TRACE) {
+			device_cpu_path_guiding_update(&path_guiding_globals,
+			                               kernel_globals.__data.integrator,
+			                               task.sample);
+		}
+		else if(task.type == DeviceTask::SHADER) {
+			device_cpu_path_guiding_update(&path_guiding_globals,
+			                               kernel_globals.__data.integrator,
+			                               0);
+		}
+
+		/* Compiled shaders are only used for path tracing, shader evaluation
+		 * may happen in the middle of a scene update when they are outdated. */
+		kernel_globals.shader_jit = NULL;
+
+		if(task.type == DeviceTask::PATH_TRACE && DebugFlags().cpu.shader_jit) {
+			if(device_cpu_shader_jit_update(&shader_jit_globals,
+			                                &kernel_globals,
+			                                DebugFlags().cpu.shader_jit_verify))
+			{
+				kernel_globals.shader_jit = &shader_jit_globals;
+			}
+		}
+
 		/* split task into smaller ones */
 		list<DeviceTask> tasks;
 
@@ -493,9 +627,17 @@ protected:
 			kg.decoupled_volume_steps[i] = NULL;
 		}
 		kg.decoupled_volume_steps_index = 0;
+		kg.path_stream = NULL;
+#ifdef __KERNEL_RAY_STATS__
+		kg.num_rays = 0;
+#endif
 #ifdef WITH_OSL
 		OSLShader::thread_init(&kg, &kernel_globals, &osl_globals);
 #endif
+		if(!oiio_globals.textures.empty()) {
+			kg.oiio_tdata = new OIIOThreadData();
+			kg.oiio_tdata->thread_info = oiio_globals.tex_sys->get_perthread_info();
+		}
 		return kg;
 	}
 
@@ -511,8 +653,17 @@ protected:
 				free(kg->decoupled_volume_steps[i]);
 			}
 		}
+		if(kg->path_stream != NULL) {
+			free(kg->path_stream);
+		}
 #ifdef WITH_OSL
 		OSLShader::thread_free(kg);
+#endif
+		delete kg->oiio_tdata;
+		kg->oiio_tdata = NULL;
+
+#ifdef __KERNEL_RAY_STATS__
+		stats.add_rays(kg->num_rays);
 #endif
 	}
 };
@@ -20,6 +20,10 @@
 CCL_NAMESPACE_BEGIN
 
 class Device;
+struct KernelGlobals;
+struct KernelIntegrator;
+struct PathGuidingGlobals;
+struct ShaderJitGlobals;
 
 Device *device_cpu_create(DeviceInfo& info, Stats &stats, bool background);
 bool device_opencl_init(void);
@@ -38,6 +42,15 @@ string device_cpu_capabilities(void);
 string device_opencl_capabilities(void);
 string device_cuda_capabilities(void);
 
+void device_cpu_path_guiding_update(PathGuidingGlobals *guiding,
+                                    const KernelIntegrator& kintegrator,
+                                    int sample);
+
+bool device_cpu_shader_jit_update(ShaderJitGlobals *jit,
+                                  KernelGlobals *kg,
+                                  bool verify);
+void device_cpu_shader_jit_free(ShaderJitGlobals *jit);
+
 CCL_NAMESPACE_END
 
 #endif /* __DEVICE_INTERN_H__ */
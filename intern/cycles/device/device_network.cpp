@@ -20,6 +20,8 @@
 
 #include "util_foreach.h"
 #include "util_logging.h"
+#include "util_set.h"
+#include "util_task.h"
 
 #if defined(WITH_NETWORK)
 
@@ -60,11 +62,19 @@ public:
 	: Device(info, stats, true), socket(io_service)
 	{
 		error_func = NetworkError();
-		stringstream portstr;
-		portstr << SERVER_PORT;
+
+		/* address is host[:port] */
+		string host = address;
+		string port = string_printf("%d", SERVER_PORT);
+		size_t colon = host.rfind(':');
+
+		if(colon != string::npos) {
+			port = host.substr(colon + 1);
+			host = host.substr(0, colon);
+		}
 
 		tcp::resolver resolver(io_service);
-		tcp::resolver::query query(address, portstr.str());
+		tcp::resolver::query query(host, port);
 		tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
 		tcp::resolver::iterator end;
 
@@ -77,6 +87,8 @@ public:
 
 		if(error)
 			error_func.network_error(error.message());
+		else
+			socket.set_option(tcp::no_delay(true));
 
 		mem_counter = 0;
 	}
@@ -107,14 +119,21 @@ public:
 		RPCSend snd(socket, &error_func, "mem_copy_to");
 
 		snd.add(mem);
+		snd.add_compressed_buffer((void*)mem.data_pointer, mem.memory_size());
 		snd.write();
-		snd.write_buffer((void*)mem.data_pointer, mem.memory_size());
 	}
 
 	void mem_copy_from(device_memory& mem, int y, int w, int h, int elem)
 	{
 		thread_scoped_lock lock(rpc_lock);
 
+		/* Tile buffers were already sent along with release_tile. */
+		set<device_ptr>::iterator it = received_buffers.find(mem.device_pointer);
+		if(it != received_buffers.end()) {
+			received_buffers.erase(it);
+			return;
+		}
+
 		size_t data_size = mem.memory_size();
 
 		RPCSend snd(socket, &error_func, "mem_copy_from");
@@ -164,8 +183,8 @@ public:
 
 		snd.add(name_string);
 		snd.add(size);
+		snd.add_buffer(host, size);
 		snd.write();
-		snd.write_buffer(host, size);
 	}
 
 	void tex_alloc(const char *name,
@@ -189,8 +208,8 @@ public:
 		snd.add(mem);
 		snd.add(interpolation);
 		snd.add(extension);
+		snd.add_compressed_buffer((void*)mem.data_pointer, mem.memory_size());
 		snd.write();
-		snd.write_buffer((void*)mem.data_pointer, mem.memory_size());
 	}
 
 	void tex_free(device_memory& mem)
@@ -249,6 +268,8 @@ public:
 		lock.unlock();
 
 		TileList the_tiles;
+		vector<RenderTile> tiles;
+		vector<pair<size_t, size_t> > ranges;
 
 		/* todo: run this threaded for connecting to multiple clients */
 		for(;;) {
@@ -261,43 +282,63 @@ public:
 			RPCReceive rcv(socket, &error_func);
 
 			if(rcv.name == "acquire_tile") {
+				/* The server asks for multiple tiles at once, so its devices
+				 * never wait for a round trip to get the next tile. */
+				int num_tiles;
+				rcv.read(num_tiles);
 				lock.unlock();
 
+				tiles.clear();
+
 				/* todo: watch out for recursive calls! */
-				if(the_task.acquire_tile(this, tile)) { /* write return as bool */
+				while((int)tiles.size() < num_tiles && the_task.acquire_tile(this, tile)) {
 					the_tiles.push_back(tile);
+					tiles.push_back(tile);
+				}
 
-					lock.lock();
+				lock.lock();
+				if(tiles.size()) {
 					RPCSend snd(socket, &error_func, "acquire_tile");
-					snd.add(tile);
+					snd.add((int)tiles.size());
+					foreach(RenderTile& acquired, tiles) {
+						snd.add(acquired);
+						snd.add(acquired.buffers->params.get_passes_size());
+					}
 					snd.write();
-					lock.unlock();
 				}
 				else {
-					lock.lock();
 					RPCSend snd(socket, &error_func, "acquire_tile_none");
 					snd.write();
-					lock.unlock();
 				}
+				lock.unlock();
 			}
 			else if(rcv.name == "release_tile") {
 				rcv.read(tile);
-				lock.unlock();
 
 				TileList::iterator it = tile_list_find(the_tiles, tile);
-				if(it != the_tiles.end()) {
-					tile.buffers = it->buffers;
-					the_tiles.erase(it);
+				if(it == the_tiles.end()) {
+					error_func.network_error("Network receive error: released unknown tile");
+					lock.unlock();
+					break;
 				}
 
-				assert(tile.buffers != NULL);
+				tile.buffers = it->buffers;
+				the_tiles.erase(it);
 
-				the_task.release_tile(tile);
+				/* The rendered pixels follow the call, read them straight into
+				 * the host memory of the tile buffers. */
+				device_vector<float>& buffer = tile.buffers->buffer;
+				rpc_tile_ranges(tile, tile.buffers->params.get_passes_size(), ranges);
 
-				lock.lock();
-				RPCSend snd(socket, &error_func, "release_tile");
-				snd.write();
+				for(size_t i = 0; i < ranges.size(); i++) {
+					assert(ranges[i].first + ranges[i].second <= buffer.memory_size());
+					rcv.read_buffer((uint8_t*)buffer.data_pointer + ranges[i].first, ranges[i].second);
+				}
+
+				received_buffers.insert(buffer.device_pointer);
 				lock.unlock();
+
+				the_task.release_tile(tile);
 			}
 			else if(rcv.name == "task_wait_done") {
 				lock.unlock();
@@ -306,6 +347,9 @@ public:
 			else
 				lock.unlock();
 		}
+
+		lock.lock();
+		received_buffers.clear();
 	}
 
 	void task_cancel()
@@ -322,6 +366,9 @@ public:
 
 private:
 	NetworkError error_func;
+
+	/* Tile buffers for which the rendered pixels were received already. */
+	set<device_ptr> received_buffers;
 };
 
 Device *device_network_create(DeviceInfo& info, Stats &stats, const char *address)
@@ -354,9 +401,20 @@ public:
 	bool have_error() { return error_func.have_error(); }
 
 	DeviceServer(Device *device_, tcp::socket& socket_)
-	: device(device_), socket(socket_), stop(false), blocked_waiting(false)
+	: device(device_),
+	  socket(socket_),
+	  acquire_pending(false),
+	  acquire_done(false),
+	  stop(false),
+	  blocked_waiting(false)
 	{
 		error_func = NetworkError();
+
+		/* Keep a tile ready for every thread rendering tiles. */
+		if(device->info.type == DEVICE_CPU)
+			prefetch_tiles = max(TaskScheduler::num_threads(), 1);
+		else
+			prefetch_tiles = 2;
 	}
 
 	void listen()
@@ -502,7 +560,7 @@ protected:
 			mem.data_pointer = (device_ptr)&data_v[0];
 
 			/* copy data from network into memory buffer */
-			rcv.read_buffer((uint8_t*)mem.data_pointer, data_size);
+			rcv.read_compressed_buffer((uint8_t*)mem.data_pointer, data_size);
 
 			/* translate the client pointer to a real device pointer */
 			mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
@@ -532,8 +590,8 @@ protected:
 			size_t data_size = mem.memory_size();
 
 			RPCSend snd(socket, &error_func, "mem_copy_from");
+			snd.add_buffer((uint8_t*)mem.data_pointer, data_size);
 			snd.write();
-			snd.write_buffer((uint8_t*)mem.data_pointer, data_size);
 			lock.unlock();
 		}
 		else if(rcv.name == "mem_zero") {
@@ -601,7 +659,7 @@ protected:
 			else
 				mem.data_pointer = 0;
 
-			rcv.read_buffer((uint8_t*)mem.data_pointer, data_size);
+			rcv.read_compressed_buffer((uint8_t*)mem.data_pointer, data_size);
 
 			device->tex_alloc(name.c_str(), mem, interpolation, extension_type);
 
@@ -665,6 +723,9 @@ protected:
 			task.update_tile_sample = function_bind(&DeviceServer::task_update_tile_sample, this, _1);
 			task.get_cancel = function_bind(&DeviceServer::task_get_cancel, this);
 
+			acquire_pending = false;
+			acquire_done = false;
+
 			device->task_add(task);
 		}
 		else if(rcv.name == "task_wait") {
@@ -684,22 +745,22 @@ protected:
 			device->task_cancel();
 		}
 		else if(rcv.name == "acquire_tile") {
-			AcquireEntry entry;
-			entry.name = rcv.name;
-			rcv.read(entry.tile);
-			acquire_queue.push_back(entry);
+			int num_tiles;
+			rcv.read(num_tiles);
+
+			for(int i = 0; i < num_tiles; i++) {
+				AcquireEntry entry;
+				rcv.read(entry.tile);
+				rcv.read(entry.pass_stride);
+				acquire_queue.push_back(entry);
+			}
+
+			acquire_pending = false;
 			lock.unlock();
 		}
 		else if(rcv.name == "acquire_tile_none") {
-			AcquireEntry entry;
-			entry.name = rcv.name;
-			acquire_queue.push_back(entry);
-			lock.unlock();
-		}
-		else if(rcv.name == "release_tile") {
-			AcquireEntry entry;
-			entry.name = rcv.name;
-			acquire_queue.push_back(entry);
+			acquire_pending = false;
+			acquire_done = true;
 			lock.unlock();
 		}
 		else {
@@ -708,45 +769,60 @@ protected:
 		}
 	}
 
+	/* Ask the client for more tiles without waiting for them, rpc_lock must
+	 * be held. */
+	void request_tiles()
+	{
+		RPCSend snd(socket, &error_func, "acquire_tile");
+		snd.add(max(prefetch_tiles - (int)acquire_queue.size(), 1));
+		snd.write();
+
+		acquire_pending = true;
+	}
+
 	bool task_acquire_tile(Device *device, RenderTile& tile)
 	{
 		thread_scoped_lock acquire_lock(acquire_mutex);
 
-		bool result = false;
+		for(;;) {
+			{
+				thread_scoped_lock lock(rpc_lock);
 
-		RPCSend snd(socket, &error_func, "acquire_tile");
-		snd.write();
+				if(!acquire_queue.empty()) {
+					AcquireEntry entry = acquire_queue.front();
+					acquire_queue.pop_front();
 
-		do {
-			if(blocked_waiting)
-				listen_step();
+					/* request the next tiles while this one renders */
+					if(!acquire_pending && !acquire_done && (int)acquire_queue.size() < prefetch_tiles)
+						request_tiles();
 
-			/* todo: avoid busy wait loop */
-			thread_scoped_lock lock(rpc_lock);
+					lock.unlock();
 
-			if(!acquire_queue.empty()) {
-				AcquireEntry entry = acquire_queue.front();
-				acquire_queue.pop_front();
+					{
+						thread_scoped_lock tiles_lock(tiles_mutex);
+						active_tiles.push_back(entry);
+					}
 
-				if(entry.name == "acquire_tile") {
 					tile = entry.tile;
 
 					if(tile.buffer) tile.buffer = ptr_map[tile.buffer];
 					if(tile.rng_state) tile.rng_state = ptr_map[tile.rng_state];
 
-					result = true;
-					break;
-				}
-				else if(entry.name == "acquire_tile_none") {
-					break;
-				}
-				else {
-					cout << "Error: unexpected acquire RPC receive call \"" + entry.name + "\"\n";
+					return true;
 				}
+
+				if(acquire_done || stop || have_error())
+					return false;
+
+				if(!acquire_pending)
+					request_tiles();
 			}
-		} while(acquire_queue.empty() && !stop && !have_error());
 
-		return result;
+			/* wait for the answer to the pending request,
+			 * todo: avoid busy wait loop when not blocked waiting */
+			if(blocked_waiting)
+				listen_step();
+		}
 	}
 
 	void task_update_progress_sample()
@@ -761,39 +837,63 @@ protected:
 
 	void task_release_tile(RenderTile& tile)
 	{
-		thread_scoped_lock acquire_lock(acquire_mutex);
-
-		if(tile.buffer) tile.buffer = ptr_imap[tile.buffer];
-		if(tile.rng_state) tile.rng_state = ptr_imap[tile.rng_state];
-
+		/* find pass stride the tile was acquired with */
+		int pass_stride = 0;
 		{
-			thread_scoped_lock lock(rpc_lock);
-			RPCSend snd(socket, &error_func, "release_tile");
-			snd.add(tile);
-			snd.write();
-			lock.unlock();
+			thread_scoped_lock tiles_lock(tiles_mutex);
+
+			for(list<AcquireEntry>::iterator it = active_tiles.begin(); it != active_tiles.end(); ++it) {
+				if(tile.x == it->tile.x && tile.y == it->tile.y && tile.start_sample == it->tile.start_sample) {
+					pass_stride = it->pass_stride;
+					active_tiles.erase(it);
+					break;
+				}
+			}
 		}
 
-		do {
-			if(blocked_waiting)
-				listen_step();
+		if(pass_stride == 0) {
+			network_error("Released tile which was not acquired");
+			return;
+		}
 
-			/* todo: avoid busy wait loop */
-			thread_scoped_lock lock(rpc_lock);
+		device_ptr client_buffer = ptr_imap[tile.buffer];
+		DataVector& data_v = data_vector_find(client_buffer);
+
+		/* make sure the rendered pixels are in host memory */
+		network_device_memory mem;
+		mem.data_type = TYPE_UCHAR;
+		mem.data_elements = 1;
+		mem.data_size = data_v.size();
+		mem.data_width = data_v.size();
+		mem.data_height = 0;
+		mem.data_depth = 0;
+		mem.data_pointer = (device_ptr)&data_v[0];
+		mem.device_pointer = tile.buffer;
+		device->mem_copy_from(mem, 0, 1, 1, data_v.size());
+
+		RenderTile client_tile = tile;
+		client_tile.buffer = client_buffer;
+		if(tile.rng_state) client_tile.rng_state = ptr_imap[tile.rng_state];
+
+		/* Send the pixels along with the call, the client does not need to
+		 * request them and the tile does not wait for an answer. */
+		vector<pair<size_t, size_t> > ranges;
+		rpc_tile_ranges(tile, pass_stride, ranges);
 
-			if(!acquire_queue.empty()) {
-				AcquireEntry entry = acquire_queue.front();
-				acquire_queue.pop_front();
+		thread_scoped_lock lock(rpc_lock);
+		RPCSend snd(socket, &error_func, "release_tile");
+		snd.add(client_tile);
 
-				if(entry.name == "release_tile") {
-					lock.unlock();
-					break;
-				}
-				else {
-					cout << "Error: unexpected release RPC receive call \"" + entry.name + "\"\n";
-				}
+		for(size_t i = 0; i < ranges.size(); i++) {
+			if(ranges[i].first + ranges[i].second > data_v.size()) {
+				network_error("Tile outside of render buffer");
+				break;
 			}
-		} while(acquire_queue.empty() && !stop);
+
+			snd.add_buffer(&data_v[ranges[i].first], ranges[i].second);
+		}
+
+		snd.write();
 	}
 
 	bool task_get_cancel()
@@ -811,12 +911,20 @@ protected:
 	DataMap mem_data;
 
 	struct AcquireEntry {
-		string name;
 		RenderTile tile;
+		int pass_stride;
 	};
 
+	/* tiles received from the client, ahead of the devices asking for them */
 	thread_mutex acquire_mutex;
 	list<AcquireEntry> acquire_queue;
+	int prefetch_tiles;
+	bool acquire_pending;
+	bool acquire_done;
+
+	/* tiles being rendered */
+	thread_mutex tiles_mutex;
+	list<AcquireEntry> active_tiles;
 
 	bool stop;
 	bool blocked_waiting;
@@ -827,19 +935,23 @@ private:
 
 };
 
-void Device::server_run()
+void Device::server_run(int port)
 {
+	if(port == 0)
+		port = SERVER_PORT;
+
 	try {
 		/* starts thread that responds to discovery requests */
-		ServerDiscovery discovery;
+		ServerDiscovery discovery(false, port);
 
 		for(;;) {
 			/* accept connection */
 			boost::asio::io_service io_service;
-			tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), SERVER_PORT));
+			tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), port));
 
 			tcp::socket socket(io_service);
 			acceptor.accept(socket);
+			socket.set_option(tcp::no_delay(true));
 
 			string remote_address = socket.remote_endpoint().address().to_string();
 			printf("Connected to remote client at: %s\n", remote_address.c_str());
@@ -33,10 +33,13 @@
 #include <sstream>
 #include <deque>
 
+#include <zlib.h>
+
 #include "buffers.h"
 
 #include "util_foreach.h"
 #include "util_list.h"
+#include "util_logging.h"
 #include "util_map.h"
 #include "util_string.h"
 
@@ -99,6 +102,50 @@ private:
 };
 
 
+/* Remote procedure call framing
+ *
+ * Every call is sent as a fixed size binary header, followed by a binary
+ * archive with the call name and arguments, followed by raw data buffers.
+ * Buffers are written straight from and read straight into the memory they
+ * belong to, without copying them into the archive. */
+
+static const uint32_t RPC_MAGIC = 0x43594e50; /* CYNP */
+static const uint32_t RPC_VERSION = 2;
+
+/* Buffers smaller than this are not worth compressing. */
+static const size_t RPC_COMPRESS_MIN_SIZE = 64*1024;
+
+/* Archives only hold the call name and small arguments, anything larger
+ * comes from a corrupt or hostile peer and is rejected before allocating. */
+static const uint64_t RPC_MAX_ARCHIVE_SIZE = 16*1024*1024;
+
+struct RPCHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t archive_size;
+};
+
+/* Byte ranges of the pixels of a tile in its render buffer, rows are merged
+ * when they are contiguous in memory. */
+static inline void rpc_tile_ranges(const RenderTile& tile,
+                                   int pass_stride,
+                                   vector<pair<size_t, size_t> >& ranges)
+{
+	const size_t pixel_size = pass_stride*sizeof(float);
+
+	ranges.clear();
+
+	for(int y = tile.y; y < tile.y + tile.h; y++) {
+		size_t start = (size_t)(tile.offset + tile.x + y*tile.stride)*pixel_size;
+		size_t size = tile.w*pixel_size;
+
+		if(ranges.size() && ranges.back().first + ranges.back().second == start)
+			ranges.back().second += size;
+		else
+			ranges.push_back(std::make_pair(start, size));
+	}
+}
+
 /* Remote procedure call Send */
 
 class RPCSend {
@@ -108,7 +155,7 @@ public:
 	{
 		archive & name_;
 		error_func = e;
-		fprintf(stderr, "rpc send %s\n", name.c_str());
+		VLOG(4) << "RPC send " << name << ".";
 	}
 
 	~RPCSend()
@@ -145,6 +192,40 @@ public:
 		archive & tile.buffer & tile.rng_state;
 	}
 
+	/* Buffers are sent after the archive in the order they are added, the
+	 * memory must stay valid until write(). */
+	void add_buffer(const void *buffer, size_t size)
+	{
+		if(size)
+			buffers.push_back(boost::asio::buffer(buffer, size));
+	}
+
+	/* Large buffers like scene data compress well, which speeds up the
+	 * upload on slower networks. Must be read with read_compressed_buffer(). */
+	void add_compressed_buffer(const void *buffer, size_t size)
+	{
+		uint64_t compressed_size = 0;
+
+		if(size >= RPC_COMPRESS_MIN_SIZE && size < ((size_t)1 << 31)) {
+			compressed.push_back(vector<uint8_t>(compressBound(size)));
+			vector<uint8_t>& data = compressed.back();
+			uLongf data_size = data.size();
+
+			if(compress2(&data[0], &data_size, (const Bytef*)buffer, size, Z_BEST_SPEED) == Z_OK &&
+			   data_size < size)
+			{
+				compressed_size = data_size;
+			}
+		}
+
+		archive & compressed_size;
+
+		if(compressed_size)
+			add_buffer(&compressed.back()[0], compressed_size);
+		else
+			add_buffer(buffer, size);
+	}
+
 	void write()
 	{
 		boost::system::error_code error;
@@ -152,46 +233,33 @@ public:
 		/* get string from stream */
 		string archive_str = archive_stream.str();
 
-		/* first send fixed size header with size of following data */
-		ostringstream header_stream;
-		header_stream << setw(8) << hex << archive_str.size();
-		string header_str = header_stream.str();
+		RPCHeader header;
+		header.magic = RPC_MAGIC;
+		header.version = RPC_VERSION;
+		header.archive_size = archive_str.size();
 
-		boost::asio::write(socket,
-			boost::asio::buffer(header_str),
-			boost::asio::transfer_all(), error);
+		/* send header, archive and buffers in a single gathered write */
+		vector<boost::asio::const_buffer> frame;
+		frame.reserve(buffers.size() + 2);
+		frame.push_back(boost::asio::buffer(&header, sizeof(header)));
+		frame.push_back(boost::asio::buffer(archive_str));
+		frame.insert(frame.end(), buffers.begin(), buffers.end());
 
-		if(error.value())
-			error_func->network_error(error.message());
+		boost::asio::write(socket, frame, boost::asio::transfer_all(), error);
 
-		/* then send actual data */
-		boost::asio::write(socket,
-			boost::asio::buffer(archive_str),
-			boost::asio::transfer_all(), error);
-		
 		if(error.value())
 			error_func->network_error(error.message());
 
 		sent = true;
 	}
 
-	void write_buffer(void *buffer, size_t size)
-	{
-		boost::system::error_code error;
-
-		boost::asio::write(socket,
-			boost::asio::buffer(buffer, size),
-			boost::asio::transfer_all(), error);
-		
-		if(error.value())
-			error_func->network_error(error.message());
-	}
-
 protected:
 	string name;
 	tcp::socket& socket;
 	ostringstream archive_stream;
 	o_archive archive;
+	vector<boost::asio::const_buffer> buffers;
+	list<vector<uint8_t> > compressed;
 	bool sent;
 	NetworkError *error_func;
 };
@@ -204,52 +272,53 @@ public:
 	: socket(socket_), archive_stream(NULL), archive(NULL)
 	{
 		error_func = e;
-		/* read head with fixed size */
-		vector<char> header(8);
+
+		/* read header with fixed size */
+		RPCHeader header;
 		boost::system::error_code error;
-		size_t len = boost::asio::read(socket, boost::asio::buffer(header), error);
+		size_t len = boost::asio::read(socket, boost::asio::buffer(&header, sizeof(header)), error);
 
 		if(error.value()) {
 			error_func->network_error(error.message());
+			return;
 		}
 
-		/* verify if we got something */
-		if(len == header.size()) {
-			/* decode header */
-			string header_str(&header[0], header.size());
-			istringstream header_stream(header_str);
-
-			size_t data_size;
-
-			if((header_stream >> hex >> data_size)) {
-
-				vector<char> data(data_size);
-				size_t len = boost::asio::read(socket, boost::asio::buffer(data), error);
+		if(len != sizeof(header)) {
+			error_func->network_error("Network receive error: invalid header size");
+			return;
+		}
 
-				if(error.value())
-					error_func->network_error(error.message());
+		if(header.magic != RPC_MAGIC || header.version != RPC_VERSION) {
+			error_func->network_error("Network receive error: incompatible protocol version");
+			return;
+		}
 
+		if(header.archive_size > RPC_MAX_ARCHIVE_SIZE) {
+			error_func->network_error("Network receive error: archive too large");
+			return;
+		}
 
-				if(len == data_size) {
-					archive_str = (data.size())? string(&data[0], data.size()): string("");
+		archive_str.resize(header.archive_size);
 
-					archive_stream = new istringstream(archive_str);
-					archive = new i_archive(*archive_stream);
+		if(header.archive_size) {
+			len = boost::asio::read(socket, boost::asio::buffer(&archive_str[0], header.archive_size), error);
 
-					*archive & name;
-					fprintf(stderr, "rpc receive %s\n", name.c_str());
-				}
-				else {
-					error_func->network_error("Network receive error: data size doesn't match header");
-				}
+			if(error.value()) {
+				error_func->network_error(error.message());
+				return;
 			}
-			else {
-				error_func->network_error("Network receive error: can't decode data size from header");
+
+			if(len != header.archive_size) {
+				error_func->network_error("Network receive error: data size doesn't match header");
+				return;
 			}
 		}
-		else {
-			error_func->network_error("Network receive error: invalid header size");
-		}
+
+		archive_stream = new istringstream(archive_str);
+		archive = new i_archive(*archive_stream);
+
+		*archive & name;
+		VLOG(4) << "RPC receive " << name << ".";
 	}
 
 	~RPCReceive()
@@ -273,15 +342,45 @@ public:
 
 	void read_buffer(void *buffer, size_t size)
 	{
+		if(size == 0)
+			return;
+
 		boost::system::error_code error;
 		size_t len = boost::asio::read(socket, boost::asio::buffer(buffer, size), error);
 
 		if(error.value()) {
 			error_func->network_error(error.message());
 		}
+		else if(len != size) {
+			error_func->network_error("Network receive error: buffer size doesn't match expected size");
+		}
+	}
+
+	void read_compressed_buffer(void *buffer, size_t size)
+	{
+		uint64_t compressed_size;
+		*archive & compressed_size;
 
-		if(len != size)
-			cout << "Network receive error: buffer size doesn't match expected size\n";
+		if(compressed_size == 0) {
+			read_buffer(buffer, size);
+			return;
+		}
+
+		/* zlib never produces more than this, so don't allocate for it. */
+		if(compressed_size > compressBound(size)) {
+			error_func->network_error("Network receive error: compressed buffer too large");
+			return;
+		}
+
+		vector<uint8_t> data(compressed_size);
+		read_buffer(&data[0], compressed_size);
+
+		uLongf data_size = size;
+		if(uncompress((Bytef*)buffer, &data_size, &data[0], compressed_size) != Z_OK ||
+		   data_size != size)
+		{
+			error_func->network_error("Network receive error: failed to decompress buffer");
+		}
 	}
 
 	void read(DeviceTask& task)
@@ -322,8 +421,8 @@ protected:
 
 class ServerDiscovery {
 public:
-	explicit ServerDiscovery(bool discover = false)
-	: listen_socket(io_service), collect_servers(false)
+	explicit ServerDiscovery(bool discover = false, int server_port_ = SERVER_PORT)
+	: listen_socket(io_service), server_port(server_port_), collect_servers(false)
 	{
 		/* setup listen socket */
 		listen_endpoint.address(boost::asio::ip::address_v4::any());
@@ -384,8 +483,11 @@ private:
 
 			/* handle incoming message */
 			if(collect_servers) {
-				if(msg == DISCOVER_REPLY_MSG) {
+				if(string_startswith(msg, DISCOVER_REPLY_MSG.c_str())) {
+					/* servers reply with the port they listen on, so
+					 * multiple servers can run on a single host */
 					string address = receive_endpoint.address().to_string();
+					address += msg.substr(DISCOVER_REPLY_MSG.size());
 
 					mutex.lock();
 
@@ -402,7 +504,7 @@ private:
 			else {
 				/* reply to request */
 				if(msg == DISCOVER_REQUEST_MSG)
-					broadcast_message(DISCOVER_REPLY_MSG);
+					broadcast_message(DISCOVER_REPLY_MSG + string_printf(":%d", server_port));
 			}
 		}
 
@@ -438,6 +540,7 @@ private:
 	boost::asio::io_service io_service;
 	boost::asio::ip::udp::endpoint listen_endpoint;
 	boost::asio::ip::udp::socket listen_socket;
+	int server_port;
 
 	/* threading */
 	boost::thread *thread;
@@ -0,0 +1,324 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "device.h"
+#include "device_intern.h"
+
+#include "kernel_types.h"
+#include "kernel_path_guiding_globals.h"
+
+#include "util_logging.h"
+#include "util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Spatial leaves are split once they received this many records, scaled
+ * by the square root of the iteration length. */
+#define PATH_GUIDING_SPATIAL_THRESHOLD 12000.0f
+#define PATH_GUIDING_SPATIAL_MAX_DEPTH 48
+/* Directional nodes are subdivided while they hold more than this
+ * fraction of the total radiance. */
+#define PATH_GUIDING_DIRECTIONAL_THRESHOLD 0.01f
+#define PATH_GUIDING_DIRECTIONAL_MAX_DEPTH 20
+
+typedef vector<PathGuidingDirectionalNode> PathGuidingDTree;
+
+static float dtree_node_sum(const PathGuidingDirectionalNode& node)
+{
+	return node.sum[0] + node.sum[1] + node.sum[2] + node.sum[3];
+}
+
+static int dtree_add_node(PathGuidingDTree& nodes)
+{
+	PathGuidingDirectionalNode node;
+	memset(&node, 0, sizeof(node));
+	nodes.push_back(node);
+	return nodes.size() - 1;
+}
+
+/* Copy the directional tree at root from src to the end of dst. */
+static int dtree_copy(const PathGuidingDTree& src, int root, PathGuidingDTree& dst)
+{
+	int index = dtree_add_node(dst);
+	dst[index] = src[root];
+
+	for(int c = 0; c < 4; c++) {
+		if(src[root].child[c]) {
+			int child = dtree_copy(src, src[root].child[c], dst);
+			dst[index].child[c] = child;
+		}
+	}
+
+	return index;
+}
+
+/* Build an empty directional tree for recording, subdividing quadrants of
+ * the src tree which hold a large fraction of the total radiance. Quadrants
+ * that are leaves in src distribute their radiance evenly to children.
+ * src_node is -1 when there is no src tree or src has no node here. */
+static int dtree_refine(const PathGuidingDTree& src,
+                        int src_node,
+                        float fraction,
+                        float inv_total,
+                        int depth,
+                        PathGuidingDTree& dst)
+{
+	int index = dtree_add_node(dst);
+
+	if(depth >= PATH_GUIDING_DIRECTIONAL_MAX_DEPTH)
+		return index;
+
+	for(int c = 0; c < 4; c++) {
+		float child_fraction = fraction*0.25f;
+		int src_child = -1;
+
+		if(src_node != -1) {
+			child_fraction = src[src_node].sum[c]*inv_total;
+			if(src[src_node].child[c])
+				src_child = src[src_node].child[c];
+		}
+
+		if(child_fraction > PATH_GUIDING_DIRECTIONAL_THRESHOLD) {
+			int child = dtree_refine(src, src_child, child_fraction, inv_total, depth + 1, dst);
+			dst[index].child[c] = child;
+		}
+	}
+
+	return index;
+}
+
+/* Build an empty directional tree with the same structure as src. */
+static int dtree_copy_structure(const PathGuidingDTree& src, int root, PathGuidingDTree& dst)
+{
+	int index = dtree_add_node(dst);
+
+	for(int c = 0; c < 4; c++) {
+		if(src[root].child[c]) {
+			int child = dtree_copy_structure(src, src[root].child[c], dst);
+			dst[index].child[c] = child;
+		}
+	}
+
+	return index;
+}
+
+static size_t path_guiding_memory_used(const PathGuidingGlobals *guiding)
+{
+	return guiding->spatial_nodes.size()*sizeof(PathGuidingSpatialNode) +
+	       (guiding->sampling_nodes.size() + guiding->building_nodes.size())*
+	       sizeof(PathGuidingDirectionalNode);
+}
+
+static void path_guiding_reset(PathGuidingGlobals *guiding, const KernelIntegrator& kintegrator)
+{
+	/* pad bounds a bit so points on the boundary don't get clamped */
+	float3 bmin = make_float3(kintegrator.path_guiding_min_x,
+	                          kintegrator.path_guiding_min_y,
+	                          kintegrator.path_guiding_min_z);
+	float3 bmax = make_float3(kintegrator.path_guiding_max_x,
+	                          kintegrator.path_guiding_max_y,
+	                          kintegrator.path_guiding_max_z);
+	float3 size = bmax - bmin;
+	float3 pad = make_float3(1e-4f, 1e-4f, 1e-4f) + size*0.01f;
+
+	bmin = bmin - pad;
+	size = max(size + 2.0f*pad, make_float3(1e-4f, 1e-4f, 1e-4f));
+
+	guiding->bounds_min = bmin;
+	guiding->bounds_inv_size = make_float3(1.0f/size.x, 1.0f/size.y, 1.0f/size.z);
+
+	/* single spatial leaf, uniformly subdivided directions */
+	PathGuidingSpatialNode root;
+	memset(&root, 0, sizeof(root));
+
+	guiding->sampling_nodes.clear();
+	guiding->building_nodes.clear();
+
+	root.sampling_root = dtree_add_node(guiding->sampling_nodes);
+	root.building_root = dtree_refine(guiding->sampling_nodes, -1, 1.0f, 0.0f, 0, guiding->building_nodes);
+
+	guiding->spatial_nodes.clear();
+	guiding->spatial_nodes.push_back(root);
+
+	guiding->iteration = 0;
+	guiding->next_iteration_sample = 1;
+}
+
+static void path_guiding_iterate(PathGuidingGlobals *guiding, const KernelIntegrator& kintegrator)
+{
+	vector<PathGuidingSpatialNode>& spatial_nodes = guiding->spatial_nodes;
+	size_t memory_limit = (size_t)max(kintegrator.path_guiding_memory, 1)*1024*1024;
+
+	/* Recorded trees become the sampling trees. Leaves which got no records
+	 * keep sampling from what was learned before. */
+	PathGuidingDTree sampling_nodes;
+	vector<int> dtree_size(spatial_nodes.size(), 0);
+
+	for(size_t i = 0; i < spatial_nodes.size(); i++) {
+		PathGuidingSpatialNode& node = spatial_nodes[i];
+
+		if(node.child)
+			continue;
+
+		size_t start = sampling_nodes.size();
+		float building_sum = dtree_node_sum(guiding->building_nodes[node.building_root]);
+
+		if(node.num_samples && building_sum > 0.0f) {
+			node.sampling_root = dtree_copy(guiding->building_nodes, node.building_root, sampling_nodes);
+			node.sampling_sum = building_sum;
+		}
+		else if(node.sampling_sum > 0.0f) {
+			node.sampling_root = dtree_copy(guiding->sampling_nodes, node.sampling_root, sampling_nodes);
+		}
+		else {
+			node.sampling_root = dtree_add_node(sampling_nodes);
+		}
+
+		dtree_size[i] = sampling_nodes.size() - start;
+	}
+
+	guiding->sampling_nodes.swap(sampling_nodes);
+	guiding->building_nodes.clear();
+
+	/* Split spatial leaves with many records, children continue sampling
+	 * from the tree of their parent and each get half of its records. Memory
+	 * is estimated assuming recording trees end up as large as sampling. */
+	float threshold = PATH_GUIDING_SPATIAL_THRESHOLD*sqrtf((float)(1 << min(guiding->iteration, 30)));
+	size_t memory_used = path_guiding_memory_used(guiding)*2;
+	vector<int> stack;
+	vector<int> depth(spatial_nodes.size(), 0);
+
+	for(size_t i = 0; i < spatial_nodes.size(); i++) {
+		if(!spatial_nodes[i].child)
+			stack.push_back(i);
+	}
+
+	/* children are always stored after their parent */
+	for(size_t i = 0; i < spatial_nodes.size(); i++) {
+		if(spatial_nodes[i].child) {
+			depth[spatial_nodes[i].child] = depth[i] + 1;
+			depth[spatial_nodes[i].child + 1] = depth[i] + 1;
+		}
+	}
+
+	while(!stack.empty()) {
+		int i = stack.back();
+		stack.pop_back();
+
+		/* two spatial nodes and one more recording tree */
+		size_t split_memory = 2*sizeof(PathGuidingSpatialNode) +
+		                      dtree_size[i]*sizeof(PathGuidingDirectionalNode);
+
+		if(spatial_nodes[i].num_samples <= threshold ||
+		   depth[i] >= PATH_GUIDING_SPATIAL_MAX_DEPTH ||
+		   memory_used + split_memory > memory_limit)
+		{
+			continue;
+		}
+
+		PathGuidingSpatialNode child = spatial_nodes[i];
+		child.axis = (child.axis + 1) % 3;
+		child.num_samples /= 2;
+
+		int first = spatial_nodes.size();
+		spatial_nodes.push_back(child);
+		spatial_nodes.push_back(child);
+		spatial_nodes[i].child = first;
+
+		dtree_size.push_back(dtree_size[i]);
+		dtree_size.push_back(dtree_size[i]);
+		depth.push_back(depth[i] + 1);
+		depth.push_back(depth[i] + 1);
+
+		memory_used += split_memory;
+
+		stack.push_back(first);
+		stack.push_back(first + 1);
+	}
+
+	/* Build empty trees for recording, refined where the sampling trees
+	 * hold most radiance. If that exceeds the memory limit, keep the
+	 * structure of the sampling trees. */
+	for(int pass = 0; pass < 2; pass++) {
+		guiding->building_nodes.clear();
+
+		for(size_t i = 0; i < spatial_nodes.size(); i++) {
+			PathGuidingSpatialNode& node = spatial_nodes[i];
+
+			if(node.child)
+				continue;
+
+			if(pass == 1) {
+				node.building_root = dtree_copy_structure(guiding->sampling_nodes,
+				                                          node.sampling_root,
+				                                          guiding->building_nodes);
+			}
+			else if(node.sampling_sum > 0.0f) {
+				node.building_root = dtree_refine(guiding->sampling_nodes,
+				                                  node.sampling_root,
+				                                  1.0f,
+				                                  1.0f/node.sampling_sum,
+				                                  0,
+				                                  guiding->building_nodes);
+			}
+			else {
+				node.building_root = dtree_refine(guiding->sampling_nodes,
+				                                  -1,
+				                                  1.0f,
+				                                  0.0f,
+				                                  0,
+				                                  guiding->building_nodes);
+			}
+
+			node.num_samples = 0;
+		}
+
+		if(path_guiding_memory_used(guiding) <= memory_limit)
+			break;
+	}
+
+	guiding->iteration++;
+	guiding->next_iteration_sample = guiding->next_iteration_sample*2 + 1;
+
+	VLOG(1) << "Path guiding iteration " << guiding->iteration << ": "
+	        << spatial_nodes.size() << " spatial nodes, "
+	        << guiding->sampling_nodes.size() << " sampling and "
+	        << guiding->building_nodes.size() << " recording directional nodes, "
+	        << string_human_readable_size(path_guiding_memory_used(guiding)) << ".";
+}
+
+void device_cpu_path_guiding_update(PathGuidingGlobals *guiding,
+                                    const KernelIntegrator& kintegrator,
+                                    int sample)
+{
+	if(!kintegrator.use_path_guiding) {
+		if(!guiding->spatial_nodes.empty()) {
+			guiding->spatial_nodes.free_memory();
+			guiding->sampling_nodes.free_memory();
+			guiding->building_nodes.free_memory();
+		}
+		return;
+	}
+
+	if(sample == 0 || guiding->spatial_nodes.empty())
+		path_guiding_reset(guiding, kintegrator);
+	else if(sample >= guiding->next_iteration_sample)
+		path_guiding_iterate(guiding, kintegrator);
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,301 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#  include <dlfcn.h>
+#endif
+
+#include "device.h"
+#include "device_intern.h"
+
+#include "kernel.h"
+#include "kernel_compat_cpu.h"
+#include "kernel_types.h"
+#include "kernel_globals.h"
+#include "kernel_shader_jit_globals.h"
+
+#include "util_logging.h"
+#include "util_md5.h"
+#include "util_path.h"
+#include "util_string.h"
+#include "util_time.h"
+
+CCL_NAMESPACE_BEGIN
+
+#ifndef _WIN32
+
+static string shader_jit_compile_cflags()
+{
+	const string kernel_path = path_get("kernel");
+	string cflags = string_printf("-std=c++11 "
+	                              "-O2 "
+	                              "-shared "
+	                              "-fPIC "
+	                              "-ffast-math "
+	                              "-msse "
+	                              "-msse2 "
+	                              "-mfpmath=sse "
+	                              "-I\"%s\"",
+	                              kernel_path.c_str());
+#ifdef NDEBUG
+	cflags += " -DNDEBUG";
+#endif
+#ifdef WITH_OSL
+	cflags += " -DWITH_OSL";
+#endif
+#ifdef WITH_CYCLES_DEBUG
+	cflags += " -D__KERNEL_DEBUG__";
+#endif
+	const char *extra_cflags = getenv("CYCLES_CPU_JIT_EXTRA_CFLAGS");
+	if(extra_cflags) {
+		cflags += string(" ") + string(extra_cflags);
+	}
+	return cflags;
+}
+
+/* Generate the source of all surface shaders. Every word of a program is
+ * listed as a node, words which are node data rather than nodes are never
+ * jumped to, they only cost compile time. */
+static string shader_jit_source(const uint4 *nodes, int num_nodes, int num_shaders)
+{
+	string source = "#include \"kernels/cpu/kernel_cpu_jit.h\"\n\n"
+	                "CCL_NAMESPACE_BEGIN\n";
+	string init;
+
+	for(int shader = 0; shader < num_shaders; shader++) {
+		int start = nodes[shader].y;
+		int end = num_nodes;
+
+		/* the program ends where the next one starts */
+		for(int i = 0; i < num_shaders; i++) {
+			if((int)nodes[i].y > start && (int)nodes[i].y < end) end = nodes[i].y;
+			if((int)nodes[i].z > start && (int)nodes[i].z < end) end = nodes[i].z;
+			if((int)nodes[i].w > start && (int)nodes[i].w < end) end = nodes[i].w;
+		}
+
+		source += string_printf("\nstatic void shader_jit_surface_%d(KernelGlobals *kg, "
+		                        "ShaderData *sd, PathState *state, int path_flag)\n"
+		                        "{\n"
+		                        "\tSHADER_JIT_BEGIN(%d)\n",
+		                        shader, start);
+
+		for(int offset = start; offset < end; offset++) {
+			const uint4& node = nodes[offset];
+
+			if(node.x > NODE_LEAVE_BUMP_EVAL)
+				continue;
+
+			source += string_printf("\tSHADER_JIT_NODE(%d, %uu, %uu, %uu, %uu)\n",
+			                        offset, node.x, node.y, node.z, node.w);
+		}
+
+		source += "\tSHADER_JIT_END\n"
+		          "}\n";
+		init += string_printf("\tif(num_shaders > %d) surface[%d] = ccl::shader_jit_surface_%d;\n",
+		                      shader, shader, shader);
+	}
+
+	source += "\nCCL_NAMESPACE_END\n\n"
+	          "extern \"C\" void " SHADER_JIT_INIT_FUNCTION "(ccl::ShaderJitFunction *surface, int num_shaders)\n"
+	          "{\n" + init + "}\n";
+
+	return source;
+}
+
+static string shader_jit_compile(const string& source)
+{
+	const string cflags = shader_jit_compile_cflags();
+
+	/* Hashing the kernel sources is slow, only do it once per session. */
+	static const string kernel_md5 = path_files_md5_hash(path_get("kernel"));
+
+	/* We include the kernel sources and cflags into md5 so changing the
+	 * kernel or compiler command line arguments makes sure the library gets
+	 * re-built, the library depends on the layout of kernel structs. */
+	const string library_md5 = util_md5_string(kernel_md5 + source + cflags);
+	const string library = path_cache_get(path_join("kernels",
+	        string_printf("cycles_shader_jit_%s.so", library_md5.c_str())));
+	VLOG(1) << "Testing for compiled shaders " << library << ".";
+	if(path_exists(library)) {
+		VLOG(1) << "Using compiled shaders.";
+		return library;
+	}
+
+	string source_file = path_cache_get(path_join("kernels",
+	        string_printf("cycles_shader_jit_%s.cpp", library_md5.c_str())));
+	path_create_directories(source_file);
+
+	string source_text = source;
+	if(!path_write_text(source_file, source_text)) {
+		fprintf(stderr, "Failed to write shader source %s.\n", source_file.c_str());
+		return "";
+	}
+
+	const char *compiler = getenv("CYCLES_CPU_JIT_CXX");
+	if(!compiler) {
+		compiler = "c++";
+	}
+
+	double starttime = time_dt();
+	printf("Compiling shaders ...\n");
+
+	string command = string_printf("\"%s\" %s \"%s\" -o \"%s\"",
+	                               compiler,
+	                               cflags.c_str(),
+	                               source_file.c_str(),
+	                               library.c_str());
+
+	printf("%s\n", command.c_str());
+
+	if(system(command.c_str()) == -1) {
+		fprintf(stderr, "Failed to execute shader compilation command, "
+		                "see console for details.\n");
+		return "";
+	}
+
+	/* Verify if compilation succeeded */
+	if(!path_exists(library)) {
+		fprintf(stderr, "Shader compilation failed, see console for details.\n");
+		return "";
+	}
+
+	printf("Shader compilation finished in %.2lfs.\n", time_dt() - starttime);
+
+	return library;
+}
+
+#endif  /* _WIN32 */
+
+void device_cpu_shader_jit_free(ShaderJitGlobals *jit)
+{
+	if(jit->num_mismatches) {
+		VLOG(1) << jit->num_mismatches << " compiled shader evaluations did not "
+		        << "match the interpreter.";
+	}
+
+	delete [] jit->surface;
+	delete [] jit->mismatch;
+	jit->surface = NULL;
+	jit->mismatch = NULL;
+	jit->num_surface = 0;
+	jit->num_mismatches = 0;
+	jit->md5[0] = '\0';
+
+#ifndef _WIN32
+	if(jit->library) {
+		dlclose(jit->library);
+	}
+#endif
+	jit->library = NULL;
+}
+
+bool device_cpu_shader_jit_update(ShaderJitGlobals *jit,
+                                  KernelGlobals *kg,
+                                  bool verify)
+{
+	jit->verify = verify;
+
+#ifdef _WIN32
+	(void)kg;
+	return false;
+#else
+	const uint4 *nodes = kg->__svm_nodes.data;
+	int num_nodes = kg->__svm_nodes.width;
+
+	if(!nodes || !num_nodes) {
+		device_cpu_shader_jit_free(jit);
+		return false;
+	}
+
+	/* only recompile when the programs changed */
+	MD5Hash md5;
+	md5.append((const uint8_t*)nodes, num_nodes*sizeof(uint4));
+	string nodes_md5 = md5.get_hex();
+
+	if(nodes_md5 == jit->md5) {
+		/* no kernel is running, switch shaders which did not match the
+		 * interpreter in the previous tasks back to it */
+		for(int i = 0; i < jit->num_surface; i++) {
+			if(jit->mismatch[i])
+				jit->surface[i] = NULL;
+		}
+
+		return jit->library != NULL;
+	}
+
+	/* failures are remembered as well, to not compile again every pass */
+	device_cpu_shader_jit_free(jit);
+	strncpy(jit->md5, nodes_md5.c_str(), sizeof(jit->md5) - 1);
+	jit->md5[sizeof(jit->md5) - 1] = '\0';
+
+	/* the jump table of all shaders comes first */
+	int num_shaders = 0;
+	int programs_start = num_nodes;
+
+	while(num_shaders < programs_start && nodes[num_shaders].x == NODE_SHADER_JUMP) {
+		programs_start = min(programs_start, (int)nodes[num_shaders].y);
+		num_shaders++;
+	}
+
+	if(num_shaders == 0)
+		return false;
+
+	string library = shader_jit_compile(shader_jit_source(nodes, num_nodes, num_shaders));
+
+	if(library == "")
+		return false;
+
+	jit->library = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+
+	if(!jit->library) {
+		fprintf(stderr, "Failed to load compiled shaders: %s.\n", dlerror());
+		return false;
+	}
+
+	ShaderJitInitFunction init = (ShaderJitInitFunction)dlsym(jit->library,
+	                                                          SHADER_JIT_INIT_FUNCTION);
+
+	if(!init) {
+		fprintf(stderr, "Compiled shaders have no entry point.\n");
+		dlclose(jit->library);
+		jit->library = NULL;
+		return false;
+	}
+
+	jit->surface = new ShaderJitFunction[num_shaders];
+	memset(jit->surface, 0, sizeof(ShaderJitFunction)*num_shaders);
+	jit->mismatch = new uint[num_shaders];
+	memset(jit->mismatch, 0, sizeof(uint)*num_shaders);
+	jit->num_surface = num_shaders;
+	init(jit->surface, num_shaders);
+
+	/* compiled code always samples images through the regular kernel, its
+	 * types must match the ones the library is compiled with */
+	jit->tex_image_is_cached = kernel_cpu_tex_image_is_cached;
+	jit->tex_image_interp_d = kernel_cpu_tex_image_interp_d;
+	jit->tex_image_interp_3d = kernel_cpu_tex_image_interp_3d;
+	jit->tex_image_interp_3d_ex = kernel_cpu_tex_image_interp_3d_ex;
+
+	VLOG(1) << "Loaded " << num_shaders << " compiled surface shaders.";
+
+	return true;
+#endif
+}
+
+CCL_NAMESPACE_END
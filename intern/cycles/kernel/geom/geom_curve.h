@@ -112,8 +112,8 @@ ccl_device float curve_thickness(KernelGlobals *kg, ShaderData *sd)
 		float4 P_curve[2];
 
 		if(ccl_fetch(sd, type) & PRIMITIVE_CURVE) {
-			P_curve[0]= kernel_tex_fetch(__curve_keys, k0);
-			P_curve[1]= kernel_tex_fetch(__curve_keys, k1);
+			P_curve[0] = curve_key(kg, ccl_fetch(sd, prim), k0);
+			P_curve[1] = curve_key(kg, ccl_fetch(sd, prim), k1);
 		}
 		else {
 			motion_curve_keys(kg, ccl_fetch(sd, object), ccl_fetch(sd, prim), ccl_fetch(sd, time), k0, k1, P_curve);
@@ -136,8 +136,8 @@ ccl_device float3 curve_motion_center_location(KernelGlobals *kg, ShaderData *sd
 
 	float4 P_curve[2];
 
-	P_curve[0]= kernel_tex_fetch(__curve_keys, k0);
-	P_curve[1]= kernel_tex_fetch(__curve_keys, k1);
+	P_curve[0] = curve_key(kg, ccl_fetch(sd, prim), k0);
+	P_curve[1] = curve_key(kg, ccl_fetch(sd, prim), k1);
 
 	return float4_to_float3(P_curve[1]) * ccl_fetch(sd, u) + float4_to_float3(P_curve[0]) * (1.0f - ccl_fetch(sd, u));
 }
@@ -258,8 +258,16 @@ ccl_device_forceinline bool bvh_cardinal_curve_intersect(KernelGlobals *kg, Inte
 #ifdef __KERNEL_AVX2__
 		avxf P_curve_0_1, P_curve_2_3;
 		if(type & PRIMITIVE_CURVE) {
-			P_curve_0_1 = _mm256_loadu2_m128(&kg->__curve_keys.data[k0].x, &kg->__curve_keys.data[ka].x);
-			P_curve_2_3 = _mm256_loadu2_m128(&kg->__curve_keys.data[kb].x, &kg->__curve_keys.data[k1].x);
+			if(kernel_data.bvh.use_compact_curves) {
+				float4 keys[4] = {curve_key(kg, prim, ka), curve_key(kg, prim, k0),
+				                  curve_key(kg, prim, k1), curve_key(kg, prim, kb)};
+				P_curve_0_1 = avxf(keys[0].m128, keys[1].m128);
+				P_curve_2_3 = avxf(keys[2].m128, keys[3].m128);
+			}
+			else {
+				P_curve_0_1 = _mm256_loadu2_m128(&kg->__curve_keys.data[k0].x, &kg->__curve_keys.data[ka].x);
+				P_curve_2_3 = _mm256_loadu2_m128(&kg->__curve_keys.data[kb].x, &kg->__curve_keys.data[k1].x);
+			}
 		}
 		else {
 			int fobject = (object == OBJECT_NONE) ? kernel_tex_fetch(__prim_object, curveAddr) : object;
@@ -269,10 +277,18 @@ ccl_device_forceinline bool bvh_cardinal_curve_intersect(KernelGlobals *kg, Inte
 		ssef P_curve[4];
 
 		if(type & PRIMITIVE_CURVE) {
-			P_curve[0] = load4f(&kg->__curve_keys.data[ka].x);
-			P_curve[1] = load4f(&kg->__curve_keys.data[k0].x);
-			P_curve[2] = load4f(&kg->__curve_keys.data[k1].x);
-			P_curve[3] = load4f(&kg->__curve_keys.data[kb].x);
+			if(kernel_data.bvh.use_compact_curves) {
+				P_curve[0] = load4f(curve_key(kg, prim, ka));
+				P_curve[1] = load4f(curve_key(kg, prim, k0));
+				P_curve[2] = load4f(curve_key(kg, prim, k1));
+				P_curve[3] = load4f(curve_key(kg, prim, kb));
+			}
+			else {
+				P_curve[0] = load4f(&kg->__curve_keys.data[ka].x);
+				P_curve[1] = load4f(&kg->__curve_keys.data[k0].x);
+				P_curve[2] = load4f(&kg->__curve_keys.data[k1].x);
+				P_curve[3] = load4f(&kg->__curve_keys.data[kb].x);
+			}
 		}
 		else {
 			int fobject = (object == OBJECT_NONE)? kernel_tex_fetch(__prim_object, curveAddr): object;
@@ -364,10 +380,10 @@ ccl_device_forceinline bool bvh_cardinal_curve_intersect(KernelGlobals *kg, Inte
 		float4 P_curve[4];
 
 		if(type & PRIMITIVE_CURVE) {
-			P_curve[0] = kernel_tex_fetch(__curve_keys, ka);
-			P_curve[1] = kernel_tex_fetch(__curve_keys, k0);
-			P_curve[2] = kernel_tex_fetch(__curve_keys, k1);
-			P_curve[3] = kernel_tex_fetch(__curve_keys, kb);
+			P_curve[0] = curve_key(kg, prim, ka);
+			P_curve[1] = curve_key(kg, prim, k0);
+			P_curve[2] = curve_key(kg, prim, k1);
+			P_curve[3] = curve_key(kg, prim, kb);
 		}
 		else {
 			int fobject = (object == OBJECT_NONE)? kernel_tex_fetch(__prim_object, curveAddr): object;
@@ -704,8 +720,8 @@ ccl_device_forceinline bool bvh_curve_intersect(KernelGlobals *kg, Intersection
 	float4 P_curve[2];
 
 	if(type & PRIMITIVE_CURVE) {
-		P_curve[0] = kernel_tex_fetch(__curve_keys, k0);
-		P_curve[1] = kernel_tex_fetch(__curve_keys, k1);
+		P_curve[0] = curve_key(kg, prim, k0);
+		P_curve[1] = curve_key(kg, prim, k1);
 	}
 	else {
 		int fobject = (object == OBJECT_NONE)? kernel_tex_fetch(__prim_object, curveAddr): object;
@@ -739,8 +755,14 @@ ccl_device_forceinline bool bvh_curve_intersect(KernelGlobals *kg, Intersection
 	ssef P_curve[2];
 	
 	if(type & PRIMITIVE_CURVE) {
-		P_curve[0] = load4f(&kg->__curve_keys.data[k0].x);
-		P_curve[1] = load4f(&kg->__curve_keys.data[k1].x);
+		if(kernel_data.bvh.use_compact_curves) {
+			P_curve[0] = load4f(curve_key(kg, prim, k0));
+			P_curve[1] = load4f(curve_key(kg, prim, k1));
+		}
+		else {
+			P_curve[0] = load4f(&kg->__curve_keys.data[k0].x);
+			P_curve[1] = load4f(&kg->__curve_keys.data[k1].x);
+		}
 	}
 	else {
 		int fobject = (object == OBJECT_NONE)? kernel_tex_fetch(__prim_object, curveAddr): object;
@@ -973,10 +995,10 @@ ccl_device_inline float3 bvh_curve_refine(KernelGlobals *kg, ShaderData *sd, con
 		float4 P_curve[4];
 
 		if(ccl_fetch(sd, type) & PRIMITIVE_CURVE) {
-			P_curve[0] = kernel_tex_fetch(__curve_keys, ka);
-			P_curve[1] = kernel_tex_fetch(__curve_keys, k0);
-			P_curve[2] = kernel_tex_fetch(__curve_keys, k1);
-			P_curve[3] = kernel_tex_fetch(__curve_keys, kb);
+			P_curve[0] = curve_key(kg, prim, ka);
+			P_curve[1] = curve_key(kg, prim, k0);
+			P_curve[2] = curve_key(kg, prim, k1);
+			P_curve[3] = curve_key(kg, prim, kb);
 		}
 		else {
 			motion_cardinal_curve_keys(kg, ccl_fetch(sd, object), ccl_fetch(sd, prim), ccl_fetch(sd, time), ka, k0, k1, kb, P_curve);
@@ -1023,8 +1045,8 @@ ccl_device_inline float3 bvh_curve_refine(KernelGlobals *kg, ShaderData *sd, con
 		float4 P_curve[2];
 
 		if(ccl_fetch(sd, type) & PRIMITIVE_CURVE) {
-			P_curve[0]= kernel_tex_fetch(__curve_keys, k0);
-			P_curve[1]= kernel_tex_fetch(__curve_keys, k1);
+			P_curve[0] = curve_key(kg, prim, k0);
+			P_curve[1] = curve_key(kg, prim, k1);
 		}
 		else {
 			motion_curve_keys(kg, ccl_fetch(sd, object), ccl_fetch(sd, prim), ccl_fetch(sd, time), k0, k1, P_curve);
@@ -25,6 +25,27 @@ CCL_NAMESPACE_BEGIN
 
 #ifdef __HAIR__
 
+/* Curve key location and radius at the frame center. Compact curves store
+ * keys as 16 bit integers relative to the bounds of their curve, the location
+ * in x and y of the first uint and z and radius in the second. */
+
+ccl_device_inline float4 curve_key(KernelGlobals *kg, int prim, int k)
+{
+	if(kernel_data.bvh.use_compact_curves) {
+		const float4 bounds = kernel_tex_fetch(__curve_key_bounds, prim);
+		const float radius_scale = kernel_tex_fetch(__curves, prim).w;
+		const uint xy = kernel_tex_fetch(__curve_keys_packed, k*2 + 0);
+		const uint zr = kernel_tex_fetch(__curve_keys_packed, k*2 + 1);
+
+		return make_float4(bounds.x + (float)(xy & 0xFFFF)*bounds.w,
+		                   bounds.y + (float)(xy >> 16)*bounds.w,
+		                   bounds.z + (float)(zr & 0xFFFF)*bounds.w,
+		                   (float)(zr >> 16)*radius_scale);
+	}
+	else
+		return kernel_tex_fetch(__curve_keys, k);
+}
+
 ccl_device_inline int find_attribute_curve_motion(KernelGlobals *kg, int object, uint id, AttributeElement *elem)
 {
 	/* todo: find a better (faster) solution for this, maybe store offset per object.
@@ -47,12 +68,12 @@ ccl_device_inline int find_attribute_curve_motion(KernelGlobals *kg, int object,
 	return (attr_map.y == ATTR_ELEMENT_NONE) ? (int)ATTR_STD_NOT_FOUND : (int)attr_map.z;
 }
 
-ccl_device_inline void motion_curve_keys_for_step(KernelGlobals *kg, int offset, int numkeys, int numsteps, int step, int k0, int k1, float4 keys[2])
+ccl_device_inline void motion_curve_keys_for_step(KernelGlobals *kg, int prim, int offset, int numkeys, int numsteps, int step, int k0, int k1, float4 keys[2])
 {
 	if(step == numsteps) {
 		/* center step: regular key location */
-		keys[0] = kernel_tex_fetch(__curve_keys, k0);
-		keys[1] = kernel_tex_fetch(__curve_keys, k1);
+		keys[0] = curve_key(kg, prim, k0);
+		keys[1] = curve_key(kg, prim, k1);
 	}
 	else {
 		/* center step is not stored in this array */
@@ -86,22 +107,22 @@ ccl_device_inline void motion_curve_keys(KernelGlobals *kg, int object, int prim
 	/* fetch key coordinates */
 	float4 next_keys[2];
 
-	motion_curve_keys_for_step(kg, offset, numkeys, numsteps, step, k0, k1, keys);
-	motion_curve_keys_for_step(kg, offset, numkeys, numsteps, step+1, k0, k1, next_keys);
+	motion_curve_keys_for_step(kg, prim, offset, numkeys, numsteps, step, k0, k1, keys);
+	motion_curve_keys_for_step(kg, prim, offset, numkeys, numsteps, step+1, k0, k1, next_keys);
 
 	/* interpolate between steps */
 	keys[0] = (1.0f - t)*keys[0] + t*next_keys[0];
 	keys[1] = (1.0f - t)*keys[1] + t*next_keys[1];
 }
 
-ccl_device_inline void motion_cardinal_curve_keys_for_step(KernelGlobals *kg, int offset, int numkeys, int numsteps, int step, int k0, int k1, int k2, int k3, float4 keys[4])
+ccl_device_inline void motion_cardinal_curve_keys_for_step(KernelGlobals *kg, int prim, int offset, int numkeys, int numsteps, int step, int k0, int k1, int k2, int k3, float4 keys[4])
 {
 	if(step == numsteps) {
 		/* center step: regular key location */
-		keys[0] = kernel_tex_fetch(__curve_keys, k0);
-		keys[1] = kernel_tex_fetch(__curve_keys, k1);
-		keys[2] = kernel_tex_fetch(__curve_keys, k2);
-		keys[3] = kernel_tex_fetch(__curve_keys, k3);
+		keys[0] = curve_key(kg, prim, k0);
+		keys[1] = curve_key(kg, prim, k1);
+		keys[2] = curve_key(kg, prim, k2);
+		keys[3] = curve_key(kg, prim, k3);
 	}
 	else {
 		/* center step is not stored in this array */
@@ -142,8 +163,8 @@ ccl_device_inline void motion_cardinal_curve_keys(KernelGlobals *kg,
 	/* fetch key coordinates */
 	float4 next_keys[4];
 
-	motion_cardinal_curve_keys_for_step(kg, offset, numkeys, numsteps, step, k0, k1, k2, k3, keys);
-	motion_cardinal_curve_keys_for_step(kg, offset, numkeys, numsteps, step+1, k0, k1, k2, k3, next_keys);
+	motion_cardinal_curve_keys_for_step(kg, prim, offset, numkeys, numsteps, step, k0, k1, k2, k3, keys);
+	motion_cardinal_curve_keys_for_step(kg, prim, offset, numkeys, numsteps, step+1, k0, k1, k2, k3, next_keys);
 
 	/* interpolate between steps */
 	keys[0] = (1.0f - t)*keys[0] + t*next_keys[0];
@@ -186,6 +207,7 @@ ccl_device_inline void motion_cardinal_curve_keys_avx(KernelGlobals *kg,
 	float4 next_keys[4];
 	float4 keys[4];
 	motion_cardinal_curve_keys_for_step(kg,
+	                                    prim,
 	                                    offset,
 	                                    numkeys,
 	                                    numsteps,
@@ -193,6 +215,7 @@ ccl_device_inline void motion_cardinal_curve_keys_avx(KernelGlobals *kg,
 	                                    k0, k1, k2, k3,
 	                                    keys);
 	motion_cardinal_curve_keys_for_step(kg,
+	                                    prim,
 	                                    offset,
 	                                    numkeys,
 	                                    numsteps,
@@ -74,15 +74,25 @@ ccl_device_inline void triangle_vertices(KernelGlobals *kg, int prim, float3 P[3
 	P[2] = float4_to_float3(kernel_tex_fetch(__prim_tri_verts, tri_vindex.w+2));
 }
 
+/* Vertex normal, octahedral encoded for compact meshes */
+
+ccl_device_inline float3 triangle_vertex_normal(KernelGlobals *kg, uint vert)
+{
+	if(kernel_data.bvh.use_compact_mesh)
+		return octahedral_to_float3(kernel_tex_fetch(__tri_vnormal_packed, vert));
+	else
+		return float4_to_float3(kernel_tex_fetch(__tri_vnormal, vert));
+}
+
 /* Interpolate smooth vertex normal from vertices */
 
 ccl_device_inline float3 triangle_smooth_normal(KernelGlobals *kg, int prim, float u, float v)
 {
 	/* load triangle vertices */
 	const uint4 tri_vindex = kernel_tex_fetch(__tri_vindex, prim);
-	float3 n0 = float4_to_float3(kernel_tex_fetch(__tri_vnormal, tri_vindex.x));
-	float3 n1 = float4_to_float3(kernel_tex_fetch(__tri_vnormal, tri_vindex.y));
-	float3 n2 = float4_to_float3(kernel_tex_fetch(__tri_vnormal, tri_vindex.z));
+	float3 n0 = triangle_vertex_normal(kg, tri_vindex.x);
+	float3 n1 = triangle_vertex_normal(kg, tri_vindex.y);
+	float3 n2 = triangle_vertex_normal(kg, tri_vindex.z);
 
 	return normalize((1.0f - u - v)*n2 + u*n0 + v*n1);
 }
@@ -147,6 +157,19 @@ ccl_device float triangle_attribute_float(KernelGlobals *kg, const ShaderData *s
 	}
 }
 
+/* Corner attribute of a compact mesh, stored as two uints holding the half
+ * float xy and zw components. */
+
+ccl_device_inline float3 triangle_attribute_half3(KernelGlobals *kg, int index)
+{
+	uint xy = kernel_tex_fetch(__attributes_half, index*2 + 0);
+	uint zw = kernel_tex_fetch(__attributes_half, index*2 + 1);
+
+	return make_float3(half_bits_to_float(xy & 0xFFFF),
+	                   half_bits_to_float(xy >> 16),
+	                   half_bits_to_float(zw & 0xFFFF));
+}
+
 ccl_device float3 triangle_attribute_float3(KernelGlobals *kg, const ShaderData *sd, const AttributeDescriptor desc, float3 *dx, float3 *dy)
 {
 	if(desc.element == ATTR_ELEMENT_FACE) {
@@ -169,7 +192,10 @@ ccl_device float3 triangle_attribute_float3(KernelGlobals *kg, const ShaderData
 
 		return ccl_fetch(sd, u)*f0 + ccl_fetch(sd, v)*f1 + (1.0f - ccl_fetch(sd, u) - ccl_fetch(sd, v))*f2;
 	}
-	else if(desc.element == ATTR_ELEMENT_CORNER || desc.element == ATTR_ELEMENT_CORNER_BYTE) {
+	else if(desc.element == ATTR_ELEMENT_CORNER ||
+	        desc.element == ATTR_ELEMENT_CORNER_BYTE ||
+	        desc.element == ATTR_ELEMENT_CORNER_HALF)
+	{
 		int tri = desc.offset + ccl_fetch(sd, prim)*3;
 		float3 f0, f1, f2;
 
@@ -178,6 +204,11 @@ ccl_device float3 triangle_attribute_float3(KernelGlobals *kg, const ShaderData
 			f1 = float4_to_float3(kernel_tex_fetch(__attributes_float3, tri + 1));
 			f2 = float4_to_float3(kernel_tex_fetch(__attributes_float3, tri + 2));
 		}
+		else if(desc.element == ATTR_ELEMENT_CORNER_HALF) {
+			f0 = triangle_attribute_half3(kg, tri + 0);
+			f1 = triangle_attribute_half3(kg, tri + 1);
+			f2 = triangle_attribute_half3(kg, tri + 2);
+		}
 		else {
 			f0 = color_byte_to_float(kernel_tex_fetch(__attributes_uchar4, tri + 0));
 			f1 = color_byte_to_float(kernel_tex_fetch(__attributes_uchar4, tri + 1));
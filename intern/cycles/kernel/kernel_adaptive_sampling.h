@@ -0,0 +1,168 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+CCL_NAMESPACE_BEGIN
+
+/* Adaptive Sampling
+ *
+ * The auxiliary pass accumulates the combined radiance of every second sample
+ * (weighted by two), so it converges to the same value as the combined pass.
+ * The difference between the two is used as a per pixel error estimate.
+ *
+ * The fourth component of the auxiliary pass is zero while the pixel is still
+ * being sampled, and holds the number of samples taken once it converged.
+ */
+
+ccl_device_inline bool kernel_adaptive_sampling_enabled(KernelGlobals *kg)
+{
+	return kernel_data.integrator.adaptive_threshold > 0.0f;
+}
+
+/* Accumulate path result into the auxiliary pass, buffer points to the pixel. */
+ccl_device_inline void kernel_write_adaptive_aux_pass(KernelGlobals *kg,
+                                                      ccl_global float *buffer,
+                                                      int sample,
+                                                      float4 L)
+{
+	if(!kernel_adaptive_sampling_enabled(kg))
+		return;
+
+	ccl_global float4 *aux = (ccl_global float4*)(buffer + kernel_data.film.pass_adaptive_aux_buffer);
+	float3 value = (sample & 1)? 2.0f*make_float3(L.x, L.y, L.z): make_float3(0.0f, 0.0f, 0.0f);
+
+	/* Sample 0 resets the convergence state together with the sums. */
+	if(sample == 0)
+		*aux = make_float4(value.x, value.y, value.z, 0.0f);
+	else
+		*aux = make_float4(aux->x + value.x, aux->y + value.y, aux->z + value.z, aux->w);
+}
+
+/* Whether path tracing of the pixel can be skipped, buffer points to the pixel. */
+ccl_device_inline bool kernel_adaptive_pixel_converged(KernelGlobals *kg,
+                                                       ccl_global float *buffer,
+                                                       int sample)
+{
+	if(!kernel_adaptive_sampling_enabled(kg) || sample == 0)
+		return false;
+
+	return buffer[kernel_data.film.pass_adaptive_aux_buffer + 3] != 0.0f;
+}
+
+ccl_device_inline float kernel_adaptive_pixel_error(KernelGlobals *kg,
+                                                    ccl_global float *buffer,
+                                                    int num_samples)
+{
+	float4 I = *((ccl_global float4*)(buffer + kernel_data.film.pass_combined));
+	float4 A = *((ccl_global float4*)(buffer + kernel_data.film.pass_adaptive_aux_buffer));
+
+	/* Per pixel error from "A hierarchical automatic stopping condition for
+	 * Monte Carlo global illumination", with epsilon to avoid division by zero. */
+	float error = (fabsf(I.x - A.x) + fabsf(I.y - A.y) + fabsf(I.z - A.z)) /
+	              (num_samples*0.0001f + sqrtf(max(I.x + I.y + I.z, 0.0f)));
+
+	return error / (float)num_samples;
+}
+
+/* Run convergence test for all pixels of the tile after num_samples were
+ * taken, returns true when all pixels converged.
+ *
+ * A pixel only counts as converged when its direct neighbors within the tile
+ * fall below the threshold as well, this avoids isolated pixels stopping early
+ * due to an unlucky error estimate. */
+ccl_device bool kernel_adaptive_convergence_check(KernelGlobals *kg,
+                                                  ccl_global float *buffer,
+                                                  int num_samples,
+                                                  int x, int y, int w, int h,
+                                                  int offset, int stride)
+{
+	const int pass_stride = kernel_data.film.pass_stride;
+	const int aux_w = kernel_data.film.pass_adaptive_aux_buffer + 3;
+	const int flag = kernel_data.film.pass_flag;
+	const int depth = (flag & PASS_DEPTH)? kernel_data.film.pass_depth: -1;
+	const int object_id = (flag & PASS_OBJECT_ID)? kernel_data.film.pass_object_id: -1;
+	const int material_id = (flag & PASS_MATERIAL_ID)? kernel_data.film.pass_material_id: -1;
+	const float threshold = kernel_data.integrator.adaptive_threshold;
+	bool all_converged = true;
+
+	for(int py = y; py < y + h; py++) {
+		for(int px = x; px < x + w; px++) {
+			ccl_global float *pixel = buffer + (offset + px + py*stride)*pass_stride;
+
+			if(pixel[aux_w] != 0.0f)
+				continue;
+
+			bool converged = kernel_adaptive_pixel_error(kg, pixel, num_samples) < threshold;
+
+			for(int i = 0; converged && i < 4; i++) {
+				int nx = px + ((i == 0)? -1: (i == 1)? 1: 0);
+				int ny = py + ((i == 2)? -1: (i == 3)? 1: 0);
+
+				if(nx < x || nx >= x + w || ny < y || ny >= y + h)
+					continue;
+
+				ccl_global float *neighbor = buffer + (offset + nx + ny*stride)*pass_stride;
+
+				if(neighbor[aux_w] == 0.0f)
+					converged = kernel_adaptive_pixel_error(kg, neighbor, num_samples) < threshold;
+			}
+
+			if(converged)
+				pixel[aux_w] = (float)num_samples;
+			else
+				all_converged = false;
+		}
+	}
+
+	return all_converged;
+}
+
+/* Converged pixels hold sums over fewer samples than the rest of the tile,
+ * scale their accumulated passes so film conversion can divide by num_samples.
+ * Depth and ID passes are written once at sample 0 and are left as they are. */
+ccl_device void kernel_adaptive_adjust_samples(KernelGlobals *kg,
+                                               ccl_global float *buffer,
+                                               int num_samples,
+                                               int x, int y, int w, int h,
+                                               int offset, int stride)
+{
+	const int pass_stride = kernel_data.film.pass_stride;
+	const int aux_w = kernel_data.film.pass_adaptive_aux_buffer + 3;
+	const int flag = kernel_data.film.pass_flag;
+	const int depth = (flag & PASS_DEPTH)? kernel_data.film.pass_depth: -1;
+	const int object_id = (flag & PASS_OBJECT_ID)? kernel_data.film.pass_object_id: -1;
+	const int material_id = (flag & PASS_MATERIAL_ID)? kernel_data.film.pass_material_id: -1;
+
+	for(int py = y; py < y + h; py++) {
+		for(int px = x; px < x + w; px++) {
+			ccl_global float *pixel = buffer + (offset + px + py*stride)*pass_stride;
+			float pixel_samples = pixel[aux_w];
+
+			if(pixel_samples == 0.0f || pixel_samples == (float)num_samples)
+				continue;
+
+			float scale = (float)num_samples / pixel_samples;
+
+			for(int i = 0; i < pass_stride; i++) {
+				if(i != aux_w && i != depth && i != object_id && i != material_id)
+					pixel[i] *= scale;
+			}
+
+			pixel[aux_w] = (float)num_samples;
+		}
+	}
+}
+
+CCL_NAMESPACE_END
@@ -33,6 +33,12 @@ struct OSLShadingSystem;
 
 struct Intersection;
 struct VolumeStep;
+struct PathStream;
+struct OIIOGlobals;
+struct OIIOThreadData;
+struct PathGuidingGlobals;
+struct VolumeGridGlobals;
+struct ShaderJitGlobals;
 
 typedef struct KernelGlobals {
 	texture_image_uchar4 texture_byte4_images[TEX_NUM_BYTE4_CPU];
@@ -56,6 +62,19 @@ typedef struct KernelGlobals {
 	OSLThreadData *osl_tdata;
 #  endif
 
+	/* Texture cache for images which are not loaded into memory. */
+	OIIOGlobals *oiio;
+	OIIOThreadData *oiio_tdata;
+
+	/* Sparse volume grids, replacing dense 3D images in the same slot. */
+	VolumeGridGlobals *volume_grids;
+
+	/* Radiance caches for path guiding. */
+	PathGuidingGlobals *path_guiding;
+
+	/* Runtime compiled shaders, NULL when not used. */
+	ShaderJitGlobals *shader_jit;
+
 	/* **** Run-time data ****  */
 
 	/* Heap-allocated storage for transparent shadows intersections. */
@@ -64,6 +83,14 @@ typedef struct KernelGlobals {
 	/* Storage for decoupled volume steps. */
 	VolumeStep *decoupled_volume_steps[2];
 	int decoupled_volume_steps_index;
+
+	/* Heap-allocated paths for ray stream path tracing. */
+	PathStream *path_stream;
+
+#ifdef __KERNEL_RAY_STATS__
+	/* Number of rays intersected with the scene, for statistics. */
+	uint64_t num_rays;
+#endif
 } KernelGlobals;
 
 #endif  /* __KERNEL_CPU__ */
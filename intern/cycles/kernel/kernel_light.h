@@ -848,6 +848,202 @@ ccl_device int light_distribution_sample(KernelGlobals *kg, float randt)
 	return clamp(first-1, 0, kernel_data.integrator.num_distribution-1);
 }
 
+/* Light Tree
+ *
+ * Emissive triangles are sampled by traversing the light tree, choosing a
+ * child with probability proportional to its importance for the shading
+ * point. The importance is the energy of the node, attenuated by distance
+ * and by the orientation bounds of the emitters. Lamps are still selected
+ * uniformly with the remaining probability. */
+
+ccl_device float light_tree_node_importance(KernelGlobals *kg, float3 P, int node)
+{
+	float4 data0 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 0);
+	float energy = data0.w;
+
+	if(energy == 0.0f)
+		return 0.0f;
+
+	float4 data1 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 1);
+	float4 data2 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 2);
+
+	float3 bbox_min = float4_to_float3(data0);
+	float3 bbox_max = float4_to_float3(data1);
+	float3 centroid = 0.5f*(bbox_min + bbox_max);
+	float r2 = 0.25f*len_squared(bbox_max - bbox_min);
+
+	float3 D = P - centroid;
+	float d2 = len_squared(D);
+
+	/* inside the bounding sphere the orientation bounds are meaningless,
+	 * and the distance is clamped to avoid a singularity */
+	if(d2 <= r2)
+		return energy/r2;
+
+	/* angle between the direction to P and the closest normal in the cone,
+	 * reduced by the angle the bounding sphere subtends. emitters are
+	 * double-sided so only the absolute cosine matters. */
+	float theta_o = data1.w;
+	float3 axis = float4_to_float3(data2);
+	float d = sqrtf(d2);
+
+	float theta = safe_acosf(fabsf(dot(axis, D))/d);
+	float theta_u = safe_asinf(sqrtf(r2)/d);
+	float theta_i = max(theta - theta_o - theta_u, 0.0f);
+
+	return energy*cosf(theta_i)/d2;
+}
+
+ccl_device int light_tree_sample(KernelGlobals *kg, float3 P, float randt, float *pdf)
+{
+	int node = 0;
+	*pdf = 1.0f;
+
+	/* traverse down to a leaf, reusing the random number at every level */
+	for(;;) {
+		float4 data3 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 3);
+		int right = __float_as_int(data3.z);
+
+		if(right == -1)
+			break;
+
+		float importance_left = light_tree_node_importance(kg, P, node + 1);
+		float importance_right = light_tree_node_importance(kg, P, right);
+		float importance = importance_left + importance_right;
+
+		if(importance == 0.0f)
+			return -1;
+
+		float prob_left = importance_left/importance;
+
+		if(randt < prob_left) {
+			randt = randt/prob_left;
+			*pdf *= prob_left;
+			node = node + 1;
+		}
+		else {
+			randt = (randt - prob_left)/(1.0f - prob_left);
+			*pdf *= importance_right/importance;
+			node = right;
+		}
+	}
+
+	/* pick an emitter in the leaf proportional to its energy */
+	float4 data0 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 0);
+	float4 data3 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 3);
+	int first = __float_as_int(data3.x);
+	int num = __float_as_int(data3.y);
+	float energy = data0.w;
+	float r = randt*energy;
+
+	for(int i = 0; i < num; i++) {
+		float emitter_energy = kernel_tex_fetch(__light_tree_emitters, first + i).x;
+
+		if(r < emitter_energy || i == num - 1) {
+			*pdf *= emitter_energy/energy;
+			return first + i;
+		}
+
+		r -= emitter_energy;
+	}
+
+	return -1;
+}
+
+ccl_device float light_tree_pdf(KernelGlobals *kg, float3 P, int emitter)
+{
+	int node = 0;
+	float pdf = 1.0f;
+
+	/* follow the path to the leaf containing the emitter, computing the
+	 * same probabilities as light_tree_sample */
+	for(;;) {
+		float4 data3 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 3);
+		int right = __float_as_int(data3.z);
+
+		if(right == -1)
+			break;
+
+		float importance_left = light_tree_node_importance(kg, P, node + 1);
+		float importance_right = light_tree_node_importance(kg, P, right);
+		float importance = importance_left + importance_right;
+
+		if(importance == 0.0f)
+			return 0.0f;
+
+		float4 right_data3 = kernel_tex_fetch(__light_tree_nodes, right*LIGHT_TREE_NODE_SIZE + 3);
+
+		if(emitter < __float_as_int(right_data3.x)) {
+			pdf *= importance_left/importance;
+			node = node + 1;
+		}
+		else {
+			pdf *= importance_right/importance;
+			node = right;
+		}
+	}
+
+	float4 data0 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 0);
+	float emitter_energy = kernel_tex_fetch(__light_tree_emitters, emitter).x;
+
+	return pdf*emitter_energy/data0.w;
+}
+
+ccl_device int light_tree_triangle_emitter(KernelGlobals *kg, int object, int prim)
+{
+	/* triangles in the light distribution are sorted by object and then by
+	 * primitive, binary search for the one that was hit */
+	int first = 0;
+	int len = kernel_data.integrator.light_tree_num_emitters;
+
+	while(len > 0) {
+		int half_len = len >> 1;
+		int middle = first + half_len;
+		float4 l = kernel_tex_fetch(__light_distribution, middle);
+		int middle_object = __float_as_int(l.w);
+		int middle_prim = __float_as_int(l.y);
+
+		if(middle_object < object || (middle_object == object && middle_prim < prim)) {
+			first = middle + 1;
+			len = len - half_len - 1;
+		}
+		else {
+			len = half_len;
+		}
+	}
+
+	if(first < kernel_data.integrator.light_tree_num_emitters) {
+		float4 l = kernel_tex_fetch(__light_distribution, first);
+		if(__float_as_int(l.w) == object && __float_as_int(l.y) == prim) {
+			/* ~0 for triangles with zero area */
+			return (int)kernel_tex_fetch(__light_tree_lookup, first);
+		}
+	}
+
+	return -1;
+}
+
+/* Pdf of sampling a point on an emissive triangle that was hit by a ray
+ * from P, used for MIS. */
+ccl_device float light_tree_triangle_pdf(KernelGlobals *kg,
+	float3 P, int object, int prim, const float3 Ng, const float3 I, float t)
+{
+	float cos_pi = fabsf(dot(Ng, I));
+
+	if(cos_pi == 0.0f)
+		return 0.0f;
+
+	int emitter = light_tree_triangle_emitter(kg, object, prim);
+
+	if(emitter == -1)
+		return 0.0f;
+
+	float area = kernel_tex_fetch(__light_tree_emitters, emitter).x;
+	float pdf = kernel_data.integrator.light_tree_pdf*light_tree_pdf(kg, P, emitter)/area;
+
+	return t*t*pdf/cos_pi;
+}
+
 /* Generic Light */
 
 ccl_device bool light_select_reached_max_bounces(KernelGlobals *kg, int index, int bounce)
@@ -865,6 +1061,52 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
                                       int bounce,
                                       LightSample *ls)
 {
+	if(kernel_data.integrator.use_light_tree) {
+		float tree_pdf = kernel_data.integrator.light_tree_pdf;
+
+		if(randt < tree_pdf) {
+			/* sample triangle from light tree */
+			float select_pdf;
+			int emitter = light_tree_sample(kg, P, randt/tree_pdf, &select_pdf);
+
+			if(emitter == -1)
+				return false;
+
+			float4 l = kernel_tex_fetch(__light_tree_emitters, emitter);
+			int prim = __float_as_int(l.y);
+			int object = __float_as_int(l.w);
+			int shader_flag = __float_as_int(l.z);
+			float area = l.x;
+
+			triangle_light_sample(kg, prim, object, randu, randv, time, ls);
+			/* compute incoming direction, distance and pdf */
+			ls->D = normalize_len(ls->P - P, &ls->t);
+
+			float cos_pi = fabsf(dot(ls->Ng, ls->D));
+			if(cos_pi == 0.0f)
+				return false;
+
+			ls->pdf = ls->t*ls->t*tree_pdf*select_pdf/(area*cos_pi);
+			ls->shader |= shader_flag;
+			return (ls->pdf > 0.0f);
+		}
+		else {
+			/* sample lamp uniformly, as the light distribution would. the
+			 * selection probability is the same pdf_lights that
+			 * lamp_light_sample applies, so the branched path corrections
+			 * for lamps and mesh lights hold with the tree too */
+			int num_lights = kernel_data.integrator.num_all_lights;
+			randt = (randt - tree_pdf)/(1.0f - tree_pdf);
+			int lamp = min(float_to_int(randt*num_lights), num_lights - 1);
+
+			if(UNLIKELY(light_select_reached_max_bounces(kg, lamp, bounce))) {
+				return false;
+			}
+
+			return lamp_light_sample(kg, lamp, randu, randv, P, ls);
+		}
+	}
+
 	/* sample index */
 	int index = light_distribution_sample(kg, randt);
 
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KERNEL_OIIO_GLOBALS_H__
+#define __KERNEL_OIIO_GLOBALS_H__
+
+#include <OpenImageIO/texture.h>
+
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Texture Cache
+ *
+ * Images which are not loaded into memory are sampled through the OIIO
+ * texture system. It reads tiles from the file on demand, keeps at most
+ * the configured amount of them in memory and picks the MIP level from
+ * the texture coordinate derivatives. Only used by the CPU device. */
+
+struct OIIOTexture {
+	OIIO::TextureSystem::TextureHandle *handle;
+	OIIO::TextureOpt::InterpMode interpolation;
+	OIIO::TextureOpt::Wrap extension;
+	int channels;
+	bool use_alpha;
+
+	OIIOTexture()
+	: handle(NULL),
+	  interpolation(OIIO::TextureOpt::InterpBilinear),
+	  extension(OIIO::TextureOpt::WrapPeriodic),
+	  channels(4),
+	  use_alpha(true)
+	{
+	}
+};
+
+struct OIIOGlobals {
+	OIIO::TextureSystem *tex_sys;
+
+	/* indexed by flat image slot, slots without handle are in memory */
+	vector<OIIOTexture> textures;
+
+	OIIOGlobals() : tex_sys(NULL) {}
+};
+
+/* per thread info, saves a thread specific storage lookup for every sample */
+struct OIIOThreadData {
+	OIIO::TextureSystem::Perthread *thread_info;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __KERNEL_OIIO_GLOBALS_H__ */
@@ -60,6 +60,20 @@ ccl_device_inline void kernel_write_pass_float4(ccl_global float *buffer, int sa
 #endif // __SPLIT_KERNEL__ && __WORK_STEALING__
 }
 
+/* Accumulate squared path radiance, used by the denoiser to estimate the
+ * variance of the combined pass. */
+ccl_device_inline void kernel_write_denoising_variance(KernelGlobals *kg, ccl_global float *buffer,
+	int sample, float4 L)
+{
+#ifdef __PASSES__
+	if(kernel_data.film.pass_denoising_data) {
+		float3 L_sqr = make_float3(L.x*L.x, L.y*L.y, L.z*L.z);
+		kernel_write_pass_float3(buffer + kernel_data.film.pass_denoising_data + DENOISING_PASS_COLOR_SQUARE,
+		                         sample, L_sqr);
+	}
+#endif
+}
+
 ccl_device_inline void kernel_write_data_passes(KernelGlobals *kg, ccl_global float *buffer, PathRadiance *L,
 	ShaderData *sd, int sample, ccl_addr_space PathState *state, float3 throughput)
 {
@@ -108,6 +122,18 @@ ccl_device_inline void kernel_write_data_passes(KernelGlobals *kg, ccl_global fl
 				kernel_write_pass_float4(buffer + kernel_data.film.pass_motion, sample, speed);
 				kernel_write_pass_float(buffer + kernel_data.film.pass_motion_weight, sample, 1.0f);
 			}
+			if(kernel_data.film.pass_denoising_data) {
+				ccl_global float *denoising = buffer + kernel_data.film.pass_denoising_data;
+				float3 albedo = shader_bsdf_diffuse(kg, sd) +
+				                shader_bsdf_glossy(kg, sd) +
+				                shader_bsdf_transmission(kg, sd) +
+				                shader_bsdf_subsurface(kg, sd);
+				float depth = camera_distance(kg, ccl_fetch(sd, P));
+
+				kernel_write_pass_float3(denoising + DENOISING_PASS_NORMAL, sample, ccl_fetch(sd, N));
+				kernel_write_pass_float3(denoising + DENOISING_PASS_ALBEDO, sample, min(albedo, make_float3(1.0f, 1.0f, 1.0f)));
+				kernel_write_pass_float(denoising + DENOISING_PASS_DEPTH, sample, depth);
+			}
 
 			state->flag |= PATH_RAY_SINGLE_PASS_DONE;
 		}
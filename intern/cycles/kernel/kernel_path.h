@@ -31,6 +31,7 @@
 #include "kernel_shader.h"
 #include "kernel_light.h"
 #include "kernel_passes.h"
+#include "kernel_adaptive_sampling.h"
 
 #ifdef __SUBSURFACE__
 #  include "kernel_subsurface.h"
@@ -44,6 +45,11 @@
 #include "kernel_shadow.h"
 #include "kernel_emission.h"
 #include "kernel_path_common.h"
+
+#ifdef __PATH_GUIDING__
+#  include "kernel_path_guiding.h"
+#endif
+
 #include "kernel_path_surface.h"
 #include "kernel_path_volume.h"
 
@@ -606,6 +612,11 @@ ccl_device_inline float4 kernel_path_integrate(KernelGlobals *kg,
 	debug_data_init(&debug_data);
 #endif  /* __KERNEL_DEBUG__ */
 
+#ifdef __PATH_GUIDING__
+	PathGuidingVertex guiding_vertices[PATH_GUIDING_MAX_VERTICES];
+	int num_guiding_vertices = 0;
+#endif  /* __PATH_GUIDING__ */
+
 #ifdef __SUBSURFACE__
 	SubsurfaceIndirectRays ss_indirect;
 	kernel_path_subsurface_init_indirect(&ss_indirect);
@@ -885,8 +896,21 @@ ccl_device_inline float4 kernel_path_integrate(KernelGlobals *kg,
 		/* compute direct lighting and next bounce */
 		if(!kernel_path_surface_bounce(kg, rng, &sd, &throughput, &state, &L, &ray))
 			break;
+
+#ifdef __PATH_GUIDING__
+		/* remember vertex to record its incident radiance */
+		if(state.guiding_pdf != 0.0f) {
+			path_guiding_add_vertex(guiding_vertices, &num_guiding_vertices,
+			                        sd.P, ray.D, throughput, &L, state.guiding_pdf);
+		}
+#endif  /* __PATH_GUIDING__ */
 	}
 
+#ifdef __PATH_GUIDING__
+	path_guiding_record_vertices(kg, guiding_vertices, num_guiding_vertices, &L);
+	num_guiding_vertices = 0;
+#endif  /* __PATH_GUIDING__ */
+
 #ifdef __SUBSURFACE__
 		kernel_path_subsurface_accum_indirect(&ss_indirect, &L);
 
@@ -929,6 +953,10 @@ ccl_device void kernel_path_trace(KernelGlobals *kg,
 	rng_state += index;
 	buffer += index*pass_stride;
 
+	/* skip pixels which already converged */
+	if(kernel_adaptive_pixel_converged(kg, buffer, sample))
+		return;
+
 	/* initialize random numbers and ray */
 	RNG rng;
 	Ray ray;
@@ -945,6 +973,8 @@ ccl_device void kernel_path_trace(KernelGlobals *kg,
 
 	/* accumulate result in output buffer */
 	kernel_write_pass_float4(buffer, sample, L);
+	kernel_write_adaptive_aux_pass(kg, buffer, sample, L);
+	kernel_write_denoising_variance(kg, buffer, sample, L);
 
 	path_rng_end(kg, rng_state, rng);
 }
@@ -0,0 +1,360 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "kernel_path_guiding_globals.h"
+#include "util_atomic.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Path Guiding
+ *
+ * Sampling and recording of the radiance caches, see
+ * kernel_path_guiding_globals.h. Guided directions are mixed with BSDF
+ * sampling through one sample MIS, so the result stays unbiased no matter
+ * how well the caches match the actual radiance. */
+
+/* Fraction of samples taken from the guiding distribution. */
+#define PATH_GUIDING_FRACTION 0.5f
+/* Maximum number of path vertices recorded per path. */
+#define PATH_GUIDING_MAX_VERTICES 32
+
+/* Spatial Tree */
+
+ccl_device PathGuidingSpatialNode *path_guiding_spatial_leaf(KernelGlobals *kg, float3 P)
+{
+	PathGuidingGlobals *guiding = kg->path_guiding;
+	float3 p = (P - guiding->bounds_min)*guiding->bounds_inv_size;
+	p = clamp(p, make_float3(0.0f, 0.0f, 0.0f), make_float3(1.0f, 1.0f, 1.0f));
+
+	PathGuidingSpatialNode *node = &guiding->spatial_nodes[0];
+
+	while(node->child) {
+		int axis = node->axis;
+
+		if(p[axis] < 0.5f) {
+			p[axis] *= 2.0f;
+			node = &guiding->spatial_nodes[node->child];
+		}
+		else {
+			p[axis] = p[axis]*2.0f - 1.0f;
+			node = &guiding->spatial_nodes[node->child + 1];
+		}
+	}
+
+	return node;
+}
+
+/* Directional Tree */
+
+ccl_device_inline float2 path_guiding_direction_to_square(float3 D)
+{
+	float x = clamp((D.z + 1.0f)*0.5f, 0.0f, 1.0f);
+	float y = atan2f(D.y, D.x)*(1.0f/M_2PI_F);
+
+	if(y < 0.0f)
+		y += 1.0f;
+
+	return make_float2(x, y);
+}
+
+ccl_device_inline float3 path_guiding_square_to_direction(float2 p)
+{
+	float cos_theta = 2.0f*p.x - 1.0f;
+	float sin_theta = safe_sqrtf(1.0f - cos_theta*cos_theta);
+	float phi = M_2PI_F*p.y;
+
+	return make_float3(sin_theta*cosf(phi), sin_theta*sinf(phi), cos_theta);
+}
+
+ccl_device float path_guiding_dtree_pdf(const PathGuidingDirectionalNode *nodes, int root, float3 D)
+{
+	float2 p = path_guiding_direction_to_square(D);
+	const PathGuidingDirectionalNode *node = &nodes[root];
+	float pdf = M_1_PI_F*0.25f;
+
+	for(;;) {
+		float total = node->sum[0] + node->sum[1] + node->sum[2] + node->sum[3];
+
+		if(!(total > 0.0f))
+			return 0.0f;
+
+		int bx = (p.x >= 0.5f), by = (p.y >= 0.5f);
+		int c = bx + 2*by;
+
+		pdf *= 4.0f*node->sum[c]/total;
+
+		if(node->child[c] == 0)
+			return pdf;
+
+		p.x = min(p.x*2.0f - bx, 1.0f);
+		p.y = min(p.y*2.0f - by, 1.0f);
+		node = &nodes[node->child[c]];
+	}
+}
+
+ccl_device float3 path_guiding_dtree_sample(const PathGuidingDirectionalNode *nodes,
+                                            int root,
+                                            float randu, float randv,
+                                            float *pdf)
+{
+	const PathGuidingDirectionalNode *node = &nodes[root];
+	float2 origin = make_float2(0.0f, 0.0f);
+	float size = 1.0f;
+
+	*pdf = M_1_PI_F*0.25f;
+
+	for(;;) {
+		/* pick the half along x, and then the quadrant within it */
+		float sum_x0 = node->sum[0] + node->sum[2];
+		float sum_x1 = node->sum[1] + node->sum[3];
+		float total = sum_x0 + sum_x1;
+
+		if(!(total > 0.0f)) {
+			*pdf = 0.0f;
+			return make_float3(0.0f, 0.0f, 0.0f);
+		}
+
+		float prob_x0 = sum_x0/total;
+		int bx;
+
+		if(randu < prob_x0) {
+			randu = randu/prob_x0;
+			bx = 0;
+		}
+		else {
+			randu = (randu - prob_x0)/(1.0f - prob_x0);
+			bx = 1;
+		}
+
+		float sum_y0 = node->sum[bx];
+		float prob_y0 = sum_y0/(sum_y0 + node->sum[bx + 2]);
+		int by;
+
+		if(randv < prob_y0) {
+			randv = randv/prob_y0;
+			by = 0;
+		}
+		else {
+			randv = (randv - prob_y0)/(1.0f - prob_y0);
+			by = 1;
+		}
+
+		int c = bx + 2*by;
+
+		randu = min(randu, 1.0f - FLT_EPSILON);
+		randv = min(randv, 1.0f - FLT_EPSILON);
+
+		*pdf *= 4.0f*node->sum[c]/total;
+		size *= 0.5f;
+		origin.x += bx*size;
+		origin.y += by*size;
+
+		if(node->child[c] == 0)
+			break;
+
+		node = &nodes[node->child[c]];
+	}
+
+	/* uniform within the leaf */
+	return path_guiding_square_to_direction(make_float2(origin.x + randu*size,
+	                                                    origin.y + randv*size));
+}
+
+ccl_device void path_guiding_dtree_record(PathGuidingDirectionalNode *nodes,
+                                          int root,
+                                          float3 D,
+                                          float value)
+{
+	float2 p = path_guiding_direction_to_square(D);
+	PathGuidingDirectionalNode *node = &nodes[root];
+
+	for(;;) {
+		int bx = (p.x >= 0.5f), by = (p.y >= 0.5f);
+		int c = bx + 2*by;
+
+		atomic_add_and_fetch_fl(&node->sum[c], value);
+
+		if(node->child[c] == 0)
+			break;
+
+		p.x = min(p.x*2.0f - bx, 1.0f);
+		p.y = min(p.y*2.0f - by, 1.0f);
+		node = &nodes[node->child[c]];
+	}
+}
+
+/* BSDF Sampling */
+
+/* Guiding only pays off for diffuse surfaces, for glossy closures the BSDF
+ * itself is a better distribution than the coarse caches. */
+ccl_device_inline PathGuidingSpatialNode *path_guiding_surface_leaf(KernelGlobals *kg, ShaderData *sd)
+{
+	for(int i = 0; i < sd->num_closure; i++) {
+		const ShaderClosure *sc = &sd->closure[i];
+
+		if(CLOSURE_IS_BSDF(sc->type) && !CLOSURE_IS_BSDF_DIFFUSE(sc->type))
+			return NULL;
+	}
+
+	return path_guiding_spatial_leaf(kg, sd->P);
+}
+
+/* Sample a direction from the mix of the BSDF and guiding distributions.
+ * Returns the BSDF pdf for MIS with light sampling in bsdf_pdf, and the
+ * pdf of the mix the throughput must be divided by in sample_pdf. */
+ccl_device int path_guiding_bsdf_sample(KernelGlobals *kg,
+                                        ShaderData *sd,
+                                        PathState *state,
+                                        float randu, float randv,
+                                        BsdfEval *bsdf_eval,
+                                        float3 *omega_in,
+                                        differential3 *domega_in,
+                                        float *bsdf_pdf,
+                                        float *sample_pdf)
+{
+	state->guiding_pdf = 0.0f;
+
+	PathGuidingSpatialNode *leaf = NULL;
+	if(kernel_data.integrator.use_path_guiding)
+		leaf = path_guiding_surface_leaf(kg, sd);
+
+	if(leaf == NULL || !(leaf->sampling_sum > 0.0f)) {
+		/* nothing learned yet, only record */
+		int label = shader_bsdf_sample(kg, sd, randu, randv, bsdf_eval, omega_in, domega_in, bsdf_pdf);
+		*sample_pdf = *bsdf_pdf;
+
+		if(leaf)
+			state->guiding_pdf = *bsdf_pdf;
+
+		return label;
+	}
+
+	const PathGuidingDirectionalNode *nodes = &kg->path_guiding->sampling_nodes[0];
+	float guide_pdf;
+	int label;
+
+	if(randu < PATH_GUIDING_FRACTION) {
+		randu = randu/PATH_GUIDING_FRACTION;
+		*omega_in = path_guiding_dtree_sample(nodes, leaf->sampling_root, randu, randv, &guide_pdf);
+
+		if(guide_pdf == 0.0f) {
+			*bsdf_pdf = 0.0f;
+			*sample_pdf = 0.0f;
+			return LABEL_NONE;
+		}
+
+		/* use the evaluated pdf, consistent with directions sampled from the BSDF */
+		guide_pdf = path_guiding_dtree_pdf(nodes, leaf->sampling_root, *omega_in);
+
+		bsdf_eval_init(bsdf_eval, NBUILTIN_CLOSURES, make_float3(0.0f, 0.0f, 0.0f), kernel_data.film.use_light_pass);
+		_shader_bsdf_multi_eval(kg, sd, *omega_in, bsdf_pdf, -1, bsdf_eval, 0.0f, 0.0f);
+
+		label = LABEL_DIFFUSE|((dot(sd->Ng, *omega_in) > 0.0f)? LABEL_REFLECT: LABEL_TRANSMIT);
+#ifdef __RAY_DIFFERENTIALS__
+		*domega_in = differential3_zero();
+#endif
+	}
+	else {
+		randu = (randu - PATH_GUIDING_FRACTION)/(1.0f - PATH_GUIDING_FRACTION);
+		label = shader_bsdf_sample(kg, sd, randu, randv, bsdf_eval, omega_in, domega_in, bsdf_pdf);
+
+		if(*bsdf_pdf == 0.0f) {
+			*sample_pdf = 0.0f;
+			return label;
+		}
+
+		guide_pdf = path_guiding_dtree_pdf(nodes, leaf->sampling_root, *omega_in);
+	}
+
+	*sample_pdf = PATH_GUIDING_FRACTION*guide_pdf + (1.0f - PATH_GUIDING_FRACTION)*(*bsdf_pdf);
+	state->guiding_pdf = *sample_pdf;
+
+	return label;
+}
+
+/* Recording */
+
+typedef struct PathGuidingVertex {
+	float3 P;
+	float3 D;
+	float3 throughput;
+	float3 L;
+	float pdf;
+} PathGuidingVertex;
+
+/* Sum of the radiance accumulated by the path so far, before passes are
+ * separated in path_radiance_clamp_and_sum(). */
+ccl_device_inline float3 path_guiding_radiance(PathRadiance *L)
+{
+#ifdef __PASSES__
+	if(L->use_light_pass) {
+		return L->emission + L->background + L->direct_emission + L->indirect +
+		       L->direct_diffuse + L->direct_glossy + L->direct_transmission +
+		       L->direct_subsurface + L->direct_scatter;
+	}
+#endif
+	return L->emission;
+}
+
+ccl_device_inline void path_guiding_add_vertex(PathGuidingVertex *vertices,
+                                               int *num_vertices,
+                                               float3 P,
+                                               float3 D,
+                                               float3 throughput,
+                                               PathRadiance *L,
+                                               float pdf)
+{
+	if(*num_vertices == PATH_GUIDING_MAX_VERTICES)
+		return;
+
+	PathGuidingVertex *v = &vertices[(*num_vertices)++];
+	v->P = P;
+	v->D = D;
+	v->throughput = throughput;
+	v->L = path_guiding_radiance(L);
+	v->pdf = pdf;
+}
+
+/* Record incident radiance at all vertices once the path is complete. The
+ * radiance arriving at a vertex is everything the path accumulated after
+ * it, divided by the throughput up to that point. */
+ccl_device void path_guiding_record_vertices(KernelGlobals *kg,
+                                             PathGuidingVertex *vertices,
+                                             int num_vertices,
+                                             PathRadiance *L)
+{
+	if(num_vertices == 0)
+		return;
+
+	float3 L_end = path_guiding_radiance(L);
+	PathGuidingGlobals *guiding = kg->path_guiding;
+
+	for(int i = 0; i < num_vertices; i++) {
+		const PathGuidingVertex *v = &vertices[i];
+		float value = average(safe_divide_color(L_end - v->L, v->throughput))/v->pdf;
+
+		if(!isfinite(value) || value < 0.0f)
+			continue;
+
+		PathGuidingSpatialNode *leaf = path_guiding_spatial_leaf(kg, v->P);
+
+		if(value > 0.0f)
+			path_guiding_dtree_record(&guiding->building_nodes[0], leaf->building_root, v->D, value);
+		atomic_add_and_fetch_uint32((uint32_t*)&leaf->num_samples, 1);
+	}
+}
+
+CCL_NAMESPACE_END
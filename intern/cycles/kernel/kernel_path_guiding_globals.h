@@ -0,0 +1,84 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KERNEL_PATH_GUIDING_GLOBALS_H__
+#define __KERNEL_PATH_GUIDING_GLOBALS_H__
+
+#include "util_types.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Path Guiding
+ *
+ * Radiance cache learned while rendering progressive passes, following
+ * "Practical Path Guiding for Efficient Light-Transport Simulation",
+ * Müller et al. Space is subdivided by a binary tree over the scene bounds,
+ * every leaf holds a quadtree over the sphere of directions which stores
+ * the incident radiance recorded in it. Only used by the CPU device.
+ *
+ * Learning happens in iterations of doubling length. During an iteration
+ * paths sample from the trees built by the previous iteration, while their
+ * radiance is recorded into a separate set of trees. At the end of the
+ * iteration the recorded trees become the sampling trees, and new trees
+ * for recording are built with a refined subdivision. */
+
+/* Directional quadtree node. Directions are mapped to the unit square with
+ * cos(theta) along x and phi along y, quadrant c covers the cell with
+ * x >= 0.5 for bit 0 and y >= 0.5 for bit 1. */
+struct PathGuidingDirectionalNode {
+	/* recorded radiance of each quadrant */
+	float sum[4];
+	/* child node index of each quadrant, 0 for leaves */
+	int child[4];
+};
+
+/* Spatial binary tree node, split in the middle along axis. */
+struct PathGuidingSpatialNode {
+	/* index of the first of two children, 0 for leaves */
+	int child;
+	int axis;
+	/* root nodes of the directional trees in the leaves */
+	int sampling_root;
+	int building_root;
+	/* total radiance of the sampling tree, zero when it can not be used */
+	float sampling_sum;
+	/* number of records in the building tree */
+	uint num_samples;
+};
+
+struct PathGuidingGlobals {
+	vector<PathGuidingSpatialNode> spatial_nodes;
+	vector<PathGuidingDirectionalNode> sampling_nodes;
+	vector<PathGuidingDirectionalNode> building_nodes;
+
+	/* bounds of the spatial tree */
+	float3 bounds_min;
+	float3 bounds_inv_size;
+
+	/* learning iteration, and sample at which the next one starts */
+	int iteration;
+	int next_iteration_sample;
+
+	PathGuidingGlobals()
+	: iteration(0), next_iteration_sample(0)
+	{
+	}
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __KERNEL_PATH_GUIDING_GLOBALS_H__ */
@@ -40,6 +40,9 @@ ccl_device_inline void path_state_init(KernelGlobals *kg,
 #ifdef __LAMP_MIS__
 	state->ray_t = 0.0f;
 #endif
+#ifdef __PATH_GUIDING__
+	state->guiding_pdf = 0.0f;
+#endif
 
 #ifdef __VOLUME__
 	state->volume_bounce = 0;
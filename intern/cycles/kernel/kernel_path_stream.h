@@ -0,0 +1,486 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+CCL_NAMESPACE_BEGIN
+
+/* Ray Stream Path Tracing
+ *
+ * CPU variant of kernel_path_integrate which advances a batch of paths one
+ * bounce at a time, similar to the split kernel on the GPU. All rays of a
+ * bounce are intersected in one go, after which the hits are sorted by shader
+ * so surfaces using the same shader nodes and textures are shaded in a row.
+ * Hits with the same shader are evaluated in batches by the SVM interpreter.
+ *
+ * Volumes, subsurface scattering and the branched path integrator are not
+ * handled here, the device uses kernel_path_trace for such scenes.
+ */
+
+#define PATH_STREAM_SIZE 1024
+
+typedef struct PathStreamItem {
+	RNG rng;
+	Ray ray;
+	Intersection isect;
+	PathState state;
+	PathRadiance L;
+	float3 throughput;
+	float L_transparent;
+
+#ifdef __KERNEL_DEBUG__
+	DebugData debug_data;
+#endif  /* __KERNEL_DEBUG__ */
+
+	/* pixel in the render buffers */
+	ccl_global float *buffer;
+	ccl_global uint *rng_state;
+} PathStreamItem;
+
+typedef struct PathStream {
+	PathStreamItem items[PATH_STREAM_SIZE];
+
+	/* indices of paths which are still being traced */
+	int queue[PATH_STREAM_SIZE];
+	int num_queued;
+
+	/* shader of every hit and scratch space for sorting by it */
+	uint keys[PATH_STREAM_SIZE];
+	int sorted[PATH_STREAM_SIZE];
+
+	/* shader data of the batch being shaded */
+	ShaderData sd[SVM_BATCH_SIZE];
+} PathStream;
+
+ccl_device void kernel_path_stream_end(KernelGlobals *kg,
+                                       PathStreamItem *item,
+                                       int sample)
+{
+	float3 L_sum = path_radiance_clamp_and_sum(kg, &item->L);
+
+	kernel_write_light_passes(kg, item->buffer, &item->L, sample);
+
+#ifdef __KERNEL_DEBUG__
+	kernel_write_debug_passes(kg, item->buffer, &item->state, &item->debug_data, sample);
+#endif  /* __KERNEL_DEBUG__ */
+
+	float4 L = make_float4(L_sum.x, L_sum.y, L_sum.z, 1.0f - item->L_transparent);
+
+	kernel_write_pass_float4(item->buffer, sample, L);
+	kernel_write_adaptive_aux_pass(kg, item->buffer, sample, L);
+	kernel_write_denoising_variance(kg, item->buffer, sample, L);
+
+	path_rng_end(kg, item->rng_state, item->rng);
+}
+
+/* Generate camera rays for pixels start to end of the w*h rectangle. */
+ccl_device void kernel_path_stream_generate(KernelGlobals *kg,
+                                            PathStream *stream,
+                                            ShaderData *emission_sd,
+                                            ccl_global float *buffer,
+                                            ccl_global uint *rng_state,
+                                            int sample,
+                                            int x, int y, int w,
+                                            int start, int end,
+                                            int offset, int stride)
+{
+	const int pass_stride = kernel_data.film.pass_stride;
+
+	stream->num_queued = 0;
+
+	for(int i = start; i < end; i++) {
+		const int px = x + i % w;
+		const int py = y + i / w;
+		const int index = offset + px + py*stride;
+
+		PathStreamItem *item = &stream->items[stream->num_queued];
+
+		item->buffer = buffer + index*pass_stride;
+		item->rng_state = rng_state + index;
+
+		/* skip pixels which already converged */
+		if(kernel_adaptive_pixel_converged(kg, item->buffer, sample))
+			continue;
+
+		kernel_path_trace_setup(kg, item->rng_state, sample, px, py, &item->rng, &item->ray);
+
+		if(item->ray.t == 0.0f) {
+			float4 L = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+			kernel_write_pass_float4(item->buffer, sample, L);
+			kernel_write_adaptive_aux_pass(kg, item->buffer, sample, L);
+			kernel_write_denoising_variance(kg, item->buffer, sample, L);
+
+			path_rng_end(kg, item->rng_state, item->rng);
+			continue;
+		}
+
+		path_radiance_init(&item->L, kernel_data.film.use_light_pass);
+		item->throughput = make_float3(1.0f, 1.0f, 1.0f);
+		item->L_transparent = 0.0f;
+
+		path_state_init(kg, emission_sd, &item->state, &item->rng, sample, &item->ray);
+
+#ifdef __KERNEL_DEBUG__
+		debug_data_init(&item->debug_data);
+#endif  /* __KERNEL_DEBUG__ */
+
+		stream->queue[stream->num_queued] = stream->num_queued;
+		stream->num_queued++;
+	}
+}
+
+ccl_device_inline uint kernel_path_stream_shader_key(KernelGlobals *kg,
+                                                     const Intersection *isect)
+{
+	const int prim = kernel_tex_fetch(__prim_index, isect->prim);
+	int shader;
+
+#ifdef __HAIR__
+	if(isect->type & PRIMITIVE_ALL_CURVE)
+		shader = __float_as_int(kernel_tex_fetch(__curves, prim).z);
+	else
+#endif
+		shader = kernel_tex_fetch(__tri_shader, prim);
+
+	return (uint)min(shader & SHADER_MASK, 0xFFFF);
+}
+
+/* Intersect all queued rays with the scene. Paths which leave the scene are
+ * finished here, remaining ones are kept in the queue with their shader key. */
+ccl_device void kernel_path_stream_intersect(KernelGlobals *kg,
+                                             PathStream *stream,
+                                             ShaderData *emission_sd,
+                                             int sample)
+{
+	int num_hits = 0;
+
+	for(int i = 0; i < stream->num_queued; i++) {
+		const int path = stream->queue[i];
+		PathStreamItem *item = &stream->items[path];
+		PathState *state = &item->state;
+		Ray *ray = &item->ray;
+		Intersection *isect = &item->isect;
+
+		uint visibility = path_state_ray_visibility(kg, state);
+
+#ifdef __HAIR__
+		float difl = 0.0f, extmax = 0.0f;
+		uint lcg_state = 0;
+
+		if(kernel_data.bvh.have_curves) {
+			if((kernel_data.cam.resolution == 1) && (state->flag & PATH_RAY_CAMERA)) {
+				float3 pixdiff = ray->dD.dx + ray->dD.dy;
+				difl = kernel_data.curve.minimum_width * len(pixdiff) * 0.5f;
+			}
+
+			extmax = kernel_data.curve.maximum_width;
+			lcg_state = lcg_state_init(&item->rng, state, 0x51633e2d);
+		}
+
+		if(state->bounce > kernel_data.integrator.ao_bounces) {
+			visibility = PATH_RAY_SHADOW;
+			ray->t = kernel_data.background.ao_distance;
+		}
+
+		bool hit = scene_intersect(kg, *ray, visibility, isect, &lcg_state, difl, extmax);
+#else
+		bool hit = scene_intersect(kg, *ray, visibility, isect, NULL, 0.0f, 0.0f);
+#endif  /* __HAIR__ */
+
+#ifdef __KERNEL_DEBUG__
+		if(state->flag & PATH_RAY_CAMERA) {
+			item->debug_data.num_bvh_traversed_nodes += isect->num_traversed_nodes;
+			item->debug_data.num_bvh_traversed_instances += isect->num_traversed_instances;
+			item->debug_data.num_bvh_intersections += isect->num_intersections;
+		}
+		item->debug_data.num_ray_bounces++;
+#endif  /* __KERNEL_DEBUG__ */
+
+#ifdef __LAMP_MIS__
+		if(kernel_data.integrator.use_lamp_mis && !(state->flag & PATH_RAY_CAMERA)) {
+			/* ray starting from previous non-transparent bounce */
+			Ray light_ray;
+
+			light_ray.P = ray->P - state->ray_t*ray->D;
+			state->ray_t += isect->t;
+			light_ray.D = ray->D;
+			light_ray.t = state->ray_t;
+			light_ray.time = ray->time;
+			light_ray.dD = ray->dD;
+			light_ray.dP = ray->dP;
+
+			/* intersect with lamp */
+			float3 emission;
+
+			if(indirect_lamp_emission(kg, emission_sd, state, &light_ray, &emission))
+				path_radiance_accum_emission(&item->L, item->throughput, emission, state->bounce);
+		}
+#endif  /* __LAMP_MIS__ */
+
+		if(!hit) {
+			bool background = true;
+
+			/* eval background shader if nothing hit */
+			if(kernel_data.background.transparent && (state->flag & PATH_RAY_CAMERA)) {
+				item->L_transparent += average(item->throughput);
+
+#ifdef __PASSES__
+				if(!(kernel_data.film.pass_flag & PASS_BACKGROUND))
+#endif  /* __PASSES__ */
+					background = false;
+			}
+
+#ifdef __BACKGROUND__
+			/* sample background shader */
+			if(background) {
+				float3 L_background = indirect_background(kg, emission_sd, state, ray);
+				path_radiance_accum_background(&item->L, item->throughput, L_background, state->bounce);
+			}
+#else
+			(void)background;
+#endif  /* __BACKGROUND__ */
+
+			kernel_path_stream_end(kg, item, sample);
+			continue;
+		}
+		else if(state->bounce > kernel_data.integrator.ao_bounces) {
+			kernel_path_stream_end(kg, item, sample);
+			continue;
+		}
+
+		stream->keys[path] = kernel_path_stream_shader_key(kg, isect);
+		stream->queue[num_hits++] = path;
+	}
+
+	stream->num_queued = num_hits;
+}
+
+/* Stable radix sort of the queue by shader key, in two passes of 8 bits. */
+ccl_device void kernel_path_stream_sort(PathStream *stream)
+{
+	int *src = stream->queue;
+	int *dst = stream->sorted;
+
+	for(int shift = 0; shift < 16; shift += 8) {
+		int count[257] = {0};
+
+		for(int i = 0; i < stream->num_queued; i++)
+			count[((stream->keys[src[i]] >> shift) & 0xFF) + 1]++;
+
+		/* all keys share the same digit, nothing to do for this pass */
+		if(count[((stream->keys[src[0]] >> shift) & 0xFF) + 1] == stream->num_queued)
+			continue;
+
+		for(int i = 1; i < 257; i++)
+			count[i] += count[i - 1];
+
+		for(int i = 0; i < stream->num_queued; i++)
+			dst[count[(stream->keys[src[i]] >> shift) & 0xFF]++] = src[i];
+
+		int *tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	if(src != stream->queue)
+		memcpy(stream->queue, src, sizeof(int)*stream->num_queued);
+}
+
+/* Setup and evaluate surface shaders of the hits from start in the queue,
+ * up to SVM_BATCH_SIZE of them as long as they have the same shader. Returns
+ * the number of hits evaluated. */
+ccl_device int kernel_path_stream_eval_batch(KernelGlobals *kg,
+                                             PathStream *stream,
+                                             int start)
+{
+	const uint key = stream->keys[stream->queue[start]];
+	int num = 0;
+
+	ShaderData *sd[SVM_BATCH_SIZE];
+	RNG *rng[SVM_BATCH_SIZE];
+	PathState *state[SVM_BATCH_SIZE];
+	float rbsdf[SVM_BATCH_SIZE];
+	int path_flag[SVM_BATCH_SIZE];
+
+	while(num < SVM_BATCH_SIZE &&
+	      start + num < stream->num_queued &&
+	      stream->keys[stream->queue[start + num]] == key)
+	{
+		PathStreamItem *item = &stream->items[stream->queue[start + num]];
+
+		sd[num] = &stream->sd[num];
+		rng[num] = &item->rng;
+		state[num] = &item->state;
+
+		shader_setup_from_ray(kg, sd[num], &item->isect, &item->ray);
+		rbsdf[num] = path_state_rng_1D_for_decision(kg, rng[num], state[num], PRNG_BSDF);
+		path_flag[num] = state[num]->flag;
+
+		num++;
+	}
+
+	shader_eval_surface_batch(kg, sd, rng, state, rbsdf, path_flag, num, SHADER_CONTEXT_MAIN);
+
+	return num;
+}
+
+/* Shade all hits in queue order and set up the next bounce. Paths which are
+ * terminated are finished, remaining ones are kept in the queue. */
+ccl_device void kernel_path_stream_shade(KernelGlobals *kg,
+                                         PathStream *stream,
+                                         ShaderData *emission_sd,
+                                         int sample)
+{
+	int num_active = 0;
+	int batch_start = 0, batch_end = 0;
+
+	for(int i = 0; i < stream->num_queued; i++) {
+		const int path = stream->queue[i];
+		PathStreamItem *item = &stream->items[path];
+		PathState *state = &item->state;
+		PathRadiance *L = &item->L;
+		RNG *rng = &item->rng;
+
+		/* setup and evaluate shading, for a batch of hits at once */
+		if(i == batch_end) {
+			batch_start = i;
+			batch_end = i + kernel_path_stream_eval_batch(kg, stream, i);
+		}
+
+		ShaderData *sd = &stream->sd[i - batch_start];
+
+		/* holdout */
+#ifdef __HOLDOUT__
+		if(((sd->flag & SD_HOLDOUT) ||
+		    (sd->object_flag & SD_OBJECT_HOLDOUT_MASK)) &&
+		   (state->flag & PATH_RAY_CAMERA))
+		{
+			if(kernel_data.background.transparent) {
+				float3 holdout_weight;
+				if(sd->object_flag & SD_OBJECT_HOLDOUT_MASK) {
+					holdout_weight = make_float3(1.0f, 1.0f, 1.0f);
+				}
+				else {
+					holdout_weight = shader_holdout_eval(kg, sd);
+				}
+				/* any throughput is ok, should all be identical here */
+				item->L_transparent += average(holdout_weight*item->throughput);
+			}
+
+			if(sd->object_flag & SD_OBJECT_HOLDOUT_MASK) {
+				kernel_path_stream_end(kg, item, sample);
+				continue;
+			}
+		}
+#endif  /* __HOLDOUT__ */
+
+		/* holdout mask objects do not write data passes */
+		kernel_write_data_passes(kg, item->buffer, L, sd, sample, state, item->throughput);
+
+		/* blurring of bsdf after bounces, for rays that have a small likelihood
+		 * of following this particular path (diffuse, rough glossy) */
+		if(kernel_data.integrator.filter_glossy != FLT_MAX) {
+			float blur_pdf = kernel_data.integrator.filter_glossy*state->min_ray_pdf;
+
+			if(blur_pdf < 1.0f) {
+				float blur_roughness = sqrtf(1.0f - blur_pdf)*0.5f;
+				shader_bsdf_blur(kg, sd, blur_roughness);
+			}
+		}
+
+#ifdef __EMISSION__
+		/* emission */
+		if(sd->flag & SD_EMISSION) {
+			float3 emission = indirect_primitive_emission(kg, sd, item->isect.t, state->flag, state->ray_pdf);
+			path_radiance_accum_emission(L, item->throughput, emission, state->bounce);
+		}
+#endif  /* __EMISSION__ */
+
+		/* path termination, see kernel_path_integrate */
+		float probability = path_state_terminate_probability(kg, state, item->throughput);
+
+		if(probability == 0.0f) {
+			kernel_path_stream_end(kg, item, sample);
+			continue;
+		}
+		else if(probability != 1.0f) {
+			float terminate = path_state_rng_1D_for_decision(kg, rng, state, PRNG_TERMINATE);
+			if(terminate >= probability) {
+				kernel_path_stream_end(kg, item, sample);
+				continue;
+			}
+
+			item->throughput /= probability;
+		}
+
+#ifdef __AO__
+		/* ambient occlusion */
+		if(kernel_data.integrator.use_ambient_occlusion || (sd->flag & SD_AO)) {
+			kernel_path_ao(kg, sd, emission_sd, L, state, rng, item->throughput, shader_bsdf_alpha(kg, sd));
+		}
+#endif  /* __AO__ */
+
+		/* direct lighting */
+		kernel_path_surface_connect_light(kg, rng, sd, emission_sd, item->throughput, state, L);
+
+		/* compute direct lighting and next bounce */
+		if(!kernel_path_surface_bounce(kg, rng, sd, &item->throughput, state, L, &item->ray)) {
+			kernel_path_stream_end(kg, item, sample);
+			continue;
+		}
+
+		stream->queue[num_active++] = path;
+	}
+
+	stream->num_queued = num_active;
+}
+
+ccl_device void kernel_path_trace_stream(KernelGlobals *kg,
+                                         ccl_global float *buffer,
+                                         ccl_global uint *rng_state,
+                                         int sample,
+                                         int x, int y, int w, int h,
+                                         int offset, int stride)
+{
+	if(kg->path_stream == NULL)
+		kg->path_stream = (PathStream*)malloc(sizeof(PathStream));
+
+	PathStream *stream = kg->path_stream;
+
+	/* shader data memory used for emission and shadows, surface shader data
+	 * of batches is stored in the stream */
+	ShaderData emission_sd;
+
+	for(int start = 0; start < w*h; start += PATH_STREAM_SIZE) {
+		const int end = min(start + PATH_STREAM_SIZE, w*h);
+
+		kernel_path_stream_generate(kg, stream, &emission_sd,
+		                            buffer, rng_state, sample,
+		                            x, y, w, start, end,
+		                            offset, stride);
+
+		while(stream->num_queued > 0) {
+			kernel_path_stream_intersect(kg, stream, &emission_sd, sample);
+
+			if(stream->num_queued == 0)
+				break;
+
+			kernel_path_stream_sort(stream);
+			kernel_path_stream_shade(kg, stream, &emission_sd, sample);
+		}
+	}
+}
+
+CCL_NAMESPACE_END
@@ -240,7 +240,7 @@ ccl_device bool kernel_path_surface_bounce(KernelGlobals *kg,
 	/* no BSDF? we can stop here */
 	if(ccl_fetch(sd, flag) & SD_BSDF) {
 		/* sample BSDF */
-		float bsdf_pdf;
+		float bsdf_pdf, sample_pdf;
 		BsdfEval bsdf_eval;
 		float3 bsdf_omega_in;
 		differential3 bsdf_domega_in;
@@ -248,14 +248,20 @@ ccl_device bool kernel_path_surface_bounce(KernelGlobals *kg,
 		path_state_rng_2D(kg, rng, state, PRNG_BSDF_U, &bsdf_u, &bsdf_v);
 		int label;
 
+#ifdef __PATH_GUIDING__
+		label = path_guiding_bsdf_sample(kg, sd, state, bsdf_u, bsdf_v, &bsdf_eval,
+			&bsdf_omega_in, &bsdf_domega_in, &bsdf_pdf, &sample_pdf);
+#else
 		label = shader_bsdf_sample(kg, sd, bsdf_u, bsdf_v, &bsdf_eval,
 			&bsdf_omega_in, &bsdf_domega_in, &bsdf_pdf);
+		sample_pdf = bsdf_pdf;
+#endif
 
-		if(bsdf_pdf == 0.0f || bsdf_eval_is_zero(&bsdf_eval))
+		if(bsdf_pdf == 0.0f || sample_pdf == 0.0f || bsdf_eval_is_zero(&bsdf_eval))
 			return false;
 
 		/* modify throughput */
-		path_radiance_bsdf_bounce(L, throughput, &bsdf_eval, bsdf_pdf, state->bounce, label);
+		path_radiance_bsdf_bounce(L, throughput, &bsdf_eval, sample_pdf, state->bounce, label);
 
 		/* set labels */
 		if(!(label & LABEL_TRANSPARENT)) {
@@ -31,6 +31,10 @@
 
 #include "svm/svm.h"
 
+#ifdef __SHADER_JIT__
+#  include "kernel_shader_jit.h"
+#endif
+
 CCL_NAMESPACE_BEGIN
 
 /* ShaderData setup from incoming ray */
@@ -864,6 +868,9 @@ ccl_device void shader_eval_surface(KernelGlobals *kg, ShaderData *sd, ccl_addr_
 #endif
 	{
 #ifdef __SVM__
+#  ifdef __SHADER_JIT__
+		if(!(kg->shader_jit && shader_jit_eval_surface(kg, sd, state, path_flag)))
+#  endif
 		svm_eval_nodes(kg, sd, state, SHADER_TYPE_SURFACE, path_flag);
 #else
 		DiffuseBsdf *bsdf = (DiffuseBsdf*)bsdf_alloc(sd,
@@ -879,6 +886,39 @@ ccl_device void shader_eval_surface(KernelGlobals *kg, ShaderData *sd, ccl_addr_
 	}
 }
 
+#ifdef __KERNEL_CPU__
+
+/* Surface Evaluation of a batch of shading points, which should mostly use
+ * the same shader for the batched SVM interpreter to pay off. */
+
+ccl_device void shader_eval_surface_batch(KernelGlobals *kg, ShaderData **sd, RNG **rng,
+	PathState **state, const float *randb, const int *path_flag, int num, ShaderContext ctx)
+{
+#ifdef __OSL__
+	if(kg->osl) {
+		for(int i = 0; i < num; i++)
+			shader_eval_surface(kg, sd[i], rng[i], state[i], randb[i], path_flag[i], ctx);
+		return;
+	}
+#endif
+
+	for(int i = 0; i < num; i++) {
+		sd[i]->num_closure = 0;
+		sd[i]->num_closure_extra = 0;
+		sd[i]->randb_closure = randb[i];
+	}
+
+	svm_eval_nodes_batch(kg, sd, state, path_flag, num, SHADER_TYPE_SURFACE);
+
+	for(int i = 0; i < num; i++) {
+		if(rng[i] && (sd[i]->flag & SD_BSDF_NEEDS_LCG)) {
+			sd[i]->lcg_state = lcg_state_init(rng[i], state[i], 0xb4bc3953);
+		}
+	}
+}
+
+#endif  /* __KERNEL_CPU__ */
+
 /* Background Evaluation */
 
 ccl_device float3 shader_eval_background(KernelGlobals *kg, ShaderData *sd,
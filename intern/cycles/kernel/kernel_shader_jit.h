@@ -0,0 +1,88 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "kernel_shader_jit_globals.h"
+#include "util_atomic.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Runtime Compiled Shaders
+ *
+ * Surface shaders run through the function compiled for them when there is
+ * one, see kernel_shader_jit_globals.h. */
+
+/* Relative tolerance for closure weights, compiled code may use different
+ * instructions for the same math. */
+#define SHADER_JIT_VERIFY_TOLERANCE 1e-4f
+
+ccl_device bool shader_jit_closures_match(const ShaderData *a, const ShaderData *b)
+{
+	if(a->num_closure != b->num_closure || a->flag != b->flag)
+		return false;
+
+	for(int i = 0; i < a->num_closure; i++) {
+		const ShaderClosure *sc_a = &a->closure[i];
+		const ShaderClosure *sc_b = &b->closure[i];
+
+		if(sc_a->type != sc_b->type)
+			return false;
+
+		float scale = max(max3(fabs(sc_a->weight)), 1.0f);
+		if(max3(fabs(sc_a->weight - sc_b->weight)) > SHADER_JIT_VERIFY_TOLERANCE*scale)
+			return false;
+	}
+
+	return true;
+}
+
+/* Returns false when the shader has no compiled function. */
+ccl_device_noinline bool shader_jit_eval_surface(KernelGlobals *kg,
+                                                 ShaderData *sd,
+                                                 PathState *state,
+                                                 int path_flag)
+{
+	ShaderJitGlobals *jit = kg->shader_jit;
+	int shader = sd->shader & SHADER_MASK;
+
+	if(shader >= jit->num_surface)
+		return false;
+
+	ShaderJitFunction function = jit->surface[shader];
+
+	if(!function)
+		return false;
+
+	if(!jit->verify) {
+		function(kg, sd, state, path_flag);
+		return true;
+	}
+
+	/* Evaluate a copy with the compiled function, the interpreter result is
+	 * the one that gets used. Other threads may be running the function, so
+	 * it is only flagged here and disabled once the task is done. */
+	ShaderData jit_sd = *sd;
+	function(kg, &jit_sd, state, path_flag);
+	svm_eval_nodes(kg, sd, state, SHADER_TYPE_SURFACE, path_flag);
+
+	if(!shader_jit_closures_match(&jit_sd, sd)) {
+		atomic_add_and_fetch_uint32((uint32_t*)&jit->num_mismatches, 1);
+		atomic_fetch_and_or_uint32((uint32_t*)&jit->mismatch[shader], 1);
+	}
+
+	return true;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KERNEL_SHADER_JIT_GLOBALS_H__
+#define __KERNEL_SHADER_JIT_GLOBALS_H__
+
+#include "util_types.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Runtime Compiled Shaders
+ *
+ * The SVM programs of the scene are turned into C++ where every node is a
+ * constant, compiled with the system compiler into a shared library and
+ * loaded by the CPU device. Each surface shader becomes a function in which
+ * the compiler resolves the node dispatch and folds constant inputs, jumps
+ * to nodes it does not know fall back to the interpreter. Only used by the
+ * CPU device, and only when enabled in the debug flags.
+ *
+ * The library is compiled against the kernel headers but not against the
+ * texture cache, image lookups call back into the main kernel. */
+
+struct KernelGlobals;
+struct ShaderData;
+struct PathState;
+
+typedef void (*ShaderJitFunction)(KernelGlobals *kg,
+                                  ShaderData *sd,
+                                  PathState *state,
+                                  int path_flag);
+
+typedef bool (*ShaderJitImageCachedFunction)(KernelGlobals *kg, int tex);
+typedef float4 (*ShaderJitImageFunction)(KernelGlobals *kg,
+                                         int tex,
+                                         float x, float y,
+                                         float2 dx, float2 dy);
+typedef float4 (*ShaderJitImage3DFunction)(KernelGlobals *kg,
+                                           int tex,
+                                           float x, float y, float z);
+typedef float4 (*ShaderJitImage3DExFunction)(KernelGlobals *kg,
+                                             int tex,
+                                             float x, float y, float z,
+                                             int interpolation);
+
+/* Signature of the function exported by the library, filling in surface
+ * functions by shader id. */
+typedef void (*ShaderJitInitFunction)(ShaderJitFunction *surface, int num_shaders);
+
+#define SHADER_JIT_INIT_FUNCTION "cycles_shader_jit_init"
+
+struct ShaderJitGlobals {
+	/* surface function of each shader, NULL to use the interpreter. only
+	 * changed between tasks, never while the kernel runs */
+	ShaderJitFunction *surface;
+	int num_surface;
+
+	/* image lookups of the main kernel */
+	ShaderJitImageCachedFunction tex_image_is_cached;
+	ShaderJitImageFunction tex_image_interp_d;
+	ShaderJitImage3DFunction tex_image_interp_3d;
+	ShaderJitImage3DExFunction tex_image_interp_3d_ex;
+
+	/* run the interpreter as well and compare closures, shaders which
+	 * give different results are flagged by the kernel and switched back
+	 * to the interpreter before the next task */
+	bool verify;
+	uint *mismatch;
+	uint num_mismatches;
+
+	/* loaded library and hash of the SVM program it was compiled from */
+	void *library;
+	char md5[33];
+
+	ShaderJitGlobals()
+	: surface(NULL),
+	  num_surface(0),
+	  tex_image_is_cached(NULL),
+	  tex_image_interp_d(NULL),
+	  tex_image_interp_3d(NULL),
+	  tex_image_interp_3d_ex(NULL),
+	  verify(false),
+	  mismatch(NULL),
+	  num_mismatches(0),
+	  library(NULL)
+	{
+		md5[0] = '\0';
+	}
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __KERNEL_SHADER_JIT_GLOBALS_H__ */
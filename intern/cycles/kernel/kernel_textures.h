@@ -40,6 +40,7 @@ KERNEL_TEX(float4, texture_float4, __objects_vector)
 /* triangles */
 KERNEL_TEX(uint, texture_uint, __tri_shader)
 KERNEL_TEX(float4, texture_float4, __tri_vnormal)
+KERNEL_TEX(uint, texture_uint, __tri_vnormal_packed)
 KERNEL_TEX(uint4, texture_uint4, __tri_vindex)
 KERNEL_TEX(uint, texture_uint, __tri_patch)
 KERNEL_TEX(float2, texture_float2, __tri_patch_uv)
@@ -47,6 +48,8 @@ KERNEL_TEX(float2, texture_float2, __tri_patch_uv)
 /* curves */
 KERNEL_TEX(float4, texture_float4, __curves)
 KERNEL_TEX(float4, texture_float4, __curve_keys)
+KERNEL_TEX(uint, texture_uint, __curve_keys_packed)
+KERNEL_TEX(float4, texture_float4, __curve_key_bounds)
 
 /* patches */
 KERNEL_TEX(uint, texture_uint, __patches)
@@ -56,12 +59,16 @@ KERNEL_TEX(uint4, texture_uint4, __attributes_map)
 KERNEL_TEX(float, texture_float, __attributes_float)
 KERNEL_TEX(float4, texture_float4, __attributes_float3)
 KERNEL_TEX(uchar4, texture_uchar4, __attributes_uchar4)
+KERNEL_TEX(uint, texture_uint, __attributes_half)
 
 /* lights */
 KERNEL_TEX(float4, texture_float4, __light_distribution)
 KERNEL_TEX(float4, texture_float4, __light_data)
 KERNEL_TEX(float2, texture_float2, __light_background_marginal_cdf)
 KERNEL_TEX(float2, texture_float2, __light_background_conditional_cdf)
+KERNEL_TEX(float4, texture_float4, __light_tree_nodes)
+KERNEL_TEX(float4, texture_float4, __light_tree_emitters)
+KERNEL_TEX(uint, texture_uint, __light_tree_lookup)
 
 /* particles */
 KERNEL_TEX(float4, texture_float4, __particles)
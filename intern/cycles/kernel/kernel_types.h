@@ -38,6 +38,7 @@ CCL_NAMESPACE_BEGIN
 #define OBJECT_SIZE 		12
 #define OBJECT_VECTOR_SIZE	6
 #define LIGHT_SIZE		11
+#define LIGHT_TREE_NODE_SIZE	4
 #define FILTER_TABLE_SIZE	1024
 #define RAMP_TABLE_SIZE		256
 #define SHUTTER_TABLE_SIZE		256
@@ -61,6 +62,9 @@ CCL_NAMESPACE_BEGIN
 #  ifdef __KERNEL_SSE2__
 #    define __QBVH__
 #  endif
+#  ifdef __KERNEL_AVX2__
+#    define __OBVH__
+#  endif
 #  define __KERNEL_SHADING__
 #  define __KERNEL_ADV_SHADING__
 #  define __BRANCHED_PATH__
@@ -74,6 +78,9 @@ CCL_NAMESPACE_BEGIN
 #  define __VOLUME_SCATTER__
 #  define __SHADOW_RECORD_ALL__
 #  define __VOLUME_RECORD_ALL__
+#  define __PATH_GUIDING__
+#  define __SHADER_JIT__
+#  define __SPARSE_VOLUME__
 #endif  /* __KERNEL_CPU__ */
 
 #ifdef __KERNEL_CUDA__
@@ -166,6 +173,12 @@ CCL_NAMESPACE_BEGIN
 #  define __KERNEL_DEBUG__
 #endif
 
+/* Ray counting is only supported on the CPU, where every thread has its own
+ * globals. */
+#if defined(WITH_CYCLES_RAY_STATS) && defined(__KERNEL_CPU__)
+#  define __KERNEL_RAY_STATS__
+#endif
+
 /* Scene-based selective features compilation. */
 #ifdef __NO_CAMERA_MOTION__
 #  undef __CAMERA_MOTION__
@@ -350,10 +363,25 @@ typedef enum PassType {
 	PASS_BVH_INTERSECTIONS = (1 << 28),
 	PASS_RAY_BOUNCES = (1 << 29),
 #endif
+	PASS_ADAPTIVE_AUX_BUFFER = (1 << 30), /* internal, used by adaptive sampling */
 } PassType;
 
 #define PASS_ALL (~0)
 
+/* Denoising feature data, stored as a block of floats after the regular
+ * passes. Features are taken at the first non-transparent camera hit, the
+ * squared combined radiance gives the per pixel color variance.
+ *
+ * float3 values may be written as four floats, so every feature has its own
+ * group of four. */
+
+#define DENOISING_PASS_NORMAL       0
+#define DENOISING_PASS_DEPTH        4
+#define DENOISING_PASS_ALBEDO       8
+#define DENOISING_PASS_COLOR_SQUARE 12
+
+#define DENOISING_PASS_SIZE         16
+
 typedef enum BakePassFilter {
 	BAKE_FILTER_NONE = 0,
 	BAKE_FILTER_DIRECT = (1 << 0),
@@ -595,6 +623,7 @@ typedef enum AttributeElement {
 	ATTR_ELEMENT_VERTEX_MOTION,
 	ATTR_ELEMENT_CORNER,
 	ATTR_ELEMENT_CORNER_BYTE,
+	ATTR_ELEMENT_CORNER_HALF,
 	ATTR_ELEMENT_CURVE,
 	ATTR_ELEMENT_CURVE_KEY,
 	ATTR_ELEMENT_CURVE_KEY_MOTION,
@@ -757,6 +786,8 @@ enum ShaderDataFlag {
 	SD_HAS_DISPLACEMENT       = (1 << 26),
 	/* Has constant emission (value stored in __shader_flag) */
 	SD_HAS_CONSTANT_EMISSION  = (1 << 27),
+	/* Heterogeneous volume only varies with voxel attributes. */
+	SD_VOLUME_GRID_VARYING    = (1 << 28),
 
 	SD_SHADER_FLAGS = (SD_USE_MIS |
 	                   SD_HAS_TRANSPARENT_SHADOW |
@@ -769,7 +800,8 @@ enum ShaderDataFlag {
 	                   SD_VOLUME_CUBIC |
 	                   SD_HAS_BUMP |
 	                   SD_HAS_DISPLACEMENT |
-	                   SD_HAS_CONSTANT_EMISSION)
+	                   SD_HAS_CONSTANT_EMISSION |
+	                   SD_VOLUME_GRID_VARYING)
 };
 
 	/* Object flags. */
@@ -928,6 +960,9 @@ typedef struct PathState {
 #ifdef __LAMP_MIS__
 	float ray_t;       /* accumulated distance through transparent surfaces */
 #endif
+#ifdef __PATH_GUIDING__
+	float guiding_pdf; /* last bounce pdf with guiding, 0 if not recorded */
+#endif
 
 	/* volume rendering */
 #ifdef __VOLUME__
@@ -1088,13 +1123,18 @@ typedef struct KernelFilm {
 	int pass_shadow;
 	float pass_shadow_scale;
 	int filter_table_offset;
-	int pass_pad2;
+	int pass_adaptive_aux_buffer;
 
 	int pass_mist;
 	float mist_start;
 	float mist_inv_depth;
 	float mist_falloff;
 
+	int pass_denoising_data;
+	int pass_pad3;
+	int pass_pad4;
+	int pass_pad5;
+
 #ifdef __KERNEL_DEBUG__
 	int pass_bvh_traversed_nodes;
 	int pass_bvh_traversed_instances;
@@ -1134,6 +1174,12 @@ typedef struct KernelIntegrator {
 	int num_portals;
 	int portal_offset;
 
+	/* light tree */
+	int use_light_tree;
+	int light_tree_num_emitters;
+	float light_tree_pdf;
+	int light_tree_pad;
+
 	/* bounces */
 	int min_bounce;
 	int max_bounce;
@@ -1189,7 +1235,17 @@ typedef struct KernelIntegrator {
 	float light_inv_rr_threshold;
 
 	int start_sample;
-	int pad1, pad2, pad3;
+
+	/* adaptive sampling */
+	float adaptive_threshold;
+	int adaptive_min_samples;
+	int adaptive_step;
+
+	/* path guiding */
+	int use_path_guiding;
+	int path_guiding_memory;
+	float path_guiding_min_x, path_guiding_min_y, path_guiding_min_z;
+	float path_guiding_max_x, path_guiding_max_y, path_guiding_max_z;
 } KernelIntegrator;
 static_assert_align(KernelIntegrator, 16);
 
@@ -1201,7 +1257,12 @@ typedef struct KernelBVH {
 	int have_curves;
 	int have_instancing;
 	int use_qbvh;
-	int pad1, pad2;
+	int use_obvh;
+	/* vertex normals and corner attributes are stored quantized */
+	int use_compact_mesh;
+	/* curve keys are stored quantized */
+	int use_compact_curves;
+	int pad1, pad2, pad3;
 } KernelBVH;
 static_assert_align(KernelBVH, 16);
 
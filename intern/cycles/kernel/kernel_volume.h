@@ -154,6 +154,107 @@ ccl_device int volume_stack_sampling_method(KernelGlobals *kg, VolumeStack *stac
 	return method;
 }
 
+#ifdef __SPARSE_VOLUME__
+/* Empty space skipping for volumes which only vary with voxel attributes
+ * stored as sparse grids. Returns the distance along the ray up to which all
+ * grids are zero, the shaders are constant there and one step covers it.
+ * next_t is where the grids have to be checked again. */
+ccl_device float kernel_volume_empty_distance(KernelGlobals *kg, VolumeStack *stack, Ray *ray, float t, float *next_t)
+{
+	float empty_t = ray->t;
+	float occupied_t = t;
+
+	*next_t = ray->t;
+
+	for(int i = 0; stack[i].shader != SHADER_NONE; i++) {
+		int shader_flag = kernel_tex_fetch(__shader_flag, (stack[i].shader & SHADER_MASK)*SHADER_SIZE);
+
+		if(!(shader_flag & SD_HETEROGENEOUS_VOLUME))
+			continue;
+
+		int object = stack[i].object;
+
+		if(!(shader_flag & SD_VOLUME_GRID_VARYING) || object == OBJECT_NONE)
+			return t;
+		if(kernel_tex_fetch(__object_flag, object) & SD_OBJECT_MOTION)
+			return t;
+
+		/* ray in normalized grid coordinates, see volume_normalized_position() */
+		Transform tfm = object_fetch_transform(kg, object, OBJECT_INVERSE_TRANSFORM);
+		float3 P = transform_point(&tfm, ray->P);
+		float3 D = transform_direction(&tfm, ray->D);
+
+		uint attr_offset = object*kernel_data.bvh.attributes_map_stride + ATTR_PRIM_TRIANGLE;
+		uint4 attr_map = kernel_tex_fetch(__attributes_map, attr_offset);
+
+		while(attr_map.x != ATTR_STD_NONE) {
+			if(attr_map.x == ATTR_STD_GENERATED_TRANSFORM) {
+				tfm.x = kernel_tex_fetch(__attributes_float3, attr_map.z + 0);
+				tfm.y = kernel_tex_fetch(__attributes_float3, attr_map.z + 1);
+				tfm.z = kernel_tex_fetch(__attributes_float3, attr_map.z + 2);
+				tfm.w = kernel_tex_fetch(__attributes_float3, attr_map.z + 3);
+				P = transform_point(&tfm, P);
+				D = transform_direction(&tfm, D);
+				break;
+			}
+
+			attr_offset += ATTR_PRIM_TYPES;
+			attr_map = kernel_tex_fetch(__attributes_map, attr_offset);
+		}
+
+		/* every voxel attribute must be empty */
+		attr_offset = object*kernel_data.bvh.attributes_map_stride + ATTR_PRIM_TRIANGLE;
+		attr_map = kernel_tex_fetch(__attributes_map, attr_offset);
+
+		while(attr_map.x != ATTR_STD_NONE) {
+			if(attr_map.y == ATTR_ELEMENT_VOXEL) {
+				const VolumeGrid *grid = kernel_volume_grid(kg, attr_map.z);
+
+				/* dense images have no majorants */
+				if(!grid)
+					return t;
+
+				float grid_occupied_t;
+				float grid_empty_t = volume_grid_empty_distance(grid, P, D, t, ray->t, &grid_occupied_t);
+
+				empty_t = min(empty_t, grid_empty_t);
+				occupied_t = max(occupied_t, grid_occupied_t);
+			}
+
+			attr_offset += ATTR_PRIM_TYPES;
+			attr_map = kernel_tex_fetch(__attributes_map, attr_offset);
+		}
+	}
+
+	/* when not empty, skip checks until all occupied tiles are left */
+	*next_t = (empty_t > t)? empty_t: occupied_t;
+
+	return empty_t;
+}
+
+/* Advance new_t over empty space when it spans at least one step, which
+ * keeps the number of steps within the regular bound. */
+ccl_device_inline bool kernel_volume_skip_empty(KernelGlobals *kg,
+                                                PathState *state,
+                                                Ray *ray,
+                                                float t,
+                                                float step_size,
+                                                float *new_t,
+                                                float *next_check_t)
+{
+	if(t < *next_check_t)
+		return false;
+
+	float empty_t = kernel_volume_empty_distance(kg, state->volume_stack, ray, t, next_check_t);
+
+	if(empty_t - t < step_size)
+		return false;
+
+	*new_t = empty_t;
+	return true;
+}
+#endif  /* __SPARSE_VOLUME__ */
+
 /* Volume Shadows
  *
  * These functions are used to attenuate shadow rays to lights. Both absorption
@@ -183,19 +284,27 @@ ccl_device void kernel_volume_shadow_heterogeneous(KernelGlobals *kg, PathState
 
 	/* compute extinction at the start */
 	float t = 0.0f;
+#ifdef __SPARSE_VOLUME__
+	float next_check_t = 0.0f;
+#endif
 
 	float3 sum = make_float3(0.0f, 0.0f, 0.0f);
 
 	for(int i = 0; i < max_steps; i++) {
 		/* advance to new position */
-		float new_t = min(ray->t, (i+1) * step);
+		float new_t = min(ray->t, t + step);
+		bool empty = false;
+#ifdef __SPARSE_VOLUME__
+		empty = kernel_volume_skip_empty(kg, state, ray, t, step, &new_t, &next_check_t);
+#endif
 		float dt = new_t - t;
 
-		/* use random position inside this segment to sample shader */
-		if(new_t == ray->t)
+		/* use random position inside this segment to sample shader,
+		 * empty space is constant and shaded once in the middle */
+		if(new_t == ray->t && !empty)
 			random_jitter_offset = lcg_step_float(&state->rng_congruential) * dt;
 
-		float3 new_P = ray->P + ray->D * (t + random_jitter_offset);
+		float3 new_P = ray->P + ray->D * (t + (empty? 0.5f*dt: random_jitter_offset));
 		float3 sigma_t;
 
 		/* compute attenuation over segment */
@@ -466,17 +575,25 @@ ccl_device VolumeIntegrateResult kernel_volume_integrate_heterogeneous_distance(
 	int channel = (int)(rphase*3.0f);
 	sd->randb_closure = rphase*3.0f - channel;
 	bool has_scatter = false;
+#ifdef __SPARSE_VOLUME__
+	float next_check_t = 0.0f;
+#endif
 
 	for(int i = 0; i < max_steps; i++) {
 		/* advance to new position */
-		float new_t = min(ray->t, (i+1) * step_size);
+		float new_t = min(ray->t, t + step_size);
+		bool empty = false;
+#ifdef __SPARSE_VOLUME__
+		empty = kernel_volume_skip_empty(kg, state, ray, t, step_size, &new_t, &next_check_t);
+#endif
 		float dt = new_t - t;
 
-		/* use random position inside this segment to sample shader */
-		if(new_t == ray->t)
+		/* use random position inside this segment to sample shader,
+		 * empty space is constant and shaded once in the middle */
+		if(new_t == ray->t && !empty)
 			random_jitter_offset = lcg_step_float(&state->rng_congruential) * dt;
 
-		float3 new_P = ray->P + ray->D * (t + random_jitter_offset);
+		float3 new_P = ray->P + ray->D * (t + (empty? 0.5f*dt: random_jitter_offset));
 		VolumeShaderCoefficients coeff;
 
 		/* compute segment */
@@ -691,17 +808,26 @@ ccl_device void kernel_volume_decoupled_record(KernelGlobals *kg, PathState *sta
 	bool is_last_step_empty = false;
 
 	VolumeStep *step = segment->steps;
+#ifdef __SPARSE_VOLUME__
+	float next_check_t = (heterogeneous)? 0.0f: ray->t;
+#endif
 
 	for(int i = 0; i < max_steps; i++, step++) {
 		/* advance to new position */
-		float new_t = min(ray->t, (i+1) * step_size);
+		float new_t = min(ray->t, t + step_size);
+		bool empty = false;
+#ifdef __SPARSE_VOLUME__
+		empty = kernel_volume_skip_empty(kg, state, ray, t, step_size, &new_t, &next_check_t);
+#endif
 		float dt = new_t - t;
 
-		/* use random position inside this segment to sample shader */
-		if(heterogeneous && new_t == ray->t)
+		/* use random position inside this segment to sample shader,
+		 * empty space is constant and shaded once in the middle */
+		if(heterogeneous && new_t == ray->t && !empty)
 			random_jitter_offset = lcg_step_float(&state->rng_congruential) * dt;
 
-		float3 new_P = ray->P + ray->D * (t + random_jitter_offset);
+		float shade_t = t + (empty? 0.5f*dt: random_jitter_offset);
+		float3 new_P = ray->P + ray->D * shade_t;
 		VolumeShaderCoefficients coeff;
 
 		/* compute segment */
@@ -753,7 +879,7 @@ ccl_device void kernel_volume_decoupled_record(KernelGlobals *kg, PathState *sta
 		step->accum_transmittance = accum_transmittance;
 		step->cdf_distance = cdf_distance;
 		step->t = new_t;
-		step->shade_t = t + random_jitter_offset;
+		step->shade_t = shade_t;
 
 		/* stop if at the end of the volume */
 		t = new_t;
@@ -0,0 +1,263 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KERNEL_VOLUME_GRID_H__
+#define __KERNEL_VOLUME_GRID_H__
+
+#include "kernel_volume_grid_globals.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Sparse Volume Grid Lookups
+ *
+ * Interpolation matches dense 3D image textures, see kernel_compat_cpu.h. */
+
+/* Limit on the number of empty tiles and blocks visited by one traversal. */
+#define VOLUME_GRID_MAX_TRAVERSAL_STEPS 256
+
+ccl_device_inline const VolumeGrid *kernel_volume_grid(KernelGlobals *kg, int tex)
+{
+	VolumeGridGlobals *volume_grids = kg->volume_grids;
+
+	if(volume_grids && tex < (int)volume_grids->grids.size())
+		return volume_grids->grids[tex];
+
+	return NULL;
+}
+
+ccl_device_inline float4 volume_grid_voxel(const VolumeGrid *grid, int x, int y, int z)
+{
+	const int mask = VOLUME_GRID_TILE_SIZE - 1;
+	int tile = grid->tiles[(x >> VOLUME_GRID_TILE_SHIFT) +
+	                       grid->tiles_x*((y >> VOLUME_GRID_TILE_SHIFT) +
+	                                      grid->tiles_y*(z >> VOLUME_GRID_TILE_SHIFT))];
+
+	if(tile == VOLUME_GRID_EMPTY_TILE)
+		return grid->background;
+
+	const float *voxel = &grid->voxels[tile + grid->channels*((x & mask) +
+	                                                           ((y & mask) << VOLUME_GRID_TILE_SHIFT) +
+	                                                           ((z & mask) << (2*VOLUME_GRID_TILE_SHIFT)))];
+
+	if(grid->channels == 1)
+		return make_float4(voxel[0], voxel[0], voxel[0], 1.0f);
+	else if(grid->channels == 3)
+		return make_float4(voxel[0], voxel[1], voxel[2], 1.0f);
+
+	return make_float4(voxel[0], voxel[1], voxel[2], voxel[3]);
+}
+
+ccl_device_inline int volume_grid_wrap(int x, int size, ExtensionType extension)
+{
+	if(extension == EXTENSION_REPEAT) {
+		x %= size;
+		return (x < 0)? x + size: x;
+	}
+
+	return clamp(x, 0, size - 1);
+}
+
+ccl_device_inline void volume_grid_cubic_weights(float u[4], float t)
+{
+	u[0] = (((-1.0f/6.0f)* t + 0.5f) * t - 0.5f) * t + (1.0f/6.0f);
+	u[1] =  ((      0.5f * t - 1.0f) * t       ) * t + (2.0f/3.0f);
+	u[2] =  ((     -0.5f * t + 0.5f) * t + 0.5f) * t + (1.0f/6.0f);
+	u[3] = (1.0f / 6.0f) * t * t * t;
+}
+
+ccl_device float4 volume_grid_interp_3d(const VolumeGrid *grid, float x, float y, float z, int interpolation)
+{
+	const ExtensionType extension = grid->extension;
+
+	if(extension == EXTENSION_CLIP) {
+		if(x < 0.0f || y < 0.0f || z < 0.0f ||
+		   x > 1.0f || y > 1.0f || z > 1.0f)
+		{
+			return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+		}
+	}
+
+	x *= (float)grid->width;
+	y *= (float)grid->height;
+	z *= (float)grid->depth;
+
+	if(interpolation == INTERPOLATION_CLOSEST) {
+		return volume_grid_voxel(grid,
+		                         volume_grid_wrap(float_to_int(floorf(x)), grid->width, extension),
+		                         volume_grid_wrap(float_to_int(floorf(y)), grid->height, extension),
+		                         volume_grid_wrap(float_to_int(floorf(z)), grid->depth, extension));
+	}
+
+	x -= 0.5f;
+	y -= 0.5f;
+	z -= 0.5f;
+
+	const float fx = floorf(x), fy = floorf(y), fz = floorf(z);
+	const float tx = x - fx, ty = y - fy, tz = z - fz;
+	const int ix = float_to_int(fx), iy = float_to_int(fy), iz = float_to_int(fz);
+
+	if(interpolation == INTERPOLATION_CUBIC) {
+		/* Tricubic b-spline interpolation. */
+		float u[4], v[4], w[4];
+		volume_grid_cubic_weights(u, tx);
+		volume_grid_cubic_weights(v, ty);
+		volume_grid_cubic_weights(w, tz);
+
+		int xc[4], yc[4], zc[4];
+		for(int i = 0; i < 4; i++) {
+			xc[i] = volume_grid_wrap(ix + i - 1, grid->width, extension);
+			yc[i] = volume_grid_wrap(iy + i - 1, grid->height, extension);
+			zc[i] = volume_grid_wrap(iz + i - 1, grid->depth, extension);
+		}
+
+		float4 r = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+		for(int k = 0; k < 4; k++) {
+			for(int j = 0; j < 4; j++) {
+				float vw = v[j]*w[k];
+
+				for(int i = 0; i < 4; i++)
+					r += u[i]*vw*volume_grid_voxel(grid, xc[i], yc[j], zc[k]);
+			}
+		}
+
+		return r;
+	}
+
+	/* Trilinear interpolation. */
+	const int x0 = volume_grid_wrap(ix, grid->width, extension);
+	const int y0 = volume_grid_wrap(iy, grid->height, extension);
+	const int z0 = volume_grid_wrap(iz, grid->depth, extension);
+	const int x1 = volume_grid_wrap(ix + 1, grid->width, extension);
+	const int y1 = volume_grid_wrap(iy + 1, grid->height, extension);
+	const int z1 = volume_grid_wrap(iz + 1, grid->depth, extension);
+
+	float4 r;
+
+	r  = (1.0f - tz)*(1.0f - ty)*(1.0f - tx)*volume_grid_voxel(grid, x0, y0, z0);
+	r += (1.0f - tz)*(1.0f - ty)*tx*volume_grid_voxel(grid, x1, y0, z0);
+	r += (1.0f - tz)*ty*(1.0f - tx)*volume_grid_voxel(grid, x0, y1, z0);
+	r += (1.0f - tz)*ty*tx*volume_grid_voxel(grid, x1, y1, z0);
+
+	r += tz*(1.0f - ty)*(1.0f - tx)*volume_grid_voxel(grid, x0, y0, z1);
+	r += tz*(1.0f - ty)*tx*volume_grid_voxel(grid, x1, y0, z1);
+	r += tz*ty*(1.0f - tx)*volume_grid_voxel(grid, x0, y1, z1);
+	r += tz*ty*tx*volume_grid_voxel(grid, x1, y1, z1);
+
+	return r;
+}
+
+/* Empty Space Traversal
+ *
+ * Walks the ray through blocks and tiles with a zero majorant, P and D are in
+ * normalized grid coordinates. Returns the distance from t up to which every
+ * lookup in the grid returns zero, or t when the grid is not empty at t. In
+ * that case occupied_t is set to the distance where the occupied tile ends. */
+
+ccl_device_inline float volume_grid_cell_exit(float3 P, float3 inv_D, float3 p, int shift)
+{
+	const float size = (float)(1 << shift);
+	const float3 cell = make_float3(floorf(p.x/size), floorf(p.y/size), floorf(p.z/size))*size;
+	const float3 bound = make_float3((inv_D.x >= 0.0f)? cell.x + size: cell.x,
+	                                 (inv_D.y >= 0.0f)? cell.y + size: cell.y,
+	                                 (inv_D.z >= 0.0f)? cell.z + size: cell.z);
+	const float3 t = (bound - P)*inv_D;
+
+	return min(min(t.x, t.y), t.z);
+}
+
+ccl_device float volume_grid_empty_distance(const VolumeGrid *grid,
+                                            float3 P,
+                                            float3 D,
+                                            float t,
+                                            float tmax,
+                                            float *occupied_t)
+{
+	*occupied_t = tmax;
+
+	/* repeating grids are never empty */
+	if(grid->block_majorants.empty() || grid->extension == EXTENSION_REPEAT)
+		return t;
+
+	const float3 size = make_float3((float)grid->width, (float)grid->height, (float)grid->depth);
+	P *= size;
+	D *= size;
+
+	const float3 inv_D = make_float3((D.x != 0.0f)? 1.0f/D.x: FLT_MAX,
+	                                 (D.y != 0.0f)? 1.0f/D.y: FLT_MAX,
+	                                 (D.z != 0.0f)? 1.0f/D.z: FLT_MAX);
+	/* step a tiny fraction of a voxel into the next cell */
+	const float eps = 1e-4f/max(max(fabsf(D.x), fabsf(D.y)), max(fabsf(D.z), 1e-8f));
+
+	for(int i = 0; i < VOLUME_GRID_MAX_TRAVERSAL_STEPS; i++) {
+		if(t >= tmax)
+			return tmax;
+
+		const float3 p = P + D*t;
+
+		if(p.x < 0.0f || p.y < 0.0f || p.z < 0.0f ||
+		   p.x >= size.x || p.y >= size.y || p.z >= size.z)
+		{
+			/* lookups outside of clipped grids return zero, extended grids
+			 * return the border voxels */
+			if(grid->extension != EXTENSION_CLIP)
+				return t;
+
+			/* advance to where the ray enters the grid */
+			const float3 t0 = (make_float3(0.0f, 0.0f, 0.0f) - P)*inv_D;
+			const float3 t1 = (size - P)*inv_D;
+			const float3 tnear = min(t0, t1);
+			const float3 tfar = max(t0, t1);
+			const float t_enter = max(max(tnear.x, tnear.y), tnear.z);
+			const float t_exit = min(min(tfar.x, tfar.y), tfar.z);
+
+			if(t_exit <= t || t_enter >= t_exit)
+				return tmax;
+
+			t = max(t_enter, t) + eps;
+			continue;
+		}
+
+		const int x = float_to_int(p.x), y = float_to_int(p.y), z = float_to_int(p.z);
+		const int block = (x >> VOLUME_GRID_BLOCK_SHIFT) +
+		                  grid->blocks_x*((y >> VOLUME_GRID_BLOCK_SHIFT) +
+		                                  grid->blocks_y*(z >> VOLUME_GRID_BLOCK_SHIFT));
+		int shift = VOLUME_GRID_BLOCK_SHIFT;
+
+		if(grid->block_majorants[block] != 0.0f) {
+			const int tile = (x >> VOLUME_GRID_TILE_SHIFT) +
+			                 grid->tiles_x*((y >> VOLUME_GRID_TILE_SHIFT) +
+			                                grid->tiles_y*(z >> VOLUME_GRID_TILE_SHIFT));
+
+			shift = VOLUME_GRID_TILE_SHIFT;
+
+			if(grid->tile_majorants[tile] != 0.0f) {
+				*occupied_t = min(volume_grid_cell_exit(P, inv_D, p, shift), tmax);
+				return t;
+			}
+		}
+
+		t = max(volume_grid_cell_exit(P, inv_D, p, shift), t) + eps;
+	}
+
+	/* empty up to here, check again later */
+	*occupied_t = t;
+	return t;
+}
+
+CCL_NAMESPACE_END
+
+#endif /* __KERNEL_VOLUME_GRID_H__ */
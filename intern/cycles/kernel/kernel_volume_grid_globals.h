@@ -0,0 +1,90 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KERNEL_VOLUME_GRID_GLOBALS_H__
+#define __KERNEL_VOLUME_GRID_GLOBALS_H__
+
+#include "util_types.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Sparse Volume Grids
+ *
+ * Voxels are stored in tiles of 8x8x8, the same as OpenVDB leaf nodes, and
+ * tiles which only contain the background value are not stored at all. Tiles
+ * are grouped into blocks of 8x8x8 tiles.
+ *
+ * For each tile and block the majorant is the largest absolute value that an
+ * interpolated lookup inside it can return, including neighboring voxels used
+ * by the interpolation. Only the color channels are included, volume attributes
+ * do not use alpha. Rays skip over tiles and blocks with a zero majorant.
+ * Only used by the CPU device. */
+
+#define VOLUME_GRID_TILE_SHIFT 3
+#define VOLUME_GRID_TILE_SIZE (1 << VOLUME_GRID_TILE_SHIFT)
+#define VOLUME_GRID_TILE_VOXELS (VOLUME_GRID_TILE_SIZE*VOLUME_GRID_TILE_SIZE*VOLUME_GRID_TILE_SIZE)
+#define VOLUME_GRID_BLOCK_SHIFT (VOLUME_GRID_TILE_SHIFT + 3)
+#define VOLUME_GRID_BLOCK_SIZE (1 << VOLUME_GRID_BLOCK_SHIFT)
+#define VOLUME_GRID_EMPTY_TILE -1
+
+struct VolumeGrid {
+	/* resolution in voxels, tiles and blocks */
+	int width, height, depth;
+	int tiles_x, tiles_y, tiles_z;
+	int blocks_x, blocks_y, blocks_z;
+
+	/* floats per voxel, 1, 3 or 4, missing alpha is one */
+	int channels;
+	float4 background;
+
+	InterpolationType interpolation;
+	ExtensionType extension;
+
+	/* offset of the first voxel of each tile in voxels, or VOLUME_GRID_EMPTY_TILE */
+	vector<int> tiles;
+	vector<float> voxels;
+
+	vector<float> tile_majorants;
+	vector<float> block_majorants;
+
+	VolumeGrid()
+	: width(0), height(0), depth(0),
+	  tiles_x(0), tiles_y(0), tiles_z(0),
+	  blocks_x(0), blocks_y(0), blocks_z(0),
+	  channels(1),
+	  background(make_float4(0.0f, 0.0f, 0.0f, 1.0f)),
+	  interpolation(INTERPOLATION_LINEAR),
+	  extension(EXTENSION_CLIP)
+	{
+	}
+
+	size_t memory_size() const
+	{
+		return tiles.size()*sizeof(int) +
+		       voxels.size()*sizeof(float) +
+		       (tile_majorants.size() + block_majorants.size())*sizeof(float);
+	}
+};
+
+struct VolumeGridGlobals {
+	/* indexed by flat image slot, slots without grid are dense images */
+	vector<VolumeGrid*> grids;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __KERNEL_VOLUME_GRID_GLOBALS_H__ */
@@ -24,6 +24,31 @@ void KERNEL_FUNCTION_FULL_NAME(path_trace)(KernelGlobals *kg,
                                            int offset,
                                            int stride);
 
+void KERNEL_FUNCTION_FULL_NAME(path_trace_stream)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  unsigned int *rng_state,
+                                                  int sample,
+                                                  int x, int y,
+                                                  int w, int h,
+                                                  int offset,
+                                                  int stride);
+
+bool KERNEL_FUNCTION_FULL_NAME(adaptive_convergence_check)(KernelGlobals *kg,
+                                                          float *buffer,
+                                                          int num_samples,
+                                                          int x, int y,
+                                                          int w, int h,
+                                                          int offset,
+                                                          int stride);
+
+void KERNEL_FUNCTION_FULL_NAME(adaptive_adjust_samples)(KernelGlobals *kg,
+                                                       float *buffer,
+                                                       int num_samples,
+                                                       int x, int y,
+                                                       int w, int h,
+                                                       int offset,
+                                                       int stride);
+
 void KERNEL_FUNCTION_FULL_NAME(convert_to_byte)(KernelGlobals *kg,
                                                 uchar4 *rgba,
                                                 float *buffer,
@@ -49,4 +74,20 @@ void KERNEL_FUNCTION_FULL_NAME(shader)(KernelGlobals *kg,
                                        int offset,
                                        int sample);
 
+bool KERNEL_FUNCTION_FULL_NAME(tex_image_is_cached)(KernelGlobals *kg, int tex);
+
+float4 KERNEL_FUNCTION_FULL_NAME(tex_image_interp_d)(KernelGlobals *kg,
+                                                     int tex,
+                                                     float x, float y,
+                                                     float2 dx, float2 dy);
+
+float4 KERNEL_FUNCTION_FULL_NAME(tex_image_interp_3d)(KernelGlobals *kg,
+                                                      int tex,
+                                                      float x, float y, float z);
+
+float4 KERNEL_FUNCTION_FULL_NAME(tex_image_interp_3d_ex)(KernelGlobals *kg,
+                                                         int tex,
+                                                         float x, float y, float z,
+                                                         int interpolation);
+
 #undef KERNEL_ARCH
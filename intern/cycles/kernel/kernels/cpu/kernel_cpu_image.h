@@ -19,10 +19,72 @@
 
 #ifdef __KERNEL_CPU__
 
+#include "kernel_oiio_globals.h"
+#include "kernel_volume_grid.h"
+
 CCL_NAMESPACE_BEGIN
 
-ccl_device float4 kernel_tex_image_interp_impl(KernelGlobals *kg, int tex, float x, float y)
+ccl_device_inline bool kernel_tex_image_is_cached(KernelGlobals *kg, int tex)
+{
+	OIIOGlobals *oiio = kg->oiio;
+	return oiio && tex < (int)oiio->textures.size() && oiio->textures[tex].handle;
+}
+
+/* Lookup in the texture cache, dx and dy are the derivatives of the texture
+ * coordinate in screen space and select the MIP level. */
+ccl_device float4 kernel_tex_image_cache_lookup(KernelGlobals *kg, int tex, float x, float y, float2 dx, float2 dy)
+{
+	const OIIOTexture& texture = kg->oiio->textures[tex];
+	OIIO::TextureSystem::Perthread *thread_info = (kg->oiio_tdata)? kg->oiio_tdata->thread_info: NULL;
+	OIIO::TextureOpt options;
+
+	options.interpmode = texture.interpolation;
+	options.swrap = texture.extension;
+	options.twrap = texture.extension;
+	if(texture.interpolation == OIIO::TextureOpt::InterpClosest)
+		options.mipmode = OIIO::TextureOpt::MipModeNoMIP;
+
+	/* Image rows are stored bottom to top in Cycles, files are top to bottom. */
+	float r[4];
+	if(!kg->oiio->tex_sys->texture(texture.handle, thread_info, options,
+	                               x, 1.0f - y,
+	                               dx.x, -dx.y, dy.x, -dy.y,
+	                               min(texture.channels, 4), r))
+	{
+		return make_float4(TEX_IMAGE_MISSING_R,
+		                   TEX_IMAGE_MISSING_G,
+		                   TEX_IMAGE_MISSING_B,
+		                   TEX_IMAGE_MISSING_A);
+	}
+
+	float4 f;
+	switch(texture.channels) {
+		case 1: f = make_float4(r[0], r[0], r[0], 1.0f); break;
+		case 2: f = make_float4(r[0], r[0], r[0], r[1]); break;
+		case 3: f = make_float4(r[0], r[1], r[2], 1.0f); break;
+		default: f = make_float4(r[0], r[1], r[2], r[3]); break;
+	}
+
+	/* The texture system associates alpha, match images loaded into memory
+	 * which ignore alpha when it is not used. */
+	if(!texture.use_alpha) {
+		if(f.w != 1.0f && f.w != 0.0f) {
+			float invw = 1.0f/f.w;
+			f.x *= invw;
+			f.y *= invw;
+			f.z *= invw;
+		}
+		f.w = 1.0f;
+	}
+
+	return f;
+}
+
+ccl_device float4 kernel_tex_image_interp_d_impl(KernelGlobals *kg, int tex, float x, float y, float2 dx, float2 dy)
 {
+	if(kernel_tex_image_is_cached(kg, tex))
+		return kernel_tex_image_cache_lookup(kg, tex, x, y, dx, dy);
+
 	if(tex >= TEX_START_HALF_CPU)
 		return kg->texture_half_images[tex - TEX_START_HALF_CPU].interp(x, y);
 	else if(tex >= TEX_START_BYTE_CPU)
@@ -37,8 +99,17 @@ ccl_device float4 kernel_tex_image_interp_impl(KernelGlobals *kg, int tex, float
 		return kg->texture_float4_images[tex].interp(x, y);
 }
 
+ccl_device float4 kernel_tex_image_interp_impl(KernelGlobals *kg, int tex, float x, float y)
+{
+	return kernel_tex_image_interp_d_impl(kg, tex, x, y, make_float2(0.0f, 0.0f), make_float2(0.0f, 0.0f));
+}
+
 ccl_device float4 kernel_tex_image_interp_3d_impl(KernelGlobals *kg, int tex, float x, float y, float z)
 {
+	const VolumeGrid *grid = kernel_volume_grid(kg, tex);
+	if(grid)
+		return volume_grid_interp_3d(grid, x, y, z, grid->interpolation);
+
 	if(tex >= TEX_START_HALF_CPU)
 		return kg->texture_half_images[tex - TEX_START_HALF_CPU].interp_3d(x, y, z);
 	else if(tex >= TEX_START_BYTE_CPU)
@@ -56,6 +127,10 @@ ccl_device float4 kernel_tex_image_interp_3d_impl(KernelGlobals *kg, int tex, fl
 
 ccl_device float4 kernel_tex_image_interp_3d_ex_impl(KernelGlobals *kg, int tex, float x, float y, float z, int interpolation)
 {
+	const VolumeGrid *grid = kernel_volume_grid(kg, tex);
+	if(grid)
+		return volume_grid_interp_3d(grid, x, y, z, interpolation);
+
 	if(tex >= TEX_START_HALF_CPU)
 		return kg->texture_half_images[tex - TEX_START_HALF_CPU].interp_3d_ex(x, y, z, interpolation);
 	else if(tex >= TEX_START_BYTE_CPU)
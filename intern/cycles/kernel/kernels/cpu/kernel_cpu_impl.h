@@ -28,6 +28,7 @@
 #include "kernel_film.h"
 #include "kernel_path.h"
 #include "kernel_path_branched.h"
+#include "kernel_path_stream.h"
 #include "kernel_bake.h"
 
 CCL_NAMESPACE_BEGIN
@@ -59,6 +60,61 @@ void KERNEL_FUNCTION_FULL_NAME(path_trace)(KernelGlobals *kg,
 	}
 }
 
+void KERNEL_FUNCTION_FULL_NAME(path_trace_stream)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  unsigned int *rng_state,
+                                                  int sample,
+                                                  int x, int y,
+                                                  int w, int h,
+                                                  int offset,
+                                                  int stride)
+{
+	kernel_path_trace_stream(kg,
+	                         buffer,
+	                         rng_state,
+	                         sample,
+	                         x, y,
+	                         w, h,
+	                         offset,
+	                         stride);
+}
+
+/* Adaptive Sampling */
+
+bool KERNEL_FUNCTION_FULL_NAME(adaptive_convergence_check)(KernelGlobals *kg,
+                                                          float *buffer,
+                                                          int num_samples,
+                                                          int x, int y,
+                                                          int w, int h,
+                                                          int offset,
+                                                          int stride)
+{
+	return kernel_adaptive_convergence_check(kg,
+	                                         buffer,
+	                                         num_samples,
+	                                         x, y,
+	                                         w, h,
+	                                         offset,
+	                                         stride);
+}
+
+void KERNEL_FUNCTION_FULL_NAME(adaptive_adjust_samples)(KernelGlobals *kg,
+                                                       float *buffer,
+                                                       int num_samples,
+                                                       int x, int y,
+                                                       int w, int h,
+                                                       int offset,
+                                                       int stride)
+{
+	kernel_adaptive_adjust_samples(kg,
+	                               buffer,
+	                               num_samples,
+	                               x, y,
+	                               w, h,
+	                               offset,
+	                               stride);
+}
+
 /* Film */
 
 void KERNEL_FUNCTION_FULL_NAME(convert_to_byte)(KernelGlobals *kg,
@@ -131,4 +187,34 @@ void KERNEL_FUNCTION_FULL_NAME(shader)(KernelGlobals *kg,
 	}
 }
 
+/* Image Lookup, for shaders compiled at runtime */
+
+bool KERNEL_FUNCTION_FULL_NAME(tex_image_is_cached)(KernelGlobals *kg, int tex)
+{
+	return kernel_tex_image_is_cached(kg, tex);
+}
+
+float4 KERNEL_FUNCTION_FULL_NAME(tex_image_interp_d)(KernelGlobals *kg,
+                                                     int tex,
+                                                     float x, float y,
+                                                     float2 dx, float2 dy)
+{
+	return kernel_tex_image_interp_d_impl(kg, tex, x, y, dx, dy);
+}
+
+float4 KERNEL_FUNCTION_FULL_NAME(tex_image_interp_3d)(KernelGlobals *kg,
+                                                      int tex,
+                                                      float x, float y, float z)
+{
+	return kernel_tex_image_interp_3d_impl(kg, tex, x, y, z);
+}
+
+float4 KERNEL_FUNCTION_FULL_NAME(tex_image_interp_3d_ex)(KernelGlobals *kg,
+                                                         int tex,
+                                                         float x, float y, float z,
+                                                         int interpolation)
+{
+	return kernel_tex_image_interp_3d_ex_impl(kg, tex, x, y, z, interpolation);
+}
+
 CCL_NAMESPACE_END
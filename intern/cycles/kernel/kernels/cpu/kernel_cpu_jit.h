@@ -0,0 +1,105 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Preamble of the shaders which the CPU device compiles at runtime, see
+ * kernel_shader_jit_globals.h. Kernel features and types must match the
+ * regular CPU kernel, since the functions are called with its data. */
+
+#ifndef CCL_NAMESPACE_BEGIN
+#  define CCL_NAMESPACE_BEGIN namespace ccl {
+#  define CCL_NAMESPACE_END }
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#  define __KERNEL_SSE2__
+#endif
+
+#include "kernel_compat_cpu.h"
+#include "kernel_math.h"
+#include "kernel_types.h"
+#include "kernel_globals.h"
+#include "kernel_shader_jit_globals.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Images are sampled by the main kernel, which also owns the texture cache. */
+
+ccl_device_inline bool kernel_tex_image_is_cached(KernelGlobals *kg, int tex)
+{
+	return kg->shader_jit->tex_image_is_cached(kg, tex);
+}
+
+ccl_device float4 kernel_tex_image_interp_d_impl(KernelGlobals *kg, int tex, float x, float y, float2 dx, float2 dy)
+{
+	return kg->shader_jit->tex_image_interp_d(kg, tex, x, y, dx, dy);
+}
+
+ccl_device float4 kernel_tex_image_interp_impl(KernelGlobals *kg, int tex, float x, float y)
+{
+	return kernel_tex_image_interp_d_impl(kg, tex, x, y, make_float2(0.0f, 0.0f), make_float2(0.0f, 0.0f));
+}
+
+ccl_device float4 kernel_tex_image_interp_3d_impl(KernelGlobals *kg, int tex, float x, float y, float z)
+{
+	return kg->shader_jit->tex_image_interp_3d(kg, tex, x, y, z);
+}
+
+ccl_device float4 kernel_tex_image_interp_3d_ex_impl(KernelGlobals *kg, int tex, float x, float y, float z, int interpolation)
+{
+	return kg->shader_jit->tex_image_interp_3d_ex(kg, tex, x, y, z, interpolation);
+}
+
+CCL_NAMESPACE_END
+
+#include "kernel_random.h"
+#include "kernel_projection.h"
+#include "kernel_montecarlo.h"
+#include "kernel_differential.h"
+#include "kernel_camera.h"
+
+#include "geom/geom.h"
+
+#include "closure/alloc.h"
+#include "closure/bsdf_util.h"
+#include "closure/bsdf.h"
+#include "closure/emissive.h"
+
+#include "svm/svm.h"
+
+/* Body of the surface function of a shader, generated code lists all nodes
+ * of its program between these. Jumps to offsets which are not listed go to
+ * the interpreter. */
+
+#define SHADER_JIT_BEGIN(start) \
+	float stack[SVM_STACK_SIZE]; \
+	int next = start; \
+	while(1) { \
+		int offset = next++; \
+		switch(offset) {
+
+#define SHADER_JIT_NODE(node_offset, x, y, z, w) \
+			case node_offset: \
+				if(!svm_eval_node(kg, sd, state, SHADER_TYPE_SURFACE, path_flag, stack, \
+				                  make_uint4(x, y, z, w), &next)) \
+					return; \
+				break;
+
+#define SHADER_JIT_END \
+			default: \
+				svm_eval_nodes_from(kg, sd, state, SHADER_TYPE_SURFACE, path_flag, stack, offset); \
+				return; \
+		} \
+	}
@@ -135,6 +135,104 @@ ccl_device_inline void decode_node_uchar4(uint i, uint *x, uint *y, uint *z, uin
 	if(w) *w = ((i >> 24) & 0xFF);
 }
 
+#ifdef __KERNEL_CPU__
+
+/* Batch Stack
+ *
+ * Stacks of the shading points evaluated by the batched interpreter. Scalar
+ * nodes use the stack of every point. Vectorized nodes use the same stack in
+ * a structure of arrays layout, where a slot holds the value of all points in
+ * SSE lanes. A slot is gathered into lanes when a vectorized node reads it,
+ * slots written by vectorized nodes are scattered back to the stacks of the
+ * points before the next scalar node, so runs of vectorized nodes stay in the
+ * lanes layout. */
+
+#define SVM_BATCH_GROUPS ((SVM_BATCH_SIZE + 3)/4)
+#define SVM_BATCH_SLOT_WORDS ((SVM_STACK_SIZE + 31)/32)
+
+typedef struct SVMBatchStack {
+	float point[SVM_BATCH_SIZE][SVM_STACK_SIZE];
+#ifdef __KERNEL_SSE2__
+	ssef lanes[SVM_STACK_SIZE][SVM_BATCH_GROUPS];
+	/* slots with up to date lanes, and slots with lanes newer than point */
+	uint valid[SVM_BATCH_SLOT_WORDS];
+	uint dirty[SVM_BATCH_SLOT_WORDS];
+#endif
+	int num;
+} SVMBatchStack;
+
+ccl_device_inline void svm_batch_stack_init(SVMBatchStack *stack, int num)
+{
+	kernel_assert(num <= SVM_BATCH_SIZE);
+
+	stack->num = num;
+#ifdef __KERNEL_SSE2__
+	for(int w = 0; w < SVM_BATCH_SLOT_WORDS; w++) {
+		stack->valid[w] = 0;
+		stack->dirty[w] = 0;
+	}
+#endif
+}
+
+#ifdef __KERNEL_SSE2__
+
+/* Lanes of a slot for reading, lanes past the number of points are zero.
+ * Nodes must load all their inputs before storing outputs. Nodes always
+ * evaluate all lanes, which is cheaper than handling partial batches. */
+ccl_device_inline const ssef *svm_batch_load(SVMBatchStack *stack, uint a)
+{
+	kernel_assert(a < SVM_STACK_SIZE);
+
+	const uint bit = 1u << (a & 31);
+
+	if(!(stack->valid[a >> 5] & bit)) {
+		float *lane = (float*)stack->lanes[a];
+
+		for(int i = 0; i < SVM_BATCH_GROUPS*4; i++)
+			lane[i] = (i < stack->num)? stack->point[i][a]: 0.0f;
+
+		stack->valid[a >> 5] |= bit;
+	}
+
+	return stack->lanes[a];
+}
+
+/* Lanes of a slot for writing, all lanes must be written. */
+ccl_device_inline ssef *svm_batch_store(SVMBatchStack *stack, uint a)
+{
+	kernel_assert(a < SVM_STACK_SIZE);
+
+	const uint bit = 1u << (a & 31);
+
+	stack->valid[a >> 5] |= bit;
+	stack->dirty[a >> 5] |= bit;
+
+	return stack->lanes[a];
+}
+
+/* Scatter slots written by vectorized nodes to the stacks of the points,
+ * before a scalar node which may read and write any slot. */
+ccl_device_inline void svm_batch_flush(SVMBatchStack *stack)
+{
+	for(int w = 0; w < SVM_BATCH_SLOT_WORDS; w++) {
+		uint dirty = stack->dirty[w];
+
+		while(dirty) {
+			const uint a = w*32 + __bscf(dirty);
+			const float *lane = (const float*)stack->lanes[a];
+
+			for(int i = 0; i < stack->num; i++)
+				stack->point[i][a] = lane[i];
+		}
+
+		stack->valid[w] = 0;
+		stack->dirty[w] = 0;
+	}
+}
+
+#endif  /* __KERNEL_SSE2__ */
+#endif  /* __KERNEL_CPU__ */
+
 CCL_NAMESPACE_END
 
 /* Nodes */
@@ -188,288 +286,415 @@ CCL_NAMESPACE_BEGIN
 #define NODES_GROUP(group) ((group) <= __NODES_MAX_GROUP__)
 #define NODES_FEATURE(feature) ((__NODES_FEATURES__ & (feature)) != 0)
 
-/* Main Interpreter Loop */
-ccl_device_noinline void svm_eval_nodes(KernelGlobals *kg, ShaderData *sd, ccl_addr_space PathState *state, ShaderType type, int path_flag)
+/* Execute a single node, returns false when the end of the program is
+ * reached. */
+ccl_device_forceinline bool svm_eval_node(KernelGlobals *kg,
+                                          ShaderData *sd,
+                                          ccl_addr_space PathState *state,
+                                          ShaderType type,
+                                          int path_flag,
+                                          float *stack,
+                                          uint4 node,
+                                          int *offset)
 {
-	float stack[SVM_STACK_SIZE];
-	int offset = ccl_fetch(sd, shader) & SHADER_MASK;
-
-	while(1) {
-		uint4 node = read_node(kg, &offset);
-
-		switch(node.x) {
+	switch(node.x) {
 #if NODES_GROUP(NODE_GROUP_LEVEL_0)
-			case NODE_SHADER_JUMP: {
-				if(type == SHADER_TYPE_SURFACE) offset = node.y;
-				else if(type == SHADER_TYPE_VOLUME) offset = node.z;
-				else if(type == SHADER_TYPE_DISPLACEMENT) offset = node.w;
-				else return;
-				break;
-			}
-			case NODE_CLOSURE_BSDF:
-				svm_node_closure_bsdf(kg, sd, stack, node, path_flag, &offset);
-				break;
-			case NODE_CLOSURE_EMISSION:
-				svm_node_closure_emission(sd, stack, node);
-				break;
-			case NODE_CLOSURE_BACKGROUND:
-				svm_node_closure_background(sd, stack, node);
-				break;
-			case NODE_CLOSURE_SET_WEIGHT:
-				svm_node_closure_set_weight(sd, node.y, node.z, node.w);
-				break;
-			case NODE_CLOSURE_WEIGHT:
-				svm_node_closure_weight(sd, stack, node.y);
-				break;
-			case NODE_EMISSION_WEIGHT:
-				svm_node_emission_weight(kg, sd, stack, node);
-				break;
-			case NODE_MIX_CLOSURE:
-				svm_node_mix_closure(sd, stack, node);
-				break;
-			case NODE_JUMP_IF_ZERO:
-				if(stack_load_float(stack, node.z) == 0.0f)
-					offset += node.y;
-				break;
-			case NODE_JUMP_IF_ONE:
-				if(stack_load_float(stack, node.z) == 1.0f)
-					offset += node.y;
-				break;
-			case NODE_GEOMETRY:
-				svm_node_geometry(kg, sd, stack, node.y, node.z);
-				break;
-			case NODE_CONVERT:
-				svm_node_convert(sd, stack, node.y, node.z, node.w);
-				break;
-			case NODE_TEX_COORD:
-				svm_node_tex_coord(kg, sd, path_flag, stack, node, &offset);
-				break;
-			case NODE_VALUE_F:
-				svm_node_value_f(kg, sd, stack, node.y, node.z);
-				break;
-			case NODE_VALUE_V:
-				svm_node_value_v(kg, sd, stack, node.y, &offset);
-				break;
-			case NODE_ATTR:
-				svm_node_attr(kg, sd, stack, node);
-				break;
+		case NODE_SHADER_JUMP: {
+			if(type == SHADER_TYPE_SURFACE) *offset = node.y;
+			else if(type == SHADER_TYPE_VOLUME) *offset = node.z;
+			else if(type == SHADER_TYPE_DISPLACEMENT) *offset = node.w;
+			else return false;
+			break;
+		}
+		case NODE_CLOSURE_BSDF:
+			svm_node_closure_bsdf(kg, sd, stack, node, path_flag, offset);
+			break;
+		case NODE_CLOSURE_EMISSION:
+			svm_node_closure_emission(sd, stack, node);
+			break;
+		case NODE_CLOSURE_BACKGROUND:
+			svm_node_closure_background(sd, stack, node);
+			break;
+		case NODE_CLOSURE_SET_WEIGHT:
+			svm_node_closure_set_weight(sd, node.y, node.z, node.w);
+			break;
+		case NODE_CLOSURE_WEIGHT:
+			svm_node_closure_weight(sd, stack, node.y);
+			break;
+		case NODE_EMISSION_WEIGHT:
+			svm_node_emission_weight(kg, sd, stack, node);
+			break;
+		case NODE_MIX_CLOSURE:
+			svm_node_mix_closure(sd, stack, node);
+			break;
+		case NODE_JUMP_IF_ZERO:
+			if(stack_load_float(stack, node.z) == 0.0f)
+				*offset += node.y;
+			break;
+		case NODE_JUMP_IF_ONE:
+			if(stack_load_float(stack, node.z) == 1.0f)
+				*offset += node.y;
+			break;
+		case NODE_GEOMETRY:
+			svm_node_geometry(kg, sd, stack, node.y, node.z);
+			break;
+		case NODE_CONVERT:
+			svm_node_convert(sd, stack, node.y, node.z, node.w);
+			break;
+		case NODE_TEX_COORD:
+			svm_node_tex_coord(kg, sd, path_flag, stack, node, offset);
+			break;
+		case NODE_VALUE_F:
+			svm_node_value_f(kg, sd, stack, node.y, node.z);
+			break;
+		case NODE_VALUE_V:
+			svm_node_value_v(kg, sd, stack, node.y, offset);
+			break;
+		case NODE_ATTR:
+			svm_node_attr(kg, sd, stack, node);
+			break;
 #  if NODES_FEATURE(NODE_FEATURE_BUMP)
-			case NODE_GEOMETRY_BUMP_DX:
-				svm_node_geometry_bump_dx(kg, sd, stack, node.y, node.z);
-				break;
-			case NODE_GEOMETRY_BUMP_DY:
-				svm_node_geometry_bump_dy(kg, sd, stack, node.y, node.z);
-				break;
-			case NODE_SET_DISPLACEMENT:
-				svm_node_set_displacement(kg, sd, stack, node.y);
-				break;
+		case NODE_GEOMETRY_BUMP_DX:
+			svm_node_geometry_bump_dx(kg, sd, stack, node.y, node.z);
+			break;
+		case NODE_GEOMETRY_BUMP_DY:
+			svm_node_geometry_bump_dy(kg, sd, stack, node.y, node.z);
+			break;
+		case NODE_SET_DISPLACEMENT:
+			svm_node_set_displacement(kg, sd, stack, node.y);
+			break;
 #  endif  /* NODES_FEATURE(NODE_FEATURE_BUMP) */
 #  ifdef __TEXTURES__
-			case NODE_TEX_IMAGE:
-				svm_node_tex_image(kg, sd, stack, node);
-				break;
-			case NODE_TEX_IMAGE_BOX:
-				svm_node_tex_image_box(kg, sd, stack, node);
-				break;
-			case NODE_TEX_NOISE:
-				svm_node_tex_noise(kg, sd, stack, node, &offset);
-				break;
+		case NODE_TEX_IMAGE:
+			svm_node_tex_image(kg, sd, stack, node);
+			break;
+		case NODE_TEX_IMAGE_BOX:
+			svm_node_tex_image_box(kg, sd, stack, node);
+			break;
+		case NODE_TEX_NOISE:
+			svm_node_tex_noise(kg, sd, stack, node, offset);
+			break;
 #  endif  /* __TEXTURES__ */
 #  ifdef __EXTRA_NODES__
 #    if NODES_FEATURE(NODE_FEATURE_BUMP)
-			case NODE_SET_BUMP:
-				svm_node_set_bump(kg, sd, stack, node);
-				break;
-			case NODE_ATTR_BUMP_DX:
-				svm_node_attr_bump_dx(kg, sd, stack, node);
-				break;
-			case NODE_ATTR_BUMP_DY:
-				svm_node_attr_bump_dy(kg, sd, stack, node);
-				break;
-			case NODE_TEX_COORD_BUMP_DX:
-				svm_node_tex_coord_bump_dx(kg, sd, path_flag, stack, node, &offset);
-				break;
-			case NODE_TEX_COORD_BUMP_DY:
-				svm_node_tex_coord_bump_dy(kg, sd, path_flag, stack, node, &offset);
-				break;
-			case NODE_CLOSURE_SET_NORMAL:
-				svm_node_set_normal(kg, sd, stack, node.y, node.z);
-				break;
+		case NODE_SET_BUMP:
+			svm_node_set_bump(kg, sd, stack, node);
+			break;
+		case NODE_ATTR_BUMP_DX:
+			svm_node_attr_bump_dx(kg, sd, stack, node);
+			break;
+		case NODE_ATTR_BUMP_DY:
+			svm_node_attr_bump_dy(kg, sd, stack, node);
+			break;
+		case NODE_TEX_COORD_BUMP_DX:
+			svm_node_tex_coord_bump_dx(kg, sd, path_flag, stack, node, offset);
+			break;
+		case NODE_TEX_COORD_BUMP_DY:
+			svm_node_tex_coord_bump_dy(kg, sd, path_flag, stack, node, offset);
+			break;
+		case NODE_CLOSURE_SET_NORMAL:
+			svm_node_set_normal(kg, sd, stack, node.y, node.z);
+			break;
 #      if NODES_FEATURE(NODE_FEATURE_BUMP_STATE)
-			case NODE_ENTER_BUMP_EVAL:
-				svm_node_enter_bump_eval(kg, sd, stack, node.y);
-				break;
-			case NODE_LEAVE_BUMP_EVAL:
-				svm_node_leave_bump_eval(kg, sd, stack, node.y);
-				break;
+		case NODE_ENTER_BUMP_EVAL:
+			svm_node_enter_bump_eval(kg, sd, stack, node.y);
+			break;
+		case NODE_LEAVE_BUMP_EVAL:
+			svm_node_leave_bump_eval(kg, sd, stack, node.y);
+			break;
 #      endif /* NODES_FEATURE(NODE_FEATURE_BUMP_STATE) */
 #    endif  /* NODES_FEATURE(NODE_FEATURE_BUMP) */
-			case NODE_HSV:
-				svm_node_hsv(kg, sd, stack, node, &offset);
-				break;
+		case NODE_HSV:
+			svm_node_hsv(kg, sd, stack, node, offset);
+			break;
 #  endif  /* __EXTRA_NODES__ */
 #endif  /* NODES_GROUP(NODE_GROUP_LEVEL_0) */
 
 #if NODES_GROUP(NODE_GROUP_LEVEL_1)
-			case NODE_CLOSURE_HOLDOUT:
-				svm_node_closure_holdout(sd, stack, node);
-				break;
-			case NODE_CLOSURE_AMBIENT_OCCLUSION:
-				svm_node_closure_ambient_occlusion(sd, stack, node);
-				break;
-			case NODE_FRESNEL:
-				svm_node_fresnel(sd, stack, node.y, node.z, node.w);
-				break;
-			case NODE_LAYER_WEIGHT:
-				svm_node_layer_weight(sd, stack, node);
-				break;
+		case NODE_CLOSURE_HOLDOUT:
+			svm_node_closure_holdout(sd, stack, node);
+			break;
+		case NODE_CLOSURE_AMBIENT_OCCLUSION:
+			svm_node_closure_ambient_occlusion(sd, stack, node);
+			break;
+		case NODE_FRESNEL:
+			svm_node_fresnel(sd, stack, node.y, node.z, node.w);
+			break;
+		case NODE_LAYER_WEIGHT:
+			svm_node_layer_weight(sd, stack, node);
+			break;
 #  if NODES_FEATURE(NODE_FEATURE_VOLUME)
-			case NODE_CLOSURE_VOLUME:
-				svm_node_closure_volume(kg, sd, stack, node, path_flag);
-				break;
+		case NODE_CLOSURE_VOLUME:
+			svm_node_closure_volume(kg, sd, stack, node, path_flag);
+			break;
 #  endif  /* NODES_FEATURE(NODE_FEATURE_VOLUME) */
 #  ifdef __EXTRA_NODES__
-			case NODE_MATH:
-				svm_node_math(kg, sd, stack, node.y, node.z, node.w, &offset);
-				break;
-			case NODE_VECTOR_MATH:
-				svm_node_vector_math(kg, sd, stack, node.y, node.z, node.w, &offset);
-				break;
-			case NODE_RGB_RAMP:
-				svm_node_rgb_ramp(kg, sd, stack, node, &offset);
-				break;
-			case NODE_GAMMA:
-				svm_node_gamma(sd, stack, node.y, node.z, node.w);
-				break;
-			case NODE_BRIGHTCONTRAST:
-				svm_node_brightness(sd, stack, node.y, node.z, node.w);
-				break;
-			case NODE_LIGHT_PATH:
-				svm_node_light_path(sd, state, stack, node.y, node.z, path_flag);
-				break;
-			case NODE_OBJECT_INFO:
-				svm_node_object_info(kg, sd, stack, node.y, node.z);
-				break;
-			case NODE_PARTICLE_INFO:
-				svm_node_particle_info(kg, sd, stack, node.y, node.z);
-				break;
+		case NODE_MATH:
+			svm_node_math(kg, sd, stack, node.y, node.z, node.w, offset);
+			break;
+		case NODE_VECTOR_MATH:
+			svm_node_vector_math(kg, sd, stack, node.y, node.z, node.w, offset);
+			break;
+		case NODE_RGB_RAMP:
+			svm_node_rgb_ramp(kg, sd, stack, node, offset);
+			break;
+		case NODE_GAMMA:
+			svm_node_gamma(sd, stack, node.y, node.z, node.w);
+			break;
+		case NODE_BRIGHTCONTRAST:
+			svm_node_brightness(sd, stack, node.y, node.z, node.w);
+			break;
+		case NODE_LIGHT_PATH:
+			svm_node_light_path(sd, state, stack, node.y, node.z, path_flag);
+			break;
+		case NODE_OBJECT_INFO:
+			svm_node_object_info(kg, sd, stack, node.y, node.z);
+			break;
+		case NODE_PARTICLE_INFO:
+			svm_node_particle_info(kg, sd, stack, node.y, node.z);
+			break;
 #    ifdef __HAIR__
 #      if NODES_FEATURE(NODE_FEATURE_HAIR)
-			case NODE_HAIR_INFO:
-				svm_node_hair_info(kg, sd, stack, node.y, node.z);
-				break;
+		case NODE_HAIR_INFO:
+			svm_node_hair_info(kg, sd, stack, node.y, node.z);
+			break;
 #      endif  /* NODES_FEATURE(NODE_FEATURE_HAIR) */
 #    endif  /* __HAIR__ */
 #  endif  /* __EXTRA_NODES__ */
 #endif  /* NODES_GROUP(NODE_GROUP_LEVEL_1) */
 
 #if NODES_GROUP(NODE_GROUP_LEVEL_2)
-			case NODE_MAPPING:
-				svm_node_mapping(kg, sd, stack, node.y, node.z, &offset);
-				break;
-			case NODE_MIN_MAX:
-				svm_node_min_max(kg, sd, stack, node.y, node.z, &offset);
-				break;
-			case NODE_CAMERA:
-				svm_node_camera(kg, sd, stack, node.y, node.z, node.w);
-				break;
+		case NODE_MAPPING:
+			svm_node_mapping(kg, sd, stack, node.y, node.z, offset);
+			break;
+		case NODE_MIN_MAX:
+			svm_node_min_max(kg, sd, stack, node.y, node.z, offset);
+			break;
+		case NODE_CAMERA:
+			svm_node_camera(kg, sd, stack, node.y, node.z, node.w);
+			break;
 #  ifdef __TEXTURES__
-			case NODE_TEX_ENVIRONMENT:
-				svm_node_tex_environment(kg, sd, stack, node);
-				break;
-			case NODE_TEX_SKY:
-				svm_node_tex_sky(kg, sd, stack, node, &offset);
-				break;
-			case NODE_TEX_GRADIENT:
-				svm_node_tex_gradient(sd, stack, node);
-				break;
-			case NODE_TEX_VORONOI:
-				svm_node_tex_voronoi(kg, sd, stack, node, &offset);
-				break;
-			case NODE_TEX_MUSGRAVE:
-				svm_node_tex_musgrave(kg, sd, stack, node, &offset);
-				break;
-			case NODE_TEX_WAVE:
-				svm_node_tex_wave(kg, sd, stack, node, &offset);
-				break;
-			case NODE_TEX_MAGIC:
-				svm_node_tex_magic(kg, sd, stack, node, &offset);
-				break;
-			case NODE_TEX_CHECKER:
-				svm_node_tex_checker(kg, sd, stack, node);
-				break;
-			case NODE_TEX_BRICK:
-				svm_node_tex_brick(kg, sd, stack, node, &offset);
-				break;
+		case NODE_TEX_ENVIRONMENT:
+			svm_node_tex_environment(kg, sd, stack, node);
+			break;
+		case NODE_TEX_SKY:
+			svm_node_tex_sky(kg, sd, stack, node, offset);
+			break;
+		case NODE_TEX_GRADIENT:
+			svm_node_tex_gradient(sd, stack, node);
+			break;
+		case NODE_TEX_VORONOI:
+			svm_node_tex_voronoi(kg, sd, stack, node, offset);
+			break;
+		case NODE_TEX_MUSGRAVE:
+			svm_node_tex_musgrave(kg, sd, stack, node, offset);
+			break;
+		case NODE_TEX_WAVE:
+			svm_node_tex_wave(kg, sd, stack, node, offset);
+			break;
+		case NODE_TEX_MAGIC:
+			svm_node_tex_magic(kg, sd, stack, node, offset);
+			break;
+		case NODE_TEX_CHECKER:
+			svm_node_tex_checker(kg, sd, stack, node);
+			break;
+		case NODE_TEX_BRICK:
+			svm_node_tex_brick(kg, sd, stack, node, offset);
+			break;
 #  endif  /* __TEXTURES__ */
 #  ifdef __EXTRA_NODES__
-			case NODE_NORMAL:
-				svm_node_normal(kg, sd, stack, node.y, node.z, node.w, &offset);
-				break;
-			case NODE_LIGHT_FALLOFF:
-				svm_node_light_falloff(sd, stack, node);
-				break;
+		case NODE_NORMAL:
+			svm_node_normal(kg, sd, stack, node.y, node.z, node.w, offset);
+			break;
+		case NODE_LIGHT_FALLOFF:
+			svm_node_light_falloff(sd, stack, node);
+			break;
 #  endif  /* __EXTRA_NODES__ */
 #endif  /* NODES_GROUP(NODE_GROUP_LEVEL_2) */
 
 #if NODES_GROUP(NODE_GROUP_LEVEL_3)
-			case NODE_RGB_CURVES:
-			case NODE_VECTOR_CURVES:
-				svm_node_curves(kg, sd, stack, node, &offset);
-				break;
-			case NODE_TANGENT:
-				svm_node_tangent(kg, sd, stack, node);
-				break;
-			case NODE_NORMAL_MAP:
-				svm_node_normal_map(kg, sd, stack, node);
-				break;
+		case NODE_RGB_CURVES:
+		case NODE_VECTOR_CURVES:
+			svm_node_curves(kg, sd, stack, node, offset);
+			break;
+		case NODE_TANGENT:
+			svm_node_tangent(kg, sd, stack, node);
+			break;
+		case NODE_NORMAL_MAP:
+			svm_node_normal_map(kg, sd, stack, node);
+			break;
 #  ifdef __EXTRA_NODES__
-			case NODE_INVERT:
-				svm_node_invert(sd, stack, node.y, node.z, node.w);
-				break;
-			case NODE_MIX:
-				svm_node_mix(kg, sd, stack, node.y, node.z, node.w, &offset);
-				break;
-			case NODE_SEPARATE_VECTOR:
-				svm_node_separate_vector(sd, stack, node.y, node.z, node.w);
-				break;
-			case NODE_COMBINE_VECTOR:
-				svm_node_combine_vector(sd, stack, node.y, node.z, node.w);
-				break;
-			case NODE_SEPARATE_HSV:
-				svm_node_separate_hsv(kg, sd, stack, node.y, node.z, node.w, &offset);
-				break;
-			case NODE_COMBINE_HSV:
-				svm_node_combine_hsv(kg, sd, stack, node.y, node.z, node.w, &offset);
-				break;
-			case NODE_VECTOR_TRANSFORM:
-				svm_node_vector_transform(kg, sd, stack, node);
-				break;
-			case NODE_WIREFRAME:
-				svm_node_wireframe(kg, sd, stack, node);
-				break;
-			case NODE_WAVELENGTH:
-				svm_node_wavelength(sd, stack, node.y, node.z);
-				break;
-			case NODE_BLACKBODY:
-				svm_node_blackbody(kg, sd, stack, node.y, node.z);
-				break;
+		case NODE_INVERT:
+			svm_node_invert(sd, stack, node.y, node.z, node.w);
+			break;
+		case NODE_MIX:
+			svm_node_mix(kg, sd, stack, node.y, node.z, node.w, offset);
+			break;
+		case NODE_SEPARATE_VECTOR:
+			svm_node_separate_vector(sd, stack, node.y, node.z, node.w);
+			break;
+		case NODE_COMBINE_VECTOR:
+			svm_node_combine_vector(sd, stack, node.y, node.z, node.w);
+			break;
+		case NODE_SEPARATE_HSV:
+			svm_node_separate_hsv(kg, sd, stack, node.y, node.z, node.w, offset);
+			break;
+		case NODE_COMBINE_HSV:
+			svm_node_combine_hsv(kg, sd, stack, node.y, node.z, node.w, offset);
+			break;
+		case NODE_VECTOR_TRANSFORM:
+			svm_node_vector_transform(kg, sd, stack, node);
+			break;
+		case NODE_WIREFRAME:
+			svm_node_wireframe(kg, sd, stack, node);
+			break;
+		case NODE_WAVELENGTH:
+			svm_node_wavelength(sd, stack, node.y, node.z);
+			break;
+		case NODE_BLACKBODY:
+			svm_node_blackbody(kg, sd, stack, node.y, node.z);
+			break;
 #  endif  /* __EXTRA_NODES__ */
 #  if NODES_FEATURE(NODE_FEATURE_VOLUME)
-			case NODE_TEX_VOXEL:
-				svm_node_tex_voxel(kg, sd, stack, node, &offset);
-				break;
+		case NODE_TEX_VOXEL:
+			svm_node_tex_voxel(kg, sd, stack, node, offset);
+			break;
 #  endif  /* NODES_FEATURE(NODE_FEATURE_VOLUME) */
 #endif  /* NODES_GROUP(NODE_GROUP_LEVEL_3) */
-			case NODE_END:
-				return;
-			default:
-				kernel_assert(!"Unknown node type was passed to the SVM machine");
-				return;
+		case NODE_END:
+			return false;
+		default:
+			kernel_assert(!"Unknown node type was passed to the SVM machine");
+			return false;
+	}
+
+	return true;
+}
+
+ccl_device_forceinline void svm_eval_nodes_from(KernelGlobals *kg,
+                                                ShaderData *sd,
+                                                ccl_addr_space PathState *state,
+                                                ShaderType type,
+                                                int path_flag,
+                                                float *stack,
+                                                int offset)
+{
+	while(1) {
+		uint4 node = read_node(kg, &offset);
+
+		if(!svm_eval_node(kg, sd, state, type, path_flag, stack, node, &offset))
+			return;
+	}
+}
+
+/* Main Interpreter Loop */
+ccl_device_noinline void svm_eval_nodes(KernelGlobals *kg, ShaderData *sd, ccl_addr_space PathState *state, ShaderType type, int path_flag)
+{
+	float stack[SVM_STACK_SIZE];
+	int offset = ccl_fetch(sd, shader) & SHADER_MASK;
+
+	svm_eval_nodes_from(kg, sd, state, type, path_flag, stack, offset);
+}
+
+#ifdef __KERNEL_CPU__
+
+#ifdef __KERNEL_SSE2__
+
+/* Execute a single node for all points of a batch in SSE lanes, returns false
+ * when the node is not vectorized and must be executed by the scalar nodes. */
+ccl_device_forceinline bool svm_eval_node_batch(KernelGlobals *kg,
+                                                ShaderData **sd,
+                                                SVMBatchStack *stack,
+                                                uint4 node,
+                                                int *offset)
+{
+	switch(node.x) {
+		case NODE_CONVERT:
+			svm_node_convert_batch(stack, node.y, node.z, node.w);
+			return true;
+		case NODE_TEX_COORD:
+			return svm_node_tex_coord_batch(kg, sd, stack, node, offset);
+		case NODE_VALUE_F:
+			svm_node_value_f_batch(stack, node.y, node.z);
+			return true;
+		case NODE_VALUE_V:
+			svm_node_value_v_batch(kg, stack, node.y, offset);
+			return true;
+#  ifdef __EXTRA_NODES__
+		case NODE_MATH:
+			return svm_node_math_batch(kg, stack, node.y, node.z, node.w, offset);
+		case NODE_VECTOR_MATH:
+			svm_node_vector_math_batch(kg, stack, node.y, node.z, node.w, offset);
+			return true;
+		case NODE_MIX:
+			return svm_node_mix_batch(kg, stack, node.y, node.z, node.w, offset);
+#  endif  /* __EXTRA_NODES__ */
+		default:
+			return false;
+	}
+}
+
+#endif  /* __KERNEL_SSE2__ */
+
+/* Batched Interpreter Loop
+ *
+ * Runs the program for several shading points in lockstep, so every node is
+ * fetched and dispatched once for the whole batch. Common nodes like math,
+ * mix and texture coordinates are vectorized and evaluate all points in SSE
+ * lanes, other nodes run for every point with its own stack. Points with the
+ * same shader follow the same nodes until they take different jumps, from
+ * there on each continues on its own. */
+ccl_device_noinline void svm_eval_nodes_batch(KernelGlobals *kg,
+                                              ShaderData **sd,
+                                              PathState **state,
+                                              const int *path_flag,
+                                              int num,
+                                              ShaderType type)
+{
+	SVMBatchStack stack;
+	int offset[SVM_BATCH_SIZE];
+	bool active[SVM_BATCH_SIZE];
+	bool uniform = true;
+
+	svm_batch_stack_init(&stack, num);
+
+	for(int i = 0; i < num; i++) {
+		offset[i] = sd[i]->shader & SHADER_MASK;
+		active[i] = true;
+		uniform = uniform && (offset[i] == offset[0]);
+	}
+
+	while(uniform) {
+		int node_offset = offset[0];
+		uint4 node = read_node(kg, &node_offset);
+
+#ifdef __KERNEL_SSE2__
+		if(svm_eval_node_batch(kg, sd, &stack, node, &node_offset)) {
+			offset[0] = node_offset;
+			continue;
+		}
+
+		svm_batch_flush(&stack);
+#endif
+
+		for(int i = 0; i < num; i++) {
+			offset[i] = node_offset;
+			active[i] = svm_eval_node(kg, sd[i], state[i], type, path_flag[i], stack.point[i], node, &offset[i]);
+			uniform = uniform && (active[i] == active[0]) && (offset[i] == offset[0]);
 		}
+
+		if(uniform && !active[0])
+			return;
+	}
+
+	for(int i = 0; i < num; i++) {
+		if(active[i])
+			svm_eval_nodes_from(kg, sd[i], state[i], type, path_flag[i], stack.point[i], offset[i]);
 	}
 }
 
+#endif  /* __KERNEL_CPU__ */
+
 #undef NODES_GROUP
 #undef NODES_FEATURE
 
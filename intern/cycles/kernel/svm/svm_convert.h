@@ -68,5 +68,71 @@ ccl_device void svm_node_convert(ShaderData *sd, float *stack, uint type, uint f
 	}
 }
 
+#ifdef __KERNEL_SSE2__
+
+ccl_device void svm_node_convert_batch(SVMBatchStack *stack, uint type, uint from, uint to)
+{
+	switch(type) {
+		case NODE_CONVERT_FI: {
+			const ssef *f = svm_batch_load(stack, from);
+			ssef *i = svm_batch_store(stack, to);
+			for(int g = 0; g < SVM_BATCH_GROUPS; g++)
+				i[g] = cast(truncatei(f[g]));
+			break;
+		}
+		case NODE_CONVERT_FV: {
+			const ssef *f = svm_batch_load(stack, from);
+			ssef *x = svm_batch_store(stack, to+0);
+			ssef *y = svm_batch_store(stack, to+1);
+			ssef *z = svm_batch_store(stack, to+2);
+			for(int g = 0; g < SVM_BATCH_GROUPS; g++)
+				x[g] = y[g] = z[g] = f[g];
+			break;
+		}
+		case NODE_CONVERT_CF:
+		case NODE_CONVERT_CI: {
+			const ssef *x = svm_batch_load(stack, from+0);
+			const ssef *y = svm_batch_load(stack, from+1);
+			const ssef *z = svm_batch_load(stack, from+2);
+			ssef *f = svm_batch_store(stack, to);
+			for(int g = 0; g < SVM_BATCH_GROUPS; g++) {
+				ssef gray = x[g]*0.2126f + y[g]*0.7152f + z[g]*0.0722f;
+				f[g] = (type == NODE_CONVERT_CF)? gray: cast(truncatei(gray));
+			}
+			break;
+		}
+		case NODE_CONVERT_VF:
+		case NODE_CONVERT_VI: {
+			const ssef *x = svm_batch_load(stack, from+0);
+			const ssef *y = svm_batch_load(stack, from+1);
+			const ssef *z = svm_batch_load(stack, from+2);
+			ssef *f = svm_batch_store(stack, to);
+			for(int g = 0; g < SVM_BATCH_GROUPS; g++) {
+				ssef avg = (x[g] + y[g] + z[g])*(1.0f/3.0f);
+				f[g] = (type == NODE_CONVERT_VF)? avg: cast(truncatei(avg));
+			}
+			break;
+		}
+		case NODE_CONVERT_IF: {
+			const ssef *i = svm_batch_load(stack, from);
+			ssef *f = svm_batch_store(stack, to);
+			for(int g = 0; g < SVM_BATCH_GROUPS; g++)
+				f[g] = ssef(_mm_castps_si128(i[g]));
+			break;
+		}
+		case NODE_CONVERT_IV: {
+			const ssef *i = svm_batch_load(stack, from);
+			ssef *x = svm_batch_store(stack, to+0);
+			ssef *y = svm_batch_store(stack, to+1);
+			ssef *z = svm_batch_store(stack, to+2);
+			for(int g = 0; g < SVM_BATCH_GROUPS; g++)
+				x[g] = y[g] = z[g] = ssef(_mm_castps_si128(i[g]));
+			break;
+		}
+	}
+}
+
+#endif  /* __KERNEL_SSE2__ */
+
 CCL_NAMESPACE_END
 
@@ -29,15 +29,17 @@ CCL_NAMESPACE_BEGIN
 #  define TEX_NUM_FLOAT4_IMAGES	TEX_NUM_FLOAT4_OPENCL
 #endif
 
-ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint srgb, uint use_alpha)
+/* dx and dy are the screen space derivatives of the texture coordinate, they
+ * are only used by images in the CPU texture cache to pick the MIP level. */
+ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, float2 dx, float2 dy, uint srgb, uint use_alpha)
 {
 #ifdef __KERNEL_CPU__
 #  ifdef __KERNEL_SSE2__
 	ssef r_ssef;
 	float4 &r = (float4 &)r_ssef;
-	r = kernel_tex_image_interp(id, x, y);
+	r = kernel_tex_image_interp_d(id, x, y, dx, dy);
 #  else
-	float4 r = kernel_tex_image_interp(id, x, y);
+	float4 r = kernel_tex_image_interp_d(id, x, y, dx, dy);
 #  endif
 #elif defined(__KERNEL_OPENCL__)
 	float4 r = kernel_tex_image_interp(kg, id, x, y);
@@ -200,6 +202,27 @@ ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y,
 	return r;
 }
 
+/* Texture coordinate derivatives for the texture cache, from the
+ * differentials of the UV map attribute the coordinate was read from. The
+ * compiler only passes an attribute when the UV map is used as is; any
+ * other texture coordinate gets zero derivatives, i.e. the full resolution. */
+ccl_device void svm_image_uv_differentials(KernelGlobals *kg, ShaderData *sd, uint attr, float2 *dx, float2 *dy)
+{
+	*dx = make_float2(0.0f, 0.0f);
+	*dy = make_float2(0.0f, 0.0f);
+
+#ifdef __RAY_DIFFERENTIALS__
+	const AttributeDescriptor desc = find_attribute(kg, sd, attr);
+
+	if(desc.offset != ATTR_STD_NOT_FOUND) {
+		float3 duv_dx, duv_dy;
+		primitive_attribute_float3(kg, sd, desc, &duv_dx, &duv_dy);
+		*dx = make_float2(duv_dx.x, duv_dx.y);
+		*dy = make_float2(duv_dy.x, duv_dy.y);
+	}
+#endif
+}
+
 /* Remap coordnate from 0..1 box to -1..-1 */
 ccl_device_inline float3 texco_remap_square(float3 co)
 {
@@ -213,21 +236,31 @@ ccl_device void svm_node_tex_image(KernelGlobals *kg, ShaderData *sd, float *sta
 
 	decode_node_uchar4(node.z, &co_offset, &out_offset, &alpha_offset, &srgb);
 
+	uint projection = node.w & 0xFF;
+	uint uv_attr = node.w >> 8;
+
 	float3 co = stack_load_float3(stack, co_offset);
 	float2 tex_co;
 	uint use_alpha = stack_valid(alpha_offset);
-	if(node.w == NODE_IMAGE_PROJ_SPHERE) {
+	if(projection == NODE_IMAGE_PROJ_SPHERE) {
 		co = texco_remap_square(co);
 		tex_co = map_to_sphere(co);
 	}
-	else if(node.w == NODE_IMAGE_PROJ_TUBE) {
+	else if(projection == NODE_IMAGE_PROJ_TUBE) {
 		co = texco_remap_square(co);
 		tex_co = map_to_tube(co);
 	}
 	else {
 		tex_co = make_float2(co.x, co.y);
 	}
-	float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, srgb, use_alpha);
+
+	float2 dx = make_float2(0.0f, 0.0f), dy = make_float2(0.0f, 0.0f);
+#ifdef __KERNEL_CPU__
+	if(uv_attr != ATTR_STD_NONE && kernel_tex_image_is_cached(kg, id))
+		svm_image_uv_differentials(kg, sd, uv_attr, &dx, &dy);
+#endif
+
+	float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, dx, dy, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -311,14 +344,15 @@ ccl_device void svm_node_tex_image_box(KernelGlobals *kg, ShaderData *sd, float
 	uint id = node.y;
 
 	float4 f = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+	float2 d = make_float2(0.0f, 0.0f);
 	uint use_alpha = stack_valid(alpha_offset);
 
 	if(weight.x > 0.0f)
-		f += weight.x*svm_image_texture(kg, id, co.y, co.z, srgb, use_alpha);
+		f += weight.x*svm_image_texture(kg, id, co.y, co.z, d, d, srgb, use_alpha);
 	if(weight.y > 0.0f)
-		f += weight.y*svm_image_texture(kg, id, co.x, co.z, srgb, use_alpha);
+		f += weight.y*svm_image_texture(kg, id, co.x, co.z, d, d, srgb, use_alpha);
 	if(weight.z > 0.0f)
-		f += weight.z*svm_image_texture(kg, id, co.y, co.x, srgb, use_alpha);
+		f += weight.z*svm_image_texture(kg, id, co.y, co.x, d, d, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -344,8 +378,24 @@ ccl_device void svm_node_tex_environment(KernelGlobals *kg, ShaderData *sd, floa
 	else
 		uv = direction_to_mirrorball(co);
 
+	float2 dx = make_float2(0.0f, 0.0f), dy = make_float2(0.0f, 0.0f);
+#if defined(__KERNEL_CPU__) && defined(__RAY_DIFFERENTIALS__)
+	/* For the background the position differentials are the differentials of
+	 * the ray direction, map them like the direction itself. */
+	const bool is_background = (ccl_fetch(sd, prim) == PRIM_NONE && ccl_fetch(sd, ray_length) == 0.0f);
+
+	if(projection == 0 && is_background && kernel_tex_image_is_cached(kg, id)) {
+		dx = direction_to_equirectangular(normalize(co + ccl_fetch(sd, dP).dx)) - uv;
+		dy = direction_to_equirectangular(normalize(co + ccl_fetch(sd, dP).dy)) - uv;
+
+		/* wrap around the seam */
+		dx.x -= floorf(dx.x + 0.5f);
+		dy.x -= floorf(dy.x + 0.5f);
+	}
+#endif
+
 	uint use_alpha = stack_valid(alpha_offset);
-	float4 f = svm_image_texture(kg, id, uv.x, uv.y, srgb, use_alpha);
+	float4 f = svm_image_texture(kg, id, uv.x, uv.y, dx, dy, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -46,5 +46,156 @@ ccl_device void svm_node_vector_math(KernelGlobals *kg, ShaderData *sd, float *s
 	if(stack_valid(node1.z)) stack_store_float3(stack, node1.z, v);
 }
 
+#ifdef __KERNEL_SSE2__
+
+/* Vectorized Nodes
+ *
+ * Same as the nodes above for all points of a batch. Operations which are not
+ * vectorized return false without reading anything, and run with the scalar
+ * node instead. */
+
+ccl_device_inline ssef svm_math_batch(NodeMath type, const ssef& Fac1, const ssef& Fac2)
+{
+	switch(type) {
+		case NODE_MATH_ADD: return Fac1 + Fac2;
+		case NODE_MATH_SUBTRACT: return Fac1 - Fac2;
+		case NODE_MATH_MULTIPLY: return Fac1*Fac2;
+		case NODE_MATH_DIVIDE: return select(Fac2 != 0.0f, Fac1/Fac2, ssef(0.0f));
+		case NODE_MATH_MINIMUM: return min(Fac1, Fac2);
+		case NODE_MATH_MAXIMUM: return max(Fac1, Fac2);
+#ifdef __KERNEL_SSE41__
+		case NODE_MATH_ROUND: return floor(Fac1 + 0.5f);
+#endif
+		case NODE_MATH_LESS_THAN: return select(Fac1 < Fac2, ssef(1.0f), ssef(0.0f));
+		case NODE_MATH_GREATER_THAN: return select(Fac1 > Fac2, ssef(1.0f), ssef(0.0f));
+		case NODE_MATH_ABSOLUTE: return abs(Fac1);
+		case NODE_MATH_CLAMP: return min(max(Fac1, 0.0f), 1.0f);
+		default: return ssef(0.0f);
+	}
+}
+
+ccl_device bool svm_node_math_batch(KernelGlobals *kg, SVMBatchStack *stack, uint itype, uint f1_offset, uint f2_offset, int *offset)
+{
+	NodeMath type = (NodeMath)itype;
+
+	switch(type) {
+		case NODE_MATH_ADD:
+		case NODE_MATH_SUBTRACT:
+		case NODE_MATH_MULTIPLY:
+		case NODE_MATH_DIVIDE:
+		case NODE_MATH_MINIMUM:
+		case NODE_MATH_MAXIMUM:
+#ifdef __KERNEL_SSE41__
+		case NODE_MATH_ROUND:
+#endif
+		case NODE_MATH_LESS_THAN:
+		case NODE_MATH_GREATER_THAN:
+		case NODE_MATH_ABSOLUTE:
+		case NODE_MATH_CLAMP:
+			break;
+		default:
+			return false;
+	}
+
+	const ssef *f1 = svm_batch_load(stack, f1_offset);
+	const ssef *f2 = svm_batch_load(stack, f2_offset);
+
+	uint4 node1 = read_node(kg, offset);
+
+	ssef *f = svm_batch_store(stack, node1.y);
+
+	for(int g = 0; g < SVM_BATCH_GROUPS; g++)
+		f[g] = svm_math_batch(type, f1[g], f2[g]);
+
+	return true;
+}
+
+ccl_device_inline ssef svm_batch_normalize_len(ssef *x, ssef *y, ssef *z)
+{
+	const ssef t = mm_sqrt(*x * *x + *y * *y + *z * *z);
+	const sseb nonzero = (t != 0.0f);
+
+	*x = select(nonzero, *x/t, *x);
+	*y = select(nonzero, *y/t, *y);
+	*z = select(nonzero, *z/t, *z);
+
+	return t;
+}
+
+ccl_device void svm_node_vector_math_batch(KernelGlobals *kg, SVMBatchStack *stack, uint itype, uint v1_offset, uint v2_offset, int *offset)
+{
+	NodeVectorMath type = (NodeVectorMath)itype;
+	const ssef *x1 = svm_batch_load(stack, v1_offset+0);
+	const ssef *y1 = svm_batch_load(stack, v1_offset+1);
+	const ssef *z1 = svm_batch_load(stack, v1_offset+2);
+	const ssef *x2 = svm_batch_load(stack, v2_offset+0);
+	const ssef *y2 = svm_batch_load(stack, v2_offset+1);
+	const ssef *z2 = svm_batch_load(stack, v2_offset+2);
+
+	uint4 node1 = read_node(kg, offset);
+
+	ssef f[SVM_BATCH_GROUPS], x[SVM_BATCH_GROUPS], y[SVM_BATCH_GROUPS], z[SVM_BATCH_GROUPS];
+
+	for(int g = 0; g < SVM_BATCH_GROUPS; g++) {
+		switch(type) {
+			case NODE_VECTOR_MATH_ADD:
+				x[g] = x1[g] + x2[g];
+				y[g] = y1[g] + y2[g];
+				z[g] = z1[g] + z2[g];
+				f[g] = (abs(x[g]) + abs(y[g]) + abs(z[g]))/3.0f;
+				break;
+			case NODE_VECTOR_MATH_SUBTRACT:
+				x[g] = x1[g] - x2[g];
+				y[g] = y1[g] - y2[g];
+				z[g] = z1[g] - z2[g];
+				f[g] = (abs(x[g]) + abs(y[g]) + abs(z[g]))/3.0f;
+				break;
+			case NODE_VECTOR_MATH_AVERAGE:
+				x[g] = x1[g] + x2[g];
+				y[g] = y1[g] + y2[g];
+				z[g] = z1[g] + z2[g];
+				f[g] = svm_batch_normalize_len(&x[g], &y[g], &z[g]);
+				break;
+			case NODE_VECTOR_MATH_DOT_PRODUCT:
+				f[g] = x1[g]*x2[g] + y1[g]*y2[g] + z1[g]*z2[g];
+				x[g] = y[g] = z[g] = ssef(0.0f);
+				break;
+			case NODE_VECTOR_MATH_CROSS_PRODUCT:
+				x[g] = y1[g]*z2[g] - z1[g]*y2[g];
+				y[g] = z1[g]*x2[g] - x1[g]*z2[g];
+				z[g] = x1[g]*y2[g] - y1[g]*x2[g];
+				f[g] = svm_batch_normalize_len(&x[g], &y[g], &z[g]);
+				break;
+			case NODE_VECTOR_MATH_NORMALIZE:
+				x[g] = x1[g];
+				y[g] = y1[g];
+				z[g] = z1[g];
+				f[g] = svm_batch_normalize_len(&x[g], &y[g], &z[g]);
+				break;
+			default:
+				f[g] = x[g] = y[g] = z[g] = ssef(0.0f);
+				break;
+		}
+	}
+
+	if(stack_valid(node1.y)) {
+		ssef *out_f = svm_batch_store(stack, node1.y);
+		for(int g = 0; g < SVM_BATCH_GROUPS; g++)
+			out_f[g] = f[g];
+	}
+	if(stack_valid(node1.z)) {
+		ssef *out_x = svm_batch_store(stack, node1.z+0);
+		ssef *out_y = svm_batch_store(stack, node1.z+1);
+		ssef *out_z = svm_batch_store(stack, node1.z+2);
+		for(int g = 0; g < SVM_BATCH_GROUPS; g++) {
+			out_x[g] = x[g];
+			out_y[g] = y[g];
+			out_z[g] = z[g];
+		}
+	}
+}
+
+#endif  /* __KERNEL_SSE2__ */
+
 CCL_NAMESPACE_END
 
@@ -31,5 +31,87 @@ ccl_device void svm_node_mix(KernelGlobals *kg, ShaderData *sd, float *stack, ui
 	stack_store_float3(stack, node1.z, result);
 }
 
+#ifdef __KERNEL_SSE2__
+
+/* Vectorized node, the supported blend types are all per channel. */
+
+ccl_device_inline ssef svm_mix_batch(NodeMix type, const ssef& t, const ssef& col1, const ssef& col2)
+{
+	const ssef tm = 1.0f - t;
+
+	switch(type) {
+		case NODE_MIX_BLEND: return col1 + t*(col2 - col1);
+		case NODE_MIX_ADD: return col1 + t*col2;
+		case NODE_MIX_MUL: return col1 + t*(col1*col2 - col1);
+		case NODE_MIX_SUB: return col1 - t*col2;
+		case NODE_MIX_SCREEN: return 1.0f - (tm + t*(1.0f - col2))*(1.0f - col1);
+		case NODE_MIX_DIV: return select(col2 != 0.0f, tm*col1 + t*col1/col2, col1);
+		case NODE_MIX_DIFF: return col1 + t*(abs(col1 - col2) - col1);
+		case NODE_MIX_DARK: return min(col1, col2)*t + col1*tm;
+		case NODE_MIX_LIGHT: return max(col1, col2*t);
+		case NODE_MIX_OVERLAY: return select(col1 < 0.5f,
+		                                     col1*(tm + 2.0f*t*col2),
+		                                     1.0f - (tm + 2.0f*t*(1.0f - col2))*(1.0f - col1));
+		case NODE_MIX_LINEAR: return col1 + t*(2.0f*col2 - 1.0f);
+		case NODE_MIX_CLAMP: return min(max(col1, 0.0f), 1.0f);
+		default: return ssef(0.0f);
+	}
+}
+
+ccl_device bool svm_node_mix_batch(KernelGlobals *kg, SVMBatchStack *stack, uint fac_offset, uint c1_offset, uint c2_offset, int *offset)
+{
+	/* read extra data */
+	int node_offset = *offset;
+	uint4 node1 = read_node(kg, &node_offset);
+	NodeMix type = (NodeMix)node1.y;
+
+	switch(type) {
+		case NODE_MIX_BLEND:
+		case NODE_MIX_ADD:
+		case NODE_MIX_MUL:
+		case NODE_MIX_SUB:
+		case NODE_MIX_SCREEN:
+		case NODE_MIX_DIV:
+		case NODE_MIX_DIFF:
+		case NODE_MIX_DARK:
+		case NODE_MIX_LIGHT:
+		case NODE_MIX_OVERLAY:
+		case NODE_MIX_LINEAR:
+		case NODE_MIX_CLAMP:
+			break;
+		default:
+			return false;
+	}
+
+	*offset = node_offset;
+
+	const ssef *fac = svm_batch_load(stack, fac_offset);
+	const ssef *c1[3], *c2[3];
+
+	for(int c = 0; c < 3; c++) {
+		c1[c] = svm_batch_load(stack, c1_offset+c);
+		c2[c] = svm_batch_load(stack, c2_offset+c);
+	}
+
+	ssef result[3][SVM_BATCH_GROUPS];
+
+	for(int g = 0; g < SVM_BATCH_GROUPS; g++) {
+		const ssef t = min(max(fac[g], 0.0f), 1.0f);
+
+		for(int c = 0; c < 3; c++)
+			result[c][g] = svm_mix_batch(type, t, c1[c][g], c2[c][g]);
+	}
+
+	for(int c = 0; c < 3; c++) {
+		ssef *out = svm_batch_store(stack, node1.z+c);
+		for(int g = 0; g < SVM_BATCH_GROUPS; g++)
+			out[g] = result[c][g];
+	}
+
+	return true;
+}
+
+#endif  /* __KERNEL_SSE2__ */
+
 CCL_NAMESPACE_END
 
@@ -98,6 +98,113 @@ ccl_device void svm_node_tex_coord(KernelGlobals *kg,
 	stack_store_float3(stack, out_offset, data);
 }
 
+#ifdef __KERNEL_SSE2__
+
+/* Vectorized node for the object, camera and reflection coordinates, returns
+ * false for other coordinates without reading anything. Shading point data is
+ * transposed into lanes, after which transforms are done for all lanes at once. */
+ccl_device bool svm_node_tex_coord_batch(KernelGlobals *kg,
+                                         ShaderData **sd,
+                                         SVMBatchStack *stack,
+                                         uint4 node,
+                                         int *offset)
+{
+	uint type = node.y;
+	uint out_offset = node.z;
+	const int num = stack->num;
+
+	if(type != NODE_TEXCO_OBJECT && type != NODE_TEXCO_CAMERA && type != NODE_TEXCO_REFLECTION)
+		return false;
+
+	float3 P[SVM_BATCH_GROUPS*4], N[SVM_BATCH_GROUPS*4];
+	int object[SVM_BATCH_GROUPS*4];
+	Transform tfm;
+	bool use_tfm = false;
+
+	for(int i = 0; i < SVM_BATCH_GROUPS*4; i++) {
+		P[i] = (i < num)? ccl_fetch(sd[i], P): make_float3(0.0f, 0.0f, 0.0f);
+		object[i] = (i < num)? ccl_fetch(sd[i], object): OBJECT_NONE;
+	}
+
+	switch(type) {
+		case NODE_TEXCO_OBJECT: {
+			if(node.w == 0) {
+				for(int i = 0; i < num; i++) {
+					if(object[i] != OBJECT_NONE) {
+						object_inverse_position_transform(kg, sd[i], &P[i]);
+					}
+				}
+			}
+			else {
+				tfm.x = read_node_float(kg, offset);
+				tfm.y = read_node_float(kg, offset);
+				tfm.z = read_node_float(kg, offset);
+				tfm.w = read_node_float(kg, offset);
+				use_tfm = true;
+			}
+			break;
+		}
+		case NODE_TEXCO_CAMERA: {
+			const float3 camera_P = camera_position(kg);
+
+			tfm = kernel_data.cam.worldtocamera;
+			use_tfm = true;
+
+			for(int i = 0; i < num; i++) {
+				if(object[i] == OBJECT_NONE)
+					P[i] += camera_P;
+			}
+			break;
+		}
+		case NODE_TEXCO_REFLECTION: {
+			/* P holds the incoming direction */
+			for(int i = 0; i < SVM_BATCH_GROUPS*4; i++) {
+				P[i] = (i < num)? ccl_fetch(sd[i], I): make_float3(0.0f, 0.0f, 0.0f);
+				N[i] = (i < num)? ccl_fetch(sd[i], N): make_float3(0.0f, 0.0f, 0.0f);
+			}
+			break;
+		}
+	}
+
+	ssef *x = svm_batch_store(stack, out_offset+0);
+	ssef *y = svm_batch_store(stack, out_offset+1);
+	ssef *z = svm_batch_store(stack, out_offset+2);
+
+	for(int g = 0; g < SVM_BATCH_GROUPS; g++) {
+		const int i = g*4;
+		ssef px, py, pz;
+
+		transpose(load4f(P[i+0]), load4f(P[i+1]), load4f(P[i+2]), load4f(P[i+3]), px, py, pz);
+
+		if(type == NODE_TEXCO_REFLECTION) {
+			ssef nx, ny, nz;
+
+			transpose(load4f(N[i+0]), load4f(N[i+1]), load4f(N[i+2]), load4f(N[i+3]), nx, ny, nz);
+
+			const sseb has_object = (ssei(object[i+0], object[i+1], object[i+2], object[i+3]) != OBJECT_NONE);
+			const ssef d = 2.0f*(nx*px + ny*py + nz*pz);
+
+			x[g] = select(has_object, d*nx - px, px);
+			y[g] = select(has_object, d*ny - py, py);
+			z[g] = select(has_object, d*nz - pz, pz);
+		}
+		else if(use_tfm) {
+			x[g] = madd(px, ssef(tfm.x.x), madd(py, ssef(tfm.x.y), madd(pz, ssef(tfm.x.z), ssef(tfm.x.w))));
+			y[g] = madd(px, ssef(tfm.y.x), madd(py, ssef(tfm.y.y), madd(pz, ssef(tfm.y.z), ssef(tfm.y.w))));
+			z[g] = madd(px, ssef(tfm.z.x), madd(py, ssef(tfm.z.y), madd(pz, ssef(tfm.z.z), ssef(tfm.z.w))));
+		}
+		else {
+			x[g] = px;
+			y[g] = py;
+			z[g] = pz;
+		}
+	}
+
+	return true;
+}
+
+#endif  /* __KERNEL_SSE2__ */
+
 ccl_device void svm_node_tex_coord_bump_dx(KernelGlobals *kg,
                                            ShaderData *sd,
                                            int path_flag,
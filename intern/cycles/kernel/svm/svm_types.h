@@ -25,6 +25,8 @@ CCL_NAMESPACE_BEGIN
 #define SVM_STACK_SIZE 255
 /* SVM stack offsets with this value indicate that it's not on the stack */
 #define SVM_STACK_INVALID 255 
+/* Number of shading points evaluated together by the batched interpreter */
+#define SVM_BATCH_SIZE 8
 
 #define SVM_BUMP_EVAL_STATE_SIZE 9
 
@@ -32,5 +32,33 @@ ccl_device void svm_node_value_v(KernelGlobals *kg, ShaderData *sd, float *stack
 	stack_store_float3(stack, out_offset, p);
 }
 
+#ifdef __KERNEL_SSE2__
+
+ccl_device void svm_node_value_f_batch(SVMBatchStack *stack, uint ivalue, uint out_offset)
+{
+	ssef *f = svm_batch_store(stack, out_offset);
+
+	for(int g = 0; g < SVM_BATCH_GROUPS; g++)
+		f[g] = ssef(__uint_as_float(ivalue));
+}
+
+ccl_device void svm_node_value_v_batch(KernelGlobals *kg, SVMBatchStack *stack, uint out_offset, int *offset)
+{
+	/* read extra data */
+	uint4 node1 = read_node(kg, offset);
+
+	ssef *x = svm_batch_store(stack, out_offset+0);
+	ssef *y = svm_batch_store(stack, out_offset+1);
+	ssef *z = svm_batch_store(stack, out_offset+2);
+
+	for(int g = 0; g < SVM_BATCH_GROUPS; g++) {
+		x[g] = ssef(__uint_as_float(node1.y));
+		y[g] = ssef(__uint_as_float(node1.z));
+		z[g] = ssef(__uint_as_float(node1.w));
+	}
+}
+
+#endif  /* __KERNEL_SSE2__ */
+
 CCL_NAMESPACE_END
 
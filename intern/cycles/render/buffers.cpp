@@ -42,6 +42,8 @@ BufferParams::BufferParams()
 	full_width = 0;
 	full_height = 0;
 
+	denoising_data_pass = false;
+
 	Pass::add(PASS_COMBINED, passes);
 }
 
@@ -59,7 +61,8 @@ bool BufferParams::modified(const BufferParams& params)
 		&& height == params.height
 		&& full_width == params.full_width
 		&& full_height == params.full_height
-		&& Pass::equals(passes, params.passes));
+		&& Pass::equals(passes, params.passes)
+		&& denoising_data_pass == params.denoising_data_pass);
 }
 
 int BufferParams::get_passes_size()
@@ -68,10 +71,25 @@ int BufferParams::get_passes_size()
 
 	for(size_t i = 0; i < passes.size(); i++)
 		size += passes[i].components;
+
+	if(denoising_data_pass)
+		size = align_up(size, 4) + DENOISING_PASS_SIZE;
 	
 	return align_up(size, 4);
 }
 
+int BufferParams::get_denoising_offset()
+{
+	assert(denoising_data_pass);
+
+	int offset = 0;
+
+	for(size_t i = 0; i < passes.size(); i++)
+		offset += passes[i].components;
+
+	return align_up(offset, 4);
+}
+
 /* Render Buffer Task */
 
 RenderTile::RenderTile()
@@ -93,6 +111,8 @@ RenderTile::RenderTile()
 	rng_state = 0;
 
 	buffers = NULL;
+
+	start_time = 0.0;
 }
 
 /* Render Buffers */
@@ -148,6 +168,16 @@ bool RenderBuffers::copy_from_device()
 	return true;
 }
 
+bool RenderBuffers::copy_to_device()
+{
+	if(!buffer.device_pointer)
+		return false;
+
+	device->mem_copy_to(buffer);
+
+	return true;
+}
+
 bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int components, float *pixels)
 {
 	int pass_offset = 0;
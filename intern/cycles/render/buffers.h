@@ -51,6 +51,7 @@ public:
 
 	/* passes */
 	array<Pass> passes;
+	bool denoising_data_pass;
 
 	/* functions */
 	BufferParams();
@@ -59,6 +60,7 @@ public:
 	bool modified(const BufferParams& params);
 	void add_pass(PassType type);
 	int get_passes_size();
+	int get_denoising_offset();
 };
 
 /* Render Buffers */
@@ -79,6 +81,7 @@ public:
 	void reset(Device *device, BufferParams& params);
 
 	bool copy_from_device();
+	bool copy_to_device();
 	bool get_pass_rect(PassType type, float exposure, int sample, int components, float *pixels);
 
 protected:
@@ -144,6 +147,9 @@ public:
 
 	RenderBuffers *buffers;
 
+	/* time the tile was acquired, to measure how long it took to render */
+	double start_time;
+
 	RenderTile();
 };
 
@@ -0,0 +1,395 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <limits.h>
+
+#include "buffers.h"
+#include "denoising.h"
+
+#include "util_foreach.h"
+#include "util_function.h"
+#include "util_logging.h"
+#include "util_math.h"
+#include "util_task.h"
+#include "util_time.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Planar copy of a tile and the pixels around it within the filter footprint,
+ * so the filter loops run over contiguous rows of floats and get vectorized by
+ * the compiler. Only pixels of the tile itself are filtered. */
+
+struct Denoiser::Image {
+	int w, h;
+
+	/* pixels to filter */
+	int filter_x0, filter_y0, filter_x1, filter_y1;
+
+	/* mean color and variance of the mean, averaged over channels */
+	vector<float> color[3];
+	vector<float> variance;
+
+	/* features */
+	vector<float> normal[3];
+	vector<float> albedo[3];
+	vector<float> depth;
+
+	/* filtered color */
+	vector<float> result[3];
+
+	Image(int w_, int h_)
+	: w(w_), h(h_), filter_x0(0), filter_y0(0), filter_x1(w_), filter_y1(h_)
+	{
+		const size_t num_pixels = (size_t)w*h;
+
+		for(int c = 0; c < 3; c++) {
+			color[c].resize(num_pixels);
+			normal[c].resize(num_pixels);
+			albedo[c].resize(num_pixels);
+			result[c].resize(num_pixels);
+		}
+
+		variance.resize(num_pixels);
+		depth.resize(num_pixels);
+	}
+};
+
+/* Where the passes of a tile are in its render buffer. */
+
+struct DenoiseTile {
+	float *buffer;
+	int pass_stride;
+	int combined_offset;
+	int denoising_offset;
+	float inv_samples;
+	float inv_variance_samples;
+
+	explicit DenoiseTile(RenderTile& rtile)
+	{
+		BufferParams& bparams = rtile.buffers->params;
+
+		buffer = (float*)rtile.buffers->buffer.data_pointer;
+		pass_stride = bparams.get_passes_size();
+		denoising_offset = bparams.get_denoising_offset();
+		combined_offset = 0;
+
+		for(size_t i = 0; i < bparams.passes.size(); i++) {
+			if(bparams.passes[i].type == PASS_COMBINED)
+				break;
+			combined_offset += bparams.passes[i].components;
+		}
+
+		inv_samples = 1.0f/max(rtile.sample, 1);
+		inv_variance_samples = 1.0f/max(rtile.sample - 1, 1);
+	}
+};
+
+Denoiser::Denoiser(const DenoiseParams& params_)
+: params(params_)
+{
+}
+
+Denoiser::~Denoiser()
+{
+}
+
+void Denoiser::denoise(vector<RenderTile>& tiles)
+{
+	if(tiles.empty())
+		return;
+
+	double start_time = time_dt();
+
+	/* Bounds of the frame and the tile each of its pixels is in. */
+	int frame_x0 = INT_MAX, frame_y0 = INT_MAX;
+	int frame_x1 = INT_MIN, frame_y1 = INT_MIN;
+
+	foreach(RenderTile& rtile, tiles) {
+		frame_x0 = min(frame_x0, rtile.x);
+		frame_y0 = min(frame_y0, rtile.y);
+		frame_x1 = max(frame_x1, rtile.x + rtile.w);
+		frame_y1 = max(frame_y1, rtile.y + rtile.h);
+	}
+
+	const int frame_w = frame_x1 - frame_x0;
+	const int frame_h = frame_y1 - frame_y0;
+	vector<int> tile_index((size_t)frame_w*frame_h, -1);
+	vector<DenoiseTile> tile_data;
+
+	for(size_t t = 0; t < tiles.size(); t++) {
+		RenderTile& rtile = tiles[t];
+
+		for(int y = rtile.y; y < rtile.y + rtile.h; y++) {
+			for(int x = rtile.x; x < rtile.x + rtile.w; x++) {
+				tile_index[(size_t)(y - frame_y0)*frame_w + (x - frame_x0)] = (int)t;
+			}
+		}
+
+		tile_data.push_back(DenoiseTile(rtile));
+	}
+
+	/* Results are written back once all tiles are filtered, neighbor tiles
+	 * still need the noisy pixels. */
+	const int margin = params.radius + params.patch_radius;
+	vector<vector<float> > results(tiles.size());
+
+	for(size_t t = 0; t < tiles.size(); t++) {
+		RenderTile& rtile = tiles[t];
+
+		if(!rtile.buffers->params.denoising_data_pass || rtile.sample < 2)
+			continue;
+
+		const int x0 = max(rtile.x - margin, frame_x0);
+		const int y0 = max(rtile.y - margin, frame_y0);
+		const int x1 = min(rtile.x + rtile.w + margin, frame_x1);
+		const int y1 = min(rtile.y + rtile.h + margin, frame_y1);
+
+		Image image(x1 - x0, y1 - y0);
+		image.filter_x0 = rtile.x - x0;
+		image.filter_y0 = rtile.y - y0;
+		image.filter_x1 = image.filter_x0 + rtile.w;
+		image.filter_y1 = image.filter_y0 + rtile.h;
+
+		/* Convert sums to means, each pixel with the samples of its own tile. */
+		for(int y = y0; y < y1; y++) {
+			for(int x = x0; x < x1; x++) {
+				int i = (y - y0)*image.w + (x - x0);
+				int n = tile_index[(size_t)(y - frame_y0)*frame_w + (x - frame_x0)];
+
+				if(n == -1)
+					continue;
+
+				const RenderTile& ntile = tiles[n];
+				const DenoiseTile& data = tile_data[n];
+				int index = ntile.offset + x + y*ntile.stride;
+				float *combined = data.buffer + index*data.pass_stride + data.combined_offset;
+				float *denoising = data.buffer + index*data.pass_stride + data.denoising_offset;
+				float variance = 0.0f;
+
+				for(int c = 0; c < 3; c++) {
+					float mean = combined[c]*data.inv_samples;
+					float mean_square = denoising[DENOISING_PASS_COLOR_SQUARE + c]*data.inv_samples;
+
+					image.color[c][i] = mean;
+					image.normal[c][i] = denoising[DENOISING_PASS_NORMAL + c]*data.inv_samples;
+					image.albedo[c][i] = denoising[DENOISING_PASS_ALBEDO + c]*data.inv_samples;
+					variance += max(mean_square - mean*mean, 0.0f)*data.inv_variance_samples;
+				}
+
+				image.variance[i] = variance*(1.0f/3.0f);
+				image.depth[i] = denoising[DENOISING_PASS_DEPTH]*data.inv_samples;
+			}
+		}
+
+		/* Filter bands of rows in parallel, each band only writes its own rows
+		 * of the result. */
+		const int band_height = 16;
+		TaskPool pool;
+
+		for(int y = image.filter_y0; y < image.filter_y1; y += band_height) {
+			pool.push(function_bind(&Denoiser::filter_rows,
+			                        this,
+			                        &image,
+			                        y,
+			                        min(y + band_height, image.filter_y1)));
+		}
+
+		pool.wait_work();
+
+		vector<float>& result = results[t];
+		result.resize((size_t)rtile.w*rtile.h*3);
+
+		for(int y = 0; y < rtile.h; y++) {
+			for(int x = 0; x < rtile.w; x++) {
+				int i = (image.filter_y0 + y)*image.w + image.filter_x0 + x;
+
+				for(int c = 0; c < 3; c++)
+					result[(y*rtile.w + x)*3 + c] = image.result[c][i];
+			}
+		}
+	}
+
+	/* Write back as sums, alpha is left untouched. */
+	for(size_t t = 0; t < tiles.size(); t++) {
+		RenderTile& rtile = tiles[t];
+		const DenoiseTile& data = tile_data[t];
+		const vector<float>& result = results[t];
+
+		if(result.empty())
+			continue;
+
+		for(int y = 0; y < rtile.h; y++) {
+			for(int x = 0; x < rtile.w; x++) {
+				int index = rtile.offset + (rtile.x + x) + (rtile.y + y)*rtile.stride;
+				float *combined = data.buffer + index*data.pass_stride + data.combined_offset;
+
+				for(int c = 0; c < 3; c++)
+					combined[c] = result[(y*rtile.w + x)*3 + c]*rtile.sample;
+			}
+		}
+	}
+
+	VLOG(3) << "Denoised " << tiles.size() << " tiles of " << frame_w << "x" << frame_h
+	        << " frame in " << time_dt() - start_time << " seconds.";
+}
+
+void Denoiser::filter_rows(Image *image, int y0, int y1)
+{
+	const int w = image->w;
+	const int h = image->h;
+	const int r = params.radius;
+	const int f = params.patch_radius;
+	const float k2 = params.strength*params.strength;
+	const float feature_scale = 1.0f/max(params.feature_strength*params.feature_strength, 1e-4f);
+
+	/* Columns filtered, and rows and columns of the distance image needed to
+	 * average patches of this band. */
+	const int fx0 = image->filter_x0;
+	const int fx1 = image->filter_x1;
+	const int d0 = max(y0 - f, 0);
+	const int d1 = min(y1 + f, h);
+	const int dx0 = max(fx0 - f, 0);
+	const int dx1 = min(fx1 + f, w);
+
+	vector<float> dist((d1 - d0)*w);
+	vector<float> dist_row((d1 - d0)*w);
+	vector<float> prefix(w + 1);
+	vector<float> out[3];
+	vector<float> weight_sum((y1 - y0)*w, 0.0f);
+
+	for(int c = 0; c < 3; c++)
+		out[c].resize((y1 - y0)*w, 0.0f);
+
+	for(int dy = -r; dy <= r; dy++) {
+		for(int dx = -r; dx <= r; dx++) {
+			/* Range of pixels for which the shifted pixel is inside the image. */
+			const int x0 = max(dx0, -dx);
+			const int x1 = min(dx1, w - dx);
+
+			if(x0 >= x1)
+				continue;
+
+			/* Per pixel color distance, corrected for the variance so noise
+			 * alone does not make pixels dissimilar. Pixels without a valid
+			 * shifted pixel get zero distance, they are skipped below. */
+			for(int y = d0; y < d1; y++) {
+				float *d = &dist[(y - d0)*w];
+				const int qy = y + dy;
+
+				if(qy < 0 || qy >= h) {
+					memset(d + dx0, 0, sizeof(float)*(dx1 - dx0));
+					continue;
+				}
+
+				for(int x = dx0; x < x0; x++)
+					d[x] = 0.0f;
+				for(int x = x1; x < dx1; x++)
+					d[x] = 0.0f;
+
+				const int p = y*w;
+				const int q = qy*w + dx;
+
+				for(int x = x0; x < x1; x++) {
+					float vp = image->variance[p + x];
+					float vq = image->variance[q + x];
+					float dr = image->color[0][p + x] - image->color[0][q + x];
+					float dg = image->color[1][p + x] - image->color[1][q + x];
+					float db = image->color[2][p + x] - image->color[2][q + x];
+					float sqr = (dr*dr + dg*dg + db*db)*(1.0f/3.0f);
+
+					d[x] = (sqr - (vp + min(vp, vq))) / (1e-10f + k2*(vp + vq));
+				}
+			}
+
+			/* Average distance over the patch, horizontal pass with prefix sums. */
+			for(int y = d0; y < d1; y++) {
+				const float *d = &dist[(y - d0)*w];
+				float *row = &dist_row[(y - d0)*w];
+
+				prefix[dx0] = 0.0f;
+				for(int x = dx0; x < dx1; x++)
+					prefix[x + 1] = prefix[x] + d[x];
+
+				for(int x = fx0; x < fx1; x++) {
+					int lo = max(x - f, dx0);
+					int hi = min(x + f + 1, dx1);
+					row[x] = (prefix[hi] - prefix[lo]) / (hi - lo);
+				}
+			}
+
+			/* Vertical pass, weighting and accumulation. */
+			for(int y = y0; y < y1; y++) {
+				const int qy = y + dy;
+
+				if(qy < 0 || qy >= h)
+					continue;
+
+				const int lo = max(y - f, d0);
+				const int hi = min(y + f + 1, d1);
+				const float inv_count = 1.0f/(hi - lo);
+				const int p = y*w;
+				const int q = qy*w + dx;
+				const int o = (y - y0)*w;
+				const int px0 = max(x0, fx0);
+				const int px1 = min(x1, fx1);
+
+				for(int x = px0; x < px1; x++) {
+					float patch_dist = 0.0f;
+					for(int yy = lo; yy < hi; yy++)
+						patch_dist += dist_row[(yy - d0)*w + x];
+					patch_dist *= inv_count;
+
+					float color_weight = expf(-max(patch_dist, 0.0f));
+
+					float dn0 = image->normal[0][p + x] - image->normal[0][q + x];
+					float dn1 = image->normal[1][p + x] - image->normal[1][q + x];
+					float dn2 = image->normal[2][p + x] - image->normal[2][q + x];
+					float da0 = image->albedo[0][p + x] - image->albedo[0][q + x];
+					float da1 = image->albedo[1][p + x] - image->albedo[1][q + x];
+					float da2 = image->albedo[2][p + x] - image->albedo[2][q + x];
+					float zp = image->depth[p + x];
+					float zq = image->depth[q + x];
+					float dz = (zp - zq) / max(max(zp, zq), 1e-4f);
+
+					float feature_dist = dn0*dn0 + dn1*dn1 + dn2*dn2 +
+					                     da0*da0 + da1*da1 + da2*da2 +
+					                     dz*dz;
+					float feature_weight = expf(-feature_dist*feature_scale);
+
+					float weight = min(color_weight, feature_weight);
+
+					out[0][o + x] += weight*image->color[0][q + x];
+					out[1][o + x] += weight*image->color[1][q + x];
+					out[2][o + x] += weight*image->color[2][q + x];
+					weight_sum[o + x] += weight;
+				}
+			}
+		}
+	}
+
+	/* The center pixel always has full weight, so the sum is never zero. */
+	for(int y = y0; y < y1; y++) {
+		for(int x = fx0; x < fx1; x++) {
+			const int o = (y - y0)*w + x;
+			const float inv_weight = 1.0f/weight_sum[o];
+
+			for(int c = 0; c < 3; c++)
+				image->result[c][y*w + x] = out[c][o]*inv_weight;
+		}
+	}
+}
+
+CCL_NAMESPACE_END
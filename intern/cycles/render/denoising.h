@@ -0,0 +1,86 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DENOISING_H__
+#define __DENOISING_H__
+
+#include "util_types.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class RenderTile;
+
+/* Denoising Parameters */
+
+class DenoiseParams {
+public:
+	/* run the denoiser on finished tiles */
+	bool use;
+	/* radius of the search window in pixels */
+	int radius;
+	/* radius of the patches which are compared */
+	int patch_radius;
+	/* color bandwidth, higher values give smoother results */
+	float strength;
+	/* feature bandwidth, higher values blur more across feature edges */
+	float feature_strength;
+
+	DenoiseParams()
+	{
+		use = false;
+		radius = 8;
+		patch_radius = 3;
+		strength = 0.5f;
+		feature_strength = 0.5f;
+	}
+
+	bool modified(const DenoiseParams& params) const
+	{ return !(use == params.use
+		&& radius == params.radius
+		&& patch_radius == params.patch_radius
+		&& strength == params.strength
+		&& feature_strength == params.feature_strength); }
+};
+
+/* Denoiser
+ *
+ * Non-local means filter guided by the feature data written by the kernel
+ * (normal, albedo, depth) and the per pixel variance of the combined pass.
+ * Runs on the host once all tiles of a frame are finished, pixels near the
+ * border of a tile are compared with those of the neighboring tiles. */
+
+class Denoiser {
+public:
+	explicit Denoiser(const DenoiseParams& params);
+	~Denoiser();
+
+	/* Filter the combined pass of all tiles of a frame in place. The tile
+	 * buffers must have the denoising data pass and be available on the
+	 * host, tiles may share the same buffers. */
+	void denoise(vector<RenderTile>& tiles);
+
+protected:
+	struct Image;
+
+	void filter_rows(Image *image, int y0, int y1);
+
+	DenoiseParams params;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __DENOISING_H__ */
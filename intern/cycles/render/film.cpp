@@ -144,6 +144,10 @@ void Pass::add(PassType type, array<Pass>& passes)
 			pass.components = 4;
 			pass.exposure = false;
 			break;
+		case PASS_ADAPTIVE_AUX_BUFFER:
+			pass.components = 4;
+			pass.filter = false;
+			break;
 		case PASS_LIGHT:
 			/* This isn't a real pass, used by baking to see whether
 			 * light data is needed or not.
@@ -279,6 +283,8 @@ NODE_DEFINE(Film)
 
 	SOCKET_BOOLEAN(use_sample_clamp, "Use Sample Clamp", false);
 
+	SOCKET_BOOLEAN(denoising_data_pass, "Denoising Data Pass", false);
+
 	return type;
 }
 
@@ -414,6 +420,9 @@ void Film::device_update(Device *device, DeviceScene *dscene, Scene *scene)
 			case PASS_LIGHT:
 				kfilm->use_light_pass = 1;
 				break;
+			case PASS_ADAPTIVE_AUX_BUFFER:
+				kfilm->pass_adaptive_aux_buffer = kfilm->pass_stride;
+				break;
 
 #ifdef WITH_CYCLES_DEBUG
 			case PASS_BVH_TRAVERSED_NODES:
@@ -437,6 +446,14 @@ void Film::device_update(Device *device, DeviceScene *dscene, Scene *scene)
 		kfilm->pass_stride += pass.components;
 	}
 
+	if(denoising_data_pass) {
+		kfilm->pass_denoising_data = align_up(kfilm->pass_stride, 4);
+		kfilm->pass_stride = kfilm->pass_denoising_data + DENOISING_PASS_SIZE;
+	}
+	else {
+		kfilm->pass_denoising_data = 0;
+	}
+
 	kfilm->pass_stride = align_up(kfilm->pass_stride, 4);
 	kfilm->pass_alpha_threshold = pass_alpha_threshold;
 
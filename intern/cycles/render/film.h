@@ -70,6 +70,9 @@ public:
 	bool use_light_visibility;
 	bool use_sample_clamp;
 
+	/* write feature data for the denoiser after the regular passes */
+	bool denoising_data_pass;
+
 	bool need_update;
 
 	Film();
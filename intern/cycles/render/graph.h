@@ -153,6 +153,8 @@ public:
 	virtual bool has_surface_bssrdf() { return false; }
 	virtual bool has_bssrdf_bump() { return false; }
 	virtual bool has_spatial_varying() { return false; }
+	/* Only varies with voxel attributes, which volumes can skip where empty. */
+	virtual bool has_volume_grid_varying() { return false; }
 	virtual bool has_object_dependency() { return false; }
 	virtual bool has_integrator_dependency() { return false; }
 
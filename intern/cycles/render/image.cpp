@@ -24,6 +24,11 @@
 #include "util_progress.h"
 #include "util_texture.h"
 
+#include "volume_grid.h"
+
+#include "kernel_oiio_globals.h"
+#include "kernel_volume_grid_globals.h"
+
 #ifdef WITH_OSL
 #include <OSL/oslexec.h>
 #endif
@@ -36,6 +41,7 @@ ImageManager::ImageManager(const DeviceInfo& info)
 	pack_images = false;
 	osl_texture_system = NULL;
 	animation_frame = 0;
+	defer_device_update = false;
 
 	/* In case of multiple devices used we need to know type of an actual
 	 * compute device.
@@ -259,13 +265,15 @@ static bool image_equals(ImageManager::Image *image,
                          void *builtin_data,
                          InterpolationType interpolation,
                          ExtensionType extension,
-                         bool use_alpha)
+                         bool use_alpha,
+                         const string& grid_name = "")
 {
 	return image->filename == filename &&
 	       image->builtin_data == builtin_data &&
 	       image->interpolation == interpolation &&
 	       image->extension == extension &&
-	       image->use_alpha == use_alpha;
+	       image->use_alpha == use_alpha &&
+	       image->grid_name == grid_name;
 }
 
 int ImageManager::add_image(const string& filename,
@@ -276,12 +284,22 @@ int ImageManager::add_image(const string& filename,
                             bool& is_linear,
                             InterpolationType interpolation,
                             ExtensionType extension,
-                            bool use_alpha)
+                            bool use_alpha,
+                            const string& grid_name)
 {
 	Image *img;
 	size_t slot;
+	ImageDataType type;
 
-	ImageDataType type = get_image_metadata(filename, builtin_data, is_linear);
+	if(grid_name != "") {
+		/* float and vector grids of OpenVDB files */
+		int channels = volume_grid_vdb_channels(filename, grid_name);
+		type = (channels > 1)? IMAGE_DATA_TYPE_FLOAT4: IMAGE_DATA_TYPE_FLOAT;
+		is_linear = true;
+	}
+	else {
+		type = get_image_metadata(filename, builtin_data, is_linear);
+	}
 
 	thread_scoped_lock device_lock(device_mutex);
 
@@ -308,7 +326,8 @@ int ImageManager::add_image(const string& filename,
 		                       builtin_data,
 		                       interpolation,
 		                       extension,
-		                       use_alpha))
+		                       use_alpha,
+		                       grid_name))
 		{
 			if(img->frame != frame) {
 				img->frame = frame;
@@ -344,6 +363,7 @@ int ImageManager::add_image(const string& filename,
 	img = new Image();
 	img->filename = filename;
 	img->builtin_data = builtin_data;
+	img->grid_name = grid_name;
 	img->need_load = true;
 	img->animated = animated;
 	img->frame = frame;
@@ -629,6 +649,196 @@ bool ImageManager::file_load_image(Image *img,
 	return true;
 }
 
+/* Dense copy of an OpenVDB grid, for devices without sparse grids. */
+template<typename DeviceType>
+bool ImageManager::file_load_volume_grid(Image *img,
+                                         int channels,
+                                         device_vector<DeviceType>& tex_img)
+{
+	VolumeGrid *grid = volume_grid_from_vdb(img->filename, img->grid_name);
+
+	if(!grid)
+		return false;
+
+	float *pixels = (float*)tex_img.resize(grid->width, grid->height, grid->depth);
+	volume_grid_to_dense(grid, pixels, channels);
+	delete grid;
+
+	return true;
+}
+
+static TextureOpt::InterpMode image_cache_interpolation(InterpolationType interpolation)
+{
+	switch(interpolation) {
+		case INTERPOLATION_CLOSEST:
+			return TextureOpt::InterpClosest;
+		case INTERPOLATION_CUBIC:
+			return TextureOpt::InterpBicubic;
+		case INTERPOLATION_SMART:
+			return TextureOpt::InterpSmartBicubic;
+		case INTERPOLATION_LINEAR:
+		default:
+			return TextureOpt::InterpBilinear;
+	}
+}
+
+static TextureOpt::Wrap image_cache_extension(ExtensionType extension)
+{
+	switch(extension) {
+		case EXTENSION_EXTEND:
+			return TextureOpt::WrapClamp;
+		case EXTENSION_CLIP:
+			return TextureOpt::WrapBlack;
+		case EXTENSION_REPEAT:
+		default:
+			return TextureOpt::WrapPeriodic;
+	}
+}
+
+/* Register image with the texture cache of the device instead of loading it,
+ * returns false if the image has to be loaded into memory. */
+bool ImageManager::device_cache_image(Device *device,
+                                      Scene *scene,
+                                      ImageDataType type,
+                                      int slot)
+{
+	OIIOGlobals *oiio = (OIIOGlobals*)device->oiio_memory();
+	Image *img = images[type][slot];
+
+	if(!oiio || scene->params.texture_cache_size <= 0)
+		return false;
+	if(img->builtin_data || img->filename == "")
+		return false;
+
+	TextureSystem *tex_sys = oiio->tex_sys;
+	ustring filename(img->filename);
+	int flat_slot = type_index_to_flattened_slot(slot, type);
+
+	{
+		thread_scoped_lock device_lock(device_mutex);
+
+		if(oiio->textures.empty()) {
+			tex_sys->attribute("max_memory_MB", (float)scene->params.texture_cache_size);
+			/* Files without tiles and MIP levels are split into tiles and MIP
+			 * mapped on first access, tiled files such as .tx are read lazily. */
+			tex_sys->attribute("autotile", 64);
+			tex_sys->attribute("automip", 1);
+		}
+
+		/* Reload of an image which was already cached. */
+		if((size_t)flat_slot < oiio->textures.size() && oiio->textures[flat_slot].handle)
+			tex_sys->invalidate(filename);
+	}
+
+	/* Only reads the header, volumes are loaded into memory. */
+	ImageSpec spec;
+	if(!tex_sys->get_imagespec(filename, 0, spec) || spec.depth > 1)
+		return false;
+
+	OIIOTexture texture;
+	texture.handle = tex_sys->get_texture_handle(filename);
+
+	if(!texture.handle)
+		return false;
+
+	texture.interpolation = image_cache_interpolation(img->interpolation);
+	texture.extension = image_cache_extension(img->extension);
+	texture.channels = spec.nchannels;
+	texture.use_alpha = img->use_alpha;
+
+	VLOG(1) << "Using texture cache for " << img->filename
+	        << ((spec.tile_width == 0)? ", file is not tiled": "") << ".";
+
+	thread_scoped_lock device_lock(device_mutex);
+
+	if((size_t)flat_slot >= oiio->textures.size())
+		oiio->textures.resize(flat_slot + 1);
+	oiio->textures[flat_slot] = texture;
+
+	return true;
+}
+
+/* Store 3D images as sparse grids on devices which support them, returns
+ * false if the image has to be loaded as dense texture. */
+bool ImageManager::device_load_volume_grid(Device *device,
+                                           Scene *scene,
+                                           ImageDataType type,
+                                           int slot)
+{
+	VolumeGridGlobals *volume_grids = (VolumeGridGlobals*)device->volume_grid_memory();
+	Image *img = images[type][slot];
+
+	if(!volume_grids)
+		return false;
+
+	VolumeGrid *grid = NULL;
+	ImageInput *in = NULL;
+	int width = 0, height = 0, depth = 0, components;
+
+	if(!pack_images && (type == IMAGE_DATA_TYPE_FLOAT4 || type == IMAGE_DATA_TYPE_FLOAT)) {
+		if(img->grid_name != "") {
+			grid = volume_grid_from_vdb(img->filename, img->grid_name);
+		}
+		/* Only reads the header, 2D images are loaded as usual. */
+		else if(file_load_image_generic(img, &in, width, height, depth, components)) {
+			if(in) {
+				in->close();
+				delete in;
+			}
+		}
+	}
+
+	if(depth > 1) {
+		const int texture_limit = scene->params.texture_limit;
+
+		if(type == IMAGE_DATA_TYPE_FLOAT4) {
+			device_vector<float4> tex_img;
+
+			if(file_load_image<TypeDesc::FLOAT, float>(img, type, texture_limit, tex_img)) {
+				grid = volume_grid_from_dense((float*)tex_img.data_pointer,
+				                              tex_img.data_width,
+				                              tex_img.data_height,
+				                              tex_img.data_depth,
+				                              4);
+			}
+		}
+		else {
+			device_vector<float> tex_img;
+
+			if(file_load_image<TypeDesc::FLOAT, float>(img, type, texture_limit, tex_img)) {
+				grid = volume_grid_from_dense((float*)tex_img.data_pointer,
+				                              tex_img.data_width,
+				                              tex_img.data_height,
+				                              tex_img.data_depth,
+				                              1);
+			}
+		}
+	}
+
+	if(grid) {
+		grid->interpolation = img->interpolation;
+		grid->extension = img->extension;
+		volume_grid_build_majorants(grid);
+	}
+
+	/* a grid from before the reload would hide the dense texture */
+	int flat_slot = type_index_to_flattened_slot(slot, type);
+
+	thread_scoped_lock device_lock(device_mutex);
+
+	if((size_t)flat_slot >= volume_grids->grids.size()) {
+		if(!grid)
+			return false;
+
+		volume_grids->grids.resize(flat_slot + 1, NULL);
+	}
+
+	delete volume_grids->grids[flat_slot];
+	volume_grids->grids[flat_slot] = grid;
+
+	return (grid != NULL);
+}
+
 void ImageManager::device_load_image(Device *device,
                                      DeviceScene *dscene,
                                      Scene *scene,
@@ -647,6 +857,18 @@ void ImageManager::device_load_image(Device *device,
 	string filename = path_filename(images[type][slot]->filename);
 	progress->set_status("Updating Images", "Loading " + filename);
 
+	/* Images in the texture cache are read on demand while rendering. */
+	if(device_cache_image(device, scene, type, slot)) {
+		img->need_load = false;
+		return;
+	}
+
+	/* Volumes are stored sparse, without a texture on the device. */
+	if(device_load_volume_grid(device, scene, type, slot)) {
+		img->need_load = false;
+		return;
+	}
+
 	const int texture_limit = scene->params.texture_limit;
 
 	/* Slot assignment */
@@ -663,16 +885,19 @@ void ImageManager::device_load_image(Device *device,
 	if(type == IMAGE_DATA_TYPE_FLOAT4) {
 		device_vector<float4>& tex_img = dscene->tex_float4_image[slot];
 
-		if(tex_img.device_pointer) {
+		if(tex_img.device_pointer && !defer_device_update) {
 			thread_scoped_lock device_lock(device_mutex);
 			device->tex_free(tex_img);
 		}
 
-		if(!file_load_image<TypeDesc::FLOAT, float>(img,
-		                                            type,
-		                                            texture_limit,
-		                                            tex_img))
-		{
+		bool loaded = (img->grid_name != "")?
+		        file_load_volume_grid(img, 4, tex_img):
+		        file_load_image<TypeDesc::FLOAT, float>(img,
+		                                                type,
+		                                                texture_limit,
+		                                                tex_img);
+
+		if(!loaded) {
 			/* on failure to load, we set a 1x1 pixels pink image */
 			float *pixels = (float*)tex_img.resize(1, 1);
 
@@ -683,26 +908,25 @@ void ImageManager::device_load_image(Device *device,
 		}
 
 		if(!pack_images) {
-			thread_scoped_lock device_lock(device_mutex);
-			device->tex_alloc(name.c_str(),
-			                  tex_img,
-			                  img->interpolation,
-			                  img->extension);
+			device_tex_alloc(device, name, tex_img, img);
 		}
 	}
 	else if(type == IMAGE_DATA_TYPE_FLOAT) {
 		device_vector<float>& tex_img = dscene->tex_float_image[slot];
 
-		if(tex_img.device_pointer) {
+		if(tex_img.device_pointer && !defer_device_update) {
 			thread_scoped_lock device_lock(device_mutex);
 			device->tex_free(tex_img);
 		}
 
-		if(!file_load_image<TypeDesc::FLOAT, float>(img,
-		                                            type,
-		                                            texture_limit,
-		                                            tex_img))
-		{
+		bool loaded = (img->grid_name != "")?
+		        file_load_volume_grid(img, 1, tex_img):
+		        file_load_image<TypeDesc::FLOAT, float>(img,
+		                                                type,
+		                                                texture_limit,
+		                                                tex_img);
+
+		if(!loaded) {
 			/* on failure to load, we set a 1x1 pixels pink image */
 			float *pixels = (float*)tex_img.resize(1, 1);
 
@@ -710,17 +934,13 @@ void ImageManager::device_load_image(Device *device,
 		}
 
 		if(!pack_images) {
-			thread_scoped_lock device_lock(device_mutex);
-			device->tex_alloc(name.c_str(),
-			                  tex_img,
-			                  img->interpolation,
-			                  img->extension);
+			device_tex_alloc(device, name, tex_img, img);
 		}
 	}
 	else if(type == IMAGE_DATA_TYPE_BYTE4) {
 		device_vector<uchar4>& tex_img = dscene->tex_byte4_image[slot];
 
-		if(tex_img.device_pointer) {
+		if(tex_img.device_pointer && !defer_device_update) {
 			thread_scoped_lock device_lock(device_mutex);
 			device->tex_free(tex_img);
 		}
@@ -740,17 +960,13 @@ void ImageManager::device_load_image(Device *device,
 		}
 
 		if(!pack_images) {
-			thread_scoped_lock device_lock(device_mutex);
-			device->tex_alloc(name.c_str(),
-			                  tex_img,
-			                  img->interpolation,
-			                  img->extension);
+			device_tex_alloc(device, name, tex_img, img);
 		}
 	}
 	else if(type == IMAGE_DATA_TYPE_BYTE){
 		device_vector<uchar>& tex_img = dscene->tex_byte_image[slot];
 
-		if(tex_img.device_pointer) {
+		if(tex_img.device_pointer && !defer_device_update) {
 			thread_scoped_lock device_lock(device_mutex);
 			device->tex_free(tex_img);
 		}
@@ -766,17 +982,13 @@ void ImageManager::device_load_image(Device *device,
 		}
 
 		if(!pack_images) {
-			thread_scoped_lock device_lock(device_mutex);
-			device->tex_alloc(name.c_str(),
-			                  tex_img,
-			                  img->interpolation,
-			                  img->extension);
+			device_tex_alloc(device, name, tex_img, img);
 		}
 	}
 	else if(type == IMAGE_DATA_TYPE_HALF4){
 		device_vector<half4>& tex_img = dscene->tex_half4_image[slot];
 
-		if(tex_img.device_pointer) {
+		if(tex_img.device_pointer && !defer_device_update) {
 			thread_scoped_lock device_lock(device_mutex);
 			device->tex_free(tex_img);
 		}
@@ -795,17 +1007,13 @@ void ImageManager::device_load_image(Device *device,
 		}
 
 		if(!pack_images) {
-			thread_scoped_lock device_lock(device_mutex);
-			device->tex_alloc(name.c_str(),
-			                  tex_img,
-			                  img->interpolation,
-			                  img->extension);
+			device_tex_alloc(device, name, tex_img, img);
 		}
 	}
 	else if(type == IMAGE_DATA_TYPE_HALF){
 		device_vector<half>& tex_img = dscene->tex_half_image[slot];
 
-		if(tex_img.device_pointer) {
+		if(tex_img.device_pointer && !defer_device_update) {
 			thread_scoped_lock device_lock(device_mutex);
 			device->tex_free(tex_img);
 		}
@@ -821,28 +1029,58 @@ void ImageManager::device_load_image(Device *device,
 		}
 
 		if(!pack_images) {
-			thread_scoped_lock device_lock(device_mutex);
-			device->tex_alloc(name.c_str(),
-			                  tex_img,
-			                  img->interpolation,
-			                  img->extension);
+			device_tex_alloc(device, name, tex_img, img);
 		}
 	}
 
 	img->need_load = false;
 }
 
+void ImageManager::device_tex_alloc(Device *device,
+                                    const string& name,
+                                    device_memory& mem,
+                                    Image *img)
+{
+	thread_scoped_lock device_lock(device_mutex);
+
+	if(defer_device_update) {
+		DeferredTexture tex;
+		tex.mem = &mem;
+		tex.name = name;
+		tex.interpolation = img->interpolation;
+		tex.extension = img->extension;
+		deferred_textures.push_back(tex);
+		return;
+	}
+
+	device->tex_alloc(name.c_str(), mem, img->interpolation, img->extension);
+}
+
 void ImageManager::device_free_image(Device *device, DeviceScene *dscene, ImageDataType type, int slot)
 {
 	Image *img = images[type][slot];
 
 	if(img) {
+		OIIOGlobals *oiio = (OIIOGlobals*)device->oiio_memory();
+		VolumeGridGlobals *volume_grids = (VolumeGridGlobals*)device->volume_grid_memory();
+		int flat_slot = type_index_to_flattened_slot(slot, type);
+
 		if(osl_texture_system && !img->builtin_data) {
 #ifdef WITH_OSL
 			ustring filename(images[type][slot]->filename);
 			((OSL::TextureSystem*)osl_texture_system)->invalidate(filename);
 #endif
 		}
+		else if(oiio && (size_t)flat_slot < oiio->textures.size() && oiio->textures[flat_slot].handle) {
+			thread_scoped_lock device_lock(device_mutex);
+			oiio->tex_sys->invalidate(ustring(img->filename));
+			oiio->textures[flat_slot] = OIIOTexture();
+		}
+		else if(volume_grids && (size_t)flat_slot < volume_grids->grids.size() && volume_grids->grids[flat_slot]) {
+			thread_scoped_lock device_lock(device_mutex);
+			delete volume_grids->grids[flat_slot];
+			volume_grids->grids[flat_slot] = NULL;
+		}
 		else if(type == IMAGE_DATA_TYPE_FLOAT4) {
 			device_vector<float4>& tex_img = dscene->tex_float4_image[slot];
 
@@ -917,6 +1155,14 @@ void ImageManager::device_update(Device *device,
 	if(!need_update)
 		return;
 
+	/* images loaded ahead of the update, the old texture is replaced */
+	foreach(DeferredTexture& tex, deferred_textures) {
+		if(tex.mem->device_pointer)
+			device->tex_free(*tex.mem);
+		device->tex_alloc(tex.name.c_str(), *tex.mem, tex.interpolation, tex.extension);
+	}
+	deferred_textures.clear();
+
 	TaskPool pool;
 
 	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
@@ -949,6 +1195,61 @@ void ImageManager::device_update(Device *device,
 	need_update = false;
 }
 
+/* Load image files on the host without using the device, so this can run
+ * while other managers update the device. Textures are allocated by the next
+ * device_update(). Images which are not loaded yet are left to it when images
+ * need to be packed, since packing needs all of them at once anyway. */
+void ImageManager::device_load_images(Device *device,
+                                      DeviceScene *dscene,
+                                      Scene *scene,
+                                      Progress *progress)
+{
+	if(!need_update || pack_images)
+		return;
+
+	/* Shader evaluation for displacement may read the texture cache table in
+	 * the meantime, so it must not be reallocated while loading. */
+	OIIOGlobals *oiio = (OIIOGlobals*)device->oiio_memory();
+	if(oiio) {
+		size_t num_slots = 0;
+		for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
+			if(images[type].size()) {
+				int flat_slot = type_index_to_flattened_slot(images[type].size() - 1, (ImageDataType)type);
+				num_slots = max(num_slots, (size_t)flat_slot + 1);
+			}
+		}
+		if(oiio->textures.size() < num_slots)
+			oiio->textures.resize(num_slots);
+	}
+
+	TaskPool pool;
+
+	defer_device_update = true;
+
+	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
+		for(size_t slot = 0; slot < images[type].size(); slot++) {
+			if(!images[type][slot])
+				continue;
+
+			if(images[type][slot]->users != 0 && images[type][slot]->need_load) {
+				if(!osl_texture_system || images[type][slot]->builtin_data)
+					pool.push(function_bind(&ImageManager::device_load_image,
+					                        this,
+					                        device,
+					                        dscene,
+					                        scene,
+					                        (ImageDataType)type,
+					                        slot,
+					                        progress));
+			}
+		}
+	}
+
+	pool.wait_work();
+
+	defer_device_update = false;
+}
+
 void ImageManager::device_update_slot(Device *device,
                                       DeviceScene *dscene,
                                       Scene *scene,
@@ -1180,6 +1481,13 @@ void ImageManager::device_free_builtin(Device *device, DeviceScene *dscene)
 
 void ImageManager::device_free(Device *device, DeviceScene *dscene)
 {
+	deferred_textures.clear();
+
+	OIIOGlobals *oiio = (OIIOGlobals*)device->oiio_memory();
+	if(oiio && !oiio->textures.empty()) {
+		VLOG(2) << "Texture cache statistics:\n" << oiio->tex_sys->getstats();
+	}
+
 	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
 		for(size_t slot = 0; slot < images[type].size(); slot++) {
 			device_free_image(device, dscene, (ImageDataType)type, slot);
@@ -56,7 +56,8 @@ public:
 	              bool& is_linear,
 	              InterpolationType interpolation,
 	              ExtensionType extension,
-	              bool use_alpha);
+	              bool use_alpha,
+	              const string& grid_name = "");
 	void remove_image(int flat_slot);
 	void remove_image(const string& filename,
 	                  void *builtin_data,
@@ -74,6 +75,10 @@ public:
 	                   DeviceScene *dscene,
 	                   Scene *scene,
 	                   Progress& progress);
+	void device_load_images(Device *device,
+	                        DeviceScene *dscene,
+	                        Scene *scene,
+	                        Progress *progress);
 	void device_update_slot(Device *device,
 	                        DeviceScene *dscene,
 	                        Scene *scene,
@@ -111,6 +116,8 @@ public:
 	struct Image {
 		string filename;
 		void *builtin_data;
+		/* grid in OpenVDB files */
+		string grid_name;
 
 		bool use_alpha;
 		bool need_load;
@@ -129,6 +136,18 @@ private:
 	thread_mutex device_mutex;
 	int animation_frame;
 
+	/* Textures of images loaded by device_load_images(), allocated on the
+	 * device by the next device_update(). */
+	struct DeferredTexture {
+		device_memory *mem;
+		string name;
+		InterpolationType interpolation;
+		ExtensionType extension;
+	};
+
+	bool defer_device_update;
+	vector<DeferredTexture> deferred_textures;
+
 	vector<Image*> images[IMAGE_DATA_NUM_TYPES];
 	void *osl_texture_system;
 	bool pack_images;
@@ -143,18 +162,35 @@ private:
 	                     int texture_limit,
 	                     device_vector<DeviceType>& tex_img);
 
+	template<typename DeviceType>
+	bool file_load_volume_grid(Image *img,
+	                           int channels,
+	                           device_vector<DeviceType>& tex_img);
+
 	int type_index_to_flattened_slot(int slot, ImageDataType type);
 	int flattened_slot_to_type_index(int flat_slot, ImageDataType *type);
 	string name_from_type(int type);
 
 	uint8_t pack_image_options(ImageDataType type, size_t slot);
 
+	bool device_cache_image(Device *device,
+	                        Scene *scene,
+	                        ImageDataType type,
+	                        int slot);
+	bool device_load_volume_grid(Device *device,
+	                             Scene *scene,
+	                             ImageDataType type,
+	                             int slot);
 	void device_load_image(Device *device,
 	                       DeviceScene *dscene,
 	                       Scene *scene,
 	                       ImageDataType type,
 	                       int slot,
 	                       Progress *progess);
+	void device_tex_alloc(Device *device,
+	                      const string& name,
+	                      device_memory& mem,
+	                      Image *img);
 	void device_free_image(Device *device,
 	                       DeviceScene *dscene,
 	                       ImageDataType type,
@@ -18,6 +18,7 @@
 #include "integrator.h"
 #include "film.h"
 #include "light.h"
+#include "object.h"
 #include "scene.h"
 #include "shader.h"
 #include "sobol.h"
@@ -69,6 +70,13 @@ NODE_DEFINE(Integrator)
 	SOCKET_BOOLEAN(sample_all_lights_direct, "Sample All Lights Direct", true);
 	SOCKET_BOOLEAN(sample_all_lights_indirect, "Sample All Lights Indirect", true);
 	SOCKET_FLOAT(light_sampling_threshold, "Light Sampling Threshold", 0.05f);
+	SOCKET_BOOLEAN(use_light_tree, "Use Light Tree", false);
+
+	SOCKET_FLOAT(adaptive_threshold, "Adaptive Threshold", 0.0f);
+	SOCKET_INT(adaptive_min_samples, "Adaptive Min Samples", 0);
+
+	SOCKET_BOOLEAN(use_path_guiding, "Use Path Guiding", false);
+	SOCKET_INT(path_guiding_memory, "Path Guiding Memory", 256);
 
 	static NodeEnum method_enum;
 	method_enum.insert("path", PATH);
@@ -183,6 +191,52 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
 		kintegrator->light_inv_rr_threshold = 0.0f;
 	}
 
+	/* Adaptive sampling needs the auxiliary pass, which is only added to
+	 * the film for final renders with all samples taken at once. */
+	if(adaptive_threshold > 0.0f &&
+	   Pass::contains(scene->film->passes, PASS_ADAPTIVE_AUX_BUFFER))
+	{
+		kintegrator->adaptive_threshold = adaptive_threshold;
+		if(adaptive_min_samples > 0) {
+			kintegrator->adaptive_min_samples = adaptive_min_samples;
+		}
+		else {
+			/* Lower thresholds need more samples for a reliable estimate. */
+			kintegrator->adaptive_min_samples =
+				max(4, (int)ceilf(16.0f / powf(adaptive_threshold, 0.3f)));
+		}
+		kintegrator->adaptive_step = 4;
+	}
+	else {
+		kintegrator->adaptive_threshold = 0.0f;
+		kintegrator->adaptive_min_samples = INT_MAX;
+		kintegrator->adaptive_step = 0;
+	}
+
+	/* Path guiding, the radiance caches cover the bounds of all objects. */
+	BoundBox bounds = BoundBox::empty;
+
+	if(use_path_guiding) {
+		foreach(Object *object, scene->objects) {
+			if(object->bounds.valid())
+				bounds.grow(object->bounds);
+		}
+	}
+
+	if(bounds.valid() && device->info.type == DEVICE_CPU) {
+		kintegrator->use_path_guiding = true;
+		kintegrator->path_guiding_memory = path_guiding_memory;
+		kintegrator->path_guiding_min_x = bounds.min.x;
+		kintegrator->path_guiding_min_y = bounds.min.y;
+		kintegrator->path_guiding_min_z = bounds.min.z;
+		kintegrator->path_guiding_max_x = bounds.max.x;
+		kintegrator->path_guiding_max_y = bounds.max.y;
+		kintegrator->path_guiding_max_z = bounds.max.z;
+	}
+	else {
+		kintegrator->use_path_guiding = false;
+	}
+
 	/* sobol directions table */
 	int max_samples = 1;
 
@@ -71,6 +71,13 @@ public:
 	bool sample_all_lights_direct;
 	bool sample_all_lights_indirect;
 	float light_sampling_threshold;
+	bool use_light_tree;
+
+	float adaptive_threshold;
+	int adaptive_min_samples;
+
+	bool use_path_guiding;
+	int path_guiding_memory;
 
 	enum Method {
 		BRANCHED_PATH = 0,
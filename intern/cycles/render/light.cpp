@@ -19,6 +19,7 @@
 #include "integrator.h"
 #include "film.h"
 #include "light.h"
+#include "light_tree.h"
 #include "mesh.h"
 #include "object.h"
 #include "scene.h"
@@ -27,6 +28,7 @@
 #include "util_foreach.h"
 #include "util_progress.h"
 #include "util_logging.h"
+#include "util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -298,6 +300,9 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 	size_t offset = 0;
 	int j = 0;
 
+	bool use_light_tree = scene->integrator->use_light_tree;
+	vector<LightTreePrimitive> tree_prims;
+
 	foreach(Object *object, scene->objects) {
 		if(progress.get_cancel()) return;
 
@@ -354,7 +359,19 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 					p3 = transform_point(&tfm, p3);
 				}
 
-				totarea += triangle_area(p1, p2, p3);
+				float area = triangle_area(p1, p2, p3);
+				totarea += area;
+
+				if(use_light_tree && area > 0.0f) {
+					LightTreePrimitive prim;
+					prim.bbox = BoundBox(p1);
+					prim.bbox.grow(p2);
+					prim.bbox.grow(p3);
+					prim.axis = normalize(cross(p2 - p1, p3 - p1));
+					prim.energy = area;
+					prim.index = offset - 1;
+					tree_prims.push_back(prim);
+				}
 			}
 		}
 
@@ -449,6 +466,21 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 		/* CDF */
 		device->tex_alloc("__light_distribution", dscene->light_distribution);
 
+		/* Light tree */
+		if(tree_prims.size()) {
+			device_update_light_tree(device, dscene, tree_prims, num_triangles);
+
+			/* probability of sampling the tree instead of a lamp */
+			kintegrator->use_light_tree = true;
+			kintegrator->light_tree_num_emitters = num_triangles;
+			kintegrator->light_tree_pdf = (num_lights)? 0.5f: 1.0f;
+		}
+		else {
+			kintegrator->use_light_tree = false;
+			kintegrator->light_tree_num_emitters = 0;
+			kintegrator->light_tree_pdf = 0.0f;
+		}
+
 		/* Portals */
 		if(num_portals > 0) {
 			kintegrator->portal_offset = light_index;
@@ -470,6 +502,9 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 		kintegrator->pdf_lights = 0.0f;
 		kintegrator->inv_pdf_lights = 0.0f;
 		kintegrator->use_lamp_mis = false;
+		kintegrator->use_light_tree = false;
+		kintegrator->light_tree_num_emitters = 0;
+		kintegrator->light_tree_pdf = 0.0f;
 		kintegrator->num_portals = 0;
 		kintegrator->portal_offset = 0;
 		kintegrator->portal_pdf = 0.0f;
@@ -842,6 +877,46 @@ void LightManager::device_update(Device *device, DeviceScene *dscene, Scene *sce
 	need_update = false;
 }
 
+void LightManager::device_update_light_tree(Device *device,
+                                            DeviceScene *dscene,
+                                            vector<LightTreePrimitive>& prims,
+                                            size_t num_triangles)
+{
+	double time_start = time_dt();
+
+	LightTree tree(prims, 4);
+
+	/* nodes */
+	float4 *nodes = dscene->light_tree_nodes.resize(tree.nodes.size());
+	memcpy(nodes, &tree.nodes[0], sizeof(float4)*tree.nodes.size());
+
+	/* emitters in the order referenced by the leaves, same as the light
+	 * distribution but with the area instead of the CDF */
+	float4 *distribution = dscene->light_distribution.get_data();
+	float4 *emitters = dscene->light_tree_emitters.resize(prims.size());
+
+	/* distribution index to emitter index, for MIS. Triangles with zero
+	 * area are not part of the tree and can not be sampled. */
+	uint *lookup = dscene->light_tree_lookup.resize(num_triangles);
+	memset(lookup, 0xff, sizeof(uint)*num_triangles);
+
+	for(size_t i = 0; i < prims.size(); i++) {
+		const LightTreePrimitive& prim = prims[i];
+
+		emitters[i] = distribution[prim.index];
+		emitters[i].x = prim.energy;
+		lookup[prim.index] = i;
+	}
+
+	device->tex_alloc("__light_tree_nodes", dscene->light_tree_nodes);
+	device->tex_alloc("__light_tree_emitters", dscene->light_tree_emitters);
+	device->tex_alloc("__light_tree_lookup", dscene->light_tree_lookup);
+
+	VLOG(1) << "Light tree with " << tree.nodes.size()/LIGHT_TREE_NODE_SIZE
+	        << " nodes for " << prims.size() << " emitters built in "
+	        << time_dt() - time_start << " seconds.";
+}
+
 void LightManager::device_free(Device *device, DeviceScene *dscene)
 {
 	device->tex_free(dscene->light_distribution);
@@ -849,10 +924,17 @@ void LightManager::device_free(Device *device, DeviceScene *dscene)
 	device->tex_free(dscene->light_background_marginal_cdf);
 	device->tex_free(dscene->light_background_conditional_cdf);
 
+	device->tex_free(dscene->light_tree_nodes);
+	device->tex_free(dscene->light_tree_emitters);
+	device->tex_free(dscene->light_tree_lookup);
+
 	dscene->light_distribution.clear();
 	dscene->light_data.clear();
 	dscene->light_background_marginal_cdf.clear();
 	dscene->light_background_conditional_cdf.clear();
+	dscene->light_tree_nodes.clear();
+	dscene->light_tree_emitters.clear();
+	dscene->light_tree_lookup.clear();
 }
 
 void LightManager::tag_update(Scene * /*scene*/)
@@ -29,6 +29,7 @@ CCL_NAMESPACE_BEGIN
 class Device;
 class DeviceScene;
 class Object;
+struct LightTreePrimitive;
 class Progress;
 class Scene;
 class Shader;
@@ -110,6 +111,10 @@ protected:
 	                                DeviceScene *dscene,
 	                                Scene *scene,
 	                                Progress& progress);
+	void device_update_light_tree(Device *device,
+	                              DeviceScene *dscene,
+	                              vector<LightTreePrimitive>& prims,
+	                              size_t num_triangles);
 	void device_update_background(Device *device,
 	                              DeviceScene *dscene,
 	                              Scene *scene,
@@ -0,0 +1,311 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "light_tree.h"
+
+#include "kernel_types.h"
+
+#include "util_algorithm.h"
+#include "util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+#define LIGHT_TREE_NUM_BINS 12
+#define LIGHT_TREE_MAX_DEPTH 64
+
+/* Bin of primitives used while finding the best split. */
+struct LightTreeBin {
+	BoundBox bbox;
+	float3 axis;
+	float theta_o;
+	float energy;
+	int count;
+
+	LightTreeBin()
+	: bbox(BoundBox::empty), energy(0.0f), count(0)
+	{
+	}
+};
+
+/* Partition predicates. */
+struct LightTreeBinLess {
+	int dim;
+	float offset, scale;
+	int bin;
+
+	bool operator()(const LightTreePrimitive& prim) const
+	{
+		float3 center = prim.bbox.center();
+		int b = min((int)((center[dim] - offset) * scale), LIGHT_TREE_NUM_BINS - 1);
+		return b <= bin;
+	}
+};
+
+struct LightTreeCenterLess {
+	int dim;
+
+	bool operator()(const LightTreePrimitive& a, const LightTreePrimitive& b) const
+	{
+		return a.bbox.center()[dim] < b.bbox.center()[dim];
+	}
+};
+
+LightTree::LightTree(vector<LightTreePrimitive>& prims_, int max_leaf_size_)
+: prims(prims_), max_leaf_size(max_leaf_size_)
+{
+	if(prims.size())
+		build(0, prims.size(), 0);
+}
+
+LightTree::Cone LightTree::merge(const Cone& a_, const Cone& b_)
+{
+	/* Union of two cones, from "Importance Sampling of Many Lights with
+	 * Adaptive Tree Splitting", Estevez and Kulla. Normals are only bounded
+	 * up to their sign, so the cone pointing closest to a is used. */
+	Cone a = a_, b = b_;
+	if(dot(a.axis, b.axis) < 0.0f)
+		b.axis = -b.axis;
+	if(b.theta_o > a.theta_o)
+		swap(a, b);
+
+	float theta_d = safe_acosf(dot(a.axis, b.axis));
+	if(min(theta_d + b.theta_o, M_PI_F) <= a.theta_o)
+		return a;
+
+	Cone cone;
+	cone.theta_o = 0.5f*(a.theta_o + theta_d + b.theta_o);
+
+	if(cone.theta_o >= M_PI_2_F) {
+		cone.axis = a.axis;
+		cone.theta_o = M_PI_2_F;
+		return cone;
+	}
+
+	/* rotate axis of a towards b */
+	float theta_r = cone.theta_o - a.theta_o;
+	float3 ortho = b.axis - a.axis*dot(a.axis, b.axis);
+	float len = len_squared(ortho);
+
+	if(len == 0.0f) {
+		cone.axis = a.axis;
+	}
+	else {
+		ortho *= 1.0f/sqrtf(len);
+		cone.axis = normalize(a.axis*cosf(theta_r) + ortho*sinf(theta_r));
+	}
+
+	return cone;
+}
+
+float LightTree::orientation_measure(const Cone& cone)
+{
+	/* Solid angle measure of the cone, with emission spreading up to
+	 * M_PI_2_F around the normals. */
+	float theta_o = cone.theta_o;
+	float theta_w = min(theta_o + M_PI_2_F, M_PI_F);
+	float sin_theta_o = sinf(theta_o);
+	float cos_theta_o = cosf(theta_o);
+
+	return M_2PI_F*(1.0f - cos_theta_o) +
+	       M_PI_2_F*(2.0f*theta_w*sin_theta_o - cosf(theta_o - 2.0f*theta_w) -
+	                 2.0f*theta_o*sin_theta_o + cos_theta_o);
+}
+
+float LightTree::split_cost(const BoundBox& bbox, const Cone& cone, float energy)
+{
+	return energy*bbox.area()*orientation_measure(cone);
+}
+
+int LightTree::build(int start, int end, int depth)
+{
+	/* compute node bounds */
+	BoundBox bbox = BoundBox::empty;
+	BoundBox centroid_bbox = BoundBox::empty;
+	Cone cone;
+	float energy = 0.0f;
+
+	for(int i = start; i < end; i++) {
+		const LightTreePrimitive& prim = prims[i];
+		Cone prim_cone = {prim.axis, 0.0f};
+
+		bbox.grow(prim.bbox);
+		centroid_bbox.grow(prim.bbox.center());
+		cone = (i == start)? prim_cone: merge(cone, prim_cone);
+		energy += prim.energy;
+	}
+
+	int idx = nodes.size()/LIGHT_TREE_NODE_SIZE;
+	nodes.resize(nodes.size() + LIGHT_TREE_NODE_SIZE);
+
+	int num = end - start;
+	float3 extent = centroid_bbox.size();
+
+	if(num <= max_leaf_size || depth >= LIGHT_TREE_MAX_DEPTH || max3(extent) == 0.0f) {
+		pack_node(idx, bbox, cone, energy, start, end, -1);
+		return idx;
+	}
+
+	/* find split with the lowest surface area orientation heuristic cost,
+	 * binning primitives by their centroid */
+	float3 size = bbox.size();
+	float max_size = max3(size);
+	float best_cost = FLT_MAX;
+	int best_dim = -1, best_bin = 0;
+
+	for(int dim = 0; dim < 3; dim++) {
+		if(extent[dim] == 0.0f)
+			continue;
+
+		LightTreeBin bins[LIGHT_TREE_NUM_BINS];
+		float scale = LIGHT_TREE_NUM_BINS/extent[dim];
+
+		for(int i = start; i < end; i++) {
+			const LightTreePrimitive& prim = prims[i];
+			float3 center = prim.bbox.center();
+			int b = min((int)((center[dim] - centroid_bbox.min[dim]) * scale), LIGHT_TREE_NUM_BINS - 1);
+			LightTreeBin& bin = bins[b];
+			Cone prim_cone = {prim.axis, 0.0f};
+
+			if(bin.count == 0) {
+				bin.axis = prim_cone.axis;
+				bin.theta_o = prim_cone.theta_o;
+			}
+			else {
+				Cone bin_cone = {bin.axis, bin.theta_o};
+				bin_cone = merge(bin_cone, prim_cone);
+				bin.axis = bin_cone.axis;
+				bin.theta_o = bin_cone.theta_o;
+			}
+
+			bin.bbox.grow(prim.bbox);
+			bin.energy += prim.energy;
+			bin.count++;
+		}
+
+		/* sweep from the right to get the cost of all right sides */
+		float right_cost[LIGHT_TREE_NUM_BINS - 1];
+		LightTreeBin right;
+
+		for(int b = LIGHT_TREE_NUM_BINS - 1; b > 0; b--) {
+			const LightTreeBin& bin = bins[b];
+
+			if(bin.count) {
+				if(right.count == 0) {
+					right.axis = bin.axis;
+					right.theta_o = bin.theta_o;
+				}
+				else {
+					Cone right_cone = {right.axis, right.theta_o}, bin_cone = {bin.axis, bin.theta_o};
+					right_cone = merge(right_cone, bin_cone);
+					right.axis = right_cone.axis;
+					right.theta_o = right_cone.theta_o;
+				}
+
+				right.bbox.grow(bin.bbox);
+				right.energy += bin.energy;
+				right.count += bin.count;
+			}
+
+			if(right.count) {
+				Cone right_cone = {right.axis, right.theta_o};
+				right_cost[b - 1] = split_cost(right.bbox, right_cone, right.energy);
+			}
+			else {
+				right_cost[b - 1] = FLT_MAX;
+			}
+		}
+
+		/* sweep from the left, regularized to avoid thin nodes */
+		float regularization = max_size/size[dim];
+		Cone left_cone;
+		LightTreeBin left;
+
+		for(int b = 0; b < LIGHT_TREE_NUM_BINS - 1; b++) {
+			const LightTreeBin& bin = bins[b];
+
+			if(bin.count) {
+				Cone bin_cone = {bin.axis, bin.theta_o};
+				left_cone = (left.count == 0)? bin_cone: merge(left_cone, bin_cone);
+				left.bbox.grow(bin.bbox);
+				left.energy += bin.energy;
+				left.count += bin.count;
+			}
+
+			if(left.count == 0 || left.count == num)
+				continue;
+
+			float cost = regularization*(split_cost(left.bbox, left_cone, left.energy) + right_cost[b]);
+
+			if(cost < best_cost) {
+				best_cost = cost;
+				best_dim = dim;
+				best_bin = b;
+			}
+		}
+	}
+
+	/* partition primitives */
+	LightTreePrimitive *first = &prims[0] + start;
+	LightTreePrimitive *last = &prims[0] + end;
+	int mid = start;
+
+	if(best_dim != -1) {
+		LightTreeBinLess pred;
+		pred.dim = best_dim;
+		pred.offset = centroid_bbox.min[best_dim];
+		pred.scale = LIGHT_TREE_NUM_BINS/extent[best_dim];
+		pred.bin = best_bin;
+
+		mid = std::partition(first, last, pred) - &prims[0];
+	}
+
+	if(mid == start || mid == end) {
+		/* no usable split found, fall back to a median split */
+		LightTreeCenterLess compare;
+		compare.dim = (extent.x > extent.y)? ((extent.x > extent.z)? 0: 2): ((extent.y > extent.z)? 1: 2);
+
+		mid = (start + end)/2;
+		std::nth_element(first, &prims[0] + mid, last, compare);
+	}
+
+	build(start, mid, depth + 1);
+	int right_child = build(mid, end, depth + 1);
+
+	pack_node(idx, bbox, cone, energy, start, end, right_child);
+
+	return idx;
+}
+
+void LightTree::pack_node(int idx,
+                          const BoundBox& bbox,
+                          const Cone& cone,
+                          float energy,
+                          int start, int end,
+                          int right_child)
+{
+	float4 *node = &nodes[idx*LIGHT_TREE_NODE_SIZE];
+
+	node[0] = make_float4(bbox.min.x, bbox.min.y, bbox.min.z, energy);
+	node[1] = make_float4(bbox.max.x, bbox.max.y, bbox.max.z, cone.theta_o);
+	node[2] = make_float4(cone.axis.x, cone.axis.y, cone.axis.z, 0.0f);
+	node[3] = make_float4(__int_as_float(start),
+	                      __int_as_float(end - start),
+	                      __int_as_float(right_child),
+	                      0.0f);
+}
+
+CCL_NAMESPACE_END
+
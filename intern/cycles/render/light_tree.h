@@ -0,0 +1,79 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LIGHT_TREE_H__
+#define __LIGHT_TREE_H__
+
+#include "util_boundbox.h"
+#include "util_types.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Light Tree
+ *
+ * Bounding volume hierarchy over emitters, used to importance sample many
+ * lights based on their energy, distance and orientation relative to the
+ * shading point. Every node stores the bounding box, total energy and a cone
+ * bounding the normals of the emitters below it.
+ *
+ * Emitters are double-sided, so the orientation cones bound normals up to
+ * their sign and an angle of M_PI_2_F covers all orientations. */
+
+struct LightTreePrimitive {
+	BoundBox bbox;
+	float3 axis;
+	float energy;
+	/* index in the light distribution */
+	int index;
+};
+
+class LightTree {
+public:
+	LightTree(vector<LightTreePrimitive>& prims, int max_leaf_size);
+
+	/* Packed nodes, LIGHT_TREE_NODE_SIZE float4 each in depth first order,
+	 * so the left child of an inner node directly follows it. */
+	vector<float4> nodes;
+
+	/* Order in which the primitives are referenced by the leaves. */
+	vector<LightTreePrimitive>& prims;
+
+protected:
+	struct Cone {
+		float3 axis;
+		float theta_o;
+	};
+
+	int max_leaf_size;
+
+	int build(int start, int end, int depth);
+	void pack_node(int idx,
+	               const BoundBox& bbox,
+	               const Cone& cone,
+	               float energy,
+	               int start, int end,
+	               int right_child);
+
+	static Cone merge(const Cone& a, const Cone& b);
+	static float orientation_measure(const Cone& cone);
+	static float split_cost(const BoundBox& bbox, const Cone& cone, float energy);
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __LIGHT_TREE_H__ */
+
@@ -21,6 +21,7 @@
 #include "curves.h"
 #include "device.h"
 #include "graph.h"
+#include "integrator.h"
 #include "shader.h"
 #include "light.h"
 #include "mesh.h"
@@ -34,9 +35,12 @@
 #include "subd_patch_table.h"
 
 #include "util_foreach.h"
+#include "util_half.h"
 #include "util_logging.h"
+#include "util_md5.h"
 #include "util_progress.h"
 #include "util_set.h"
+#include "util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -943,8 +947,8 @@ void Mesh::pack_curves(Scene *scene, float4 *curve_key_co, float4 *curve_data, s
 {
 	size_t curve_keys_size = curve_keys.size();
 
-	/* pack curve keys */
-	if(curve_keys_size) {
+	/* pack curve keys, compact keys are packed separately */
+	if(curve_keys_size && curve_key_co) {
 		float3 *keys_ptr = curve_keys.data();
 		float *radius_ptr = curve_radius.data();
 
@@ -970,6 +974,60 @@ void Mesh::pack_curves(Scene *scene, float4 *curve_key_co, float4 *curve_data, s
 	}
 }
 
+/* Quantize curve keys to 16 bits relative to the bounds of their curve, and
+ * the radius relative to the largest radius of the curve. The radius is reduced
+ * by the largest location error of the interpolated curve, so that the compact
+ * curve stays inside the BVH bounds computed from the original keys. */
+
+void Mesh::pack_curve_keys_compact(uint *curve_keys_packed,
+                                   float4 *curve_key_bounds,
+                                   float4 *curve_data,
+                                   float *max_radius_error)
+{
+	size_t curve_num = num_curves();
+
+	for(size_t i = 0; i < curve_num; i++) {
+		Curve curve = get_curve(i);
+		const float3 *keys = &curve_keys[curve.first_key];
+		const float *radius = &curve_radius[curve.first_key];
+
+		BoundBox bounds = BoundBox::empty;
+		float max_radius = 0.0f;
+
+		for(int k = 0; k < curve.num_keys; k++) {
+			bounds.grow(keys[k]);
+			max_radius = max(max_radius, radius[k]);
+		}
+
+		const float step = max3(bounds.size())/65535.0f;
+		const float inv_step = (step > 0.0f)? 1.0f/step: 0.0f;
+		const float radius_step = max_radius/65535.0f;
+		const float inv_radius_step = (radius_step > 0.0f)? 1.0f/radius_step: 0.0f;
+		/* keys are off by at most half a step along each axis, and the absolute
+		 * cardinal spline weights sum up to less than 1.36 */
+		const float key_error = 1.36f*0.5f*sqrtf(3.0f)*step;
+
+		for(int k = 0; k < curve.num_keys; k++) {
+			const float3 q = (keys[k] - bounds.min)*inv_step + make_float3(0.5f, 0.5f, 0.5f);
+			const uint x = min((uint)q.x, 65535u);
+			const uint y = min((uint)q.y, 65535u);
+			const uint z = min((uint)q.z, 65535u);
+			const uint r = min((uint)(max(radius[k] - key_error, 0.0f)*inv_radius_step), 65535u);
+
+			curve_keys_packed[(curve.first_key + k)*2 + 0] = x | (y << 16);
+			curve_keys_packed[(curve.first_key + k)*2 + 1] = z | (r << 16);
+
+			if(radius[k] > 0.0f) {
+				const float error = (radius[k] - (float)r*radius_step)/radius[k];
+				*max_radius_error = max(*max_radius_error, error);
+			}
+		}
+
+		curve_key_bounds[i] = make_float4(bounds.min.x, bounds.min.y, bounds.min.z, step);
+		curve_data[i].w = radius_step;
+	}
+}
+
 void Mesh::pack_patches(uint *patch_data, uint vert_offset, uint face_offset, uint corner_offset)
 {
 	size_t num_faces = subd_faces.size();
@@ -1016,6 +1074,101 @@ void Mesh::pack_patches(uint *patch_data, uint vert_offset, uint face_offset, ui
 	}
 }
 
+static void bvh_key_append(MD5Hash& md5, const void *data, size_t size)
+{
+	/* MD5Hash takes an int size, feed large arrays in chunks. */
+	const uint8_t *bytes = (const uint8_t*)data;
+	const size_t chunk_size = 1 << 30;
+
+	while(size > 0) {
+		const size_t chunk = min(size, chunk_size);
+		md5.append(bytes, (int)chunk);
+		bytes += chunk;
+		size -= chunk;
+	}
+}
+
+template<typename T>
+static void bvh_key_append(MD5Hash& md5, const array<T>& data)
+{
+	size_t size = data.size();
+	bvh_key_append(md5, &size, sizeof(size));
+	bvh_key_append(md5, data.data(), data.size()*sizeof(T));
+}
+
+static void bvh_key_append(MD5Hash& md5, const float3 *data, size_t size)
+{
+	/* Only hash xyz, the fourth component is not guaranteed to be set. */
+	float xyz[3*256];
+
+	for(size_t i = 0; i < size; i += 256) {
+		const size_t num = min(size - i, (size_t)256);
+
+		for(size_t j = 0; j < num; j++) {
+			xyz[j*3 + 0] = data[i + j].x;
+			xyz[j*3 + 1] = data[i + j].y;
+			xyz[j*3 + 2] = data[i + j].z;
+		}
+
+		bvh_key_append(md5, xyz, num*3*sizeof(float));
+	}
+}
+
+static void bvh_key_append(MD5Hash& md5, const array<float3>& data)
+{
+	size_t size = data.size();
+	bvh_key_append(md5, &size, sizeof(size));
+	bvh_key_append(md5, data.data(), size);
+}
+
+static void bvh_key_append(MD5Hash& md5, const Attribute *attr)
+{
+	size_t size = (attr)? attr->buffer.size(): 0;
+	bvh_key_append(md5, &size, sizeof(size));
+
+	if(size) {
+		bvh_key_append(md5, (const float3*)attr->data(), size/sizeof(float3));
+	}
+}
+
+static void bvh_key_append(MD5Hash& md5, const BVHParams& bparams)
+{
+	/* Build parameters affecting the tree. */
+	bvh_key_append(md5, &bparams.top_level, sizeof(bool));
+	bvh_key_append(md5, &bparams.use_spatial_split, sizeof(bool));
+	bvh_key_append(md5, &bparams.use_qbvh, sizeof(bool));
+	bvh_key_append(md5, &bparams.use_obvh, sizeof(bool));
+	bvh_key_append(md5, &bparams.use_unaligned_nodes, sizeof(bool));
+	bvh_key_append(md5, &bparams.num_motion_triangle_steps, sizeof(int));
+	bvh_key_append(md5, &bparams.num_motion_curve_steps, sizeof(int));
+}
+
+string Mesh::bvh_key(const BVHParams& bparams) const
+{
+	MD5Hash md5;
+
+	bvh_key_append(md5, bparams);
+
+	/* Geometry. */
+	bvh_key_append(md5, verts);
+	bvh_key_append(md5, triangles);
+	bvh_key_append(md5, curve_keys);
+	bvh_key_append(md5, curve_radius);
+	bvh_key_append(md5, curve_first_key);
+
+	/* Motion blur. */
+	const bool motion_blur = has_motion_blur();
+	bvh_key_append(md5, &motion_blur, sizeof(bool));
+	bvh_key_append(md5, &motion_steps, sizeof(motion_steps));
+
+	if(motion_blur) {
+		bvh_key_append(md5, attributes.find(ATTR_STD_MOTION_VERTEX_POSITION));
+		bvh_key_append(md5, curve_attributes.find(ATTR_STD_MOTION_VERTEX_POSITION));
+	}
+
+	return md5.get_hex();
+}
+
 void Mesh::compute_bvh(DeviceScene *dscene,
                        SceneParams *params,
                        Progress *progress,
@@ -1040,25 +1193,43 @@ void Mesh::compute_bvh(DeviceScene *dscene,
 		vector<Object*> objects;
 		objects.push_back(&object);
 
-		if(bvh && !need_update_rebuild) {
-			progress->set_status(msg, "Refitting BVH");
-			bvh->objects = objects;
-			bvh->refit(*progress);
+		BVHParams bparams;
+		bparams.use_spatial_split = params->use_bvh_spatial_split;
+		bparams.use_qbvh = params->use_qbvh;
+		bparams.use_obvh = params->use_obvh;
+		bparams.use_unaligned_nodes = dscene->data.bvh.have_curves &&
+		                              params->use_bvh_unaligned_nodes;
+		bparams.num_motion_triangle_steps = params->num_bvh_time_steps;
+		bparams.num_motion_curve_steps = params->num_bvh_time_steps;
+
+		/* Meshes are often synced again with the same geometry, for example
+		 * on frame changes or when only shaders changed. Keep the BVH as is
+		 * in that case. */
+		string key = bvh_key(bparams);
+
+		if(bvh && key == bvh_built_key) {
+			VLOG(2) << "Reusing BVH of mesh " << name << ", geometry unchanged.";
 		}
 		else {
-			progress->set_status(msg, "Building BVH");
+			bool refit = false;
+
+			if(bvh && !need_update_rebuild) {
+				progress->set_status(msg, "Refitting BVH");
+				bvh->objects = objects;
+				refit = bvh->refit(*progress);
+			}
 
-			BVHParams bparams;
-			bparams.use_spatial_split = params->use_bvh_spatial_split;
-			bparams.use_qbvh = params->use_qbvh;
-			bparams.use_unaligned_nodes = dscene->data.bvh.have_curves &&
-			                              params->use_bvh_unaligned_nodes;
-			bparams.num_motion_triangle_steps = params->num_bvh_time_steps;
-			bparams.num_motion_curve_steps = params->num_bvh_time_steps;
+			if(!refit) {
+				progress->set_status(msg, "Building BVH");
 
-			delete bvh;
-			bvh = BVH::create(bparams, objects);
-			MEM_GUARDED_CALL(progress, bvh->build, *progress);
+				delete bvh;
+				bvh = BVH::create(bparams, objects);
+				if(params->use_bvh_cache)
+					bvh->cache_key = key;
+				MEM_GUARDED_CALL(progress, bvh->build, *progress);
+			}
+
+			bvh_built_key = (progress->get_cancel())? "": key;
 		}
 	}
 
@@ -1124,6 +1295,7 @@ MeshManager::MeshManager()
 	bvh = NULL;
 	need_update = true;
 	need_flags_update = true;
+	bvh_build_time = 0.0;
 }
 
 MeshManager::~MeshManager()
@@ -1358,12 +1530,25 @@ void MeshManager::update_svm_attributes(Device *device, DeviceScene *dscene, Sce
 	device->tex_alloc("__attributes_map", dscene->attributes_map);
 }
 
+/* With compact meshes, triangle corner vectors and colors such as UVs are
+ * stored as half floats, two uint per element. */
+static bool attribute_use_half(Attribute *mattr, AttributePrimitive prim, bool use_compact_mesh)
+{
+	return use_compact_mesh &&
+	       prim == ATTR_PRIM_TRIANGLE &&
+	       mattr->element == ATTR_ELEMENT_CORNER &&
+	       mattr->type != TypeDesc::TypeFloat &&
+	       mattr->type != TypeDesc::TypeMatrix;
+}
+
 static void update_attribute_element_size(Mesh *mesh,
                                           Attribute *mattr,
                                           AttributePrimitive prim,
+                                          bool use_compact_mesh,
                                           size_t *attr_float_size,
                                           size_t *attr_float3_size,
-                                          size_t *attr_uchar4_size)
+                                          size_t *attr_uchar4_size,
+                                          size_t *attr_half_size)
 {
 	if(mattr) {
 		size_t size = mattr->element_size(mesh, prim);
@@ -1374,6 +1559,9 @@ static void update_attribute_element_size(Mesh *mesh,
 		else if(mattr->element == ATTR_ELEMENT_CORNER_BYTE) {
 			*attr_uchar4_size += size;
 		}
+		else if(attribute_use_half(mattr, prim, use_compact_mesh)) {
+			*attr_half_size += size * 2;
+		}
 		else if(mattr->type == TypeDesc::TypeFloat) {
 			*attr_float_size += size;
 		}
@@ -1393,8 +1581,11 @@ static void update_attribute_element_offset(Mesh *mesh,
                                             size_t& attr_float3_offset,
                                             vector<uchar4>& attr_uchar4,
                                             size_t& attr_uchar4_offset,
+                                            vector<uint>& attr_half,
+                                            size_t& attr_half_offset,
                                             Attribute *mattr,
                                             AttributePrimitive prim,
+                                            bool use_compact_mesh,
                                             TypeDesc& type,
                                             AttributeDescriptor& desc)
 {
@@ -1425,6 +1616,19 @@ static void update_attribute_element_offset(Mesh *mesh,
 			}
 			attr_uchar4_offset += size;
 		}
+		else if(attribute_use_half(mattr, prim, use_compact_mesh)) {
+			float4 *data = mattr->data_float4();
+			offset = attr_half_offset/2;
+			element = ATTR_ELEMENT_CORNER_HALF;
+
+			assert(attr_half.capacity() >= attr_half_offset + size * 2);
+			for(size_t k = 0; k < size; k++) {
+				uint *h = &attr_half[attr_half_offset + k*2];
+				h[0] = float_to_half_bits(data[k].x) | (float_to_half_bits(data[k].y) << 16);
+				h[1] = float_to_half_bits(data[k].z) | (float_to_half_bits(data[k].w) << 16);
+			}
+			attr_half_offset += size * 2;
+		}
 		else if(mattr->type == TypeDesc::TypeFloat) {
 			float *data = mattr->data_float();
 			offset = attr_float_offset;
@@ -1472,7 +1676,10 @@ static void update_attribute_element_offset(Mesh *mesh,
 			else
 				offset -= mesh->face_offset;
 		}
-		else if(element == ATTR_ELEMENT_CORNER || element == ATTR_ELEMENT_CORNER_BYTE) {
+		else if(element == ATTR_ELEMENT_CORNER ||
+		        element == ATTR_ELEMENT_CORNER_BYTE ||
+		        element == ATTR_ELEMENT_CORNER_HALF)
+		{
 			if(prim == ATTR_PRIM_TRIANGLE)
 				offset -= 3*mesh->tri_offset;
 			else
@@ -1521,6 +1728,8 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 	size_t attr_float_size = 0;
 	size_t attr_float3_size = 0;
 	size_t attr_uchar4_size = 0;
+	size_t attr_half_size = 0;
+	bool use_compact_mesh = scene->params.use_compact_mesh;
 	for(size_t i = 0; i < scene->meshes.size(); i++) {
 		Mesh *mesh = scene->meshes[i];
 		AttributeRequestSet& attributes = mesh_attributes[i];
@@ -1532,31 +1741,39 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			update_attribute_element_size(mesh,
 			                              triangle_mattr,
 			                              ATTR_PRIM_TRIANGLE,
+			                              use_compact_mesh,
 			                              &attr_float_size,
 			                              &attr_float3_size,
-			                              &attr_uchar4_size);
+			                              &attr_uchar4_size,
+			                              &attr_half_size);
 			update_attribute_element_size(mesh,
 			                              curve_mattr,
 			                              ATTR_PRIM_CURVE,
+			                              use_compact_mesh,
 			                              &attr_float_size,
 			                              &attr_float3_size,
-			                              &attr_uchar4_size);
+			                              &attr_uchar4_size,
+			                              &attr_half_size);
 			update_attribute_element_size(mesh,
 			                              subd_mattr,
 			                              ATTR_PRIM_SUBD,
+			                              use_compact_mesh,
 			                              &attr_float_size,
 			                              &attr_float3_size,
-			                              &attr_uchar4_size);
+			                              &attr_uchar4_size,
+			                              &attr_half_size);
 		}
 	}
 
 	vector<float> attr_float(attr_float_size);
 	vector<float4> attr_float3(attr_float3_size);
 	vector<uchar4> attr_uchar4(attr_uchar4_size);
+	vector<uint> attr_half(attr_half_size);
 
 	size_t attr_float_offset = 0;
 	size_t attr_float3_offset = 0;
 	size_t attr_uchar4_offset = 0;
+	size_t attr_half_offset = 0;
 
 	/* Fill in attributes. */
 	for(size_t i = 0; i < scene->meshes.size(); i++) {
@@ -1574,8 +1791,10 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			                                attr_float, attr_float_offset,
 			                                attr_float3, attr_float3_offset,
 			                                attr_uchar4, attr_uchar4_offset,
+			                                attr_half, attr_half_offset,
 			                                triangle_mattr,
 			                                ATTR_PRIM_TRIANGLE,
+			                                use_compact_mesh,
 			                                req.triangle_type,
 			                                req.triangle_desc);
 
@@ -1583,8 +1802,10 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			                                attr_float, attr_float_offset,
 			                                attr_float3, attr_float3_offset,
 			                                attr_uchar4, attr_uchar4_offset,
+			                                attr_half, attr_half_offset,
 			                                curve_mattr,
 			                                ATTR_PRIM_CURVE,
+			                                use_compact_mesh,
 			                                req.curve_type,
 			                                req.curve_desc);
 
@@ -1592,8 +1813,10 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			                                attr_float, attr_float_offset,
 			                                attr_float3, attr_float3_offset,
 			                                attr_uchar4, attr_uchar4_offset,
+			                                attr_half, attr_half_offset,
 			                                subd_mattr,
 			                                ATTR_PRIM_SUBD,
+			                                use_compact_mesh,
 			                                req.subd_type,
 			                                req.subd_desc);
 
@@ -1624,6 +1847,16 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 		dscene->attributes_uchar4.copy(&attr_uchar4[0], attr_uchar4.size());
 		device->tex_alloc("__attributes_uchar4", dscene->attributes_uchar4);
 	}
+	if(attr_half.size()) {
+		dscene->attributes_half.copy(&attr_half[0], attr_half.size());
+		device->tex_alloc("__attributes_half", dscene->attributes_half);
+
+		VLOG(1) << "Compact mesh corner attributes: "
+		        << string_human_readable_size(attr_half.size()*sizeof(uint))
+		        << " instead of "
+		        << string_human_readable_size(attr_half.size()/2*sizeof(float4))
+		        << ".";
+	}
 }
 
 void MeshManager::mesh_calc_offset(Scene *scene)
@@ -1728,12 +1961,26 @@ void MeshManager::device_update_mesh(Device *device,
 	}
 
 	/* Fill in all the arrays. */
+	bool use_compact_mesh = scene->params.use_compact_mesh;
+	dscene->data.bvh.use_compact_mesh = use_compact_mesh;
+
 	if(tri_size != 0) {
 		/* normals */
 		progress.set_status("Updating Mesh", "Computing normals");
 
+		/* compact normals are packed from a temporary array */
+		vector<float4> vnormal_full;
+		float4 *vnormal;
+
+		if(use_compact_mesh) {
+			vnormal_full.resize(vert_size);
+			vnormal = &vnormal_full[0];
+		}
+		else {
+			vnormal = dscene->tri_vnormal.resize(vert_size);
+		}
+
 		uint *tri_shader = dscene->tri_shader.resize(tri_size);
-		float4 *vnormal = dscene->tri_vnormal.resize(vert_size);
 		uint4 *tri_vindex = dscene->tri_vindex.resize(tri_size);
 		uint *tri_patch = dscene->tri_patch.resize(tri_size);
 		float2 *tri_patch_uv = dscene->tri_patch_uv.resize(vert_size);
@@ -1751,28 +1998,76 @@ void MeshManager::device_update_mesh(Device *device,
 			if(progress.get_cancel()) return;
 		}
 
+		if(use_compact_mesh) {
+			uint *vnormal_packed = dscene->tri_vnormal_packed.resize(vert_size);
+
+			for(size_t i = 0; i < vert_size; i++)
+				vnormal_packed[i] = float3_to_octahedral(float4_to_float3(vnormal[i]));
+
+			VLOG(1) << "Compact mesh vertex normals: "
+			        << string_human_readable_size(vert_size*sizeof(uint))
+			        << " instead of "
+			        << string_human_readable_size(vert_size*sizeof(float4))
+			        << ".";
+		}
+
 		/* vertex coordinates */
 		progress.set_status("Updating Mesh", "Copying Mesh to device");
 
 		device->tex_alloc("__tri_shader", dscene->tri_shader);
-		device->tex_alloc("__tri_vnormal", dscene->tri_vnormal);
+		if(use_compact_mesh)
+			device->tex_alloc("__tri_vnormal_packed", dscene->tri_vnormal_packed);
+		else
+			device->tex_alloc("__tri_vnormal", dscene->tri_vnormal);
 		device->tex_alloc("__tri_vindex", dscene->tri_vindex);
 		device->tex_alloc("__tri_patch", dscene->tri_patch);
 		device->tex_alloc("__tri_patch_uv", dscene->tri_patch_uv);
 	}
 
+	bool use_compact_curves = scene->params.use_compact_curves;
+	dscene->data.bvh.use_compact_curves = use_compact_curves;
+
 	if(curve_size != 0) {
 		progress.set_status("Updating Mesh", "Copying Strands to device");
 
-		float4 *curve_keys = dscene->curve_keys.resize(curve_key_size);
 		float4 *curves = dscene->curves.resize(curve_size);
 
-		foreach(Mesh *mesh, scene->meshes) {
-			mesh->pack_curves(scene, &curve_keys[mesh->curvekey_offset], &curves[mesh->curve_offset], mesh->curvekey_offset);
-			if(progress.get_cancel()) return;
+		if(use_compact_curves) {
+			uint *curve_keys_packed = dscene->curve_keys_packed.resize(curve_key_size*2);
+			float4 *curve_key_bounds = dscene->curve_key_bounds.resize(curve_size);
+			float max_radius_error = 0.0f;
+
+			foreach(Mesh *mesh, scene->meshes) {
+				mesh->pack_curves(scene, NULL, &curves[mesh->curve_offset], mesh->curvekey_offset);
+				mesh->pack_curve_keys_compact(&curve_keys_packed[mesh->curvekey_offset*2],
+				                              &curve_key_bounds[mesh->curve_offset],
+				                              &curves[mesh->curve_offset],
+				                              &max_radius_error);
+				if(progress.get_cancel()) return;
+			}
+
+			VLOG(1) << "Compact curve keys: "
+			        << string_human_readable_size(curve_key_size*2*sizeof(uint) +
+			                                      curve_size*sizeof(float4))
+			        << " instead of "
+			        << string_human_readable_size(curve_key_size*sizeof(float4))
+			        << ", radius reduced by up to "
+			        << max_radius_error*100.0f << "%.";
+
+			device->tex_alloc("__curve_keys_packed", dscene->curve_keys_packed);
+			device->tex_alloc("__curve_key_bounds", dscene->curve_key_bounds);
+		}
+		else {
+			float4 *curve_keys = dscene->curve_keys.resize(curve_key_size);
+
+			foreach(Mesh *mesh, scene->meshes) {
+				mesh->pack_curves(scene, &curve_keys[mesh->curvekey_offset], &curves[mesh->curve_offset], mesh->curvekey_offset);
+				if(progress.get_cancel()) return;
+			}
+
+			device->tex_alloc("__curve_keys", dscene->curve_keys);
 		}
 
-		device->tex_alloc("__curve_keys", dscene->curve_keys);
 		device->tex_alloc("__curves", dscene->curves);
 	}
 
@@ -1809,26 +2104,104 @@ void MeshManager::device_update_mesh(Device *device,
 	}
 }
 
-void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
+/* Content hash of the scene BVH. Instanced meshes are only referenced by
+ * their bounds, their own BVHs are merged in after building. */
+string MeshManager::bvh_key(Scene *scene, const BVHParams& bparams)
+{
+	MD5Hash md5;
+
+	bvh_key_append(md5, bparams);
+
+	foreach(Object *object, scene->objects) {
+		Mesh *mesh = object->mesh;
+		const bool instanced = mesh->need_build_bvh();
+
+		bvh_key_append(md5, &object->visibility, sizeof(object->visibility));
+		bvh_key_append(md5, &instanced, sizeof(instanced));
+
+		if(instanced) {
+			bvh_key_append(md5, &object->bounds.min, 1);
+			bvh_key_append(md5, &object->bounds.max, 1);
+		}
+		else {
+			string mesh_key = mesh->bvh_key(bparams);
+			bvh_key_append(md5, mesh_key.c_str(), mesh_key.size());
+		}
+	}
+
+	return md5.get_hex();
+}
+
+/* Mesh of every object as included in the scene BVH, NULL for meshes which
+ * have their own BVH and are only referenced by their bounds. */
+static void bvh_object_meshes(const vector<Object*>& objects, vector<Mesh*>& meshes)
 {
-	/* bvh build */
-	progress.set_status("Updating Scene BVH", "Building");
+	meshes.clear();
 
-	VLOG(1) << (scene->params.use_qbvh ? "Using QBVH optimization structure"
-	                                   : "Using regular BVH optimization structure");
+	foreach(Object *object, objects) {
+		meshes.push_back(object->mesh->need_build_bvh()? NULL: object->mesh);
+	}
+}
+
+void MeshManager::device_update_bvh(Device *device,
+                                    DeviceScene *dscene,
+                                    Scene *scene,
+                                    bool topology_changed,
+                                    Progress& progress)
+{
+	if(scene->params.use_obvh) {
+		VLOG(1) << "Using OBVH optimization structure";
+	}
+	else {
+		VLOG(1) << (scene->params.use_qbvh ? "Using QBVH optimization structure"
+		                                   : "Using regular BVH optimization structure");
+	}
 
 	BVHParams bparams;
 	bparams.top_level = true;
 	bparams.use_qbvh = scene->params.use_qbvh;
+	bparams.use_obvh = scene->params.use_obvh;
 	bparams.use_spatial_split = scene->params.use_bvh_spatial_split;
 	bparams.use_unaligned_nodes = dscene->data.bvh.have_curves &&
 	                              scene->params.use_bvh_unaligned_nodes;
 	bparams.num_motion_triangle_steps = scene->params.num_bvh_time_steps;
 	bparams.num_motion_curve_steps = scene->params.num_bvh_time_steps;
 
-	delete bvh;
-	bvh = BVH::create(bparams, scene->objects);
-	bvh->build(progress);
+	/* The tree can be refitted when primitives only moved, which is common
+	 * for deforming meshes in animations. */
+	vector<Mesh*> meshes;
+	bvh_object_meshes(scene->objects, meshes);
+
+	bool refit = false;
+
+	if(bvh &&
+	   !topology_changed &&
+	   bvh->objects == scene->objects &&
+	   bvh_meshes == meshes &&
+	   bvh->params.use_qbvh == bparams.use_qbvh &&
+	   bvh->params.use_obvh == bparams.use_obvh &&
+	   bvh->params.use_unaligned_nodes == bparams.use_unaligned_nodes)
+	{
+		progress.set_status("Updating Scene BVH", "Refitting");
+		refit = bvh->refit(progress);
+		VLOG(1) << (refit ? "Refitted scene BVH."
+		                  : "Scene BVH refit rejected, rebuilding.");
+	}
+
+	if(!refit) {
+		progress.set_status("Updating Scene BVH", "Building");
+
+		delete bvh;
+		bvh = BVH::create(bparams, scene->objects);
+		if(scene->params.use_bvh_cache)
+			bvh->cache_key = bvh_key(scene, bparams);
+		bvh->build(progress);
+		bvh_meshes = meshes;
+	}
+
+	/* all mesh and scene BVHs are written at this point */
+	if(scene->params.use_bvh_cache)
+		BVH::cache_trim();
 
 	if(progress.get_cancel()) return;
 
@@ -1876,6 +2249,7 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 
 	dscene->data.bvh.root = pack.root_index;
 	dscene->data.bvh.use_qbvh = scene->params.use_qbvh;
+	dscene->data.bvh.use_obvh = scene->params.use_obvh;
 }
 
 void MeshManager::device_update_flags(Device * /*device*/,
@@ -1953,6 +2327,8 @@ void MeshManager::device_update_displacement_images(Device *device,
 
 void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
 {
+	bvh_build_time = 0.0;
+
 	if(!need_update)
 		return;
 
@@ -2074,13 +2450,18 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 	/* Update bvh. */
 	size_t num_bvh = 0;
+	bool topology_changed = false;
 	foreach(Mesh *mesh, scene->meshes) {
 		if(mesh->need_update && mesh->need_build_bvh()) {
 			num_bvh++;
 		}
+		if(mesh->need_update && mesh->need_update_rebuild) {
+			topology_changed = true;
+		}
 	}
 
 	TaskPool pool;
+	double bvh_start_time = time_dt();
 
 	i = 0;
 	foreach(Mesh *mesh, scene->meshes) {
@@ -2103,6 +2484,8 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 	VLOG(2) << "Objects BVH build pool statistics:\n"
 	        << summary.full_report();
 
+	bvh_build_time += time_dt() - bvh_start_time;
+
 	foreach(Shader *shader, scene->shaders) {
 		shader->need_update_attributes = false;
 	}
@@ -2120,9 +2503,15 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 		object->compute_bounds(motion_blur);
 	}
 
+	/* path guiding caches cover the object bounds */
+	if(scene->integrator->use_path_guiding)
+		scene->integrator->need_update = true;
+
 	if(progress.get_cancel()) return;
 
-	device_update_bvh(device, dscene, scene, progress);
+	bvh_start_time = time_dt();
+	device_update_bvh(device, dscene, scene, topology_changed, progress);
+	bvh_build_time += time_dt() - bvh_start_time;
 	if(progress.get_cancel()) return;
 
 	device_update_mesh(device, dscene, scene, false, progress);
@@ -2154,16 +2543,20 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	device->tex_free(dscene->prim_object);
 	device->tex_free(dscene->tri_shader);
 	device->tex_free(dscene->tri_vnormal);
+	device->tex_free(dscene->tri_vnormal_packed);
 	device->tex_free(dscene->tri_vindex);
 	device->tex_free(dscene->tri_patch);
 	device->tex_free(dscene->tri_patch_uv);
 	device->tex_free(dscene->curves);
 	device->tex_free(dscene->curve_keys);
+	device->tex_free(dscene->curve_keys_packed);
+	device->tex_free(dscene->curve_key_bounds);
 	device->tex_free(dscene->patches);
 	device->tex_free(dscene->attributes_map);
 	device->tex_free(dscene->attributes_float);
 	device->tex_free(dscene->attributes_float3);
 	device->tex_free(dscene->attributes_uchar4);
+	device->tex_free(dscene->attributes_half);
 
 	dscene->bvh_nodes.clear();
 	dscene->object_node.clear();
@@ -2175,16 +2568,20 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	dscene->prim_object.clear();
 	dscene->tri_shader.clear();
 	dscene->tri_vnormal.clear();
+	dscene->tri_vnormal_packed.clear();
 	dscene->tri_vindex.clear();
 	dscene->tri_patch.clear();
 	dscene->tri_patch_uv.clear();
 	dscene->curves.clear();
 	dscene->curve_keys.clear();
+	dscene->curve_keys_packed.clear();
+	dscene->curve_key_bounds.clear();
 	dscene->patches.clear();
 	dscene->attributes_map.clear();
 	dscene->attributes_float.clear();
 	dscene->attributes_float3.clear();
 	dscene->attributes_uchar4.clear();
+	dscene->attributes_half.clear();
 
 #ifdef WITH_OSL
 	OSLGlobals *og = (OSLGlobals*)device->osl_memory();
@@ -33,6 +33,7 @@ CCL_NAMESPACE_BEGIN
 
 class Attribute;
 class BVH;
+class BVHParams;
 class Device;
 class DeviceScene;
 class Mesh;
@@ -234,6 +235,8 @@ public:
 
 	/* BVH */
 	BVH *bvh;
+	/* Hash of the geometry and parameters bvh was built from, see bvh_key(). */
+	string bvh_built_key;
 	size_t tri_offset;
 	size_t vert_offset;
 
@@ -279,6 +282,10 @@ public:
 	                size_t vert_offset,
 	                size_t tri_offset);
 	void pack_curves(Scene *scene, float4 *curve_key_co, float4 *curve_data, size_t curvekey_offset);
+	void pack_curve_keys_compact(uint *curve_keys_packed,
+	                             float4 *curve_key_bounds,
+	                             float4 *curve_data,
+	                             float *max_radius_error);
 	void pack_patches(uint *patch_data, uint vert_offset, uint face_offset, uint corner_offset);
 
 	void compute_bvh(DeviceScene *dscene,
@@ -286,6 +293,9 @@ public:
 	                 Progress *progress,
 	                 int n,
 	                 int total);
+	/* Content hash of everything the own BVH of the mesh depends on, used
+	 * to reuse the BVH when the mesh is synced again without changes. */
+	string bvh_key(const BVHParams& bparams) const;
 
 	bool need_attribute(Scene *scene, AttributeStandard std);
 	bool need_attribute(Scene *scene, ustring name);
@@ -316,10 +326,15 @@ public:
 class MeshManager {
 public:
 	BVH *bvh;
+	/* Meshes the scene BVH was built for, to detect when it can be refitted. */
+	vector<Mesh*> bvh_meshes;
 
 	bool need_update;
 	bool need_flags_update;
 
+	/* time spent building BVHs in the last update, in seconds */
+	double bvh_build_time;
+
 	MeshManager();
 	~MeshManager();
 
@@ -331,6 +346,10 @@ public:
 
 	void device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
 	void device_update_flags(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
+	void device_update_displacement_images(Device *device,
+	                                       DeviceScene *dscene,
+	                                       Scene *scene,
+	                                       Progress& progress);
 
 	void device_free(Device *device, DeviceScene *dscene);
 
@@ -356,15 +375,15 @@ protected:
 	                              Scene *scene,
 	                              Progress& progress);
 
+	/* content hash of the scene BVH for the disk cache */
+	string bvh_key(Scene *scene, const BVHParams& bparams);
+
 	void device_update_bvh(Device *device,
 	                       DeviceScene *dscene,
 	                       Scene *scene,
+	                       bool topology_changed,
 	                       Progress& progress);
 
-	void device_update_displacement_images(Device *device,
-	                                       DeviceScene *dscene,
-	                                       Scene *scene,
-	                                       Progress& progress);
 };
 
 CCL_NAMESPACE_END
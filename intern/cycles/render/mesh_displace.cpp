@@ -26,6 +26,9 @@
 
 CCL_NAMESPACE_BEGIN
 
+/* Maximum number of vertices displaced by a single device task. */
+#define DISPLACE_CHUNK_SIZE (1024*1024)
+
 static float3 compute_face_normal(const Mesh::Triangle& t, float3 *verts)
 {
 	float3 v0 = verts[t.v[0]];
@@ -61,125 +64,131 @@ bool MeshManager::displace(Device *device, DeviceScene *dscene, Scene *scene, Me
 		}
 	}
 
-	/* setup input for device task */
+	/* Vertices are displaced in chunks, so the device memory used does not
+	 * grow with the number of vertices of finely diced meshes. */
 	const size_t num_verts = mesh->verts.size();
-	vector<bool> done(num_verts, false);
-	device_vector<uint4> d_input;
-	uint4 *d_input_data = d_input.resize(num_verts);
-	size_t d_input_size = 0;
+	const size_t num_triangles = mesh->num_triangles();
+	const size_t chunk_size = min(num_triangles*3, (size_t)DISPLACE_CHUNK_SIZE);
 
-	size_t num_triangles = mesh->num_triangles();
-	for(size_t i = 0; i < num_triangles; i++) {
-		Mesh::Triangle t = mesh->get_triangle(i);
-		int shader_index = mesh->shader[i];
-		Shader *shader = (shader_index < mesh->used_shaders.size()) ?
-			mesh->used_shaders[shader_index] : scene->default_surface;
-
-		if(!shader->has_displacement || shader->displacement_method == DISPLACE_BUMP) {
-			continue;
-		}
-
-		for(int j = 0; j < 3; j++) {
-			if(done[t.v[j]])
-				continue;
-
-			done[t.v[j]] = true;
-
-			/* set up object, primitive and barycentric coordinates */
-			int object = object_index;
-			int prim = mesh->tri_offset + i;
-			float u, v;
-			
-			switch(j) {
-				case 0:
-					u = 1.0f;
-					v = 0.0f;
-					break;
-				case 1:
-					u = 0.0f;
-					v = 1.0f;
-					break;
-				default:
-					u = 0.0f;
-					v = 0.0f;
-					break;
-			}
+	if(num_triangles == 0)
+		return false;
 
-			/* back */
-			uint4 in = make_uint4(object, prim, __float_as_int(u), __float_as_int(v));
-			d_input_data[d_input_size++] = in;
-		}
-	}
+	vector<bool> done(num_verts, false);
+	vector<int> chunk_verts(chunk_size);
 
-	if(d_input_size == 0)
-		return false;
-	
-	/* run device task */
+	device_vector<uint4> d_input;
 	device_vector<float4> d_output;
-	d_output.resize(d_input_size);
+	uint4 *d_input_data = d_input.resize(chunk_size);
+	float4 *offset = d_output.resize(chunk_size);
 
 	/* needs to be up to data for attribute access */
 	device->const_copy_to("__data", &dscene->data, sizeof(dscene->data));
 
 	device->mem_alloc(d_input, MEM_READ_ONLY);
-	device->mem_copy_to(d_input);
 	device->mem_alloc(d_output, MEM_WRITE_ONLY);
 
-	DeviceTask task(DeviceTask::SHADER);
-	task.shader_input = d_input.device_pointer;
-	task.shader_output = d_output.device_pointer;
-	task.shader_eval_type = SHADER_EVAL_DISPLACE;
-	task.shader_x = 0;
-	task.shader_w = d_output.size();
-	task.num_samples = 1;
-	task.get_cancel = function_bind(&Progress::get_cancel, &progress);
-
-	device->task_add(task);
-	device->task_wait();
-
-	if(progress.get_cancel()) {
-		device->mem_free(d_input);
-		device->mem_free(d_output);
-		return false;
-	}
+	Attribute *attr_mP = mesh->attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
+	size_t num_displaced = 0;
+	size_t i = 0;
 
-	device->mem_copy_from(d_output, 0, 1, d_output.size(), sizeof(float4));
-	device->mem_free(d_input);
-	device->mem_free(d_output);
+	while(i < num_triangles) {
+		/* setup input for device task */
+		size_t d_input_size = 0;
+
+		for(; i < num_triangles && d_input_size + 3 <= chunk_size; i++) {
+			Mesh::Triangle t = mesh->get_triangle(i);
+			int shader_index = mesh->shader[i];
+			Shader *shader = (shader_index < mesh->used_shaders.size()) ?
+				mesh->used_shaders[shader_index] : scene->default_surface;
 
-	/* read result */
-	done.clear();
-	done.resize(num_verts, false);
-	int k = 0;
+			if(!shader->has_displacement || shader->displacement_method == DISPLACE_BUMP) {
+				continue;
+			}
 
-	float4 *offset = (float4*)d_output.data_pointer;
+			for(int j = 0; j < 3; j++) {
+				if(done[t.v[j]])
+					continue;
 
-	Attribute *attr_mP = mesh->attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
-	for(size_t i = 0; i < num_triangles; i++) {
-		Mesh::Triangle t = mesh->get_triangle(i);
-		int shader_index = mesh->shader[i];
-		Shader *shader = (shader_index < mesh->used_shaders.size()) ?
-			mesh->used_shaders[shader_index] : scene->default_surface;
+				done[t.v[j]] = true;
+
+				/* set up object, primitive and barycentric coordinates */
+				int object = object_index;
+				int prim = mesh->tri_offset + i;
+				float u, v;
+
+				switch(j) {
+					case 0:
+						u = 1.0f;
+						v = 0.0f;
+						break;
+					case 1:
+						u = 0.0f;
+						v = 1.0f;
+						break;
+					default:
+						u = 0.0f;
+						v = 0.0f;
+						break;
+				}
+
+				/* back */
+				uint4 in = make_uint4(object, prim, __float_as_int(u), __float_as_int(v));
+				chunk_verts[d_input_size] = t.v[j];
+				d_input_data[d_input_size++] = in;
+			}
+		}
 
-		if(!shader->has_displacement || shader->displacement_method == DISPLACE_BUMP) {
+		if(d_input_size == 0)
 			continue;
+
+		/* run device task */
+		device->mem_copy_to(d_input);
+
+		DeviceTask task(DeviceTask::SHADER);
+		task.shader_input = d_input.device_pointer;
+		task.shader_output = d_output.device_pointer;
+		task.shader_eval_type = SHADER_EVAL_DISPLACE;
+		task.shader_x = 0;
+		task.shader_w = d_input_size;
+		task.num_samples = 1;
+		task.get_cancel = function_bind(&Progress::get_cancel, &progress);
+
+		device->task_add(task);
+		device->task_wait();
+
+		if(progress.get_cancel()) {
+			device->mem_free(d_input);
+			device->mem_free(d_output);
+			return false;
 		}
 
-		for(int j = 0; j < 3; j++) {
-			if(!done[t.v[j]]) {
-				done[t.v[j]] = true;
-				float3 off = float4_to_float3(offset[k++]);
-				mesh->verts[t.v[j]] += off;
-				if(attr_mP != NULL) {
-					for(int step = 0; step < mesh->motion_steps - 1; step++) {
-						float3 *mP = attr_mP->data_float3() + step*num_verts;
-						mP[t.v[j]] += off;
-					}
+		device->mem_copy_from(d_output, 0, 1, d_input_size, sizeof(float4));
+
+		/* read result */
+		for(size_t k = 0; k < d_input_size; k++) {
+			int vert = chunk_verts[k];
+			float3 off = float4_to_float3(offset[k]);
+			mesh->verts[vert] += off;
+			if(attr_mP != NULL) {
+				for(int step = 0; step < mesh->motion_steps - 1; step++) {
+					float3 *mP = attr_mP->data_float3() + step*num_verts;
+					mP[vert] += off;
 				}
 			}
 		}
+
+		num_displaced += d_input_size;
+
+		progress.set_status("Updating Mesh",
+		                    string_printf("%s (%d%%)", msg.c_str(), (int)(i*100/num_triangles)));
 	}
 
+	device->mem_free(d_input);
+	device->mem_free(d_output);
+
+	if(num_displaced == 0)
+		return false;
+
 	/* for displacement method both, we only need to recompute the face
 	 * normals, as bump mapping in the shader will already alter the
 	 * vertex normal, so we start from the non-displaced vertex normals
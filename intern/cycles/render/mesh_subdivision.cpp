@@ -22,8 +22,10 @@
 #include "subd_patch.h"
 #include "subd_patch_table.h"
 
+#include "util_atomic.h"
 #include "util_foreach.h"
 #include "util_algorithm.h"
+#include "util_task.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -335,59 +337,89 @@ struct OsdPatch : Patch {
 
 #endif
 
-void Mesh::tessellate(DiagSplit *split)
-{
-#ifdef WITH_OPENSUBDIV
-	OsdData osd_data;
-	bool need_packed_patch_table = false;
+/* Tessellation
+ *
+ * Faces are split into subpatches in parallel, a range of faces per task with
+ * its own DiagSplit. The number of verts and triangles of each subpatch follows
+ * from its edge factors, so the mesh is resized once and every range of
+ * subpatches gets a fixed place in it, the result does not depend on the number
+ * of threads. Ranges are then diced in parallel, each into a buffer that is
+ * copied into the mesh and freed right away. Split ranges are freed as soon as
+ * all of their subpatches are diced. */
+
+#define SUBD_SPLIT_RANGE_SIZE 16
+#define SUBD_DICE_RANGE_SIZE 16
+
+struct SubdSplitRange {
+	SubdSplitRange(const SubdParams& params, int start_, int end_)
+	: split(params), start(start_), end(end_)
+	{
+	}
 
-	if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
-		if(subd_faces.size()) {
-			osd_data.build_from_mesh(this);
+	~SubdSplitRange()
+	{
+		foreach(Patch *patch, patches) {
+			delete patch;
 		}
 	}
-	else
+
+	DiagSplit split;
+	int start, end;
+	/* patches referenced by the subpatches */
+	vector<Patch*> patches;
+	/* dice ranges still using the subpatches */
+	size_t num_dice_ranges;
+#ifdef WITH_OPENSUBDIV
+	OsdData *osd_data;
 #endif
-	{
-		/* force linear subdivision if OpenSubdiv is unavailable to avoid
-		 * falling into catmull-clark code paths by accident
-		 */
-		subdivision_type = SUBDIVISION_LINEAR;
+};
 
-		/* force disable attribute subdivision for same reason as above */
-		foreach(Attribute& attr, subd_attributes.attributes) {
-			attr.flags &= ~ATTR_SUBDIVIDED;
-		}
+struct SubdDiceRange {
+	SubdDiceRange(SubdSplitRange *split_range_, size_t start_, size_t end_)
+	: split_range(split_range_), start(start_), end(end_), vert_offset(0), tri_offset(0)
+	{
+		split_range->split.dice_size(start, end, &num_verts, &num_triangles);
 	}
 
-	int num_faces = subd_faces.size();
+	SubdSplitRange *split_range;
+	size_t start, end;
+	/* where the diced geometry goes in the mesh */
+	size_t vert_offset, tri_offset;
+	size_t num_verts, num_triangles;
+};
 
-	Attribute *attr_vN = subd_attributes.find(ATTR_STD_VERTEX_NORMAL);
+static void tessellate_split(Mesh *mesh, SubdSplitRange *range)
+{
+	DiagSplit *split = &range->split;
+
+	Attribute *attr_vN = mesh->subd_attributes.find(ATTR_STD_VERTEX_NORMAL);
 	float3* vN = attr_vN->data_float3();
 
-	for(int f = 0; f < num_faces; f++) {
-		SubdFace& face = subd_faces[f];
+	const array<float3>& verts = mesh->verts;
+	const array<int>& subd_face_corners = mesh->subd_face_corners;
+
+	for(int f = range->start; f < range->end; f++) {
+		Mesh::SubdFace& face = mesh->subd_faces[f];
 
 		if(face.is_quad()) {
 			/* quad */
 			QuadDice::SubPatch subpatch;
 
-			LinearQuadPatch quad_patch;
 #ifdef WITH_OPENSUBDIV
-			OsdPatch osd_patch(&osd_data);
-
-			if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
-				osd_patch.patch_index = face.ptex_offset;
+			if(mesh->subdivision_type == Mesh::SUBDIVISION_CATMULL_CLARK) {
+				OsdPatch *osd_patch = new OsdPatch(range->osd_data);
+				osd_patch->patch_index = face.ptex_offset;
 
-				subpatch.patch = &osd_patch;
+				subpatch.patch = osd_patch;
 			}
 			else
 #endif
 			{
-				float3 *hull = quad_patch.hull;
-				float3 *normals = quad_patch.normals;
+				LinearQuadPatch *quad_patch = new LinearQuadPatch();
+				float3 *hull = quad_patch->hull;
+				float3 *normals = quad_patch->normals;
 
-				quad_patch.patch_index = face.ptex_offset;
+				quad_patch->patch_index = face.ptex_offset;
 
 				for(int i = 0; i < 4; i++) {
 					hull[i] = verts[subd_face_corners[face.start_corner+i]];
@@ -399,7 +431,7 @@ void Mesh::tessellate(DiagSplit *split)
 					}
 				}
 				else {
-					float3 N = face.normal(this);
+					float3 N = face.normal(mesh);
 					for(int i = 0; i < 4; i++) {
 						normals[i] = N;
 					}
@@ -408,10 +440,11 @@ void Mesh::tessellate(DiagSplit *split)
 				swap(hull[2], hull[3]);
 				swap(normals[2], normals[3]);
 
-				subpatch.patch = &quad_patch;
+				subpatch.patch = quad_patch;
 			}
 
 			subpatch.patch->shader = face.shader;
+			range->patches.push_back(subpatch.patch);
 
 			/* Quad faces need to be split at least once to line up with split ngons, we do this
 			 * here in this manner because if we do it later edge factors may end up slightly off.
@@ -443,15 +476,15 @@ void Mesh::tessellate(DiagSplit *split)
 		else {
 			/* ngon */
 #ifdef WITH_OPENSUBDIV
-			if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
-				OsdPatch patch(&osd_data);
-
-				patch.shader = face.shader;
-
+			if(mesh->subdivision_type == Mesh::SUBDIVISION_CATMULL_CLARK) {
 				for(int corner = 0; corner < face.num_corners; corner++) {
-					patch.patch_index = face.ptex_offset + corner;
+					OsdPatch *patch = new OsdPatch(range->osd_data);
+
+					patch->shader = face.shader;
+					patch->patch_index = face.ptex_offset + corner;
+					range->patches.push_back(patch);
 
-					split->split_quad(&patch);
+					split->split_quad(patch);
 				}
 			}
 			else
@@ -467,13 +500,13 @@ void Mesh::tessellate(DiagSplit *split)
 				}
 
 				for(int corner = 0; corner < face.num_corners; corner++) {
-					LinearQuadPatch patch;
-					float3 *hull = patch.hull;
-					float3 *normals = patch.normals;
+					LinearQuadPatch *patch = new LinearQuadPatch();
+					float3 *hull = patch->hull;
+					float3 *normals = patch->normals;
 
-					patch.patch_index = face.ptex_offset + corner;
+					patch->patch_index = face.ptex_offset + corner;
 
-					patch.shader = face.shader;
+					patch->shader = face.shader;
 
 					hull[0] = verts[subd_face_corners[face.start_corner + mod(corner + 0, face.num_corners)]];
 					hull[1] = verts[subd_face_corners[face.start_corner + mod(corner + 1, face.num_corners)]];
@@ -493,17 +526,175 @@ void Mesh::tessellate(DiagSplit *split)
 						normals[2] = (normals[2] + normals[0]) * 0.5;
 					}
 					else {
-						float3 N = face.normal(this);
+						float3 N = face.normal(mesh);
 						for(int i = 0; i < 4; i++) {
 							normals[i] = N;
 						}
 					}
 
-					split->split_quad(&patch);
+					range->patches.push_back(patch);
+
+					split->split_quad(patch);
 				}
 			}
 		}
 	}
+}
+
+static void tessellate_append(Mesh *mesh, SubdDiceRange *range, const DiceBuffer& buffer)
+{
+	size_t vert_offset = range->vert_offset;
+	size_t tri_offset = range->tri_offset;
+
+	float3 *vN = mesh->attributes.find(ATTR_STD_VERTEX_NORMAL)->data_float3();
+	Attribute *attr_ptex_uv = mesh->attributes.find(ATTR_STD_PTEX_UV);
+	Attribute *attr_ptex_face_id = mesh->attributes.find(ATTR_STD_PTEX_FACE_ID);
+
+	for(size_t i = 0; i < buffer.num_verts(); i++) {
+		mesh->verts[vert_offset + i] = buffer.P[i];
+		mesh->vert_patch_uv[vert_offset + i] = buffer.uv[i];
+		vN[vert_offset + i] = buffer.N[i];
+	}
+
+	for(size_t i = 0; i < buffer.num_triangles(); i++) {
+		size_t tri = tri_offset + i;
+
+		mesh->triangles[tri*3 + 0] = vert_offset + buffer.triangles[i*3 + 0];
+		mesh->triangles[tri*3 + 1] = vert_offset + buffer.triangles[i*3 + 1];
+		mesh->triangles[tri*3 + 2] = vert_offset + buffer.triangles[i*3 + 2];
+		mesh->shader[tri] = buffer.shader[i];
+		mesh->smooth[tri] = true;
+		mesh->triangle_patch[tri] = buffer.patch_index[i];
+	}
+
+	if(attr_ptex_uv && attr_ptex_face_id && buffer.ptex_face_id.size()) {
+		float3 *ptex_uv = attr_ptex_uv->data_float3();
+		float *ptex_face_id = attr_ptex_face_id->data_float();
+
+		for(size_t i = 0; i < buffer.num_verts(); i++) {
+			ptex_uv[vert_offset + i] = make_float3(buffer.uv[i].x, buffer.uv[i].y, 0.0f);
+		}
+
+		for(size_t i = 0; i < buffer.num_triangles(); i++) {
+			ptex_face_id[tri_offset + i] = (float)buffer.ptex_face_id[i];
+		}
+	}
+}
+
+static void tessellate_dice(Mesh *mesh, SubdDiceRange *range)
+{
+	SubdSplitRange *split_range = range->split_range;
+
+	DiceBuffer buffer;
+	split_range->split.dice(&buffer, range->start, range->end);
+
+	assert(buffer.num_verts() == range->num_verts);
+	assert(buffer.num_triangles() == range->num_triangles);
+
+	tessellate_append(mesh, range, buffer);
+	delete range;
+
+	/* the last range diced from the subpatches frees them */
+	if(atomic_sub_and_fetch_z(&split_range->num_dice_ranges, 1) == 0) {
+		delete split_range;
+	}
+}
+
+void Mesh::tessellate(DiagSplit *split)
+{
+#ifdef WITH_OPENSUBDIV
+	OsdData osd_data;
+	bool need_packed_patch_table = false;
+
+	if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
+		if(subd_faces.size()) {
+			osd_data.build_from_mesh(this);
+		}
+	}
+	else
+#endif
+	{
+		/* force linear subdivision if OpenSubdiv is unavailable to avoid
+		 * falling into catmull-clark code paths by accident
+		 */
+		subdivision_type = SUBDIVISION_LINEAR;
+
+		/* force disable attribute subdivision for same reason as above */
+		foreach(Attribute& attr, subd_attributes.attributes) {
+			attr.flags &= ~ATTR_SUBDIVIDED;
+		}
+	}
+
+	int num_faces = subd_faces.size();
+	const SubdParams& params = split->params;
+	TaskPool pool;
+
+	/* split faces into subpatches */
+	vector<SubdSplitRange*> split_ranges;
+
+	for(int start = 0; start < num_faces; start += SUBD_SPLIT_RANGE_SIZE) {
+		SubdSplitRange *range = new SubdSplitRange(params,
+		                                           start,
+		                                           min(start + SUBD_SPLIT_RANGE_SIZE, num_faces));
+#ifdef WITH_OPENSUBDIV
+		range->osd_data = &osd_data;
+#endif
+		split_ranges.push_back(range);
+		pool.push(function_bind(&tessellate_split, this, range));
+	}
+
+	pool.wait_work();
+
+	/* place the diced geometry of subpatches in the mesh, in order of the
+	 * faces they come from */
+	vector<SubdDiceRange*> dice_ranges;
+	size_t num_verts = verts.size();
+	size_t num_tris = num_triangles();
+	size_t num_diced_verts = 0;
+
+	foreach(SubdSplitRange *split_range, split_ranges) {
+		size_t num_subpatches = split_range->split.subpatches_quad.size();
+
+		split_range->num_dice_ranges = (num_subpatches + SUBD_DICE_RANGE_SIZE - 1)/SUBD_DICE_RANGE_SIZE;
+
+		if(split_range->num_dice_ranges == 0) {
+			delete split_range;
+			continue;
+		}
+
+		for(size_t start = 0; start < num_subpatches; start += SUBD_DICE_RANGE_SIZE) {
+			SubdDiceRange *range = new SubdDiceRange(split_range,
+			                                         start,
+			                                         min(start + SUBD_DICE_RANGE_SIZE, num_subpatches));
+
+			range->vert_offset = num_verts + num_diced_verts;
+			range->tri_offset = num_tris;
+
+			num_diced_verts += range->num_verts;
+			num_tris += range->num_triangles;
+
+			dice_ranges.push_back(range);
+		}
+	}
+
+	split_ranges.clear();
+
+	attributes.add(ATTR_STD_VERTEX_NORMAL);
+
+	if(params.ptex) {
+		attributes.add(ATTR_STD_PTEX_UV);
+		attributes.add(ATTR_STD_PTEX_FACE_ID);
+	}
+
+	resize_mesh(num_verts + num_diced_verts, num_tris);
+	num_subd_verts += num_diced_verts;
+
+	/* dice and append, ranges and their split data free themselves */
+	foreach(SubdDiceRange *range, dice_ranges) {
+		pool.push(function_bind(&tessellate_dice, this, range));
+	}
+
+	pool.wait_work();
 
 	/* interpolate center points for attributes */
 	foreach(Attribute& attr, subd_attributes.attributes) {
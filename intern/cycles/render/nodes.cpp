@@ -293,6 +293,35 @@ void ImageTextureNode::attributes(Shader *shader, AttributeRequestSet *attribute
 	ShaderNode::attributes(shader, attributes);
 }
 
+/* Attribute the image texture coordinate is read from unchanged, so the
+ * kernel can use its differentials to pick a texture cache MIP level.
+ * ATTR_STD_NONE when the coordinate is anything else. */
+static uint image_texture_uv_attribute(SVMCompiler& compiler,
+                                       ShaderInput *vector_in,
+                                       TextureMapping& tex_mapping)
+{
+	if(!vector_in->link || !tex_mapping.skip())
+		return ATTR_STD_NONE;
+
+	ShaderNode *node = vector_in->link->parent;
+
+	if(node->type == TextureCoordinateNode::node_type) {
+		TextureCoordinateNode *texco = (TextureCoordinateNode*)node;
+		if(vector_in->link->name() == "UV" && !texco->from_dupli)
+			return compiler.attribute(ATTR_STD_UV);
+	}
+	else if(node->type == UVMapNode::node_type) {
+		UVMapNode *uvmap = (UVMapNode*)node;
+		if(!uvmap->from_dupli) {
+			if(uvmap->attribute != "")
+				return compiler.attribute(uvmap->attribute);
+			return compiler.attribute(ATTR_STD_UV);
+		}
+	}
+
+	return ATTR_STD_NONE;
+}
+
 void ImageTextureNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *vector_in = input("Vector");
@@ -319,6 +348,10 @@ void ImageTextureNode::compile(SVMCompiler& compiler)
 		int vector_offset = tex_mapping.compile_begin(compiler, vector_in);
 
 		if(projection != NODE_IMAGE_PROJ_BOX) {
+			uint uv_attr = ATTR_STD_NONE;
+			if(projection == NODE_IMAGE_PROJ_FLAT)
+				uv_attr = image_texture_uv_attribute(compiler, vector_in, tex_mapping);
+
 			compiler.add_node(NODE_TEX_IMAGE,
 				slot,
 				compiler.encode_uchar4(
@@ -326,7 +359,7 @@ void ImageTextureNode::compile(SVMCompiler& compiler)
 					compiler.stack_assign_if_linked(color_out),
 					compiler.stack_assign_if_linked(alpha_out),
 					srgb),
-				projection);
+				projection | (uv_attr << 8));
 		}
 		else {
 			compiler.add_node(NODE_TEX_IMAGE_BOX,
@@ -4256,6 +4289,20 @@ void AttributeNode::attributes(Shader *shader, AttributeRequestSet *attributes)
 	ShaderNode::attributes(shader, attributes);
 }
 
+bool AttributeNode::has_volume_grid_varying()
+{
+	switch(Attribute::name_standard(attribute.c_str())) {
+		case ATTR_STD_VOLUME_DENSITY:
+		case ATTR_STD_VOLUME_COLOR:
+		case ATTR_STD_VOLUME_FLAME:
+		case ATTR_STD_VOLUME_HEAT:
+		case ATTR_STD_VOLUME_VELOCITY:
+			return true;
+		default:
+			return false;
+	}
+}
+
 void AttributeNode::compile(SVMCompiler& compiler)
 {
 	ShaderOutput *color_out = output("Color");
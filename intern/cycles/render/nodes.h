@@ -762,6 +762,7 @@ public:
 	SHADER_NODE_CLASS(AttributeNode)
 	void attributes(Shader *shader, AttributeRequestSet *attributes);
 	bool has_spatial_varying() { return true; }
+	bool has_volume_grid_varying();
 
 	ustring attribute;
 };
@@ -1117,6 +1117,7 @@ void OSLCompiler::compile(Scene *scene, OSLGlobals *og, Shader *shader)
 		shader->has_displacement = false;
 		shader->has_surface_spatial_varying = false;
 		shader->has_volume_spatial_varying = false;
+		shader->has_volume_grid_varying_only = false;
 		shader->has_object_dependency = false;
 		shader->has_integrator_dependency = false;
 
@@ -37,6 +37,8 @@
 #include "util_guarded_allocator.h"
 #include "util_logging.h"
 #include "util_progress.h"
+#include "util_task.h"
+#include "util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -46,6 +48,9 @@ Scene::Scene(const SceneParams& params_, const DeviceInfo& device_info_)
 	device = NULL;
 	memset(&dscene.data, 0, sizeof(dscene.data));
 
+	update_time = 0.0;
+	bvh_build_time = 0.0;
+
 	camera = new Camera();
 	lookup_tables = new LookupTables();
 	film = new Film();
@@ -131,108 +136,157 @@ void Scene::free_memory(bool final)
 	}
 }
 
+/* Sets the progress status and logs how long a stage of the device update
+ * took, for finding what delays the first pixels on heavy scenes. */
+class SceneUpdateStage {
+public:
+	SceneUpdateStage(Progress& progress, const char *status)
+	: status_(status)
+	{
+		progress.set_status(status);
+	}
+
+	~SceneUpdateStage()
+	{
+		VLOG(1) << status_ << " done in " << time_dt() - timer_.get_start() << " seconds.";
+	}
+
+protected:
+	const char *status_;
+	scoped_timer timer_;
+};
+
 void Scene::device_update(Device *device_, Progress& progress)
 {
 	if(!device)
 		device = device_;
 
 	bool print_stats = need_data_update();
+	scoped_timer timer;
 
 	/* The order of updates is important, because there's dependencies between
 	 * the different managers, using data computed by previous managers.
 	 *
+	 * - Shaders assign image slots and set flags used by all others.
 	 * - Image manager uploads images used by shaders.
 	 * - Camera may be used for adaptive subdivision.
 	 * - Displacement shader must have all shader data available.
 	 * - Light manager needs lookup tables and final mesh data to compute emission CDF.
 	 * - Film needs light manager to run for use_light_visibility
 	 * - Lookup tables are done a second time to handle film tables
+	 *
+	 * Image files are loaded on the host while geometry is updated, they are
+	 * only allocated on the device afterwards so managers don't use the device
+	 * from multiple threads at once.
 	 */
 	
 	image_manager->set_pack_images(device->info.pack_images);
 
-	progress.set_status("Updating Shaders");
-	shader_manager->device_update(device, &dscene, this, progress);
-
-	if(progress.get_cancel() || device->have_error()) return;
-
-	progress.set_status("Updating Background");
-	background->device_update(device, &dscene, this);
+	{
+		SceneUpdateStage stage(progress, "Updating Shaders");
+		shader_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
-	progress.set_status("Updating Camera");
-	camera->device_update(device, &dscene, this);
+	{
+		SceneUpdateStage stage(progress, "Updating Background");
+		background->device_update(device, &dscene, this);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
-	progress.set_status("Updating Meshes Flags");
-	mesh_manager->device_update_flags(device, &dscene, this, progress);
+	{
+		SceneUpdateStage stage(progress, "Updating Camera");
+		camera->device_update(device, &dscene, this);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
-	progress.set_status("Updating Objects");
-	object_manager->device_update(device, &dscene, this, progress);
+	/* the mesh update needs images used for displacement on the device */
+	if(mesh_manager->need_update) {
+		SceneUpdateStage stage(progress, "Updating Displacement Images");
+		mesh_manager->device_update_displacement_images(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
-	progress.set_status("Updating Meshes");
-	mesh_manager->device_update(device, &dscene, this, progress);
+	TaskPool image_pool;
+	image_pool.push(function_bind(&Scene::device_load_images, this, &progress));
 
-	if(progress.get_cancel() || device->have_error()) return;
+	bool geometry_updated = device_update_geometry(progress);
 
-	progress.set_status("Updating Objects Flags");
-	object_manager->device_update_flags(device, &dscene, this, progress);
+	image_pool.wait_work();
 
-	if(progress.get_cancel() || device->have_error()) return;
+	if(!geometry_updated || progress.get_cancel() || device->have_error()) return;
 
-	progress.set_status("Updating Images");
-	image_manager->device_update(device, &dscene, this, progress);
+	{
+		SceneUpdateStage stage(progress, "Updating Images");
+		image_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
-	progress.set_status("Updating Camera Volume");
-	camera->device_update_volume(device, &dscene, this);
+	{
+		SceneUpdateStage stage(progress, "Updating Camera Volume");
+		camera->device_update_volume(device, &dscene, this);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
-	progress.set_status("Updating Hair Systems");
-	curve_system_manager->device_update(device, &dscene, this, progress);
+	{
+		SceneUpdateStage stage(progress, "Updating Hair Systems");
+		curve_system_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
-	progress.set_status("Updating Lookup Tables");
-	lookup_tables->device_update(device, &dscene);
+	{
+		SceneUpdateStage stage(progress, "Updating Lookup Tables");
+		lookup_tables->device_update(device, &dscene);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
-	progress.set_status("Updating Lights");
-	light_manager->device_update(device, &dscene, this, progress);
+	{
+		SceneUpdateStage stage(progress, "Updating Lights");
+		light_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
-	progress.set_status("Updating Particle Systems");
-	particle_system_manager->device_update(device, &dscene, this, progress);
+	{
+		SceneUpdateStage stage(progress, "Updating Particle Systems");
+		particle_system_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
-	progress.set_status("Updating Integrator");
-	integrator->device_update(device, &dscene, this);
+	{
+		SceneUpdateStage stage(progress, "Updating Integrator");
+		integrator->device_update(device, &dscene, this);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
-	progress.set_status("Updating Film");
-	film->device_update(device, &dscene, this);
+	{
+		SceneUpdateStage stage(progress, "Updating Film");
+		film->device_update(device, &dscene, this);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
-	progress.set_status("Updating Lookup Tables");
-	lookup_tables->device_update(device, &dscene);
+	{
+		SceneUpdateStage stage(progress, "Updating Lookup Tables");
+		lookup_tables->device_update(device, &dscene);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
-	progress.set_status("Updating Baking");
-	bake_manager->device_update(device, &dscene, this, progress);
+	{
+		SceneUpdateStage stage(progress, "Updating Baking");
+		bake_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
@@ -241,6 +295,12 @@ void Scene::device_update(Device *device_, Progress& progress)
 		device->const_copy_to("__data", &dscene.data, sizeof(dscene.data));
 	}
 
+	update_time = time_dt() - timer.get_start();
+	bvh_build_time = mesh_manager->bvh_build_time;
+
+	VLOG(1) << "Scene device update done in "
+	        << update_time << " seconds.";
+
 	if(print_stats) {
 		size_t mem_used = util_guarded_get_mem_used();
 		size_t mem_peak = util_guarded_get_mem_peak();
@@ -253,6 +313,46 @@ void Scene::device_update(Device *device_, Progress& progress)
 	}
 }
 
+bool Scene::device_update_geometry(Progress& progress)
+{
+	{
+		SceneUpdateStage stage(progress, "Updating Meshes Flags");
+		mesh_manager->device_update_flags(device, &dscene, this, progress);
+	}
+
+	if(progress.get_cancel() || device->have_error()) return false;
+
+	{
+		SceneUpdateStage stage(progress, "Updating Objects");
+		object_manager->device_update(device, &dscene, this, progress);
+	}
+
+	if(progress.get_cancel() || device->have_error()) return false;
+
+	{
+		SceneUpdateStage stage(progress, "Updating Meshes");
+		mesh_manager->device_update(device, &dscene, this, progress);
+	}
+
+	if(progress.get_cancel() || device->have_error()) return false;
+
+	{
+		SceneUpdateStage stage(progress, "Updating Objects Flags");
+		object_manager->device_update_flags(device, &dscene, this, progress);
+	}
+
+	return !(progress.get_cancel() || device->have_error());
+}
+
+void Scene::device_load_images(Progress *progress)
+{
+	scoped_timer timer;
+
+	image_manager->device_load_images(device, &dscene, this, progress);
+
+	VLOG(1) << "Loading images done in " << time_dt() - timer.get_start() << " seconds.";
+}
+
 Scene::MotionType Scene::need_motion(bool advanced_shading)
 {
 	if(integrator->motion_blur)
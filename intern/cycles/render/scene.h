@@ -73,12 +73,15 @@ public:
 	/* mesh */
 	device_vector<uint> tri_shader;
 	device_vector<float4> tri_vnormal;
+	device_vector<uint> tri_vnormal_packed;
 	device_vector<uint4> tri_vindex;
 	device_vector<uint> tri_patch;
 	device_vector<float2> tri_patch_uv;
 
 	device_vector<float4> curves;
 	device_vector<float4> curve_keys;
+	device_vector<uint> curve_keys_packed;
+	device_vector<float4> curve_key_bounds;
 
 	device_vector<uint> patches;
 
@@ -91,12 +94,16 @@ public:
 	device_vector<float> attributes_float;
 	device_vector<float4> attributes_float3;
 	device_vector<uchar4> attributes_uchar4;
+	device_vector<uint> attributes_half;
 
 	/* lights */
 	device_vector<float4> light_distribution;
 	device_vector<float4> light_data;
 	device_vector<float2> light_background_marginal_cdf;
 	device_vector<float2> light_background_conditional_cdf;
+	device_vector<float4> light_tree_nodes;
+	device_vector<float4> light_tree_emitters;
+	device_vector<uint> light_tree_lookup;
 
 	/* particles */
 	device_vector<float4> particles;
@@ -144,9 +151,20 @@ public:
 	bool use_bvh_spatial_split;
 	bool use_bvh_unaligned_nodes;
 	int num_bvh_time_steps;
+	/* store built BVHs in the disk cache, keyed by content hash */
+	bool use_bvh_cache;
 	bool use_qbvh;
+	/* 8-wide BVH, only for the CPU device with the AVX2 kernel */
+	bool use_obvh;
 	bool persistent_data;
 	int texture_limit;
+	/* memory budget in megabytes for the CPU texture cache, 0 loads all
+	 * images into memory */
+	int texture_cache_size;
+	/* store vertex normals and triangle corner attributes quantized */
+	bool use_compact_mesh;
+	/* store curve keys quantized relative to the bounds of each curve */
+	bool use_compact_curves;
 
 	SceneParams()
 	{
@@ -155,9 +173,14 @@ public:
 		use_bvh_spatial_split = false;
 		use_bvh_unaligned_nodes = true;
 		num_bvh_time_steps = 0;
+		use_bvh_cache = false;
 		use_qbvh = false;
+		use_obvh = false;
 		persistent_data = false;
 		texture_limit = 0;
+		texture_cache_size = 0;
+		use_compact_mesh = false;
+		use_compact_curves = false;
 	}
 
 	bool modified(const SceneParams& params)
@@ -166,9 +189,14 @@ public:
 		&& use_bvh_spatial_split == params.use_bvh_spatial_split
 		&& use_bvh_unaligned_nodes == params.use_bvh_unaligned_nodes
 		&& num_bvh_time_steps == params.num_bvh_time_steps
+		&& use_bvh_cache == params.use_bvh_cache
 		&& use_qbvh == params.use_qbvh
+		&& use_obvh == params.use_obvh
 		&& persistent_data == params.persistent_data
-		&& texture_limit == params.texture_limit); }
+		&& texture_limit == params.texture_limit
+		&& texture_cache_size == params.texture_cache_size
+		&& use_compact_mesh == params.use_compact_mesh
+		&& use_compact_curves == params.use_compact_curves); }
 };
 
 /* Scene */
@@ -215,6 +243,11 @@ public:
 	/* mutex must be locked manually by callers */
 	thread_mutex mutex;
 
+	/* duration of the last device update and of the BVH builds in it,
+	 * in seconds */
+	double update_time;
+	double bvh_build_time;
+
 	Scene(const SceneParams& params, const DeviceInfo& device_info);
 	~Scene();
 
@@ -239,6 +272,11 @@ protected:
 	 */
 	bool need_data_update();
 
+	/* Stages of device_update() which run in parallel, geometry returns
+	 * false when cancelled or on device errors. */
+	bool device_update_geometry(Progress& progress);
+	void device_load_images(Progress *progress);
+
 	void free_memory(bool final);
 };
 
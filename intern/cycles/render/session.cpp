@@ -33,6 +33,8 @@
 #include "util_logging.h"
 #include "util_math.h"
 #include "util_opengl.h"
+#include "util_path.h"
+#include "util_set.h"
 #include "util_task.h"
 #include "util_time.h"
 
@@ -55,6 +57,20 @@ Session::Session(const SessionParams& params_)
 
 	device = Device::create(params.device, stats, params.background);
 
+	/* every CPU thread renders its own tile */
+	int num_workers = 0;
+
+	if(params.device.multi_devices.size()) {
+		foreach(DeviceInfo& info, params.device.multi_devices)
+			num_workers += (info.type == DEVICE_CPU)? TaskScheduler::num_threads(): 1;
+	}
+	else {
+		num_workers = (params.device.type == DEVICE_CPU)? TaskScheduler::num_threads(): 1;
+	}
+
+	/* progressive refine keeps buffers per tile over samples */
+	tile_manager.set_tile_splitting(params.split_tiles && !params.progressive_refine, num_workers);
+
 	if(params.background && params.output_path.empty()) {
 		buffers = NULL;
 		display = NULL;
@@ -69,6 +85,7 @@ Session::Session(const SessionParams& params_)
 
 	reset_time = 0.0;
 	last_update_time = 0.0;
+	last_update_duration = 0.0;
 
 	delayed_reset.do_reset = false;
 	delayed_reset.samples = 0;
@@ -301,6 +318,8 @@ void Session::run_gpu()
 		}
 	}
 
+	denoise_and_write_tiles();
+
 	if(!tiles_written)
 		update_progressive_refine(true);
 }
@@ -370,6 +389,7 @@ bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
 	rtile.start_sample = tile_manager.state.sample;
 	rtile.num_samples = tile_manager.state.num_samples;
 	rtile.resolution = tile_manager.state.resolution_divider;
+	rtile.start_time = time_dt();
 
 	tile_lock.unlock();
 
@@ -456,11 +476,30 @@ void Session::update_tile_sample(RenderTile& rtile)
 
 void Session::release_tile(RenderTile& rtile)
 {
+	double render_time = time_dt() - rtile.start_time;
+
+	/* Finished tiles are denoised once the whole frame is done, so the
+	 * filter can use the pixels of neighboring tiles. */
+	bool denoise = (params.denoising.use &&
+	                params.background &&
+	                params.progressive_refine == false &&
+	                rtile.sample == rtile.start_sample + rtile.num_samples);
+
 	thread_scoped_lock tile_lock(tile_mutex);
 
 	progress.add_finished_tile();
 
-	if(write_render_tile_cb) {
+	tile_manager.add_tile_time(rtile.x - tile_manager.state.buffer.full_x,
+	                           rtile.y - tile_manager.state.buffer.full_y,
+	                           rtile.w,
+	                           rtile.h,
+	                           rtile.sample - rtile.start_sample,
+	                           render_time);
+
+	if(denoise) {
+		denoise_tiles.push_back(rtile);
+	}
+	else if(write_render_tile_cb) {
 		if(params.progressive_refine == false) {
 			/* todo: optimize this by making it thread safe and removing lock */
 			write_render_tile_cb(rtile);
@@ -472,6 +511,45 @@ void Session::release_tile(RenderTile& rtile)
 	update_status_time();
 }
 
+void Session::denoise_and_write_tiles()
+{
+	thread_scoped_lock tile_lock(tile_mutex);
+
+	if(denoise_tiles.empty())
+		return;
+
+	/* Nothing renders anymore, so shared buffers can be copied as well. A
+	 * cancelled frame is written without denoising. */
+	if(!progress.get_cancel()) {
+		progress.set_status("Denoising");
+
+		set<RenderBuffers*> unique_buffers;
+		foreach(RenderTile& rtile, denoise_tiles)
+			unique_buffers.insert(rtile.buffers);
+
+		foreach(RenderBuffers *denoise_buffers, unique_buffers)
+			denoise_buffers->copy_from_device();
+
+		Denoiser denoiser(params.denoising);
+		denoiser.denoise(denoise_tiles);
+
+		foreach(RenderBuffers *denoise_buffers, unique_buffers)
+			denoise_buffers->copy_to_device();
+
+		progress.set_status("Finished");
+	}
+
+	if(write_render_tile_cb) {
+		foreach(RenderTile& rtile, denoise_tiles) {
+			write_render_tile_cb(rtile);
+
+			delete rtile.buffers;
+		}
+	}
+
+	denoise_tiles.clear();
+}
+
 void Session::run_cpu()
 {
 	bool tiles_written = false;
@@ -594,6 +672,8 @@ void Session::run_cpu()
 		progress.set_update();
 	}
 
+	denoise_and_write_tiles();
+
 	if(!tiles_written)
 		update_progressive_refine(true);
 }
@@ -882,6 +962,8 @@ void Session::path_trace()
 	task.update_progress_sample = function_bind(&Progress::add_samples, &this->progress, _1, _2);
 	task.need_finish_queue = params.progressive_refine;
 	task.integrator_branched = scene->integrator->method == Integrator::BRANCHED_PATH;
+	task.sample = tile_manager.state.sample;
+	task.num_samples = tile_manager.state.num_samples;
 	task.requested_tile_size = params.tile_size;
 
 	device->task_add(task);
@@ -918,9 +1000,19 @@ bool Session::update_progressive_refine(bool cancel)
 	int sample = tile_manager.state.sample + 1;
 	bool write = sample == tile_manager.num_samples || cancel;
 
+	if(!write && params.output_interval > 0 && sample % params.output_interval == 0)
+		write_output(sample);
+
 	double current_time = time_dt();
 
-	if(current_time - last_update_time < params.progressive_update_timeout) {
+	/* besides the timeout, keep the time spent on updates a small fraction
+	 * of the render time, copying all tiles to the host can be slow */
+	double update_interval = params.progressive_update_timeout;
+
+	if(params.progressive_update_overhead > 0.0)
+		update_interval = max(update_interval, last_update_duration/params.progressive_update_overhead);
+
+	if(current_time - last_update_time < update_interval) {
 		/* if last sample was processed, we need to write buffers anyway  */
 		if(!write && sample != 1)
 			return false;
@@ -944,10 +1036,39 @@ bool Session::update_progressive_refine(bool cancel)
 	}
 
 	last_update_time = current_time;
+	last_update_duration = time_dt() - current_time;
 
 	return write;
 }
 
+void Session::write_output(int sample)
+{
+	/* the display of interactive sessions may be drawn with half floats */
+	if(!params.background || !buffers || !display || params.output_path.empty())
+		return;
+
+	string filename = path_filename(params.output_path);
+	string extension = "";
+	size_t dot = filename.rfind('.');
+
+	if(dot != string::npos) {
+		extension = filename.substr(dot);
+		filename = filename.substr(0, dot);
+	}
+
+	string path = path_join(path_dirname(params.output_path),
+	                        string_printf("%s_%04d%s", filename.c_str(), sample, extension.c_str()));
+
+	scoped_timer write_timer;
+
+	tonemap(sample - 1);
+	display->write(device, path);
+
+	progress.add_skip_time(write_timer, params.background);
+
+	VLOG(1) << "Wrote intermediate image " << path << " at sample " << sample << ".";
+}
+
 void Session::device_free()
 {
 	scene->device_free();
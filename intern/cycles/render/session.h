@@ -18,6 +18,7 @@
 #define __SESSION_H__
 
 #include "buffers.h"
+#include "denoising.h"
 #include "device.h"
 #include "shader.h"
 #include "tile.h"
@@ -46,12 +47,14 @@ public:
 	bool background;
 	bool progressive_refine;
 	string output_path;
+	int output_interval;
 
 	bool progressive;
 	bool experimental;
 	int samples;
 	int2 tile_size;
 	TileOrder tile_order;
+	bool split_tiles;
 	int start_resolution;
 	int threads;
 
@@ -61,14 +64,18 @@ public:
 	double reset_timeout;
 	double text_timeout;
 	double progressive_update_timeout;
+	double progressive_update_overhead;
 
 	ShadingSystem shadingsystem;
 
+	DenoiseParams denoising;
+
 	SessionParams()
 	{
 		background = false;
 		progressive_refine = false;
 		output_path = "";
+		output_interval = 0;
 
 		progressive = false;
 		experimental = false;
@@ -83,9 +90,11 @@ public:
 		reset_timeout = 0.1;
 		text_timeout = 1.0;
 		progressive_update_timeout = 1.0;
+		progressive_update_overhead = 0.02;
 
 		shadingsystem = SHADINGSYSTEM_SVM;
 		tile_order = TILE_CENTER;
+		split_tiles = true;
 	}
 
 	bool modified(const SessionParams& params)
@@ -93,6 +102,7 @@ public:
 		&& background == params.background
 		&& progressive_refine == params.progressive_refine
 		&& output_path == params.output_path
+		&& output_interval == params.output_interval
 		/* && samples == params.samples */
 		&& progressive == params.progressive
 		&& experimental == params.experimental
@@ -104,8 +114,11 @@ public:
 		&& reset_timeout == params.reset_timeout
 		&& text_timeout == params.text_timeout
 		&& progressive_update_timeout == params.progressive_update_timeout
+		&& progressive_update_overhead == params.progressive_update_overhead
 		&& tile_order == params.tile_order
-		&& shadingsystem == params.shadingsystem); }
+		&& split_tiles == params.split_tiles
+		&& shadingsystem == params.shadingsystem
+		&& !denoising.modified(params.denoising)); }
 
 };
 
@@ -200,10 +213,18 @@ protected:
 
 	/* progressive refine */
 	double last_update_time;
+	double last_update_duration;
 	bool update_progressive_refine(bool cancel);
 
+	/* write intermediate image to the output path */
+	void write_output(int sample);
+
 	vector<RenderBuffers *> tile_buffers;
 
+	/* finished tiles kept until the frame is done, to denoise them together */
+	vector<RenderTile> denoise_tiles;
+	void denoise_and_write_tiles();
+
 	DeviceRequestedFeatures get_requested_device_features();
 
 	/* ** Split kernel routines ** */
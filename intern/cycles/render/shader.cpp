@@ -176,6 +176,7 @@ Shader::Shader()
 	has_bssrdf_bump = false;
 	has_surface_spatial_varying = false;
 	has_volume_spatial_varying = false;
+	has_volume_grid_varying_only = false;
 	has_object_dependency = false;
 	has_integrator_dependency = false;
 
@@ -427,8 +428,11 @@ void ShaderManager::device_update_common(Device *device,
 			 */
 			flag |= SD_HAS_TRANSPARENT_SHADOW;
 		}
-		if(shader->heterogeneous_volume && shader->has_volume_spatial_varying)
+		if(shader->heterogeneous_volume && shader->has_volume_spatial_varying) {
 			flag |= SD_HETEROGENEOUS_VOLUME;
+			if(shader->has_volume_grid_varying_only)
+				flag |= SD_VOLUME_GRID_VARYING;
+		}
 		if(shader->has_bssrdf_bump)
 			flag |= SD_HAS_BSSRDF_BUMP;
 		if(shader->volume_sampling_method == VOLUME_SAMPLING_EQUIANGULAR)
@@ -115,6 +115,7 @@ public:
 	bool has_bssrdf_bump;
 	bool has_surface_spatial_varying;
 	bool has_volume_spatial_varying;
+	bool has_volume_grid_varying_only;
 	bool has_object_dependency;
 	bool has_integrator_dependency;
 
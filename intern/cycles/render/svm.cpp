@@ -441,8 +441,11 @@ void SVMCompiler::generate_node(ShaderNode *node, ShaderNodeSet& done)
 			current_shader->has_surface_spatial_varying = true;
 	}
 	else if(current_type == SHADER_TYPE_VOLUME) {
-		if(node->has_spatial_varying())
+		if(node->has_spatial_varying()) {
 			current_shader->has_volume_spatial_varying = true;
+			if(!node->has_volume_grid_varying())
+				current_shader->has_volume_grid_varying_only = false;
+		}
 	}
 
 	if(node->has_object_dependency()) {
@@ -837,6 +840,7 @@ void SVMCompiler::compile(Scene *scene,
 	shader->has_displacement = false;
 	shader->has_surface_spatial_varying = false;
 	shader->has_volume_spatial_varying = false;
+	shader->has_volume_grid_varying_only = false;
 	shader->has_object_dependency = false;
 	shader->has_integrator_dependency = false;
 
@@ -866,6 +870,7 @@ void SVMCompiler::compile(Scene *scene,
 	/* generate volume shader */
 	{
 		scoped_timer timer((summary != NULL)? &summary->time_generate_volume: NULL);
+		shader->has_volume_grid_varying_only = true;
 		compile_type(shader, shader->graph, SHADER_TYPE_VOLUME);
 		svm_nodes[index].z = svm_nodes.size();
 		svm_nodes.insert(svm_nodes.end(),
@@ -17,10 +17,16 @@
 #include "tile.h"
 
 #include "util_algorithm.h"
+#include "util_foreach.h"
 #include "util_types.h"
 
 CCL_NAMESPACE_BEGIN
 
+/* Size in pixels of the cells render times are recorded in. */
+#define TILE_COST_CELL_SIZE 32
+/* Tiles are not split into parts smaller than this. */
+#define TILE_MIN_SPLIT_SIZE 16
+
 namespace {
 
 class TileComparator {
@@ -100,6 +106,11 @@ TileManager::TileManager(bool progressive_, int num_samples_, int2 tile_size_, i
 	range_start_sample = 0;
 	range_num_samples = -1;
 
+	split_tiles = false;
+	num_workers = 1;
+	cost_grid_width = 0;
+	cost_grid_height = 0;
+
 	BufferParams buffer_params;
 	reset(buffer_params, 0);
 }
@@ -135,6 +146,8 @@ void TileManager::reset(BufferParams& params_, int num_samples_)
 	state.num_samples = 0;
 	state.resolution_divider = get_divider(params.width, params.height, start_resolution);
 	state.tiles.clear();
+
+	reset_cost_grid();
 }
 
 void TileManager::set_samples(int num_samples_)
@@ -341,12 +354,158 @@ bool TileManager::next_tile(Tile& tile, int device)
 	if((logical_device >= state.tiles.size()) || state.tiles[logical_device].empty())
 		return false;
 
-	tile = Tile(state.tiles[logical_device].front());
-	state.tiles[logical_device].pop_front();
+	list<Tile>& tiles = state.tiles[logical_device];
+	list<Tile>::iterator next = tiles.begin();
+
+	if(split_tiles) {
+		size_t num_list_workers = preserve_tile_device? max(num_workers/num_devices, 1): num_workers;
+
+		if(tiles.size() < num_list_workers) {
+			float mean_cost = mean_pixel_cost();
+
+			split_remaining_tiles(tiles, num_list_workers, mean_cost);
+
+			/* hand out the most expensive tiles first, so they don't finish last */
+			float next_cost = 0.0f;
+
+			for(list<Tile>::iterator it = tiles.begin(); it != tiles.end(); it++) {
+				float cost = predict_cost(*it, mean_cost);
+
+				if(cost > next_cost) {
+					next = it;
+					next_cost = cost;
+				}
+			}
+		}
+	}
+
+	tile = Tile(*next);
+	tiles.erase(next);
 	state.num_rendered_tiles++;
 	return true;
 }
 
+void TileManager::set_tile_splitting(bool split_tiles_, int num_workers_)
+{
+	split_tiles = split_tiles_;
+	num_workers = max(num_workers_, 1);
+}
+
+void TileManager::reset_cost_grid()
+{
+	int width = (params.width + TILE_COST_CELL_SIZE - 1)/TILE_COST_CELL_SIZE;
+	int height = (params.height + TILE_COST_CELL_SIZE - 1)/TILE_COST_CELL_SIZE;
+
+	if(width != cost_grid_width || height != cost_grid_height) {
+		cost_grid.clear();
+		cost_grid.resize(width*height, 0.0f);
+		cost_grid_width = width;
+		cost_grid_height = height;
+	}
+}
+
+void TileManager::add_tile_time(int x, int y, int w, int h, int num_samples, double time)
+{
+	if(w <= 0 || h <= 0 || num_samples <= 0 || cost_grid.empty())
+		return;
+
+	int resolution = state.resolution_divider;
+	float cost = (float)(time / ((double)w*h*num_samples));
+
+	int x0 = (x*resolution)/TILE_COST_CELL_SIZE;
+	int y0 = (y*resolution)/TILE_COST_CELL_SIZE;
+	int x1 = min(((x + w)*resolution - 1)/TILE_COST_CELL_SIZE, cost_grid_width - 1);
+	int y1 = min(((y + h)*resolution - 1)/TILE_COST_CELL_SIZE, cost_grid_height - 1);
+
+	for(int cy = y0; cy <= y1; cy++) {
+		for(int cx = x0; cx <= x1; cx++) {
+			cost_grid[cy*cost_grid_width + cx] = cost;
+		}
+	}
+}
+
+float TileManager::mean_pixel_cost()
+{
+	double sum = 0.0;
+	int num = 0;
+
+	foreach(float cost, cost_grid) {
+		if(cost > 0.0f) {
+			sum += cost;
+			num++;
+		}
+	}
+
+	return (num)? (float)(sum/num): 1.0f;
+}
+
+/* Predicted time to render a sample of the tile. Parts of the image which
+ * were not rendered yet are assumed to have average cost. */
+float TileManager::predict_cost(const Tile& tile, float mean_cost)
+{
+	if(cost_grid.empty())
+		return (float)(tile.w*tile.h);
+
+	int resolution = state.resolution_divider;
+	int x0 = tile.x*resolution, x1 = (tile.x + tile.w)*resolution;
+	int y0 = tile.y*resolution, y1 = (tile.y + tile.h)*resolution;
+	float cost = 0.0f;
+
+	for(int cy = y0/TILE_COST_CELL_SIZE; cy*TILE_COST_CELL_SIZE < y1 && cy < cost_grid_height; cy++) {
+		int h = min(y1, (cy + 1)*TILE_COST_CELL_SIZE) - max(y0, cy*TILE_COST_CELL_SIZE);
+
+		for(int cx = x0/TILE_COST_CELL_SIZE; cx*TILE_COST_CELL_SIZE < x1 && cx < cost_grid_width; cx++) {
+			int w = min(x1, (cx + 1)*TILE_COST_CELL_SIZE) - max(x0, cx*TILE_COST_CELL_SIZE);
+			float cell_cost = cost_grid[cy*cost_grid_width + cx];
+
+			cost += ((cell_cost > 0.0f)? cell_cost: mean_cost) * (w*h);
+		}
+	}
+
+	return cost / (resolution*resolution);
+}
+
+/* Split the most expensive remaining tile in half until there are as many
+ * tiles as workers, or tiles got too small to be worth splitting. */
+void TileManager::split_remaining_tiles(list<Tile>& tiles, size_t num_list_workers, float mean_cost)
+{
+	while(tiles.size() < num_list_workers) {
+		list<Tile>::iterator split_tile = tiles.end();
+		float split_cost = 0.0f;
+
+		for(list<Tile>::iterator it = tiles.begin(); it != tiles.end(); it++) {
+			if(max(it->w, it->h) < TILE_MIN_SPLIT_SIZE*2)
+				continue;
+
+			float cost = predict_cost(*it, mean_cost);
+
+			if(split_tile == tiles.end() || cost > split_cost) {
+				split_tile = it;
+				split_cost = cost;
+			}
+		}
+
+		if(split_tile == tiles.end())
+			break;
+
+		Tile second = *split_tile;
+		second.index = state.num_tiles++;
+
+		if(split_tile->w >= split_tile->h) {
+			split_tile->w /= 2;
+			second.x += split_tile->w;
+			second.w -= split_tile->w;
+		}
+		else {
+			split_tile->h /= 2;
+			second.y += split_tile->h;
+			second.h -= split_tile->h;
+		}
+
+		tiles.insert(++split_tile, second);
+	}
+}
+
 bool TileManager::done()
 {
 	int end_sample = (range_num_samples == -1)
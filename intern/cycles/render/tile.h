@@ -87,6 +87,18 @@ public:
 
 	void set_tile_order(TileOrder tile_order_) { tile_order = tile_order_; }
 
+	/* ** Dynamic tile splitting. ** */
+
+	/* Split remaining tiles when there are fewer of them than workers
+	 * rendering them, so a few expensive tiles at the end of a sample don't
+	 * leave most threads idle. Tile indices are then no longer fixed, which
+	 * progressive refine relies on. */
+	void set_tile_splitting(bool split_tiles, int num_workers);
+
+	/* Record the time it took to render a tile, in the coordinates of the
+	 * current state buffer. Used to predict the cost of remaining tiles. */
+	void add_tile_time(int x, int y, int w, int h, int num_samples, double time);
+
 	/* ** Sample range rendering. ** */
 
 	/* Start sample in the range. */
@@ -128,6 +140,20 @@ protected:
 
 	/* Generate tile list, return number of tiles. */
 	int gen_tiles(bool sliced);
+
+	bool split_tiles;
+	int num_workers;
+
+	/* Render time per pixel sample measured in cells of the full resolution
+	 * image, zero where nothing was rendered yet. Kept over resets, so
+	 * viewport samples and re-renders use what previous samples measured. */
+	vector<float> cost_grid;
+	int cost_grid_width, cost_grid_height;
+
+	void reset_cost_grid();
+	float mean_pixel_cost();
+	float predict_cost(const Tile& tile, float mean_cost);
+	void split_remaining_tiles(list<Tile>& tiles, size_t num_list_workers, float mean_cost);
 };
 
 CCL_NAMESPACE_END
@@ -0,0 +1,383 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "volume_grid.h"
+
+#include "kernel_volume_grid_globals.h"
+
+#include "util_logging.h"
+#include "util_math.h"
+
+#ifdef WITH_OPENVDB
+#  include "openvdb_capi.h"
+#endif
+
+CCL_NAMESPACE_BEGIN
+
+/* Voxels around a tile which can influence interpolated lookups in it,
+ * enough for cubic interpolation. */
+#define VOLUME_GRID_APRON 3
+
+static int volume_grid_divide_up(int x, int y)
+{
+	return (x + y - 1)/y;
+}
+
+static VolumeGrid *volume_grid_create(int width, int height, int depth, int channels)
+{
+	VolumeGrid *grid = new VolumeGrid();
+
+	grid->width = width;
+	grid->height = height;
+	grid->depth = depth;
+	grid->tiles_x = volume_grid_divide_up(width, VOLUME_GRID_TILE_SIZE);
+	grid->tiles_y = volume_grid_divide_up(height, VOLUME_GRID_TILE_SIZE);
+	grid->tiles_z = volume_grid_divide_up(depth, VOLUME_GRID_TILE_SIZE);
+	grid->blocks_x = volume_grid_divide_up(width, VOLUME_GRID_BLOCK_SIZE);
+	grid->blocks_y = volume_grid_divide_up(height, VOLUME_GRID_BLOCK_SIZE);
+	grid->blocks_z = volume_grid_divide_up(depth, VOLUME_GRID_BLOCK_SIZE);
+	grid->channels = channels;
+	grid->tiles.resize(((size_t)grid->tiles_x)*grid->tiles_y*grid->tiles_z, VOLUME_GRID_EMPTY_TILE);
+
+	return grid;
+}
+
+/* Store a tile unless all its voxels are the background value. */
+static void volume_grid_add_tile(VolumeGrid *grid, int tx, int ty, int tz, const float *values)
+{
+	const int channels = grid->channels;
+	const int num_values = VOLUME_GRID_TILE_VOXELS*channels;
+	const float *background = &grid->background.x;
+	bool empty = true;
+
+	for(int i = 0; i < num_values && empty; i++)
+		empty = (values[i] == background[i % channels]);
+
+	if(empty)
+		return;
+
+	size_t offset = grid->voxels.size();
+	grid->tiles[tx + grid->tiles_x*(ty + grid->tiles_y*tz)] = offset;
+	grid->voxels.insert(grid->voxels.end(), values, values + num_values);
+}
+
+static float4 volume_grid_voxel_get(const VolumeGrid *grid, int x, int y, int z)
+{
+	const int mask = VOLUME_GRID_TILE_SIZE - 1;
+	int tile = grid->tiles[(x >> VOLUME_GRID_TILE_SHIFT) +
+	                       grid->tiles_x*((y >> VOLUME_GRID_TILE_SHIFT) +
+	                                      grid->tiles_y*(z >> VOLUME_GRID_TILE_SHIFT))];
+
+	if(tile == VOLUME_GRID_EMPTY_TILE)
+		return grid->background;
+
+	const float *voxel = &grid->voxels[tile + grid->channels*((x & mask) +
+	                                                           ((y & mask) << VOLUME_GRID_TILE_SHIFT) +
+	                                                           ((z & mask) << (2*VOLUME_GRID_TILE_SHIFT)))];
+
+	if(grid->channels == 1)
+		return make_float4(voxel[0], voxel[0], voxel[0], 1.0f);
+	else if(grid->channels == 3)
+		return make_float4(voxel[0], voxel[1], voxel[2], 1.0f);
+
+	return make_float4(voxel[0], voxel[1], voxel[2], voxel[3]);
+}
+
+VolumeGrid *volume_grid_from_dense(const float *pixels,
+                                   int width,
+                                   int height,
+                                   int depth,
+                                   int channels)
+{
+	const size_t num_pixels = ((size_t)width)*height*depth;
+	int grid_channels = channels;
+
+	/* alpha of one is not stored */
+	if(channels == 4) {
+		grid_channels = 3;
+		for(size_t i = 0; i < num_pixels; i++) {
+			if(pixels[i*4 + 3] != 1.0f) {
+				grid_channels = 4;
+				break;
+			}
+		}
+	}
+
+	VolumeGrid *grid = volume_grid_create(width, height, depth, grid_channels);
+
+	if(grid_channels == 4)
+		grid->background = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	vector<float> values(VOLUME_GRID_TILE_VOXELS*grid_channels);
+	const float *background = &grid->background.x;
+
+	for(int tz = 0; tz < grid->tiles_z; tz++) {
+		for(int ty = 0; ty < grid->tiles_y; ty++) {
+			for(int tx = 0; tx < grid->tiles_x; tx++) {
+				size_t index = 0;
+
+				for(int z = tz*VOLUME_GRID_TILE_SIZE; z < (tz + 1)*VOLUME_GRID_TILE_SIZE; z++) {
+					for(int y = ty*VOLUME_GRID_TILE_SIZE; y < (ty + 1)*VOLUME_GRID_TILE_SIZE; y++) {
+						for(int x = tx*VOLUME_GRID_TILE_SIZE; x < (tx + 1)*VOLUME_GRID_TILE_SIZE; x++) {
+							/* voxels past the image border are never looked up */
+							if(x >= width || y >= height || z >= depth) {
+								for(int c = 0; c < grid_channels; c++)
+									values[index++] = background[c];
+								continue;
+							}
+
+							const float *pixel = pixels + (x + ((size_t)width)*(y + ((size_t)height)*z))*channels;
+
+							for(int c = 0; c < grid_channels; c++)
+								values[index++] = pixel[c];
+						}
+					}
+				}
+
+				volume_grid_add_tile(grid, tx, ty, tz, &values[0]);
+			}
+		}
+	}
+
+	VLOG(1) << "Sparse volume grid " << width << "x" << height << "x" << depth
+	        << " uses " << string_human_readable_size(grid->memory_size())
+	        << " instead of " << string_human_readable_size(num_pixels*channels*sizeof(float)) << ".";
+
+	return grid;
+}
+
+void volume_grid_to_dense(const VolumeGrid *grid, float *pixels, int channels)
+{
+	for(int z = 0; z < grid->depth; z++) {
+		for(int y = 0; y < grid->height; y++) {
+			for(int x = 0; x < grid->width; x++) {
+				float4 value = volume_grid_voxel_get(grid, x, y, z);
+
+				if(channels == 1) {
+					*(pixels++) = value.x;
+				}
+				else {
+					*(pixels++) = value.x;
+					*(pixels++) = value.y;
+					*(pixels++) = value.z;
+					*(pixels++) = value.w;
+				}
+			}
+		}
+	}
+}
+
+void volume_grid_build_majorants(VolumeGrid *grid)
+{
+	grid->tile_majorants.clear();
+	grid->block_majorants.clear();
+
+	/* Skipping requires lookups outside of the grid and in empty tiles to
+	 * return the same, which they don't with a background value. */
+	const float4 background = grid->background;
+	if(background.x != 0.0f || background.y != 0.0f || background.z != 0.0f)
+		return;
+
+	/* largest color value stored in each tile */
+	const int num_tiles = grid->tiles.size();
+	const int channels = grid->channels;
+	const int color_channels = min(channels, 3);
+	vector<float> tile_max(num_tiles, 0.0f);
+
+	for(int i = 0; i < num_tiles; i++) {
+		if(grid->tiles[i] == VOLUME_GRID_EMPTY_TILE)
+			continue;
+
+		const float *voxel = &grid->voxels[grid->tiles[i]];
+		float value = 0.0f;
+
+		for(int j = 0; j < VOLUME_GRID_TILE_VOXELS; j++, voxel += channels)
+			for(int c = 0; c < color_channels; c++)
+				value = max(value, fabsf(voxel[c]));
+
+		tile_max[i] = value;
+	}
+
+	/* dilate by the interpolation apron, which is smaller than a tile */
+	assert(VOLUME_GRID_APRON <= VOLUME_GRID_TILE_SIZE);
+
+	grid->tile_majorants.resize(num_tiles, 0.0f);
+	grid->block_majorants.resize(((size_t)grid->blocks_x)*grid->blocks_y*grid->blocks_z, 0.0f);
+
+	for(int tz = 0; tz < grid->tiles_z; tz++) {
+		for(int ty = 0; ty < grid->tiles_y; ty++) {
+			for(int tx = 0; tx < grid->tiles_x; tx++) {
+				float value = 0.0f;
+
+				for(int z = max(tz - 1, 0); z <= min(tz + 1, grid->tiles_z - 1); z++)
+					for(int y = max(ty - 1, 0); y <= min(ty + 1, grid->tiles_y - 1); y++)
+						for(int x = max(tx - 1, 0); x <= min(tx + 1, grid->tiles_x - 1); x++)
+							value = max(value, tile_max[x + grid->tiles_x*(y + grid->tiles_y*z)]);
+
+				grid->tile_majorants[tx + grid->tiles_x*(ty + grid->tiles_y*tz)] = value;
+
+				const int block = (tx >> (VOLUME_GRID_BLOCK_SHIFT - VOLUME_GRID_TILE_SHIFT)) +
+				                  grid->blocks_x*((ty >> (VOLUME_GRID_BLOCK_SHIFT - VOLUME_GRID_TILE_SHIFT)) +
+				                                  grid->blocks_y*(tz >> (VOLUME_GRID_BLOCK_SHIFT - VOLUME_GRID_TILE_SHIFT)));
+				grid->block_majorants[block] = max(grid->block_majorants[block], value);
+			}
+		}
+	}
+}
+
+/* OpenVDB */
+
+#ifdef WITH_OPENVDB
+static bool volume_grid_vdb_read_bounds(OpenVDBReader *reader,
+                                        const string& grid_name,
+                                        int3 *origin,
+                                        int3 *resolution,
+                                        Transform *index_to_world)
+{
+	int bbox_min[3], bbox_max[3];
+	float matrix[4][4];
+
+	if(!OpenVDB_sparse_grid_bounds(reader, grid_name.c_str(), bbox_min, bbox_max, matrix))
+		return false;
+
+	/* align to leaf nodes, so they map to tiles */
+	const int mask = ~(VOLUME_GRID_TILE_SIZE - 1);
+	*origin = make_int3(bbox_min[0] & mask, bbox_min[1] & mask, bbox_min[2] & mask);
+	*resolution = make_int3(bbox_max[0] + 1 - origin->x,
+	                        bbox_max[1] + 1 - origin->y,
+	                        bbox_max[2] + 1 - origin->z);
+
+	/* OpenVDB matrices transform row vectors */
+	*index_to_world = make_transform(matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0],
+	                                 matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1],
+	                                 matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2],
+	                                 0.0f, 0.0f, 0.0f, 1.0f);
+
+	return true;
+}
+
+struct VolumeGridVDBLeaves {
+	VolumeGrid *grid;
+	int3 origin;
+};
+
+static void volume_grid_vdb_leaf(void *userdata,
+                                 const int origin[3],
+                                 const float *values,
+                                 const int /*channels*/)
+{
+	VolumeGridVDBLeaves *data = (VolumeGridVDBLeaves*)userdata;
+	VolumeGrid *grid = data->grid;
+
+	const int tx = (origin[0] - data->origin.x) >> VOLUME_GRID_TILE_SHIFT;
+	const int ty = (origin[1] - data->origin.y) >> VOLUME_GRID_TILE_SHIFT;
+	const int tz = (origin[2] - data->origin.z) >> VOLUME_GRID_TILE_SHIFT;
+
+	/* only inactive voxels are outside of the bounds */
+	if(tx < 0 || ty < 0 || tz < 0 ||
+	   tx >= grid->tiles_x || ty >= grid->tiles_y || tz >= grid->tiles_z)
+	{
+		return;
+	}
+
+	volume_grid_add_tile(grid, tx, ty, tz, values);
+}
+#endif  /* WITH_OPENVDB */
+
+int volume_grid_vdb_channels(const string& filepath, const string& grid_name)
+{
+#ifdef WITH_OPENVDB
+	OpenVDBReader *reader = OpenVDBReader_create();
+	OpenVDBReader_open(reader, filepath.c_str());
+	int channels = OpenVDB_sparse_grid_channels(reader, grid_name.c_str());
+	OpenVDBReader_free(reader);
+
+	return channels;
+#else
+	(void)filepath;
+	(void)grid_name;
+	return 0;
+#endif
+}
+
+bool volume_grid_vdb_bounds(const string& filepath,
+                            const string& grid_name,
+                            int3 *origin,
+                            int3 *resolution,
+                            Transform *index_to_world)
+{
+#ifdef WITH_OPENVDB
+	OpenVDBReader *reader = OpenVDBReader_create();
+	OpenVDBReader_open(reader, filepath.c_str());
+	bool result = volume_grid_vdb_read_bounds(reader, grid_name, origin, resolution, index_to_world);
+	OpenVDBReader_free(reader);
+
+	return result;
+#else
+	(void)filepath;
+	(void)grid_name;
+	(void)origin;
+	(void)resolution;
+	(void)index_to_world;
+	return false;
+#endif
+}
+
+VolumeGrid *volume_grid_from_vdb(const string& filepath, const string& grid_name)
+{
+#ifdef WITH_OPENVDB
+	OpenVDBReader *reader = OpenVDBReader_create();
+	OpenVDBReader_open(reader, filepath.c_str());
+
+	int3 origin, resolution;
+	Transform index_to_world;
+	OpenVDBSparseGrid *vdb_grid = NULL;
+
+	if(volume_grid_vdb_read_bounds(reader, grid_name, &origin, &resolution, &index_to_world))
+		vdb_grid = OpenVDB_sparse_grid_read(reader, grid_name.c_str());
+
+	if(!vdb_grid) {
+		OpenVDBReader_free(reader);
+		return NULL;
+	}
+
+	int channels = OpenVDB_sparse_grid_channels(reader, grid_name.c_str());
+	float background[3];
+	OpenVDB_sparse_grid_background(vdb_grid, background);
+
+	VolumeGridVDBLeaves data;
+	data.grid = volume_grid_create(resolution.x, resolution.y, resolution.z, channels);
+	data.grid->background = make_float4(background[0], background[1], background[2], 1.0f);
+	data.origin = origin;
+
+	OpenVDB_sparse_grid_leaves(vdb_grid, volume_grid_vdb_leaf, &data);
+
+	OpenVDB_sparse_grid_free(vdb_grid);
+	OpenVDBReader_free(reader);
+
+	VLOG(1) << "Sparse volume grid " << grid_name << " from " << filepath << " "
+	        << resolution.x << "x" << resolution.y << "x" << resolution.z
+	        << " uses " << string_human_readable_size(data.grid->memory_size()) << ".";
+
+	return data.grid;
+#else
+	(void)filepath;
+	(void)grid_name;
+	return NULL;
+#endif
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __VOLUME_GRID_H__
+#define __VOLUME_GRID_H__
+
+#include "util_string.h"
+#include "util_transform.h"
+#include "util_types.h"
+
+CCL_NAMESPACE_BEGIN
+
+struct VolumeGrid;
+
+/* Sparse Volume Grids
+ *
+ * Conversion of dense 3D images and OpenVDB grids to the sparse storage used
+ * by the CPU kernel, see kernel_volume_grid_globals.h. */
+
+VolumeGrid *volume_grid_from_dense(const float *pixels,
+                                   int width,
+                                   int height,
+                                   int depth,
+                                   int channels);
+void volume_grid_to_dense(const VolumeGrid *grid, float *pixels, int channels);
+
+/* Majorants for empty space skipping, to be built once all voxels are set. */
+void volume_grid_build_majorants(VolumeGrid *grid);
+
+/* OpenVDB files. All float and vector grids in a file are mapped to the same
+ * index space bounds, so that they can share one texture space. Channels are
+ * 1 for float and 3 for vector grids, 0 if the grid can not be read. */
+int volume_grid_vdb_channels(const string& filepath, const string& grid_name);
+bool volume_grid_vdb_bounds(const string& filepath,
+                            const string& grid_name,
+                            int3 *origin,
+                            int3 *resolution,
+                            Transform *index_to_world);
+VolumeGrid *volume_grid_from_vdb(const string& filepath, const string& grid_name);
+
+CCL_NAMESPACE_END
+
+#endif /* __VOLUME_GRID_H__ */
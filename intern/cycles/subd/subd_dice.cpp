@@ -26,39 +26,9 @@ CCL_NAMESPACE_BEGIN
 
 /* EdgeDice Base */
 
-EdgeDice::EdgeDice(const SubdParams& params_)
-: params(params_)
+EdgeDice::EdgeDice(const SubdParams& params_, DiceBuffer *buffer_)
+: params(params_), buffer(buffer_)
 {
-	mesh_P = NULL;
-	mesh_N = NULL;
-	vert_offset = 0;
-
-	params.mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
-
-	if(params.ptex) {
-		params.mesh->attributes.add(ATTR_STD_PTEX_UV);
-		params.mesh->attributes.add(ATTR_STD_PTEX_FACE_ID);
-	}
-}
-
-void EdgeDice::reserve(int num_verts)
-{
-	Mesh *mesh = params.mesh;
-
-	vert_offset = mesh->verts.size();
-	tri_offset = mesh->num_triangles();
-
-	/* todo: optimize so we can reserve in advance, this is like push_back_slow() */
-	if(vert_offset + num_verts > mesh->verts.capacity()) {
-		mesh->reserve_mesh(size_t((vert_offset + num_verts) * 1.2), mesh->num_triangles());
-	}
-
-	mesh->resize_mesh(vert_offset + num_verts, tri_offset);
-
-	Attribute *attr_vN = mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
-
-	mesh_P = mesh->verts.data();
-	mesh_N = attr_vN->data_float3();
 }
 
 int EdgeDice::add_vert(Patch *patch, float2 uv)
@@ -67,45 +37,24 @@ int EdgeDice::add_vert(Patch *patch, float2 uv)
 
 	patch->eval(&P, NULL, NULL, &N, uv.x, uv.y);
 
-	assert(vert_offset < params.mesh->verts.size());
-
-	mesh_P[vert_offset] = P;
-	mesh_N[vert_offset] = N;
-	params.mesh->vert_patch_uv[vert_offset] = make_float2(uv.x, uv.y);
-
-	if(params.ptex) {
-		Attribute *attr_ptex_uv = params.mesh->attributes.add(ATTR_STD_PTEX_UV);
-		params.mesh->attributes.resize();
-
-		float3 *ptex_uv = attr_ptex_uv->data_float3();
-		ptex_uv[vert_offset] = make_float3(uv.x, uv.y, 0.0f);
-	}
-
-	params.mesh->num_subd_verts++;
+	buffer->P.push_back(P);
+	buffer->N.push_back(N);
+	buffer->uv.push_back(uv);
 
-	return vert_offset++;
+	return buffer->P.size() - 1;
 }
 
 void EdgeDice::add_triangle(Patch *patch, int v0, int v1, int v2)
 {
-	Mesh *mesh = params.mesh;
-
-	/* todo: optimize so we can reserve in advance, this is like push_back_slow() */
-	if(mesh->triangles.size() == mesh->triangles.capacity())
-		mesh->reserve_mesh(mesh->verts.size(), size_t(max(mesh->num_triangles() + 1, 1) * 1.2));
-
-	mesh->add_triangle(v0, v1, v2, patch->shader, true);
-	params.mesh->triangle_patch[params.mesh->num_triangles()-1] = patch->patch_index;
+	buffer->triangles.push_back(v0);
+	buffer->triangles.push_back(v1);
+	buffer->triangles.push_back(v2);
+	buffer->shader.push_back(patch->shader);
+	buffer->patch_index.push_back(patch->patch_index);
 
 	if(params.ptex) {
-		Attribute *attr_ptex_face_id = params.mesh->attributes.add(ATTR_STD_PTEX_FACE_ID);
-		params.mesh->attributes.resize();
-
-		float *ptex_face_id = attr_ptex_face_id->data_float();
-		ptex_face_id[tri_offset] = (float)patch->ptex_face_id();
+		buffer->ptex_face_id.push_back(patch->ptex_face_id());
 	}
-
-	tri_offset++;
 }
 
 void EdgeDice::stitch_triangles(Patch *patch, vector<int>& outer, vector<int>& inner)
@@ -117,6 +66,8 @@ void EdgeDice::stitch_triangles(Patch *patch, vector<int>& outer, vector<int>& i
 	 * we compare using the next verts on both sides, to find the split
 	 * direction with the smallest diagonal, and use that in order to keep
 	 * the triangle shape reasonable. */
+	const float3 *P = &buffer->P[0];
+
 	for(size_t i = 0, j = 0; i+1 < inner.size() || j+1 < outer.size();) {
 		int v0, v1, v2;
 
@@ -131,8 +82,8 @@ void EdgeDice::stitch_triangles(Patch *patch, vector<int>& outer, vector<int>& i
 		}
 		else {
 			/* length of diagonals */
-			float len1 = len_squared(mesh_P[inner[i]] - mesh_P[outer[j+1]]);
-			float len2 = len_squared(mesh_P[outer[j]] - mesh_P[inner[i+1]]);
+			float len1 = len_squared(P[inner[i]] - P[outer[j+1]]);
+			float len2 = len_squared(P[outer[j]] - P[inner[i+1]]);
 
 			/* use smallest diagonal */
 			if(len1 < len2)
@@ -147,16 +98,9 @@ void EdgeDice::stitch_triangles(Patch *patch, vector<int>& outer, vector<int>& i
 
 /* QuadDice */
 
-QuadDice::QuadDice(const SubdParams& params_)
-: EdgeDice(params_)
-{
-}
-
-void QuadDice::reserve(EdgeFactors& ef, int Mu, int Mv)
+QuadDice::QuadDice(const SubdParams& params_, DiceBuffer *buffer_)
+: EdgeDice(params_, buffer_)
 {
-	/* XXX need to make this also work for edge factor 0 and 1 */
-	int num_verts = (ef.tu0 + ef.tu1 + ef.tv0 + ef.tv1) + (Mu - 1)*(Mv - 1);
-	EdgeDice::reserve(num_verts);
 }
 
 float2 QuadDice::map_uv(SubPatch& sub, float u, float v)
@@ -305,24 +249,33 @@ void QuadDice::add_grid(SubPatch& sub, int Mu, int Mv, int offset)
 	}
 }
 
-void QuadDice::dice(SubPatch& sub, EdgeFactors& ef)
+void QuadDice::grid_size(const EdgeFactors& ef, int *Mu, int *Mv)
 {
-	/* compute inner grid size with scale factor */
-	int Mu = max(ef.tu0, ef.tu1);
-	int Mv = max(ef.tv0, ef.tv1);
+	/* inner grid size, not adjusted with scale_factor() as that doesn't work
+	 * very well, especially at grazing angles */
+	*Mu = max(max(ef.tu0, ef.tu1), 2); // XXX handle 0 & 1?
+	*Mv = max(max(ef.tv0, ef.tv1), 2); // XXX handle 0 & 1?
+}
 
-#if 0 /* Doesnt work very well, especially at grazing angles. */
-	float S = scale_factor(sub, ef, Mu, Mv);
-#else
-	float S = 1.0f;
-#endif
+void QuadDice::dice_size(const EdgeFactors& ef, size_t *num_verts, size_t *num_triangles)
+{
+	int Mu, Mv;
+	grid_size(ef, &Mu, &Mv);
 
-	Mu = max((int)ceil(S*Mu), 2); // XXX handle 0 & 1?
-	Mv = max((int)ceil(S*Mv), 2); // XXX handle 0 & 1?
+	/* corners, inner grid and verts along the sides */
+	*num_verts = 4 + (Mu-1)*(Mv-1) + (ef.tu0-1) + (ef.tu1-1) + (ef.tv0-1) + (ef.tv1-1);
 
-	/* reserve space for new verts */
-	int offset = params.mesh->verts.size();
-	reserve(ef, Mu, Mv);
+	/* inner grid quads, and stitching adds one triangle per step along
+	 * either the inner or the outer verts of each side */
+	*num_triangles = 2*(Mu-2)*(Mv-2) + 2*(Mu-2) + 2*(Mv-2) + ef.tu0 + ef.tu1 + ef.tv0 + ef.tv1;
+}
+
+void QuadDice::dice(SubPatch& sub, EdgeFactors& ef)
+{
+	int Mu, Mv;
+	grid_size(ef, &Mu, &Mv);
+
+	int offset = buffer->num_verts();
 
 	/* corners and inner grid */
 	add_corners(sub);
@@ -345,8 +298,6 @@ void QuadDice::dice(SubPatch& sub, EdgeFactors& ef)
 	/* right side */
 	add_side_v(sub, outer, inner, Mu, Mv, ef.tv1, 1, offset);
 	stitch_triangles(sub.patch, outer, inner);
-
-	assert(vert_offset == params.mesh->verts.size());
 }
 
 CCL_NAMESPACE_END
@@ -56,19 +56,34 @@ struct SubdParams {
 
 };
 
+/* Diced Geometry
+ *
+ * Patches are diced on multiple threads, each into its own buffer which is
+ * appended to the mesh afterwards. Triangle vertex indices are local to the
+ * buffer. */
+
+struct DiceBuffer {
+	vector<float3> P;
+	vector<float3> N;
+	vector<float2> uv;
+
+	vector<int> triangles;
+	vector<int> shader;
+	vector<int> patch_index;
+	vector<int> ptex_face_id;
+
+	size_t num_verts() const { return P.size(); }
+	size_t num_triangles() const { return shader.size(); }
+};
+
 /* EdgeDice Base */
 
 class EdgeDice {
 public:
 	SubdParams params;
-	float3 *mesh_P;
-	float3 *mesh_N;
-	size_t vert_offset;
-	size_t tri_offset;
+	DiceBuffer *buffer;
 
-	explicit EdgeDice(const SubdParams& params);
-
-	void reserve(int num_verts);
+	EdgeDice(const SubdParams& params, DiceBuffer *buffer);
 
 	int add_vert(Patch *patch, float2 uv);
 	void add_triangle(Patch *patch, int v0, int v1, int v2);
@@ -107,9 +122,8 @@ public:
 		int tv1;
 	};
 
-	explicit QuadDice(const SubdParams& params);
+	QuadDice(const SubdParams& params, DiceBuffer *buffer);
 
-	void reserve(EdgeFactors& ef, int Mu, int Mv);
 	float3 eval_projected(SubPatch& sub, float u, float v);
 
 	float2 map_uv(SubPatch& sub, float u, float v);
@@ -129,6 +143,10 @@ public:
 	float quad_area(const float3& a, const float3& b, const float3& c, const float3& d);
 	float scale_factor(SubPatch& sub, EdgeFactors& ef, int Mu, int Mv);
 
+	static void grid_size(const EdgeFactors& ef, int *Mu, int *Mv);
+	/* number of verts and triangles dice() adds, without evaluating the patch */
+	static void dice_size(const EdgeFactors& ef, size_t *num_verts, size_t *num_triangles);
+
 	void dice(SubPatch& sub, EdgeFactors& ef);
 };
 
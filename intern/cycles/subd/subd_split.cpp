@@ -239,23 +239,44 @@ void DiagSplit::split_quad(Patch *patch, QuadDice::SubPatch *subpatch)
 	limit_edge_factors(sub_split, ef_split, 1 << params.max_level);
 
 	split(sub_split, ef_split);
+}
+
+static QuadDice::EdgeFactors dice_edge_factors(const QuadDice::EdgeFactors& ef)
+{
+	QuadDice::EdgeFactors result;
 
-	QuadDice dice(params);
+	result.tu0 = max(ef.tu0, 1);
+	result.tu1 = max(ef.tu1, 1);
+	result.tv0 = max(ef.tv0, 1);
+	result.tv1 = max(ef.tv1, 1);
 
-	for(size_t i = 0; i < subpatches_quad.size(); i++) {
-		QuadDice::SubPatch& sub = subpatches_quad[i];
-		QuadDice::EdgeFactors& ef = edgefactors_quad[i];
+	return result;
+}
+
+void DiagSplit::dice(DiceBuffer *buffer, size_t start, size_t end)
+{
+	QuadDice dice(params, buffer);
 
-		ef.tu0 = max(ef.tu0, 1);
-		ef.tu1 = max(ef.tu1, 1);
-		ef.tv0 = max(ef.tv0, 1);
-		ef.tv1 = max(ef.tv1, 1);
+	for(size_t i = start; i < end; i++) {
+		QuadDice::SubPatch sub = subpatches_quad[i];
+		QuadDice::EdgeFactors ef = dice_edge_factors(edgefactors_quad[i]);
 
 		dice.dice(sub, ef);
 	}
+}
+
+void DiagSplit::dice_size(size_t start, size_t end, size_t *num_verts, size_t *num_triangles)
+{
+	*num_verts = 0;
+	*num_triangles = 0;
 
-	subpatches_quad.clear();
-	edgefactors_quad.clear();
+	for(size_t i = start; i < end; i++) {
+		size_t verts, triangles;
+		QuadDice::dice_size(dice_edge_factors(edgefactors_quad[i]), &verts, &triangles);
+
+		*num_verts += verts;
+		*num_triangles += triangles;
+	}
 }
 
 CCL_NAMESPACE_END
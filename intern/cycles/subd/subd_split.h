@@ -52,6 +52,12 @@ public:
 	void split(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef, int depth=0);
 
 	void split_quad(Patch *patch, QuadDice::SubPatch *subpatch=NULL);
+
+	/* Dice subpatches in the range start to end into buffer. Splitting only
+	 * adds subpatches, so that dicing them can be done in parallel. */
+	void dice(DiceBuffer *buffer, size_t start, size_t end);
+	/* Number of verts and triangles dice() adds for the same range. */
+	void dice_size(size_t start, size_t end, size_t *num_verts, size_t *num_triangles);
 };
 
 CCL_NAMESPACE_END
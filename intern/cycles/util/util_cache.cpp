@@ -0,0 +1,164 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "util_cache.h"
+#include "util_logging.h"
+#include "util_path.h"
+#include "util_time.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Bump when the layout of the file header changes. */
+#define CACHE_MAGIC 0x43594343 /* CYCC */
+#define CACHE_VERSION 1
+
+struct CacheHeader {
+	uint magic;
+	uint version;
+	uint64_t size;
+};
+
+/* Cache Data */
+
+CacheData::CacheData()
+: offset(0)
+{
+}
+
+void CacheData::add_data(const void *data, size_t size)
+{
+	if(size == 0)
+		return;
+
+	size_t start = buffer.size();
+	buffer.resize(start + size);
+	memcpy(&buffer[start], data, size);
+}
+
+bool CacheData::read_data(void *data, size_t size)
+{
+	if(size > buffer.size() - offset)
+		return false;
+
+	if(size) {
+		memcpy(data, &buffer[offset], size);
+		offset += size;
+	}
+
+	return true;
+}
+
+/* Cache */
+
+string Cache::filepath(const string& category, const string& key)
+{
+	return path_cache_get(path_join(category, key));
+}
+
+bool Cache::read(const string& category, const string& key, CacheData& data)
+{
+	string path = filepath(category, key);
+	FILE *f = path_fopen(path, "rb");
+
+	if(!f)
+		return false;
+
+	/* The size in the header is only trusted when it matches the file, a
+	 * truncated or corrupt file must not cause a huge allocation. */
+	size_t file_size = path_file_size(path);
+
+	CacheHeader header;
+	bool ok = (fread(&header, sizeof(header), 1, f) == 1 &&
+	           header.magic == CACHE_MAGIC &&
+	           header.version == CACHE_VERSION &&
+	           file_size != (size_t)-1 &&
+	           file_size >= sizeof(header) &&
+	           header.size == file_size - sizeof(header));
+
+	if(ok) {
+		data.buffer.resize(header.size);
+		data.offset = 0;
+
+		if(header.size)
+			ok = (fread(&data.buffer[0], header.size, 1, f) == 1);
+	}
+
+	fclose(f);
+
+	if(!ok) {
+		VLOG(1) << "Ignoring invalid cache file " << path << ".";
+		data.buffer.clear();
+		return false;
+	}
+
+	/* Keep recently used files when trimming. */
+	path_touch(path);
+
+	return true;
+}
+
+bool Cache::write(const string& category, const string& key, const CacheData& data)
+{
+	string path = filepath(category, key);
+
+	/* Unique temporary file so concurrent writers never see partial files. */
+	string tmp_path = string_printf("%s.%p.%.0f.tmp",
+	                                path.c_str(),
+	                                (const void*)&data,
+	                                time_dt()*1e6);
+
+	path_create_directories(path);
+	FILE *f = path_fopen(tmp_path, "wb");
+
+	if(!f)
+		return false;
+
+	CacheHeader header;
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.size = data.buffer.size();
+
+	bool ok = (fwrite(&header, sizeof(header), 1, f) == 1);
+	if(ok && header.size)
+		ok = (fwrite(&data.buffer[0], header.size, 1, f) == 1);
+
+	ok = (fclose(f) == 0) && ok;
+
+	if(ok && rename(tmp_path.c_str(), path.c_str()) != 0) {
+		/* Another process may have written the same file in the meantime,
+		 * which has the same content. */
+		ok = path_exists(path);
+	}
+
+	path_remove(tmp_path);
+
+	if(!ok) {
+		VLOG(1) << "Failed to write cache file " << path << ".";
+	}
+
+	return ok;
+}
+
+void Cache::trim(const string& category, uint64_t max_size)
+{
+	path_cache_trim(path_cache_get(category), max_size);
+}
+
+CCL_NAMESPACE_END
+
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __UTIL_CACHE_H__
+#define __UTIL_CACHE_H__
+
+/* Disk Cache
+ *
+ * Stores binary data in the user cache directory, named by a content hash
+ * of everything the data was computed from. Used to skip preprocessing of
+ * unchanged data in consecutive frames and re-renders.
+ *
+ * Files are written to a temporary file first and then renamed, so multiple
+ * processes can share the same cache directory, for example on a render
+ * farm. Data is read back in the same order it was added.
+ *
+ * Reading a file marks it as used, trim() removes the least recently used
+ * files of a category once it grows above a size limit. */
+
+#include "util_string.h"
+#include "util_types.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class CacheData {
+public:
+	CacheData();
+
+	void add_data(const void *data, size_t size);
+
+	template<typename T> void add(const T& value)
+	{
+		add_data(&value, sizeof(T));
+	}
+
+	template<typename T> void add(const T *data, size_t count)
+	{
+		add(count);
+		add_data(data, count*sizeof(T));
+	}
+
+	/* Returns false when the data is truncated or corrupt. */
+	bool read_data(void *data, size_t size);
+
+	template<typename T> bool read(T& value)
+	{
+		return read_data(&value, sizeof(T));
+	}
+
+	template<typename T> bool read(array<T>& data)
+	{
+		size_t count;
+		if(!read(count) || count > (buffer.size() - offset)/sizeof(T))
+			return false;
+
+		data.resize(count);
+		return read_data(data.data(), count*sizeof(T));
+	}
+
+	vector<uint8_t> buffer;
+	size_t offset;
+};
+
+class Cache {
+public:
+	/* Filepath of the cache file for a key in a category. */
+	static string filepath(const string& category, const string& key);
+
+	static bool read(const string& category, const string& key, CacheData& data);
+	static bool write(const string& category, const string& key, const CacheData& data);
+	static void trim(const string& category, uint64_t max_size);
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_CACHE_H__ */
+
@@ -29,7 +29,11 @@ DebugFlags::CPU::CPU()
     sse41(true),
     sse3(true),
     sse2(true),
-    qbvh(true)
+    qbvh(true),
+    obvh(true),
+    stream(false),
+    shader_jit(false),
+    shader_jit_verify(false)
 {
 	reset();
 }
@@ -55,6 +59,10 @@ void DebugFlags::CPU::reset()
 #undef CHECK_CPU_FLAGS
 
 	qbvh = true;
+	obvh = true;
+	stream = false;
+	shader_jit = false;
+	shader_jit_verify = false;
 }
 
 DebugFlags::CUDA::CUDA()
@@ -46,6 +46,18 @@ public:
 
 		/* Whether QBVH usage is allowed or not. */
 		bool qbvh;
+
+		/* Whether OBVH usage is allowed or not, only used with AVX2. */
+		bool obvh;
+
+		/* Whether to trace paths breadth-first in batches, when the scene
+		 * does not use features unsupported by the ray stream kernel. */
+		bool stream;
+
+		/* Whether to compile surface shaders to native code at runtime,
+		 * and whether to check their results against the interpreter. */
+		bool shader_jit;
+		bool shader_jit_verify;
 	};
 
 	/* Descriptor of CUDA feature-set to be used. */
@@ -19,6 +19,10 @@
 
 #include "util_types.h"
 
+#ifndef __KERNEL_GPU__
+#include "util_math.h"
+#endif
+
 #ifdef __KERNEL_SSE2__
 #include "util_simd.h"
 #endif
@@ -114,6 +118,41 @@ ccl_device_inline float4 half4_to_float4(half4 h)
 
 #endif
 
+/* Half floats stored as bits of a uint, for compact mesh attributes. Unlike
+ * the conversion for pixels above these handle negative values and zero,
+ * denormals are flushed to zero and overflow is clamped to the largest
+ * finite half. Usable on all devices. */
+
+ccl_device_inline uint float_to_half_bits(float f)
+{
+	uint x = __float_as_uint(f);
+	uint sign = (x >> 16) & 0x8000;
+	int exponent = (int)((x >> 23) & 0xFF) - 127 + 15;
+	uint mantissa = x & 0x7FFFFF;
+
+	if(exponent <= 0)
+		return sign;
+	if(exponent >= 31)
+		return sign | 0x7BFF;
+
+	/* round to nearest, a carry into the exponent is correct */
+	uint h = ((uint)exponent << 10) | (mantissa >> 13);
+	h += (mantissa >> 12) & 1;
+
+	return sign | ((h < 0x7C00)? h: 0x7BFF);
+}
+
+ccl_device_inline float half_bits_to_float(uint h)
+{
+	uint sign = (h & 0x8000) << 16;
+	uint exponent = (h >> 10) & 0x1F;
+
+	if(exponent == 0)
+		return __uint_as_float(sign);
+
+	return __uint_as_float(sign | ((exponent + 112) << 23) | ((h & 0x3FF) << 13));
+}
+
 CCL_NAMESPACE_END
 
 #endif /* __UTIL_HALF_H__ */
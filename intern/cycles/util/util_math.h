@@ -1380,6 +1380,47 @@ ccl_device_inline float3 rotate_around_axis(float3 p, float3 axis, float angle)
 	return r;
 }
 
+/* Octahedral encoding of unit vectors, "A Survey of Efficient Representations
+ * for Independent Unit Vectors", Cigolle et al. Both coordinates are stored
+ * with 16 bits in a single uint, with a maximum error below 0.05 degrees. */
+
+ccl_device_inline uint float3_to_octahedral(float3 n)
+{
+	float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	float u = 0.0f, v = 0.0f;
+
+	if(l1 > 0.0f) {
+		u = n.x/l1;
+		v = n.y/l1;
+
+		if(n.z < 0.0f) {
+			float t = u;
+			u = (1.0f - fabsf(v))*signf(t);
+			v = (1.0f - fabsf(t))*signf(v);
+		}
+	}
+
+	uint x = (uint)float_to_int(clamp(u*0.5f + 0.5f, 0.0f, 1.0f)*65535.0f + 0.5f);
+	uint y = (uint)float_to_int(clamp(v*0.5f + 0.5f, 0.0f, 1.0f)*65535.0f + 0.5f);
+
+	return x | (y << 16);
+}
+
+ccl_device_inline float3 octahedral_to_float3(uint e)
+{
+	float u = (e & 0xFFFF)*(2.0f/65535.0f) - 1.0f;
+	float v = (e >> 16)*(2.0f/65535.0f) - 1.0f;
+	float z = 1.0f - fabsf(u) - fabsf(v);
+
+	if(z < 0.0f) {
+		float t = u;
+		u = (1.0f - fabsf(v))*signf(t);
+		v = (1.0f - fabsf(t))*signf(v);
+	}
+
+	return normalize(make_float3(u, v, z));
+}
+
 /* NaN-safe math ops */
 
 ccl_device_inline float safe_sqrtf(float f)
@@ -27,17 +27,21 @@ OIIO_NAMESPACE_USING
 
 #include <stdio.h>
 
+#include <algorithm>
+
 #include <sys/stat.h>
 
 #if defined(_WIN32)
 #  define DIR_SEP '\\'
 #  define DIR_SEP_ALT '/'
 #  include <direct.h>
+#  include <sys/utime.h>
 #else
 #  define DIR_SEP '/'
 #  include <dirent.h>
 #  include <pwd.h>
 #  include <unistd.h>
+#  include <utime.h>
 #  include <sys/types.h>
 #endif
 
@@ -767,6 +771,16 @@ bool path_remove(const string& path)
 	return remove(path.c_str()) == 0;
 }
 
+bool path_touch(const string& path)
+{
+#ifdef _WIN32
+	wstring path_wc = string_to_wstring(path_make_compatible(path));
+	return _wutime(path_wc.c_str(), NULL) == 0;
+#else
+	return utime(path.c_str(), NULL) == 0;
+#endif
+}
+
 static string line_directive(const string& path, int line)
 {
 	string escaped_path = path;
@@ -854,5 +868,56 @@ void path_cache_clear_except(const string& name, const set<string>& except)
 
 }
 
+namespace {
+
+struct CacheFile {
+	uint64_t modified_time;
+	uint64_t size;
+	string path;
+
+	bool operator<(const CacheFile& other) const
+	{
+		return modified_time < other.modified_time;
+	}
+};
+
+}  /* namespace */
+
+void path_cache_trim(const string& dir, uint64_t max_size)
+{
+	if(!path_exists(dir))
+		return;
+
+	vector<CacheFile> files;
+	uint64_t total_size = 0;
+
+	directory_iterator it(dir), it_end;
+
+	for(; it != it_end; ++it) {
+		CacheFile file;
+		file.path = it->path();
+
+		if(path_is_directory(file.path))
+			continue;
+
+		size_t size = path_file_size(file.path);
+		if(size == (size_t)-1)
+			continue;
+
+		file.size = size;
+		file.modified_time = path_modified_time(file.path);
+		total_size += file.size;
+		files.push_back(file);
+	}
+
+	/* remove least recently used files first */
+	std::sort(files.begin(), files.end());
+
+	for(size_t i = 0; i < files.size() && total_size > max_size; i++) {
+		if(path_remove(files[i].path))
+			total_size -= files[i].size;
+	}
+}
+
 CCL_NAMESPACE_END
 
@@ -25,7 +25,7 @@ class Stats {
 public:
 	enum static_init_t { static_init = 0 };
 
-	Stats() : mem_used(0), mem_peak(0) {}
+	Stats() : mem_used(0), mem_peak(0), num_rays(0) {}
 	explicit Stats(static_init_t) {}
 
 	void mem_alloc(size_t size) {
@@ -38,8 +38,15 @@ public:
 		atomic_sub_and_fetch_z(&mem_used, size);
 	}
 
+	void add_rays(uint64_t num) {
+		atomic_add_and_fetch_uint64(&num_rays, num);
+	}
+
 	size_t mem_used;
 	size_t mem_peak;
+
+	/* rays traced by the CPU device */
+	uint64_t num_rays;
 };
 
 CCL_NAMESPACE_END
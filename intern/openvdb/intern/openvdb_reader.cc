@@ -114,7 +114,7 @@ void OpenVDBReader::mat4sMeta(const openvdb::Name &name, float value[4][4]) cons
 
 bool OpenVDBReader::hasGrid(const openvdb::Name &name) const
 {
-	return m_file->hasGrid(name);
+	return m_file && m_file->hasGrid(name);
 }
 
 openvdb::GridBase::Ptr OpenVDBReader::getGrid(const openvdb::Name &name) const
@@ -122,6 +122,16 @@ openvdb::GridBase::Ptr OpenVDBReader::getGrid(const openvdb::Name &name) const
 	return m_file->readGrid(name);
 }
 
+openvdb::GridBase::Ptr OpenVDBReader::getGridMetadata(const openvdb::Name &name) const
+{
+	return m_file->readGridMetadata(name);
+}
+
+openvdb::GridPtrVecPtr OpenVDBReader::getGridsMetadata() const
+{
+	return m_file->readAllGridMetadata();
+}
+
 size_t OpenVDBReader::numGrids() const
 {
 	return m_file->getGrids()->size();
@@ -132,5 +142,6 @@ void OpenVDBReader::cleanupFile()
 	if (m_file) {
 		m_file->close();
 		delete m_file;
+		m_file = NULL;
 	}
 }
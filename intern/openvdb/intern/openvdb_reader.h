@@ -49,6 +49,8 @@ public:
 
 	bool hasGrid(const openvdb::Name &name) const;
 	openvdb::GridBase::Ptr getGrid(const openvdb::Name &name) const;
+	openvdb::GridBase::Ptr getGridMetadata(const openvdb::Name &name) const;
+	openvdb::GridPtrVecPtr getGridsMetadata() const;
 	size_t numGrids() const;
 };
 
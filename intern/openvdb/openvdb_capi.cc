@@ -31,6 +31,10 @@ struct OpenVDBFloatGrid { int unused; };
 struct OpenVDBIntGrid { int unused; };
 struct OpenVDBVectorGrid { int unused; };
 
+struct OpenVDBSparseGrid {
+	openvdb::GridBase::Ptr grid;
+};
+
 int OpenVDB_getVersionHex()
 {
 	return openvdb::OPENVDB_LIBRARY_VERSION;
@@ -139,6 +143,171 @@ void OpenVDB_import_grid_vec(
 	internal::OpenVDB_import_grid_vector(reader, name, data_x, data_y, data_z, res);
 }
 
+int OpenVDB_sparse_grid_channels(OpenVDBReader *reader, const char *name)
+{
+	if (!reader->hasGrid(name)) {
+		return 0;
+	}
+
+	openvdb::GridBase::Ptr grid = reader->getGridMetadata(name);
+
+	if (grid->isType<openvdb::FloatGrid>()) {
+		return 1;
+	}
+	else if (grid->isType<openvdb::Vec3SGrid>()) {
+		return 3;
+	}
+
+	return 0;
+}
+
+bool OpenVDB_sparse_grid_bounds(
+        OpenVDBReader *reader,
+        const char *name,
+        int bbox_min[3], int bbox_max[3],
+        float matrix[4][4])
+{
+	using namespace openvdb;
+
+	if (OpenVDB_sparse_grid_channels(reader, name) == 0) {
+		return false;
+	}
+
+	CoordBBox file_bbox;
+	GridPtrVecPtr grids = reader->getGridsMetadata();
+
+	for (GridPtrVec::const_iterator it = grids->begin(); it != grids->end(); ++it) {
+		const GridBase::Ptr &grid = *it;
+
+		if (!grid->isType<FloatGrid>() && !grid->isType<Vec3SGrid>()) {
+			continue;
+		}
+
+		/* Written by default, otherwise the whole grid has to be read. */
+		Vec3IMetadata::ConstPtr meta_min = grid->getMetadata<Vec3IMetadata>(GridBase::META_FILE_BBOX_MIN);
+		Vec3IMetadata::ConstPtr meta_max = grid->getMetadata<Vec3IMetadata>(GridBase::META_FILE_BBOX_MAX);
+		CoordBBox bbox;
+
+		if (meta_min && meta_max) {
+			bbox = CoordBBox(Coord(meta_min->value()), Coord(meta_max->value()));
+		}
+		else {
+			bbox = reader->getGrid(grid->getName())->evalActiveVoxelBoundingBox();
+		}
+
+		if (!bbox.empty()) {
+			file_bbox.expand(bbox);
+		}
+	}
+
+	if (file_bbox.empty()) {
+		return false;
+	}
+
+	for (int i = 0; i < 3; ++i) {
+		bbox_min[i] = file_bbox.min()[i];
+		bbox_max[i] = file_bbox.max()[i];
+	}
+
+	GridBase::Ptr grid = reader->getGridMetadata(name);
+	Mat4R mat = grid->transform().baseMap()->getAffineMap()->getMat4();
+
+	for (int i = 0; i < 4; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			matrix[i][j] = mat[i][j];
+		}
+	}
+
+	return true;
+}
+
+OpenVDBSparseGrid *OpenVDB_sparse_grid_read(OpenVDBReader *reader, const char *name)
+{
+	Timer(__func__);
+
+	if (OpenVDB_sparse_grid_channels(reader, name) == 0) {
+		std::fprintf(stderr, "OpenVDB float or vector grid %s not found in file!\n", name);
+		return NULL;
+	}
+
+	OpenVDBSparseGrid *sparse_grid = new OpenVDBSparseGrid();
+	sparse_grid->grid = reader->getGrid(name);
+
+	/* Constant tiles are stored as leaves, so all values are in leaves. */
+	if (sparse_grid->grid->isType<openvdb::FloatGrid>()) {
+		openvdb::gridPtrCast<openvdb::FloatGrid>(sparse_grid->grid)->tree().voxelizeActiveTiles();
+	}
+	else {
+		openvdb::gridPtrCast<openvdb::Vec3SGrid>(sparse_grid->grid)->tree().voxelizeActiveTiles();
+	}
+
+	return sparse_grid;
+}
+
+void OpenVDB_sparse_grid_background(OpenVDBSparseGrid *sparse_grid, float background[3])
+{
+	if (sparse_grid->grid->isType<openvdb::FloatGrid>()) {
+		openvdb::FloatGrid::Ptr grid = openvdb::gridPtrCast<openvdb::FloatGrid>(sparse_grid->grid);
+		background[0] = background[1] = background[2] = grid->background();
+	}
+	else {
+		openvdb::Vec3SGrid::Ptr grid = openvdb::gridPtrCast<openvdb::Vec3SGrid>(sparse_grid->grid);
+		background[0] = grid->background().x();
+		background[1] = grid->background().y();
+		background[2] = grid->background().z();
+	}
+}
+
+template <typename GridType>
+static void sparse_grid_leaves(const GridType &grid, const int channels,
+                               OpenVDBLeafFunc func, void *userdata)
+{
+	typedef typename GridType::TreeType::LeafNodeType LeafNodeType;
+	typedef typename GridType::ValueType ValueType;
+
+	const int dim = LeafNodeType::DIM;
+	std::vector<float> values(LeafNodeType::SIZE * channels);
+
+	for (typename GridType::TreeType::LeafCIter iter = grid.tree().cbeginLeaf(); iter; ++iter) {
+		const LeafNodeType &leaf = *iter;
+		const openvdb::Coord origin = leaf.origin();
+		const int leaf_origin[3] = {origin.x(), origin.y(), origin.z()};
+		size_t index = 0;
+
+		for (int z = 0; z < dim; ++z) {
+			for (int y = 0; y < dim; ++y) {
+				for (int x = 0; x < dim; ++x) {
+					const ValueType &value = leaf.getValue(LeafNodeType::coordToOffset(openvdb::Coord(x, y, z)));
+					const float *value_data = reinterpret_cast<const float *>(&value);
+
+					for (int c = 0; c < channels; ++c) {
+						values[index++] = value_data[c];
+					}
+				}
+			}
+		}
+
+		func(userdata, leaf_origin, &values[0], channels);
+	}
+}
+
+void OpenVDB_sparse_grid_leaves(OpenVDBSparseGrid *sparse_grid, OpenVDBLeafFunc func, void *userdata)
+{
+	Timer(__func__);
+
+	if (sparse_grid->grid->isType<openvdb::FloatGrid>()) {
+		sparse_grid_leaves(*openvdb::gridPtrCast<openvdb::FloatGrid>(sparse_grid->grid), 1, func, userdata);
+	}
+	else {
+		sparse_grid_leaves(*openvdb::gridPtrCast<openvdb::Vec3SGrid>(sparse_grid->grid), 3, func, userdata);
+	}
+}
+
+void OpenVDB_sparse_grid_free(OpenVDBSparseGrid *sparse_grid)
+{
+	delete sparse_grid;
+}
+
 OpenVDBWriter *OpenVDBWriter_create()
 {
 	return new OpenVDBWriter();
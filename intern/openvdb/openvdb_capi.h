@@ -35,6 +35,7 @@ struct OpenVDBWriter;
 struct OpenVDBFloatGrid;
 struct OpenVDBIntGrid;
 struct OpenVDBVectorGrid;
+struct OpenVDBSparseGrid;
 
 int OpenVDB_getVersionHex(void);
 
@@ -82,6 +83,42 @@ void OpenVDB_import_grid_vec(
         float **data_x, float **data_y, float **data_z,
         const int res[3]);
 
+/* Sparse access to float and vector grids, for renderers which store leaf
+ * nodes directly rather than a dense copy of the grid. Bounds are the union
+ * of the voxel bounding boxes of all float and vector grids in the file, the
+ * matrix transforms voxel index coordinates of the named grid to world space.
+ * Leaf values are ordered with x varying fastest, with 1 or 3 values per
+ * voxel. */
+typedef void (*OpenVDBLeafFunc)(void *userdata,
+                                const int origin[3],
+                                const float *values,
+                                const int channels);
+
+int OpenVDB_sparse_grid_channels(
+        struct OpenVDBReader *reader,
+        const char *name);
+
+bool OpenVDB_sparse_grid_bounds(
+        struct OpenVDBReader *reader,
+        const char *name,
+        int bbox_min[3], int bbox_max[3],
+        float matrix[4][4]);
+
+struct OpenVDBSparseGrid *OpenVDB_sparse_grid_read(
+        struct OpenVDBReader *reader,
+        const char *name);
+
+void OpenVDB_sparse_grid_background(
+        struct OpenVDBSparseGrid *grid,
+        float background[3]);
+
+void OpenVDB_sparse_grid_leaves(
+        struct OpenVDBSparseGrid *grid,
+        OpenVDBLeafFunc func,
+        void *userdata);
+
+void OpenVDB_sparse_grid_free(struct OpenVDBSparseGrid *grid);
+
 struct OpenVDBWriter *OpenVDBWriter_create(void);
 void OpenVDBWriter_free(struct OpenVDBWriter *writer);
 void OpenVDBWriter_set_flags(struct OpenVDBWriter *writer, const int flag, const bool half);
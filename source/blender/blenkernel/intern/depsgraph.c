@@ -240,6 +240,7 @@ void DAG_init(void)
 
 void DAG_exit(void)
 {
+	DEG_stats_free();
 	DEG_free_node_types();
 }
 
@@ -35,6 +35,8 @@
 
 #include <stdio.h>
 
+#include "DNA_ID.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -48,7 +50,16 @@ struct Depsgraph;
 /* Statistics */
 
 typedef struct DepsgraphStatsTimes {
+	/* Time spent in the last evaluation this entity took part in, seconds. */
 	float duration_last;
+	/* Maximum of duration_last over all evaluations. */
+	float duration_max;
+	/* Sum of all durations, used to calculate average. */
+	float duration_total;
+	/* Number of evaluations this entity took part in. */
+	int num_evaluations;
+	/* Index of the graph evaluation duration_last belongs to. */
+	int eval_index;
 } DepsgraphStatsTimes;
 
 typedef struct DepsgraphStatsComponent {
@@ -59,20 +70,65 @@ typedef struct DepsgraphStatsComponent {
 } DepsgraphStatsComponent;
 
 typedef struct DepsgraphStatsID {
-	struct ID *id;
-	
+	struct DepsgraphStatsID *next, *prev;
+
+	/* Copy of the ID name, statistics are looked up by it. */
+	char id_name[MAX_ID_NAME];
+
+
 	DepsgraphStatsTimes times;
 	ListBase components;
 } DepsgraphStatsID;
 
 typedef struct DepsgraphStats {
+	/* DepsgraphStatsID, keyed by ID name. */
 	struct GHash *id_stats;
+	/* DepsgraphStatsID, in order of their first evaluation. */
+	ListBase ids;
+
+	/* Number of graph evaluations since stats were enabled or reset. */
+	int num_evaluations;
+	/* Number of threads used by the last evaluation. */
+	int num_threads;
+	/* Wall-clock time of the last evaluation, seconds. */
+	float eval_duration_last;
+	/* Time spent in operations during the last evaluation, summed over all
+	 * threads, seconds.
+	 */
+	float eval_busy_last;
+	/* eval_busy_last relative to the time threads were available for the
+	 * last evaluation, in 0..1 range.
+	 */
+	float thread_utilization_last;
+	/* Change of guarded memory in use over the last evaluation, megabytes. */
+	float memory_delta_last;
+
+	/* Memory in use when the current evaluation started, bytes. */
+	size_t memory_begin;
+	/* Start time of the current evaluation. */
+	double eval_start_time;
+
+	/* Statistics are being collected. */
+	bool enabled;
 } DepsgraphStats;
 
+/* Get statistics, NULL when statistics are not collected. */
 struct DepsgraphStats *DEG_stats(void);
 
+/* Start collecting statistics (if not started yet). */
 void DEG_stats_verify(void);
 
+/* Clear all collected statistics, but keep collecting.
+ * Entries are zeroed rather than freed, so references to them stay valid.
+ */
+void DEG_stats_reset(void);
+
+/* Stop collecting statistics, already collected ones stay valid. */
+void DEG_stats_disable(void);
+
+/* Free statistics, only on exit since Python may still reference them. */
+void DEG_stats_free(void);
+
 struct DepsgraphStatsID *DEG_stats_id(struct ID *id);
 
 /* ------------------------------------------------ */
@@ -173,6 +173,8 @@ void deg_graph_build_finalize(Depsgraph *graph)
 		id_node->finalize_build();
 	}
 	GHASH_FOREACH_END();
+	/* STEP 4: Pack relations between operations for evaluation. */
+	graph->build_operation_links();
 }
 
 }  // namespace DEG
@@ -32,6 +32,8 @@
 
 extern "C" {
 #include "MEM_guardedalloc.h"
+
+#include "BLI_mempool.h"
 }
 
 #include "intern/nodes/deg_node.h"
@@ -96,15 +98,12 @@ void deg_graph_transitive_reduction(Depsgraph *graph)
 			deg_graph_tag_paths_recursive(rel->from);
 		}
 
-		/* Remove redundant paths to the target. */
-		for (DepsNode::Relations::const_iterator it_rel = target->inlinks.begin();
-		     it_rel != target->inlinks.end();
-		     )
-		{
-			DepsRelation *rel = *it_rel;
-			/* Increment in advance, so we can safely remove the relation. */
-			++it_rel;
-
+		/* Remove redundant paths to the target.
+		 *
+		 * Iterate over a copy since unlinking modifies the original list.
+		 */
+		DepsNode::Relations inlinks = target->inlinks;
+		foreach (DepsRelation *rel, inlinks) {
 			if (rel->from->type == DEPSNODE_TYPE_TIMESOURCE) {
 				/* HACK: time source nodes don't get "done" flag set/cleared. */
 				/* TODO: there will be other types in future, so iterators above
@@ -112,7 +111,9 @@ void deg_graph_transitive_reduction(Depsgraph *graph)
 				 */
 			}
 			else if (rel->from->done & OP_REACHABLE) {
-				OBJECT_GUARDED_DELETE(rel, DepsRelation);
+				rel->unlink();
+				rel->~DepsRelation();
+				BLI_mempool_free(graph->relations_pool, rel);
 			}
 		}
 	}
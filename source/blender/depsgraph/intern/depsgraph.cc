@@ -37,6 +37,7 @@
 #include "BLI_utildefines.h"
 #include "BLI_ghash.h"
 #include "BLI_listbase.h"
+#include "BLI_mempool.h"
 
 extern "C" {
 #include "DNA_action_types.h"
@@ -51,7 +52,9 @@ extern "C" {
 #include "RNA_access.h"
 }
 
+#include <algorithm>
 #include <cstring>
+#include <new>
 
 #include "DEG_depsgraph.h"
 
@@ -77,6 +80,7 @@ Depsgraph::Depsgraph()
 	id_hash = BLI_ghash_ptr_new("Depsgraph id hash");
 	subgraphs = BLI_gset_ptr_new("Depsgraph subgraphs");
 	entry_tags = BLI_gset_ptr_new("Depsgraph entry_tags");
+	relations_pool = BLI_mempool_create(sizeof(DepsRelation), 0, 1024, BLI_MEMPOOL_NOP);
 }
 
 Depsgraph::~Depsgraph()
@@ -90,6 +94,7 @@ Depsgraph::~Depsgraph()
 	if (this->root_node != NULL) {
 		OBJECT_GUARDED_DELETE(this->root_node, RootDepsNode);
 	}
+	BLI_mempool_destroy(relations_pool);
 	BLI_spin_end(&lock);
 }
 
@@ -371,7 +376,8 @@ DepsRelation *Depsgraph::add_new_relation(OperationDepsNode *from,
                                           const char *description)
 {
 	/* Create new relation, and add it to the graph. */
-	DepsRelation *rel = OBJECT_GUARDED_NEW(DepsRelation, from, to, type, description);
+	DepsRelation *rel = new(BLI_mempool_alloc(relations_pool))
+	        DepsRelation(from, to, type, description);
 	/* TODO(sergey): Find a better place for this. */
 #ifdef WITH_OPENSUBDIV
 	ComponentDepsNode *comp_node = from->owner;
@@ -395,7 +401,8 @@ DepsRelation *Depsgraph::add_new_relation(DepsNode *from, DepsNode *to,
                                           const char *description)
 {
 	/* Create new relation, and add it to the graph. */
-	DepsRelation *rel = OBJECT_GUARDED_NEW(DepsRelation, from, to, type, description);
+	DepsRelation *rel = new(BLI_mempool_alloc(relations_pool))
+	        DepsRelation(from, to, type, description);
 	return rel;
 }
 
@@ -454,6 +461,16 @@ DepsRelation::~DepsRelation()
 	BLI_assert(this->from && this->to);
 }
 
+void DepsRelation::unlink()
+{
+	DepsNode::Relations &outlinks = from->outlinks;
+	DepsNode::Relations &inlinks = to->inlinks;
+	outlinks.erase(std::remove(outlinks.begin(), outlinks.end(), this),
+	               outlinks.end());
+	inlinks.erase(std::remove(inlinks.begin(), inlinks.end(), this),
+	              inlinks.end());
+}
+
 /* Low level tagging -------------------------------------- */
 
 /* Tag a specific node as needing updates. */
@@ -478,6 +495,62 @@ void Depsgraph::clear_all_nodes()
 		OBJECT_GUARDED_DELETE(this->root_node, RootDepsNode);
 		root_node = NULL;
 	}
+	/* Relations are not referenced anymore, nodes they were connecting are
+	 * all freed.
+	 */
+	operation_links.clear();
+	BLI_mempool_clear(relations_pool);
+}
+
+void Depsgraph::build_operation_links()
+{
+	/* Count links first, so the array is allocated once and pointers to its
+	 * elements stay valid.
+	 */
+	size_t num_links = 0;
+	foreach (OperationDepsNode *node, operations) {
+		num_links += node->inlinks.size() + node->outlinks.size();
+	}
+	operation_links.clear();
+	operation_links.reserve(num_links);
+
+	foreach (OperationDepsNode *node, operations) {
+		node->num_eval_inlinks = 0;
+		node->num_eval_outlinks = 0;
+		foreach (DepsRelation *rel, node->inlinks) {
+			if (rel->from->type == DEPSNODE_TYPE_OPERATION &&
+			    (rel->flag & DEPSREL_FLAG_CYCLIC) == 0)
+			{
+				OperationLink link;
+				link.node = (OperationDepsNode *)rel->from;
+				link.is_cyclic = false;
+				operation_links.push_back(link);
+				++node->num_eval_inlinks;
+			}
+		}
+		foreach (DepsRelation *rel, node->outlinks) {
+			if (rel->to->type == DEPSNODE_TYPE_OPERATION) {
+				OperationLink link;
+				link.node = (OperationDepsNode *)rel->to;
+				link.is_cyclic = (rel->flag & DEPSREL_FLAG_CYCLIC) != 0;
+				operation_links.push_back(link);
+				++node->num_eval_outlinks;
+			}
+		}
+	}
+
+	/* Array is not going to be re-allocated anymore, assign pointers. */
+	size_t offset = 0;
+	foreach (OperationDepsNode *node, operations) {
+		node->eval_inlinks = (node->num_eval_inlinks != 0)
+		                     ? &operation_links[offset]
+		                     : NULL;
+		offset += node->num_eval_inlinks;
+		node->eval_outlinks = (node->num_eval_outlinks != 0)
+		                      ? &operation_links[offset]
+		                      : NULL;
+		offset += node->num_eval_outlinks;
+	}
 }
 
 void deg_editors_id_update(Main *bmain, ID *id)
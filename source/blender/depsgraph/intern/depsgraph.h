@@ -40,6 +40,7 @@
 
 #include "intern/depsgraph_types.h"
 
+struct BLI_mempool;
 struct ID;
 struct GHash;
 struct GSet;
@@ -88,6 +89,17 @@ struct DepsRelation {
 	             const char *description);
 
 	~DepsRelation();
+
+	/* Remove relation from the nodes it connects. */
+	void unlink();
+};
+
+/* Relation between two operations in the compact adjacency arrays which are
+ * used by evaluation.
+ */
+struct OperationLink {
+	OperationDepsNode *node;
+	bool is_cyclic;
 };
 
 /* ********* */
@@ -141,6 +153,11 @@ struct Depsgraph {
 	/* Clear storage used by all nodes. */
 	void clear_all_nodes();
 
+	/* Fill in operation_links from the relations of operation nodes.
+	 * Is to be called once the graph is fully built.
+	 */
+	void build_operation_links();
+
 	/* Core Graph Functionality ........... */
 
 	/* <ID : IDDepsNode> mapping from ID blocks to nodes representing these blocks
@@ -167,6 +184,17 @@ struct Depsgraph {
 	/* All operation nodes, sorted in order of single-thread traversal order. */
 	OperationNodes operations;
 
+	/* Relations between operations in CSR layout: every operation node points
+	 * to a contiguous range of this array for its incoming and outgoing links,
+	 * so evaluation doesn't need to go via individual DepsRelation.
+	 */
+	vector<OperationLink> operation_links;
+
+	/* Storage of all DepsRelation of this graph, they are freed all at once
+	 * together with the nodes.
+	 */
+	BLI_mempool *relations_pool;
+
 	/* Spin lock for threading-critical operations.
 	 * Mainly used by graph evaluation.
 	 */
@@ -49,6 +49,9 @@ extern "C" {
 
 DepsgraphStats *DEG_stats(void)
 {
+	if (!DEG::DepsgraphDebug::stats_enabled()) {
+		return NULL;
+	}
 	return DEG::DepsgraphDebug::stats;
 }
 
@@ -57,12 +60,30 @@ void DEG_stats_verify()
 	DEG::DepsgraphDebug::verify_stats();
 }
 
+void DEG_stats_reset()
+{
+	DEG::DepsgraphDebug::reset_stats();
+}
+
+void DEG_stats_disable()
+{
+	DEG::DepsgraphDebug::disable_stats();
+}
+
+void DEG_stats_free()
+{
+	DEG::DepsgraphDebug::stats_free();
+}
+
 DepsgraphStatsID *DEG_stats_id(ID *id)
 {
-	if (!DEG::DepsgraphDebug::stats) {
+	if (!DEG::DepsgraphDebug::stats_enabled()) {
 		return NULL;
 	}
-	return DEG::DepsgraphDebug::get_id_stats(id, false);
+	BLI_mutex_lock(&DEG::DepsgraphDebug::stats_mutex);
+	DepsgraphStatsID *id_stats = DEG::DepsgraphDebug::get_id_stats(id, false);
+	BLI_mutex_unlock(&DEG::DepsgraphDebug::stats_mutex);
+	return id_stats;
 }
 
 bool DEG_debug_compare(const struct Depsgraph *graph1,
@@ -59,11 +59,6 @@ extern "C" {
 /* Unfinished and unused, and takes quite some pre-processing time. */
 #undef USE_EVAL_PRIORITY
 
-/* Use integrated debugger to keep track how much each of the nodes was
- * evaluating.
- */
-#undef USE_DEBUGGER
-
 namespace DEG {
 
 /* ********************** */
@@ -80,6 +75,8 @@ struct DepsgraphEvalState {
 	EvaluationContext *eval_ctx;
 	Depsgraph *graph;
 	unsigned int layers;
+	/* Keep track how much each of the nodes was evaluating. */
+	bool do_stats;
 };
 
 static void deg_task_run_func(TaskPool *pool,
@@ -109,22 +106,22 @@ static void deg_task_run_func(TaskPool *pool,
 		 * but that's all fine, we'll just scheduler it's children.
 		 */
 		if (node->evaluate) {
-			/* Take note of current time. */
-#ifdef USE_DEBUGGER
-			double start_time = PIL_check_seconds_timer();
-			DepsgraphDebug::task_started(state->graph, node);
-#endif
+			if (state->do_stats) {
+				/* Take note of current time. */
+				const double start_time = PIL_check_seconds_timer();
 
-			/* Perform operation. */
-			node->evaluate(state->eval_ctx);
+				/* Perform operation. */
+				node->evaluate(state->eval_ctx);
 
-			/* Note how long this took. */
-#ifdef USE_DEBUGGER
-			double end_time = PIL_check_seconds_timer();
-			DepsgraphDebug::task_completed(state->graph,
-			                               node,
-			                               end_time - start_time);
-#endif
+				/* Note how long this took. */
+				DepsgraphDebug::task_completed(state->graph,
+				                               node,
+				                               PIL_check_seconds_timer() - start_time);
+			}
+			else {
+				/* Perform operation. */
+				node->evaluate(state->eval_ctx);
+			}
 		}
 
 		/* If there's only one outgoing link we try to immediately switch to
@@ -136,10 +133,9 @@ static void deg_task_run_func(TaskPool *pool,
 		 * TODO(sergey): Checks here can be de-duplicated with the ones from
 		 * schedule_node(), however, how to do it nicely?
 		 */
-		if (node->outlinks.size() == 1) {
-			DepsRelation *rel = node->outlinks[0];
-			OperationDepsNode *child = (OperationDepsNode *)rel->to;
-			BLI_assert(child->type == DEPSNODE_TYPE_OPERATION);
+		if (node->num_eval_outlinks == 1) {
+			const OperationLink &link = node->eval_outlinks[0];
+			OperationDepsNode *child = link.node;
 			if (!child->scheduled) {
 				unsigned int id_layers = child->owner->owner->layers;
 				if (!((child->flag & DEPSOP_FLAG_NEEDS_UPDATE) != 0 &&
@@ -151,7 +147,7 @@ static void deg_task_run_func(TaskPool *pool,
 					 */
 					break;
 				}
-				if ((rel->flag & DEPSREL_FLAG_CYCLIC) == 0) {
+				if (!link.is_cyclic) {
 					BLI_assert(child->num_links_pending > 0);
 					atomic_sub_and_fetch_uint32(&child->num_links_pending, 1);
 				}
@@ -216,17 +212,13 @@ static void calculate_pending_func(void *data_v, int i)
 	if ((id_node->layers & layers) != 0 &&
 	    (node->flag & DEPSOP_FLAG_NEEDS_UPDATE) != 0)
 	{
-		foreach (DepsRelation *rel, node->inlinks) {
-			if (rel->from->type == DEPSNODE_TYPE_OPERATION &&
-			    (rel->flag & DEPSREL_FLAG_CYCLIC) == 0)
+		for (int j = 0; j < node->num_eval_inlinks; ++j) {
+			OperationDepsNode *from = node->eval_inlinks[j].node;
+			IDDepsNode *id_from_node = from->owner->owner;
+			if ((id_from_node->layers & layers) != 0 &&
+			    (from->flag & DEPSOP_FLAG_NEEDS_UPDATE) != 0)
 			{
-				OperationDepsNode *from = (OperationDepsNode *)rel->from;
-				IDDepsNode *id_from_node = from->owner->owner;
-				if ((id_from_node->layers & layers) != 0 &&
-				    (from->flag & DEPSOP_FLAG_NEEDS_UPDATE) != 0)
-				{
-					++node->num_links_pending;
-				}
+				++node->num_links_pending;
 			}
 		}
 	}
@@ -328,9 +320,9 @@ static void schedule_children(TaskPool *pool,
                               const unsigned int layers,
                               const int thread_id)
 {
-	foreach (DepsRelation *rel, node->outlinks) {
-		OperationDepsNode *child = (OperationDepsNode *)rel->to;
-		BLI_assert(child->type == DEPSNODE_TYPE_OPERATION);
+	for (int i = 0; i < node->num_eval_outlinks; ++i) {
+		const OperationLink &link = node->eval_outlinks[i];
+		OperationDepsNode *child = link.node;
 		if (child->scheduled) {
 			/* Happens when having cyclic dependencies. */
 			continue;
@@ -339,7 +331,7 @@ static void schedule_children(TaskPool *pool,
 		              graph,
 		              layers,
 		              child,
-		              (rel->flag & DEPSREL_FLAG_CYCLIC) == 0,
+		              !link.is_cyclic,
 		              thread_id);
 	}
 }
@@ -377,12 +369,15 @@ void deg_evaluate_on_refresh(EvaluationContext *eval_ctx,
 	state.eval_ctx = eval_ctx;
 	state.graph = graph;
 	state.layers = layers;
+	state.do_stats = DepsgraphDebug::stats_enabled();
 
 	TaskScheduler *task_scheduler = BLI_task_scheduler_get();
 	TaskPool *task_pool = BLI_task_pool_create(task_scheduler, &state);
 
+	int num_threads = BLI_task_scheduler_num_threads(task_scheduler);
 	if (G.debug & G_DEBUG_DEPSGRAPH_NO_THREADS) {
 		BLI_pool_set_num_threads(task_pool, 1);
+		num_threads = 1;
 	}
 
 	calculate_pending_parents(graph, layers);
@@ -399,7 +394,7 @@ void deg_evaluate_on_refresh(EvaluationContext *eval_ctx,
 	}
 #endif
 
-	DepsgraphDebug::eval_begin(eval_ctx);
+	DepsgraphDebug::eval_begin(eval_ctx, num_threads);
 
 	schedule_graph(task_pool, graph, layers);
 
@@ -34,9 +34,15 @@
 
 #include <cstring>  /* required for STREQ later on. */
 
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+
 extern "C" {
 #include "BLI_listbase.h"
 #include "BLI_ghash.h"
+#include "BLI_math_base.h"
+#include "BLI_string.h"
 
 #include "DEG_depsgraph_debug.h"
 
@@ -52,11 +58,12 @@ extern "C" {
 namespace DEG {
 
 DepsgraphStats *DepsgraphDebug::stats = NULL;
+ThreadMutex DepsgraphDebug::stats_mutex = BLI_MUTEX_INITIALIZER;
 
 static string get_component_name(eDepsNode_Type type, const char *name = "")
 {
 	DepsNodeFactory *factory = deg_get_node_factory(type);
-	if (name[0] != '\0') {
+	if (name[0] == '\0') {
 		return string(factory->tname());
 	}
 	else {
@@ -64,25 +71,51 @@ static string get_component_name(eDepsNode_Type type, const char *name = "")
 	}
 }
 
-static void times_clear(DepsgraphStatsTimes &times)
-{
-	times.duration_last = 0.0f;
-}
-
-static void times_add(DepsgraphStatsTimes &times, float time)
+static void times_add(DepsgraphStatsTimes &times, float time, int eval_index)
 {
+	if (times.eval_index != eval_index) {
+		/* First operation of the entity in this evaluation. */
+		times.eval_index = eval_index;
+		times.duration_last = 0.0f;
+		++times.num_evaluations;
+	}
 	times.duration_last += time;
+	times.duration_total += time;
+	times.duration_max = max_ff(times.duration_max, times.duration_last);
 }
 
-void DepsgraphDebug::eval_begin(const EvaluationContext *UNUSED(eval_ctx))
+void DepsgraphDebug::eval_begin(const EvaluationContext *UNUSED(eval_ctx),
+                                int num_threads)
 {
-	/* TODO(sergey): Stats are currently globally disabled. */
-	/* verify_stats(); */
-	reset_stats();
+	if (stats_enabled()) {
+		BLI_mutex_lock(&stats_mutex);
+		++stats->num_evaluations;
+		stats->num_threads = num_threads;
+		stats->eval_busy_last = 0.0f;
+		stats->memory_begin = MEM_get_memory_in_use();
+		stats->eval_start_time = PIL_check_seconds_timer();
+		BLI_mutex_unlock(&stats_mutex);
+	}
 }
 
 void DepsgraphDebug::eval_end(const EvaluationContext *UNUSED(eval_ctx))
 {
+	if (stats_enabled()) {
+		BLI_mutex_lock(&stats_mutex);
+		const double duration = PIL_check_seconds_timer() - stats->eval_start_time;
+		const size_t memory_end = MEM_get_memory_in_use();
+		stats->eval_duration_last = (float)duration;
+		if (duration > 0.0 && stats->num_threads > 0) {
+			stats->thread_utilization_last =
+			        min_ff(stats->eval_busy_last / (float)(duration * stats->num_threads), 1.0f);
+		}
+		else {
+			stats->thread_utilization_last = 0.0f;
+		}
+		stats->memory_delta_last =
+		        ((double)memory_end - (double)stats->memory_begin) / (1024.0 * 1024.0);
+		BLI_mutex_unlock(&stats_mutex);
+	}
 	WM_main_add_notifier(NC_SPACE | ND_SPACE_INFO_REPORT, NULL);
 }
 
@@ -97,61 +130,34 @@ void DepsgraphDebug::eval_step(const EvaluationContext *UNUSED(eval_ctx),
 #endif
 }
 
-void DepsgraphDebug::task_started(Depsgraph *graph,
-                                  const OperationDepsNode *node)
-{
-	if (stats) {
-		BLI_spin_lock(&graph->lock);
-
-		ComponentDepsNode *comp = node->owner;
-		ID *id = comp->owner->id;
-
-		DepsgraphStatsID *id_stats = get_id_stats(id, true);
-		times_clear(id_stats->times);
-
-		/* XXX TODO use something like: if (id->flag & ID_DEG_DETAILS) {...} */
-		if (0) {
-			/* XXX component name usage needs cleanup! currently mixes identifier
-			 * and description strings!
-			 */
-			DepsgraphStatsComponent *comp_stats =
-			        get_component_stats(id, get_component_name(comp->type,
-			                                                   comp->name).c_str(),
-			                            true);
-			times_clear(comp_stats->times);
-		}
-
-		BLI_spin_unlock(&graph->lock);
-	}
-}
-
-void DepsgraphDebug::task_completed(Depsgraph *graph,
+void DepsgraphDebug::task_completed(Depsgraph *UNUSED(graph),
                                     const OperationDepsNode *node,
                                     double time)
 {
+	/* Statistics are only freed on exit, so they are still here when they
+	 * got disabled during the evaluation.
+	 */
 	if (stats) {
-		BLI_spin_lock(&graph->lock);
-
 		ComponentDepsNode *comp = node->owner;
 		ID *id = comp->owner->id;
+		/* XXX component name usage needs cleanup! currently mixes identifier
+		 * and description strings!
+		 */
+		const string comp_name = get_component_name(comp->type, comp->name);
+
+		BLI_mutex_lock(&stats_mutex);
+
+		const int eval_index = stats->num_evaluations;
+		stats->eval_busy_last += (float)time;
 
 		DepsgraphStatsID *id_stats = get_id_stats(id, true);
-		times_add(id_stats->times, time);
-
-		/* XXX TODO use something like: if (id->flag & ID_DEG_DETAILS) {...} */
-		if (0) {
-			/* XXX component name usage needs cleanup! currently mixes identifier
-			 * and description strings!
-			 */
-			DepsgraphStatsComponent *comp_stats =
-			        get_component_stats(id,
-			                            get_component_name(comp->type,
-			                                               comp->name).c_str(),
-			                            true);
-			times_add(comp_stats->times, time);
-		}
+		times_add(id_stats->times, (float)time, eval_index);
+
+		DepsgraphStatsComponent *comp_stats =
+		        get_component_stats(id_stats, comp_name.c_str(), true);
+		times_add(comp_stats->times, (float)time, eval_index);
 
-		BLI_spin_unlock(&graph->lock);
+		BLI_mutex_unlock(&stats_mutex);
 	}
 }
 
@@ -175,12 +181,16 @@ void DepsgraphDebug::stats_init()
 	if (!stats) {
 		stats = (DepsgraphStats *)MEM_callocN(sizeof(DepsgraphStats),
 		                                      "Depsgraph Stats");
-		stats->id_stats = BLI_ghash_new(BLI_ghashutil_ptrhash,
-		                                BLI_ghashutil_ptrcmp,
-		                                "Depsgraph ID Stats Hash");
+		stats->id_stats = BLI_ghash_str_new("Depsgraph ID Stats Hash");
+		BLI_listbase_clear(&stats->ids);
 	}
 }
 
+bool DepsgraphDebug::stats_enabled()
+{
+	return stats != NULL && stats->enabled;
+}
+
 void DepsgraphDebug::stats_free()
 {
 	if (stats) {
@@ -193,6 +203,12 @@ void DepsgraphDebug::stats_free()
 void DepsgraphDebug::verify_stats()
 {
 	stats_init();
+	stats->enabled = true;
+}
+
+static void times_reset(DepsgraphStatsTimes &times)
+{
+	memset(&times, 0, sizeof(times));
 }
 
 void DepsgraphDebug::reset_stats()
@@ -200,25 +216,49 @@ void DepsgraphDebug::reset_stats()
 	if (!stats) {
 		return;
 	}
+	/* Python may hold references to the entries, so only zero them. */
+	BLI_mutex_lock(&stats_mutex);
+	for (DepsgraphStatsID *id_stats = (DepsgraphStatsID *)stats->ids.first;
+	     id_stats != NULL;
+	     id_stats = id_stats->next)
+	{
+		times_reset(id_stats->times);
+		for (DepsgraphStatsComponent *comp_stats = (DepsgraphStatsComponent *)id_stats->components.first;
+		     comp_stats != NULL;
+		     comp_stats = comp_stats->next)
+		{
+			times_reset(comp_stats->times);
+		}
+	}
+	stats->num_evaluations = 0;
+	stats->eval_duration_last = 0.0f;
+	stats->eval_busy_last = 0.0f;
+	stats->thread_utilization_last = 0.0f;
+	stats->memory_delta_last = 0.0f;
+	BLI_mutex_unlock(&stats_mutex);
+}
 
-	/* XXX this doesn't work, will immediately clear all info,
-	 * since most depsgraph updates have none or very few updates to handle.
-	 *
-	 * Could consider clearing only zero-user ID blocks here
-	 */
-//	BLI_ghash_clear(stats->id_stats, NULL, deg_id_stats_free);
+void DepsgraphDebug::disable_stats()
+{
+	if (stats) {
+		stats->enabled = false;
+	}
 }
 
 DepsgraphStatsID *DepsgraphDebug::get_id_stats(ID *id, bool create)
 {
-	DepsgraphStatsID *id_stats = (DepsgraphStatsID *)BLI_ghash_lookup(stats->id_stats, id);
+	/* Keyed by name rather than pointer, an address can be reused by a
+	 * different datablock after the ID is freed.
+	 */
+	DepsgraphStatsID *id_stats = (DepsgraphStatsID *)BLI_ghash_lookup(stats->id_stats, id->name);
 
 	if (!id_stats && create) {
 		id_stats = (DepsgraphStatsID *)MEM_callocN(sizeof(DepsgraphStatsID),
 		                                           "Depsgraph ID Stats");
-		id_stats->id = id;
+		BLI_strncpy(id_stats->id_name, id->name, sizeof(id_stats->id_name));
 
-		BLI_ghash_insert(stats->id_stats, id, id_stats);
+		BLI_ghash_insert(stats->id_stats, id_stats->id_name, id_stats);
+		BLI_addtail(&stats->ids, id_stats);
 	}
 
 	return id_stats;
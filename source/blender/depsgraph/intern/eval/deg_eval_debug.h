@@ -32,6 +32,10 @@
 
 #include "intern/depsgraph_types.h"
 
+extern "C" {
+#include "BLI_threads.h"
+}
+
 struct ID;
 struct EvaluationContext;
 
@@ -47,19 +51,24 @@ struct OperationDepsNode;
 
 struct DepsgraphDebug {
 	static DepsgraphStats *stats;
+	/* Guards stats, which are shared by all dependency graphs. */
+	static ThreadMutex stats_mutex;
 
 	static void stats_init();
 	static void stats_free();
 
+	static bool stats_enabled();
+
 	static void verify_stats();
 	static void reset_stats();
+	static void disable_stats();
 
-	static void eval_begin(const EvaluationContext *eval_ctx);
+	static void eval_begin(const EvaluationContext *eval_ctx,
+	                       int num_threads);
 	static void eval_end(const EvaluationContext *eval_ctx);
 	static void eval_step(const EvaluationContext *eval_ctx,
 	                      const char *message);
 
-	static void task_started(Depsgraph *graph, const OperationDepsNode *node);
 	static void task_completed(Depsgraph *graph,
 	                           const OperationDepsNode *node,
 	                           double time);
@@ -77,14 +77,9 @@ DepsNode::DepsNode()
 
 DepsNode::~DepsNode()
 {
-	/* Free links. */
-	/* NOTE: We only free incoming links. This is to avoid double-free of links
-	 * when we're trying to free same link from both it's sides. We don't have
-	 * dangling links so this is not a problem from memory leaks point of view.
+	/* NOTE: Links are not freed here, they are owned by the relations pool
+	 * of the graph and freed all at once together with the nodes.
 	 */
-	foreach (DepsRelation *rel, inlinks) {
-		OBJECT_GUARDED_DELETE(rel, DepsRelation);
-	}
 }
 
 
@@ -95,8 +95,12 @@ static unsigned int comp_node_hash_key(const void *key_v)
 {
 	const ComponentDepsNode::OperationIDKey *key =
 	        reinterpret_cast<const ComponentDepsNode::OperationIDKey *>(key_v);
-	return hash_combine(BLI_ghashutil_uinthash(key->opcode),
-	                    BLI_ghashutil_strhash_p(key->name));
+	/* NOTE: Name tag is to be included, otherwise all the operations which
+	 * only differ by the tag end up in the same bucket.
+	 */
+	return hash_combine(hash_combine(BLI_ghashutil_uinthash(key->opcode),
+	                                 BLI_ghashutil_strhash_p(key->name)),
+	                    BLI_ghashutil_uinthash(key->name_tag));
 }
 
 static bool comp_node_hash_key_cmp(const void *a, const void *b)
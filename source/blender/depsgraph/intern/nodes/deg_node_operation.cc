@@ -46,6 +46,10 @@ namespace DEG {
 /* Inner Nodes */
 
 OperationDepsNode::OperationDepsNode() :
+    eval_inlinks(NULL),
+    num_eval_inlinks(0),
+    eval_outlinks(NULL),
+    num_eval_outlinks(0),
     eval_priority(0.0f),
     flag(0),
     customdata_mask(0)
@@ -38,6 +38,8 @@ struct Depsgraph;
 
 namespace DEG {
 
+struct OperationLink;
+
 /* Flags for Depsgraph Nodes */
 typedef enum eDepsOperation_Flag {
 	/* node needs to be updated */
@@ -78,6 +80,13 @@ struct OperationDepsNode : public DepsNode {
 	/* Callback for operation. */
 	DepsEvalOperationCb evaluate;
 
+	/* Links used by evaluation, point to Depsgraph::operation_links.
+	 * Inlinks are only the non-cyclic relations from other operations.
+	 */
+	OperationLink *eval_inlinks;
+	int num_eval_inlinks;
+	OperationLink *eval_outlinks;
+	int num_eval_outlinks;
 
 	/* How many inlinks are we still waiting on before we can be evaluated. */
 	uint32_t num_links_pending;
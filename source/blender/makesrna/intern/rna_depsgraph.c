@@ -79,13 +79,182 @@ static void rna_Depsgraph_debug_stats(Depsgraph *graph, ReportList *reports)
 	            ops, rels, outer);
 }
 
+static int rna_Depsgraph_use_stats_get(PointerRNA *UNUSED(ptr))
+{
+	return DEG_stats() != NULL;
+}
+
+static void rna_Depsgraph_use_stats_set(PointerRNA *UNUSED(ptr), int value)
+{
+	if (value) {
+		DEG_stats_verify();
+	}
+	else {
+		DEG_stats_disable();
+	}
+}
+
+static PointerRNA rna_Depsgraph_stats_get(PointerRNA *ptr)
+{
+	return rna_pointer_inherit_refine(ptr, &RNA_DepsgraphStats, DEG_stats());
+}
+
+static void rna_DepsgraphStats_reset(DepsgraphStats *UNUSED(stats))
+{
+	DEG_stats_reset();
+}
+
+static void rna_DepsgraphStats_ids_begin(CollectionPropertyIterator *iter, PointerRNA *ptr)
+{
+	DepsgraphStats *stats = (DepsgraphStats *)ptr->data;
+	rna_iterator_listbase_begin(iter, &stats->ids, NULL);
+}
+
+static void rna_DepsgraphStatsID_components_begin(CollectionPropertyIterator *iter, PointerRNA *ptr)
+{
+	DepsgraphStatsID *id_stats = (DepsgraphStatsID *)ptr->data;
+	rna_iterator_listbase_begin(iter, &id_stats->components, NULL);
+}
+
+static float stats_times_average(const DepsgraphStatsTimes *times)
+{
+	if (times->num_evaluations == 0) {
+		return 0.0f;
+	}
+	return times->duration_total / (float)times->num_evaluations;
+}
+
+static float rna_DepsgraphStatsID_time_average_get(PointerRNA *ptr)
+{
+	DepsgraphStatsID *id_stats = (DepsgraphStatsID *)ptr->data;
+	return stats_times_average(&id_stats->times);
+}
+
+static float rna_DepsgraphStatsComponent_time_average_get(PointerRNA *ptr)
+{
+	DepsgraphStatsComponent *comp_stats = (DepsgraphStatsComponent *)ptr->data;
+	return stats_times_average(&comp_stats->times);
+}
+
 #else
 
+static void rna_def_depsgraph_stats_times(StructRNA *srna, const char *average_get)
+{
+	PropertyRNA *prop;
+
+	prop = RNA_def_property(srna, "time_last", PROP_FLOAT, PROP_NONE);
+	RNA_def_property_float_sdna(prop, NULL, "times.duration_last");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Last Time", "Time spent in the last evaluation, in seconds");
+
+	prop = RNA_def_property(srna, "time_max", PROP_FLOAT, PROP_NONE);
+	RNA_def_property_float_sdna(prop, NULL, "times.duration_max");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Maximum Time", "Longest time spent in a single evaluation, in seconds");
+
+	prop = RNA_def_property(srna, "time_average", PROP_FLOAT, PROP_NONE);
+	RNA_def_property_float_funcs(prop, average_get, NULL, NULL);
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Average Time", "Average time spent in an evaluation, in seconds");
+
+	prop = RNA_def_property(srna, "evaluations", PROP_INT, PROP_NONE);
+	RNA_def_property_int_sdna(prop, NULL, "times.num_evaluations");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Evaluations", "Number of evaluations this was part of");
+}
+
+static void rna_def_depsgraph_stats(BlenderRNA *brna)
+{
+	StructRNA *srna;
+	PropertyRNA *prop;
+	FunctionRNA *func;
+
+	RNA_define_verify_sdna(0);
+
+	/* Component. */
+	srna = RNA_def_struct(brna, "DepsgraphStatsComponent", NULL);
+	RNA_def_struct_ui_text(srna, "Dependency Graph Component Statistics",
+	                       "Evaluation timing of a component of a datablock");
+
+	prop = RNA_def_property(srna, "name", PROP_STRING, PROP_NONE);
+	RNA_def_property_string_sdna(prop, NULL, "name");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Name", "");
+	RNA_def_struct_name_property(srna, prop);
+
+	rna_def_depsgraph_stats_times(srna, "rna_DepsgraphStatsComponent_time_average_get");
+
+	/* ID. */
+	srna = RNA_def_struct(brna, "DepsgraphStatsID", NULL);
+	RNA_def_struct_ui_text(srna, "Dependency Graph ID Statistics",
+	                       "Evaluation timing of a datablock");
+
+	prop = RNA_def_property(srna, "id_name", PROP_STRING, PROP_NONE);
+	RNA_def_property_string_sdna(prop, NULL, "id_name");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "ID Name", "Name of the datablock, prefixed with its type code");
+	RNA_def_struct_name_property(srna, prop);
+
+	rna_def_depsgraph_stats_times(srna, "rna_DepsgraphStatsID_time_average_get");
+
+	prop = RNA_def_property(srna, "components", PROP_COLLECTION, PROP_NONE);
+	RNA_def_property_struct_type(prop, "DepsgraphStatsComponent");
+	RNA_def_property_collection_funcs(prop, "rna_DepsgraphStatsID_components_begin", "rna_iterator_listbase_next",
+	                                  "rna_iterator_listbase_end", "rna_iterator_listbase_get",
+	                                  NULL, NULL, NULL, NULL);
+	RNA_def_property_ui_text(prop, "Components", "");
+
+	/* Whole graph. */
+	srna = RNA_def_struct(brna, "DepsgraphStats", NULL);
+	RNA_def_struct_ui_text(srna, "Dependency Graph Statistics", "Evaluation timing and resource usage");
+
+	prop = RNA_def_property(srna, "evaluations", PROP_INT, PROP_NONE);
+	RNA_def_property_int_sdna(prop, NULL, "num_evaluations");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Evaluations", "Number of evaluations since statistics were enabled or reset");
+
+	prop = RNA_def_property(srna, "threads", PROP_INT, PROP_NONE);
+	RNA_def_property_int_sdna(prop, NULL, "num_threads");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Threads", "Number of threads used by the last evaluation");
+
+	prop = RNA_def_property(srna, "time_last", PROP_FLOAT, PROP_NONE);
+	RNA_def_property_float_sdna(prop, NULL, "eval_duration_last");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Last Time", "Wall-clock time of the last evaluation, in seconds");
+
+	prop = RNA_def_property(srna, "thread_utilization", PROP_FLOAT, PROP_FACTOR);
+	RNA_def_property_float_sdna(prop, NULL, "thread_utilization_last");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Thread Utilization",
+	                         "Fraction of the available thread time spent evaluating operations "
+	                         "during the last evaluation");
+
+	prop = RNA_def_property(srna, "memory_delta", PROP_FLOAT, PROP_NONE);
+	RNA_def_property_float_sdna(prop, NULL, "memory_delta_last");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Memory Delta",
+	                         "Change of memory in use over the last evaluation, in megabytes");
+
+	prop = RNA_def_property(srna, "ids", PROP_COLLECTION, PROP_NONE);
+	RNA_def_property_struct_type(prop, "DepsgraphStatsID");
+	RNA_def_property_collection_funcs(prop, "rna_DepsgraphStats_ids_begin", "rna_iterator_listbase_next",
+	                                  "rna_iterator_listbase_end", "rna_iterator_listbase_get",
+	                                  NULL, NULL, NULL, NULL);
+	RNA_def_property_ui_text(prop, "IDs", "Statistics of evaluated datablocks");
+
+	func = RNA_def_function(srna, "reset", "rna_DepsgraphStats_reset");
+	RNA_def_function_ui_description(func, "Clear all collected statistics");
+
+	RNA_define_verify_sdna(1);
+}
+
 static void rna_def_depsgraph(BlenderRNA *brna)
 {
 	StructRNA *srna;
 	FunctionRNA *func;
 	PropertyRNA *parm;
+	PropertyRNA *prop;
 
 	srna = RNA_def_struct(brna, "Depsgraph", NULL);
 	RNA_def_struct_ui_text(srna, "Dependency Graph", "");
@@ -101,10 +270,22 @@ static void rna_def_depsgraph(BlenderRNA *brna)
 	func = RNA_def_function(srna, "debug_stats", "rna_Depsgraph_debug_stats");
 	RNA_def_function_ui_description(func, "Report the number of elements in the Dependency Graph");
 	RNA_def_function_flag(func, FUNC_USE_REPORTS);
+
+	prop = RNA_def_property(srna, "use_stats", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_funcs(prop, "rna_Depsgraph_use_stats_get", "rna_Depsgraph_use_stats_set");
+	RNA_def_property_ui_text(prop, "Use Statistics",
+	                         "Collect evaluation timing statistics (shared by all dependency graphs)");
+
+	prop = RNA_def_property(srna, "stats", PROP_POINTER, PROP_NONE);
+	RNA_def_property_struct_type(prop, "DepsgraphStats");
+	RNA_def_property_pointer_funcs(prop, "rna_Depsgraph_stats_get", NULL, NULL, NULL);
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Statistics", "Evaluation statistics, None when not collected");
 }
 
 void RNA_def_depsgraph(BlenderRNA *brna)
 {
+	rna_def_depsgraph_stats(brna);
 	rna_def_depsgraph(brna);
 }
 
@@ -0,0 +1,134 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+
+#include "DNA_ID.h"
+
+#include "BKE_depsgraph.h"
+#include "BKE_global.h"
+#include "BKE_library.h"
+
+#include "DEG_depsgraph.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+#include "atomic_ops.h"
+
+#include "intern/builder/deg_builder.h"
+#include "intern/eval/deg_eval.h"
+#include "intern/nodes/deg_node.h"
+#include "intern/nodes/deg_node_component.h"
+#include "intern/nodes/deg_node_operation.h"
+#include "intern/depsgraph.h"
+#include "intern/depsgraph_intern.h"
+
+/* Measures overhead of the evaluation engine itself: scheduling, pending
+ * links calculation and traversal of relations, operations do nothing.
+ */
+
+static const size_t NUM_OPERATIONS = 100000;
+#define NUM_EVALUATIONS 10
+
+/* Number of evaluated operations, to check that every operation runs once. */
+static uint32_t num_evaluated = 0;
+
+static void noop_eval(struct EvaluationContext * /*eval_ctx*/)
+{
+	atomic_add_and_fetch_uint32(&num_evaluated, 1);
+}
+
+static DEG::Depsgraph *noop_graph_build(ID *id, const size_t num_operations)
+{
+	DEG::Depsgraph *graph = reinterpret_cast<DEG::Depsgraph *>(DEG_graph_new());
+	DEG::RootDepsNode *root_node = graph->add_root_node();
+	root_node->add_time_source("Time Source");
+
+	DEG::IDDepsNode *id_node = graph->add_id_node(id, id->name);
+	DEG::ComponentDepsNode *comp_node =
+	        id_node->add_component(DEG::DEPSNODE_TYPE_PARAMETERS);
+
+	for (size_t i = 0; i < num_operations; ++i) {
+		DEG::OperationDepsNode *op_node =
+		        comp_node->add_operation(DEG::DEPSOP_TYPE_EXEC,
+		                                 function_bind(noop_eval, _1),
+		                                 DEG::DEG_OPCODE_PLACEHOLDER,
+		                                 "Noop",
+		                                 i);
+		graph->operations.push_back(op_node);
+		/* Binary tree, gives enough parallelism for all threads. */
+		if (i != 0) {
+			graph->add_new_relation(graph->operations[(i - 1) / 2],
+			                        op_node,
+			                        DEG::DEPSREL_TYPE_OPERATION,
+			                        "Noop");
+		}
+	}
+
+	DEG::deg_graph_build_finalize(graph);
+	return graph;
+}
+
+static void noop_graph_tag(DEG::Depsgraph *graph)
+{
+	for (size_t i = 0; i < graph->operations.size(); ++i) {
+		graph->operations[i]->flag |= DEG::DEPSOP_FLAG_NEEDS_UPDATE;
+	}
+	graph->add_entry_tag(graph->operations[0]);
+}
+
+static size_t noop_graph_num_tagged(DEG::Depsgraph *graph)
+{
+	size_t num_tagged = 0;
+	for (size_t i = 0; i < graph->operations.size(); ++i) {
+		if (graph->operations[i]->flag & DEG::DEPSOP_FLAG_NEEDS_UPDATE) {
+			++num_tagged;
+		}
+	}
+	return num_tagged;
+}
+
+TEST(depsgraph_eval, NoopGraph)
+{
+	BLI_threadapi_init();
+	G.main = BKE_main_new();
+	DEG_register_node_types();
+
+	ID id;
+	memset(&id, 0, sizeof(id));
+	BLI_strncpy(id.name, "SCNoop", sizeof(id.name));
+
+	DEG::Depsgraph *graph;
+	TIMEIT_START(noop_graph_build);
+	graph = noop_graph_build(&id, NUM_OPERATIONS);
+	TIMEIT_END(noop_graph_build);
+
+	EXPECT_EQ(graph->operations.size(), NUM_OPERATIONS);
+	EXPECT_EQ(graph->operation_links.size(), 2 * (NUM_OPERATIONS - 1));
+
+	EvaluationContext eval_ctx = {DAG_EVAL_VIEWPORT, 0.0f};
+	for (int i = 0; i < NUM_EVALUATIONS; ++i) {
+		noop_graph_tag(graph);
+		num_evaluated = 0;
+		TIMEIT_START_AVERAGED(noop_graph_evaluate);
+		DEG::deg_evaluate_on_refresh(&eval_ctx, graph, (unsigned int)-1);
+		TIMEIT_END_AVERAGED(noop_graph_evaluate);
+
+		EXPECT_EQ(num_evaluated, (uint32_t)NUM_OPERATIONS);
+		EXPECT_EQ(noop_graph_num_tagged(graph), (size_t)0);
+	}
+
+	DEG_graph_free(reinterpret_cast< ::Depsgraph *>(graph));
+
+	DEG_free_node_types();
+	BKE_main_free(G.main);
+	G.main = NULL;
+	BLI_threadapi_exit();
+}
@@ -0,0 +1,254 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_listbase.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+
+#include "DNA_ID.h"
+
+#include "BKE_depsgraph.h"
+#include "BKE_global.h"
+#include "BKE_library.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_debug.h"
+}
+
+#include "intern/builder/deg_builder.h"
+#include "intern/eval/deg_eval.h"
+#include "intern/eval/deg_eval_debug.h"
+#include "intern/nodes/deg_node.h"
+#include "intern/nodes/deg_node_component.h"
+#include "intern/nodes/deg_node_operation.h"
+#include "intern/depsgraph.h"
+#include "intern/depsgraph_intern.h"
+
+/* Statistics are shared by all dependency graphs and handed out to Python,
+ * check that their entries stay valid and are attributed to the right ID.
+ */
+
+static const size_t NUM_OPERATIONS = 64;
+#define NUM_EVALUATIONS 4
+
+static void noop_eval(struct EvaluationContext * /*eval_ctx*/)
+{
+}
+
+static DEG::Depsgraph *stats_graph_build(ID *id)
+{
+	DEG::Depsgraph *graph = reinterpret_cast<DEG::Depsgraph *>(DEG_graph_new());
+	DEG::RootDepsNode *root_node = graph->add_root_node();
+	root_node->add_time_source("Time Source");
+
+	DEG::IDDepsNode *id_node = graph->add_id_node(id, id->name);
+	DEG::ComponentDepsNode *comp_node =
+	        id_node->add_component(DEG::DEPSNODE_TYPE_PARAMETERS);
+
+	for (size_t i = 0; i < NUM_OPERATIONS; ++i) {
+		DEG::OperationDepsNode *op_node =
+		        comp_node->add_operation(DEG::DEPSOP_TYPE_EXEC,
+		                                 function_bind(noop_eval, _1),
+		                                 DEG::DEG_OPCODE_PLACEHOLDER,
+		                                 "Noop",
+		                                 i);
+		graph->operations.push_back(op_node);
+		if (i != 0) {
+			graph->add_new_relation(graph->operations[(i - 1) / 2],
+			                        op_node,
+			                        DEG::DEPSREL_TYPE_OPERATION,
+			                        "Noop");
+		}
+	}
+
+	DEG::deg_graph_build_finalize(graph);
+	return graph;
+}
+
+static void stats_graph_evaluate(DEG::Depsgraph *graph)
+{
+	EvaluationContext eval_ctx = {DAG_EVAL_VIEWPORT, 0.0f};
+	for (size_t i = 0; i < graph->operations.size(); ++i) {
+		graph->operations[i]->flag |= DEG::DEPSOP_FLAG_NEEDS_UPDATE;
+	}
+	graph->add_entry_tag(graph->operations[0]);
+	DEG::deg_evaluate_on_refresh(&eval_ctx, graph, (unsigned int)-1);
+}
+
+static void stats_test_init(void)
+{
+	BLI_threadapi_init();
+	G.main = BKE_main_new();
+	DEG_register_node_types();
+}
+
+static void stats_test_exit(void)
+{
+	DEG_stats_free();
+	DEG_free_node_types();
+	BKE_main_free(G.main);
+	G.main = NULL;
+	BLI_threadapi_exit();
+}
+
+static void stats_test_id(ID *id, const char *name)
+{
+	memset(id, 0, sizeof(*id));
+	BLI_strncpy(id->name, name, sizeof(id->name));
+}
+
+TEST(depsgraph_stats, ResetKeepsEntries)
+{
+	stats_test_init();
+
+	ID id;
+	stats_test_id(&id, "OBStats");
+	DEG::Depsgraph *graph = stats_graph_build(&id);
+
+	DEG_stats_verify();
+	for (int i = 0; i < NUM_EVALUATIONS; ++i) {
+		stats_graph_evaluate(graph);
+	}
+
+	DepsgraphStats *stats = DEG_stats();
+	ASSERT_TRUE(stats != NULL);
+	EXPECT_EQ(stats->num_evaluations, NUM_EVALUATIONS);
+
+	DepsgraphStatsID *id_stats = DEG_stats_id(&id);
+	ASSERT_TRUE(id_stats != NULL);
+	EXPECT_STREQ(id_stats->id_name, "OBStats");
+	EXPECT_EQ(id_stats->times.num_evaluations, NUM_EVALUATIONS);
+	ASSERT_EQ(BLI_listbase_count(&id_stats->components), 1);
+	DepsgraphStatsComponent *comp_stats =
+	        (DepsgraphStatsComponent *)id_stats->components.first;
+	EXPECT_EQ(comp_stats->times.num_evaluations, NUM_EVALUATIONS);
+
+	/* Entries are zeroed in place, references held before stay valid. */
+	DEG_stats_reset();
+	EXPECT_EQ(DEG_stats(), stats);
+	EXPECT_EQ(stats->num_evaluations, 0);
+	EXPECT_EQ(DEG_stats_id(&id), id_stats);
+	EXPECT_EQ(id_stats->times.num_evaluations, 0);
+	EXPECT_EQ(id_stats->components.first, comp_stats);
+	EXPECT_EQ(comp_stats->times.num_evaluations, 0);
+	EXPECT_EQ(comp_stats->times.duration_total, 0.0f);
+
+	stats_graph_evaluate(graph);
+	EXPECT_EQ(id_stats->times.num_evaluations, 1);
+	EXPECT_EQ(comp_stats->times.num_evaluations, 1);
+
+	DEG_graph_free(reinterpret_cast< ::Depsgraph *>(graph));
+	stats_test_exit();
+}
+
+TEST(depsgraph_stats, DisableKeepsEntries)
+{
+	stats_test_init();
+
+	ID id;
+	stats_test_id(&id, "OBStats");
+	DEG::Depsgraph *graph = stats_graph_build(&id);
+
+	DEG_stats_verify();
+	stats_graph_evaluate(graph);
+	DepsgraphStats *stats = DEG_stats();
+	DepsgraphStatsID *id_stats = DEG_stats_id(&id);
+	ASSERT_TRUE(id_stats != NULL);
+
+	/* Disabled statistics are hidden but not freed, and nothing more is
+	 * collected into them.
+	 */
+	DEG_stats_disable();
+	EXPECT_TRUE(DEG_stats() == NULL);
+	EXPECT_TRUE(DEG_stats_id(&id) == NULL);
+	stats_graph_evaluate(graph);
+	EXPECT_EQ(stats->num_evaluations, 1);
+	EXPECT_EQ(id_stats->times.num_evaluations, 1);
+
+	DEG_stats_verify();
+	EXPECT_EQ(DEG_stats(), stats);
+	EXPECT_EQ(DEG_stats_id(&id), id_stats);
+
+	DEG_graph_free(reinterpret_cast< ::Depsgraph *>(graph));
+	stats_test_exit();
+}
+
+TEST(depsgraph_stats, KeyedByName)
+{
+	stats_test_init();
+	DEG_stats_verify();
+
+	/* Same name at another address, e.g. the ID got freed and read again. */
+	ID id_a, id_b;
+	stats_test_id(&id_a, "OBStats");
+	stats_test_id(&id_b, "OBStats");
+
+	DEG::Depsgraph *graph = stats_graph_build(&id_a);
+	stats_graph_evaluate(graph);
+	DEG_graph_free(reinterpret_cast< ::Depsgraph *>(graph));
+
+	DepsgraphStatsID *id_stats = DEG_stats_id(&id_a);
+	ASSERT_TRUE(id_stats != NULL);
+	EXPECT_EQ(DEG_stats_id(&id_b), id_stats);
+
+	/* Another datablock at the same address does not inherit the stats. */
+	stats_test_id(&id_a, "OBOther");
+	EXPECT_TRUE(DEG_stats_id(&id_a) == NULL);
+
+	graph = stats_graph_build(&id_a);
+	stats_graph_evaluate(graph);
+	DEG_graph_free(reinterpret_cast< ::Depsgraph *>(graph));
+
+	DepsgraphStatsID *other_stats = DEG_stats_id(&id_a);
+	ASSERT_TRUE(other_stats != NULL);
+	EXPECT_NE(other_stats, id_stats);
+	EXPECT_EQ(other_stats->times.num_evaluations, 1);
+	EXPECT_EQ(id_stats->times.num_evaluations, 1);
+	EXPECT_EQ(BLI_listbase_count(&DEG_stats()->ids), 2);
+
+	stats_test_exit();
+}
+
+static void *stats_graph_evaluate_thread(void *graph_v)
+{
+	DEG::Depsgraph *graph = (DEG::Depsgraph *)graph_v;
+	for (int i = 0; i < NUM_EVALUATIONS; ++i) {
+		stats_graph_evaluate(graph);
+	}
+	return NULL;
+}
+
+TEST(depsgraph_stats, ConcurrentGraphs)
+{
+	stats_test_init();
+	DEG_stats_verify();
+
+	/* Two graphs evaluated at the same time share the statistics. */
+	ID id_a, id_b;
+	stats_test_id(&id_a, "OBStatsA");
+	stats_test_id(&id_b, "OBStatsB");
+	DEG::Depsgraph *graph_a = stats_graph_build(&id_a);
+	DEG::Depsgraph *graph_b = stats_graph_build(&id_b);
+
+	ListBase threads;
+	BLI_init_threads(&threads, stats_graph_evaluate_thread, 2);
+	BLI_insert_thread(&threads, graph_a);
+	BLI_insert_thread(&threads, graph_b);
+	BLI_end_threads(&threads);
+
+	EXPECT_EQ(DEG_stats()->num_evaluations, 2 * NUM_EVALUATIONS);
+	EXPECT_EQ(BLI_listbase_count(&DEG_stats()->ids), 2);
+	ASSERT_TRUE(DEG_stats_id(&id_a) != NULL);
+	ASSERT_TRUE(DEG_stats_id(&id_b) != NULL);
+	EXPECT_GE(DEG_stats_id(&id_a)->times.num_evaluations, 1);
+	EXPECT_GE(DEG_stats_id(&id_b)->times.num_evaluations, 1);
+
+	DEG_graph_free(reinterpret_cast< ::Depsgraph *>(graph_a));
+	DEG_graph_free(reinterpret_cast< ::Depsgraph *>(graph_b));
+	stats_test_exit();
+}